@@ -3,6 +3,11 @@
 #include <vcl.h>
 #pragma hdrstop
 #include <tchar.h>
+#include <iostream>
+#include "ExpertManagerBenchmark.h"
+#include "ExpertManagerHeadless.h"
+#include "ExpertManagerRegFile.h"
+#include "ExpertManagerTrace.h"
 
 #ifdef DEBUG
   #pragma comment(lib,"CodeSiteLoggingPkg.lib")
@@ -14,15 +19,160 @@ USEFORM("Source\ExpertManagerProgressForm.cpp", frmProgress);
 USEFORM("Source\ExpertMgrMainForm.cpp", frmExpertManager);
 USEFORM("Source\ExpertEditorForm.cpp", frmExpertEditor);
 //---------------------------------------------------------------------------
+/**
+
+  This method makes sure that the standard output of this (GUI) application goes somewhere. If the
+  output has been redirected (e.g. to a file or pipe) it is used as is else the parent's console is
+  attached (or a new one allocated).
+
+  @precon  None.
+  @postcon stdout is connected to a file, pipe or console.
+
+**/
+static void AttachStdOut()
+{
+  HANDLE hOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+  if (hOutput != NULL && hOutput != INVALID_HANDLE_VALUE && GetFileType(hOutput) != FILE_TYPE_UNKNOWN)
+    return;
+  if (AttachConsole(ATTACH_PARENT_PROCESS) || AllocConsole())
+    _wfreopen(L"CONOUT$", L"w", stdout);
+}
+//---------------------------------------------------------------------------
+/**
+
+  This method updates the given integer with the value of the named command line switch (e.g.
+  -installations:100) if it is present and valid.
+
+  @precon  None.
+  @postcon iValue is updated if the switch is present and valid.
+
+  @param   strSwitch as a String as a constant reference
+  @param   iValue    as an int as a reference
+
+**/
+static void ReadIntSwitch(const String& strSwitch, int& iValue)
+{
+  String strValue;
+  if (FindCmdLineSwitch(strSwitch, strValue) && !strValue.IsEmpty())
+    iValue = StrToIntDef(strValue, iValue);
+}
+//---------------------------------------------------------------------------
+/**
+
+  This method updates the given fraction with the value of the named command line switch given as
+  a percentage (e.g. -invalid:10) if it is present and valid.
+
+  @precon  None.
+  @postcon dblValue is updated if the switch is present and valid.
+
+  @param   strSwitch as a String as a constant reference
+  @param   dblValue  as a double as a reference
+
+**/
+static void ReadFractionSwitch(const String& strSwitch, double& dblValue)
+{
+  String strValue;
+  if (FindCmdLineSwitch(strSwitch, strValue) && !strValue.IsEmpty())
+    dblValue = StrToFloatDef(strValue, dblValue * 100) / 100;
+}
+//---------------------------------------------------------------------------
+/**
+
+  This method writes the recorded trace spans to the given file if one was requested with the
+  trace switch.
+
+  @precon  None.
+  @postcon The trace is written if a file was given.
+
+  @param   strTraceFile as a String as a constant reference
+
+**/
+static void SaveTrace(const String& strTraceFile)
+{
+  if (!strTraceFile.IsEmpty() && !TEMTrace::SaveToFile(strTraceFile.c_str()))
+    std::cerr << "The trace could not be written." << std::endl;
+}
+//---------------------------------------------------------------------------
+/**
+
+  This method scans the installations in the given registry store and writes JSON records to the
+  standard output: the entries which reference the given file if one was given with the used-by
+  switch else the validation of every installation and its entries.
+
+  @precon  None.
+  @postcon The records are written and the exit code is returned (1 if the file is not referenced
+           or any installation is not valid else 0).
+
+  @param   RegistryStore as a TEMRegistryStore as a reference
+  @param   FileSystem    as a TEMFileSystem as a reference
+  @param   strUsedBy     as a String as a constant reference
+  @return  an int
+
+**/
+static int HeadlessScan(TEMRegistryStore& RegistryStore, TEMFileSystem& FileSystem,
+  const String& strUsedBy)
+{
+  if (!strUsedBy.IsEmpty())
+    return EMHeadlessUsedBy(RegistryStore, FileSystem, strUsedBy.c_str(), std::cout) > 0 ? 0 : 1;
+  return EMHeadlessScan(RegistryStore, FileSystem, std::cout) > evOkay ? 1 : 0;
+}
+//---------------------------------------------------------------------------
 int WINAPI _tWinMain(HINSTANCE, HINSTANCE, LPTSTR, int)
 {
+  String strTraceFile;
+  String strUsedBy;
   try
   {
+     if (FindCmdLineSwitch("trace", strTraceFile) || FindCmdLineSwitch("-trace", strTraceFile))
+       TEMTrace::Enable(true);
+     bool boolUsedBy = FindCmdLineSwitch("used-by", strUsedBy) ||
+       FindCmdLineSwitch("-used-by", strUsedBy);
+     if (boolUsedBy || FindCmdLineSwitch("scan") || FindCmdLineSwitch("-scan"))
+     {
+       AttachStdOut();
+       TEMCachedFileSystem FileSystem(new TEMNativeFileSystem());
+       String strRegFile;
+       int iExitCode;
+       if (FindCmdLineSwitch("reg", strRegFile) || FindCmdLineSwitch("-reg", strRegFile))
+       {
+         TEMRegFileRegistryStore RegistryStore(TEMRegistrySnapshot::InstallationFilter);
+         if (!RegistryStore.LoadFromFile(strRegFile.c_str()))
+         {
+           std::cerr << "The registry export could not be read." << std::endl;
+           return 2;
+         }
+         iExitCode = HeadlessScan(RegistryStore, FileSystem, strUsedBy);
+       } else
+       {
+         TEMWinRegistryStore RegistryStore;
+         iExitCode = HeadlessScan(RegistryStore, FileSystem, strUsedBy);
+       }
+       SaveTrace(strTraceFile);
+       return iExitCode;
+     }
+     if (FindCmdLineSwitch("benchmark"))
+     {
+       AttachStdOut();
+       EMWriteMacroBenchmark(std::wcout, EMBenchmarkMacroExpansion(100000));
+       TEMSyntheticOptions Options;
+       ReadIntSwitch("installations", Options.iInstallations);
+       ReadIntSwitch("experts", Options.iExperts);
+       ReadIntSwitch("packages", Options.iPackages);
+       ReadFractionSwitch("invalid", Options.dblInvalid);
+       ReadFractionSwitch("duplicates", Options.dblDuplicates);
+       ReadFractionSwitch("macros", Options.dblMacros);
+       int iIterations = 10;
+       ReadIntSwitch("iterations", iIterations);
+       EMWriteScanBenchmark(std::wcout, EMBenchmarkScan(Options, iIterations > 0 ? iIterations : 1));
+       SaveTrace(strTraceFile);
+       return 0;
+     }
      Application->Initialize();
      Application->MainFormOnTaskBar = true;
      Application->Title = "Expert and Package Manager for Multiple RAD Studio Installations";
      Application->CreateForm(__classid(TfrmExpertManager), &frmExpertManager);
      Application->Run();
+     SaveTrace(strTraceFile);
   }
   catch (Exception &exception)
   {
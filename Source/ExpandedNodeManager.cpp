@@ -2,8 +2,11 @@
 
 #include "ExpandedNodeManager.h"
 #include <Registry.hpp>
+#include <System.IOUtils.hpp>
+#include <memory>
 #include <ExpertManagerGlobals.h>
 #include "ExpertManagerTypes.h"
+#include "ExpertManagerStrings.h"
 
 #pragma package(smart_init)
 
@@ -12,12 +15,10 @@
   This is a constructor for the expanded node manager class.
 
   @precon  None.
-  @postcon Creates memeory for an internal strings to store the node paths and then
-           loads the saved paths.
+  @postcon Loads the saved paths.
 
 **/
-TExpandedNodeManager::TExpandedNodeManager() {
-  FExpandedNodes = std::unique_ptr<TStringList>( new TStringList() );
+TExpandedNodeManager::TExpandedNodeManager() : FModified(false), FMigrated(false) {
   LoadSettings();
 }
 
@@ -26,8 +27,7 @@ TExpandedNodeManager::TExpandedNodeManager() {
   This is a destructor for the expaned node manager class.
 
   @precon  None.
-  @postcon Saves the paths in the string list and then frees the memory used by the string
-           list.
+  @postcon Saves the paths if they have changed.
 
 **/
 TExpandedNodeManager::~TExpandedNodeManager() {
@@ -36,32 +36,71 @@ TExpandedNodeManager::~TExpandedNodeManager() {
 
 /**
 
-  This method loads the expanded nodes from the registry.
+  This method returns the name of the file in the user's application data folder in which the
+  expanded nodes are stored.
 
   @precon  None.
-  @postcon The expanded nodes in the registry are loaded into the internal string list.
+  @postcon Returns the expanded nodes file name.
+
+  @return  a String
+
+**/
+String __fastcall TExpandedNodeManager::FileName() {
+  return TPath::Combine(TPath::GetHomePath(), strExpandedNodesFile);
+}
+
+/**
+
+  This method loads the expanded nodes from the expanded nodes file (one path per line). If there
+  is no file the nodes are read from the registry section used by earlier versions and are written
+  to the file on exit.
+
+  @precon  None.
+  @postcon The expanded nodes are loaded into the internal hash set.
 
 **/
 void __fastcall TExpandedNodeManager::LoadSettings() {
-  std::unique_ptr<TRegistryINIFileCls> iniFile( new TRegistryINIFileCls(strRegSettings) );
   std::unique_ptr<TStringList> sl( new TStringList() );
-  iniFile->ReadSection("ExpandedNodes", sl.get());
-  FExpandedNodes->Assign(sl.get());
+  if (FileExists(FileName()))
+    sl->LoadFromFile(FileName(), TEncoding::UTF8);
+  else {
+    std::unique_ptr<TRegistryINIFileCls> iniFile( new TRegistryINIFileCls(strRegSettings) );
+    iniFile->ReadSection("ExpandedNodes", sl.get());
+    FMigrated = sl->Count > 0;
+    FModified = FMigrated;
+  }
+  FExpandedNodes.reserve(sl->Count);
+  for (int i = 0; i < sl->Count; i++)
+    if (sl->Strings[i].Length() != 0)
+      FExpandedNodes.insert(EMFoldCase(sl->Strings[i].c_str()));
 }
 
 /**
 
-  This method saves the expanded nodes to the registry.
+  This method saves the expanded nodes to the expanded nodes file if they have changed. The file
+  is written to a temporary file which then replaces the old file so that it is never left half
+  written.
 
   @precon  None.
-  @postcon The expanded nodes in the internal string list are saved to the registry.
+  @postcon The expanded nodes in the internal hash set are saved to the file.
 
 **/
 void __fastcall TExpandedNodeManager::SaveSettings() {
-  std::unique_ptr<TRegistryINIFileCls> iniFile( new TRegistryINIFileCls(strRegSettings) );
-  iniFile->EraseSection("ExpandedNodes");
-  for (int i = 0; i < FExpandedNodes->Count; i++) {
-    iniFile->WriteString("ExpandedNodes", FExpandedNodes->Strings[i], "");
+  if (!FModified || !ForceDirectories(ExtractFilePath(FileName())))
+    return;
+  std::unique_ptr<TStringList> sl( new TStringList() );
+  for (auto strPath : FExpandedNodes)
+    sl->Add(strPath.c_str());
+  sl->Sort();
+  String strTempFileName = FileName() + ".tmp";
+  sl->SaveToFile(strTempFileName, TEncoding::UTF8);
+  if (!MoveFileEx(strTempFileName.c_str(), FileName().c_str(), MOVEFILE_REPLACE_EXISTING))
+    return;
+  FModified = false;
+  if (FMigrated) {
+    std::unique_ptr<TRegistryINIFileCls> iniFile( new TRegistryINIFileCls(strRegSettings) );
+    iniFile->EraseSection("ExpandedNodes");
+    FMigrated = false;
   }
 }
 
@@ -70,15 +109,28 @@ void __fastcall TExpandedNodeManager::SaveSettings() {
   This method adds the path to the passed node to the list of expanded nodes.
 
   @precon  Node must be a valid instance.
-  @postcon The path to the passed node is added to the string list.
+  @postcon The path to the passed node is added to the hash set.
 
   @param   Node as a TTreeNode
 
 **/
 void __fastcall TExpandedNodeManager::AddNode(TTreeNode* Node) {
-  String strPath = ConvertNodeToPath(Node);
-  if (strPath.Length() != 0)
-    FExpandedNodes->Add(strPath);
+  AddNode(ConvertNodeToPath(Node));
+}
+
+/**
+
+  This method adds the given node path to the list of expanded nodes.
+
+  @precon  None.
+  @postcon The path is added to the hash set.
+
+  @param   strPath as a String as a constant reference
+
+**/
+void __fastcall TExpandedNodeManager::AddNode(const String& strPath) {
+  if (strPath.Length() != 0 && FExpandedNodes.insert(EMFoldCase(strPath.c_str())).second)
+    FModified = true;
 }
 
 /**
@@ -86,18 +138,28 @@ void __fastcall TExpandedNodeManager::AddNode(TTreeNode* Node) {
   This method moves the path to the passed node from the list of expanded nodes.
 
   @precon  Node must be a valid instance.
-  @postcon The path to the passed node is removed from the string list.
+  @postcon The path to the passed node is removed from the hash set.
 
   @param   Node as a TTreeNode
 
 **/
 void __fastcall TExpandedNodeManager::RemoveNode(TTreeNode* Node) {
-  String strPath = ConvertNodeToPath(Node);
-  if (strPath.Length() != 0) {
-    int iIndex = FExpandedNodes->IndexOf(strPath);
-    if (iIndex != -1)
-      FExpandedNodes->Delete(iIndex);
-  }
+  RemoveNode(ConvertNodeToPath(Node));
+}
+
+/**
+
+  This method removes the given node path from the list of expanded nodes.
+
+  @precon  None.
+  @postcon The path is removed from the hash set.
+
+  @param   strPath as a String as a constant reference
+
+**/
+void __fastcall TExpandedNodeManager::RemoveNode(const String& strPath) {
+  if (strPath.Length() != 0 && FExpandedNodes.erase(EMFoldCase(strPath.c_str())) > 0)
+    FModified = true;
 }
 
 /**
@@ -106,24 +168,74 @@ void __fastcall TExpandedNodeManager::RemoveNode(TTreeNode* Node) {
 
   @precon  Node must be a valid instance.
   @postcon A path is returned by transering the nodes parent back to the root and converts
-           this into a string representation.
+           this into a string representation. The names are collected first and joined once.
 
   @paramm  Node as a TTreeNode
   @return  a String
 
 **/
 String __fastcall TExpandedNodeManager::ConvertNodeToPath(TTreeNode* Node) {
-  if (Node != NULL) {
-    String strPath = "";
-    while (Node != NULL) {
-      if (strPath.Length() != 0)
-        strPath = "\\" + strPath;
-      strPath = Node->Text + strPath;
-      Node = Node->Parent;
-    }
-    return strPath;
-  } else
-    return "";
+  std::vector<TTreeNode*> Nodes;
+  int iLength = 0;
+  for (; Node != NULL; Node = Node->Parent) {
+    Nodes.push_back(Node);
+    iLength += Node->Text.Length() + 1;
+  }
+  std::wstring strPath;
+  strPath.reserve(iLength);
+  for (size_t i = Nodes.size(); i > 0; i--) {
+    if (strPath.length() != 0)
+      strPath += L'\\';
+    strPath += Nodes[i - 1]->Text.c_str();
+  }
+  return strPath.c_str();
+}
+
+/**
+
+  This method returns the path of the given node from the path of its parent so that a walk of
+  the tree builds each node's path once.
+
+  @precon  Node must be a valid instance.
+  @postcon Returns the path of the node.
+
+  @param   strParentPath as a String as a constant reference
+  @param   Node          as a TTreeNode
+  @return  a String
+
+**/
+String __fastcall TExpandedNodeManager::ChildPath(const String& strParentPath, TTreeNode* Node) {
+  if (strParentPath.Length() == 0)
+    return Node->Text;
+  return strParentPath + "\\" + Node->Text;
+}
+
+/**
+
+  This method returns the node with the given path by descending the tree a name at a time.
+
+  @precon  Nodes must be a valid instance.
+  @postcon Returns the node or NULL if there is no node with the path.
+
+  @param   Nodes   as a TTreeNodes
+  @param   strPath as a String as a constant reference
+  @return  a TTreeNode
+
+**/
+TTreeNode* __fastcall TExpandedNodeManager::FindNode(TTreeNodes* Nodes, const String& strPath) {
+  TEMNameList Names;
+  EMSplitPath(strPath.c_str(), Names);
+  TTreeNode* Node = NULL;
+  TTreeNode* N = Nodes->GetFirstNode();
+  for (size_t i = 0; i < Names.size(); i++) {
+    while (N != NULL && Names[i].compare(N->Text.c_str()) != 0)
+      N = N->getNextSibling();
+    if (N == NULL)
+      return NULL;
+    Node = N;
+    N = Node->getFirstChild();
+  }
+  return Node;
 }
 
 /**
@@ -140,6 +252,20 @@ String __fastcall TExpandedNodeManager::ConvertNodeToPath(TTreeNode* Node) {
 
 **/
 bool __fastcall TExpandedNodeManager::IsExpanded(TTreeNode* Node) {
-  String strPath = ConvertNodeToPath(Node);
-  return FExpandedNodes->IndexOf(strPath) != -1;
+  return IsExpanded(ConvertNodeToPath(Node));
+}
+
+/**
+
+  This method determines whether the given node path is in the list of expanded nodes.
+
+  @precon  None.
+  @postcon True is returned if the path is in the hash set else returns false.
+
+  @param   strPath as a String as a constant reference
+  @return  a bool
+
+**/
+bool __fastcall TExpandedNodeManager::IsExpanded(const String& strPath) {
+  return FExpandedNodes.find(EMFoldCase(strPath.c_str())) != FExpandedNodes.end();
 }
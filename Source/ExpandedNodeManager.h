@@ -3,21 +3,31 @@
 
 #include <Classes.hpp>
 #include <ComCtrls.hpp>
-#include <memory>
+#include <string>
+#include <unordered_set>
 
 /** This is a simple class to manage which nodes in the treeview have been expaned so
-    that they can be re-expanded when the application is launched. **/
+    that they can be re-expanded when the application is launched. The paths of the nodes
+    are held in a (case folded) hash set and persisted as a single file. **/
 class TExpandedNodeManager {
 private:
-  std::unique_ptr<TStringList> FExpandedNodes;
+  std::unordered_set<std::wstring> FExpandedNodes;
+  bool                             FModified;
+  bool                             FMigrated;
 protected:
+  String __fastcall FileName();
   void __fastcall LoadSettings();
   void __fastcall SaveSettings();
 public:
   void __fastcall AddNode(TTreeNode* Node);
+  void __fastcall AddNode(const String& strPath);
   void __fastcall RemoveNode(TTreeNode* Node);
+  void __fastcall RemoveNode(const String& strPath);
   bool __fastcall IsExpanded(TTreeNode* Node);
-  String __fastcall ConvertNodeToPath(TTreeNode* Node);
+  bool __fastcall IsExpanded(const String& strPath);
+  static String __fastcall ConvertNodeToPath(TTreeNode* Node);
+  static String __fastcall ChildPath(const String& strParentPath, TTreeNode* Node);
+  static TTreeNode* __fastcall FindNode(TTreeNodes* Nodes, const String& strPath);
   TExpandedNodeManager();
   ~TExpandedNodeManager();
 };
@@ -0,0 +1,429 @@
+#pragma hdrstop
+
+#include "ExpertManagerBenchmark.h"
+#include "ExpertManagerMacros.h"
+#include "ExpertManagerScanner.h"
+#include "ExpertManagerSearchIndex.h"
+#include "ExpertManagerWorkerPool.h"
+#include "ExpertManagerWriteBatch.h"
+#include "ExpertManagerGlobals.h"
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <regex>
+
+#pragma package(smart_init)
+
+/**
+
+  This function expands the macros in the given filename using the original regular expression
+  and replace all algorithm of the macro table. It is only kept as the reference that the single
+  pass expander is compared against.
+
+  @precon  None.
+  @postcon Any of the given macros in the filename are expanded.
+
+  @param   Macros      as a TEMRegValueList as a constant reference
+  @param   strFileName as a std::wstring as a constant reference
+  @return  a std::wstring
+
+**/
+static std::wstring ExpandLegacy(const TEMRegValueList& Macros, const std::wstring& strFileName) {
+  static const std::wregex BDSMacroPattern(L"\\$\\(\\w+\\)", std::regex::icase);
+  std::wstring strExpandedFileName = strFileName;
+  std::vector<std::wstring> Matches;
+  for (std::wsregex_iterator M(strFileName.begin(), strFileName.end(), BDSMacroPattern), E;
+    M != E; ++M)
+    Matches.push_back(M->str());
+  for (int iMatch = (int)Matches.size() - 1; iMatch >= 0; iMatch--)
+    for (size_t iMacro = 0; iMacro < Macros.size(); iMacro++)
+      if (EMSameText(Macros[iMacro].first, Matches[iMatch])) {
+        std::wstring strFolded = EMFoldCase(strExpandedFileName);
+        std::wstring strMacro = EMFoldCase(Matches[iMatch]);
+        size_t iPos = strFolded.rfind(strMacro);
+        while (iPos != std::wstring::npos) {
+          strExpandedFileName.replace(iPos, strMacro.length(), Macros[iMacro].second);
+          iPos = iPos > 0 ? strFolded.rfind(strMacro, iPos - 1) : std::wstring::npos;
+        }
+        break;
+      }
+  return strExpandedFileName;
+}
+
+/**
+
+  This method times the expansion of a representative set of expert and package filenames with
+  both the single pass expander and the original regular expression based expander. The macro
+  table is built from an in memory registry so that the results do not depend on the machine.
+
+  @precon  iIterations must be greater than zero.
+  @postcon Returns the average time per filename of each expander and whether they agree.
+
+  @param   iIterations as an int as a constant
+  @return  a TEMMacroBenchmarkResult
+
+**/
+TEMMacroBenchmarkResult EMBenchmarkMacroExpansion(const int iIterations) {
+  const std::wstring strRegPath = L"Software\\Embarcadero\\BDS\\20.0";
+  TEMMemoryRegistryStore Store;
+  Store.SetValue(strRegPath, L"RootDir", L"C:\\Program Files (x86)\\Embarcadero\\Studio\\20.0");
+  Store.SetValue(strRegPath + L"\\Environment Variables", L"$(VENDORLIB)", L"C:\\Vendor\\Lib");
+  TEMSnapshotPtr Snapshot = TEMRegistrySnapshot::Create(Store, TEMNameList(1, L"Software"),
+    TEMRegistrySnapshot::InstallationFilter);
+  TEMMacroTable Macros(*Snapshot, strRegPath);
+  const wchar_t* FileNames[] = {
+    L"$(BDSBIN)\\dclIndyCore260.bpl",
+    L"$(BDS)\\Bin\\dclstd260.bpl",
+    L"$(BDSCOMMONDIR)\\Bpl\\VendorComponents260.bpl",
+    L"$(bdsbin)\\..\\$(BDSLIB)\\win32\\release\\rtl.dcp",
+    L"$(VENDORLIB)\\Experts\\VendorExpert.dll",
+    L"C:\\Program Files (x86)\\GExperts for RAD Studio 10.3\\GExpertsRS103.dll",
+    L"C:\\Users\\Public\\Documents\\Embarcadero\\Studio\\20.0\\Bpl\\Plain.bpl",
+    L"$(UNKNOWN)\\Missing.bpl"
+  };
+  const size_t iFileNames = sizeof(FileNames) / sizeof(FileNames[0]);
+  TEMMacroBenchmarkResult Result;
+  Result.iFileNames = iFileNames;
+  Result.iIterations = iIterations;
+  Result.boolIdentical = true;
+  for (size_t i = 0; i < iFileNames; i++)
+    if (Macros.Expand(FileNames[i]) != ExpandLegacy(Macros.Macros(), FileNames[i]))
+      Result.boolIdentical = false;
+  size_t iChecksum = 0;
+  std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+  for (int iIteration = 0; iIteration < iIterations; iIteration++)
+    for (size_t i = 0; i < iFileNames; i++)
+      iChecksum += ExpandLegacy(Macros.Macros(), FileNames[i]).length();
+  std::chrono::steady_clock::time_point Middle = std::chrono::steady_clock::now();
+  for (int iIteration = 0; iIteration < iIterations; iIteration++)
+    for (size_t i = 0; i < iFileNames; i++)
+      iChecksum -= Macros.Expand(FileNames[i]).length();
+  std::chrono::steady_clock::time_point Finish = std::chrono::steady_clock::now();
+  const double dblCalls = (double)iIterations * iFileNames;
+  Result.dblLegacyNS = std::chrono::duration<double, std::nano>(Middle - Start).count() / dblCalls;
+  Result.dblExpandNS = std::chrono::duration<double, std::nano>(Finish - Middle).count() / dblCalls;
+  if (iChecksum != 0)
+    Result.boolIdentical = false;
+  return Result;
+}
+
+/**
+
+  This method writes the given macro benchmark result to the given stream.
+
+  @precon  None.
+  @postcon The result is written as a short report.
+
+  @param   Stream as a std::wostream as a reference
+  @param   Result as a TEMMacroBenchmarkResult as a constant reference
+
+**/
+void EMWriteMacroBenchmark(std::wostream& Stream, const TEMMacroBenchmarkResult& Result) {
+  Stream << L"Macro expansion: " << Result.iFileNames << L" filenames x " << Result.iIterations
+    << L" iterations" << std::endl;
+  Stream << L"  Legacy (regex + replace all): " << Result.dblLegacyNS << L" ns/filename" << std::endl;
+  Stream << L"  Single pass:                  " << Result.dblExpandNS << L" ns/filename" << std::endl;
+  if (Result.dblExpandNS > 0)
+    Stream << L"  Speed up:                     " << Result.dblLegacyNS / Result.dblExpandNS << L"x"
+      << std::endl;
+  Stream << L"  Results identical:            " << (Result.boolIdentical ? L"Yes" : L"No") << std::endl;
+}
+
+/**
+
+  This is the constructor for the synthetic options record.
+
+  @precon  None.
+  @postcon The options describe a busy machine: 24 installations (3 companies, several -r profiles
+           and versions) each with 40 experts and 400 packages.
+
+**/
+TEMSyntheticOptions::TEMSyntheticOptions() : iInstallations(24), iExperts(40), iPackages(400),
+  dblInvalid(0.05), dblDuplicates(0.02), dblMacros(0.5), iSeed(1) {
+}
+
+/**
+
+  This method generates a synthetic set of installations in the given registry store with the
+  files that exist added to the given file system. The installations are spread across the
+  three companies, a number of -r profiles and eight versions with the installations of the same
+  version sharing their RootDir (and so their directories) as real profiles do. A duplicate is a
+  file of the same name in a folder of its own so that no two entries share a value name. The
+  generation is deterministic for a given seed.
+
+  @precon  None.
+  @postcon The installations are added to the store and their existing files to the file system.
+
+  @param   Options    as a TEMSyntheticOptions as a constant reference
+  @param   Store      as a TEMMemoryRegistryStore as a reference
+  @param   FileSystem as a TEMMemoryFileSystem as a reference
+
+**/
+void EMGenerateInstallations(const TEMSyntheticOptions& Options, TEMMemoryRegistryStore& Store,
+  TEMMemoryFileSystem& FileSystem) {
+  const wchar_t* strCompanies[3] = {L"Borland", L"CodeGear", L"Embarcadero"};
+  std::mt19937 Random(Options.iSeed);
+  std::uniform_real_distribution<double> Fraction(0.0, 1.0);
+  for (int i = 0; i < Options.iInstallations; i++) {
+    const int iProfile = i / 8;
+    const std::wstring strVersion = std::to_wstring(14 + i % 8) + L".0";
+    const std::wstring strRegPath = std::wstring(L"Software\\") + strCompanies[iProfile % 3] +
+      L"\\" + (iProfile < 3 ? std::wstring(L"BDS") : L"Profile" + std::to_wstring(iProfile)) +
+      L"\\" + strVersion;
+    const std::wstring strRootDir = L"C:\\Program Files\\Embarcadero\\Studio\\" + strVersion;
+    Store.SetValue(strRegPath, L"RootDir", strRootDir);
+    Store.SetValue(strRegPath + L"\\Environment Variables", L"$(VENDORLIB)", L"C:\\Vendor\\Lib");
+    const int iEntries = Options.iExperts + Options.iPackages;
+    std::vector<std::wstring> Names;
+    for (int j = 0; j < iEntries; j++) {
+      const bool boolExpert = j < Options.iExperts;
+      const std::wstring strExtension = boolExpert ? L".dll" : L".bpl";
+      std::wstring strName = (boolExpert ? L"Expert" : L"Package") + std::to_wstring(j) + strExtension;
+      bool boolDuplicate = !Names.empty() && Fraction(Random) < Options.dblDuplicates;
+      if (boolDuplicate)
+        strName = Names[Random() % Names.size()];
+      Names.push_back(strName);
+      std::wstring strFileName, strExpanded;
+      const double dblMacro = Fraction(Random);
+      if (boolDuplicate) {
+        strFileName = L"C:\\Components\\" + strVersion + L"\\Copy" + std::to_wstring(j) + L"\\" +
+          strName;
+        strExpanded = strFileName;
+      } else if (dblMacro < Options.dblMacros / 2) {
+        strFileName = L"$(BDSBIN)\\" + strName;
+        strExpanded = strRootDir + L"\\Bin\\" + strName;
+      } else if (dblMacro < Options.dblMacros) {
+        strFileName = L"$(VENDORLIB)\\" + strName;
+        strExpanded = L"C:\\Vendor\\Lib\\" + strName;
+      } else {
+        strFileName = L"C:\\Components\\" + strVersion + L"\\" + strName;
+        strExpanded = strFileName;
+      }
+      if (Fraction(Random) >= Options.dblInvalid)
+        FileSystem.AddFile(strExpanded);
+      if (boolExpert)
+        Store.SetValue(strRegPath + L"\\" + (j % 10 == 9 ? strDisabledExperts : strExperts),
+          L"Expert " + std::to_wstring(j), strFileName);
+      else
+        Store.SetValue(strRegPath + L"\\" + (j % 4 == 0 ? strKnownIDEPackages : strKnownPackages),
+          strFileName, (j % 10 == 9 ? L"__Package " : L"Package ") + std::to_wstring(j));
+    }
+  }
+}
+
+/**
+
+  This method returns the mean, percentiles and maximum of the given latencies.
+
+  @precon  None.
+  @postcon Returns the statistics (all zero if there are no samples). The samples are sorted.
+
+  @param   Samples as a std::vector<double> as a reference
+  @return  a TEMLatencyStats
+
+**/
+TEMLatencyStats EMLatencyStats(std::vector<double>& Samples) {
+  TEMLatencyStats Stats = {Samples.size(), 0, 0, 0, 0, 0};
+  if (Samples.empty())
+    return Stats;
+  std::sort(Samples.begin(), Samples.end());
+  for (size_t i = 0; i < Samples.size(); i++)
+    Stats.dblMeanMS += Samples[i];
+  Stats.dblMeanMS /= Samples.size();
+  Stats.dblP50MS = Samples[(Samples.size() - 1) * 50 / 100];
+  Stats.dblP90MS = Samples[(Samples.size() - 1) * 90 / 100];
+  Stats.dblP99MS = Samples[(Samples.size() - 1) * 99 / 100];
+  Stats.dblMaxMS = Samples.back();
+  return Stats;
+}
+
+/**
+
+  This method returns the milliseconds elapsed since the given time.
+
+  @precon  None.
+  @postcon Returns the elapsed time.
+
+  @param   Start as a std::chrono::steady_clock::time_point as a constant reference
+  @return  a double
+
+**/
+static double ElapsedMS(const std::chrono::steady_clock::time_point& Start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+}
+
+/**
+
+  This method benchmarks the scan engine end to end against a synthetic set of installations in
+  an in memory registry store and file system (through the cached file system as the application
+  does). Four operations are timed:
+    Full scan  - reading the snapshot, finding the installations and validating them all on the
+                 worker pool with cold caches (as at start up);
+    Selection  - validating a single installation and listing its sections with warm caches (as
+                 when a tree node is selected);
+    Edit       - writing a single toggled entry to the store and revalidating it in the entries
+                 model (as when an entry is enabled or disabled);
+    Search     - finding the entries of all the installations that contain each prefix of a
+                 random piece of an expanded filename (as the user types in the search box).
+
+  @precon  iIterations must be greater than zero.
+  @postcon Returns the throughput of the full scans, the size of the path pool after them and the
+           latencies of each operation.
+
+  @param   Options     as a TEMSyntheticOptions as a constant reference
+  @param   iIterations as an int as a constant
+  @return  a TEMScanBenchmarkResult
+
+**/
+TEMScanBenchmarkResult EMBenchmarkScan(const TEMSyntheticOptions& Options, const int iIterations) {
+  TEMScanBenchmarkResult Result;
+  Result.Options = Options;
+  TEMMemoryRegistryStore Store;
+  TEMMemoryFileSystem* MemoryFileSystem = new TEMMemoryFileSystem();
+  EMGenerateInstallations(Options, Store, *MemoryFileSystem);
+  TEMCachedFileSystem FileSystem(MemoryFileSystem);
+  const wchar_t* strInstallationRoots[3] = {L"Borland", L"CodeGear", L"Embarcadero"};
+  TEMNameList Roots;
+  for (auto strInstallation : strInstallationRoots)
+    Roots.push_back(std::wstring(L"Software\\") + strInstallation);
+  std::vector<double> Samples;
+  TEMNameList Installations;
+  TEMSnapshotPtr Snapshot;
+  TEMResultQueue<size_t> Results;
+  TEMWorkerPool WorkerPool;
+  Result.iEntries = 0;
+  for (int i = 0; i < iIterations; i++) {
+    TEMCachedFileSystem ColdFileSystem(new TEMMemoryFileSystem(*MemoryFileSystem));
+    std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+    TEMMacroCache MacroCache;
+    Snapshot = TEMRegistrySnapshot::Create(Store, Roots, TEMRegistrySnapshot::InstallationFilter);
+    EMFindInstallations(*Snapshot, Roots, Installations);
+    TEMInstallationScanner Scanner(Snapshot, ColdFileSystem, MacroCache);
+    for (size_t j = 0; j < Installations.size(); j++) {
+      std::wstring strRegPath = Installations[j];
+      WorkerPool.Submit([&Scanner, &Results, strRegPath]() {
+        Results.Push(Scanner.Scan(strRegPath).Entries->Count());
+      });
+    }
+    std::vector<size_t> Counts;
+    size_t iScanned = 0, iEntries = 0;
+    while (iScanned < Installations.size()) {
+      Results.Drain(Counts, 100);
+      for (size_t j = 0; j < Counts.size(); j++)
+        iEntries += Counts[j];
+      iScanned += Counts.size();
+    }
+    Samples.push_back(ElapsedMS(Start));
+    Result.iEntries = iEntries;
+  }
+  Result.FullScan = EMLatencyStats(Samples);
+  Result.dblEntriesPerSecond = Result.FullScan.dblMeanMS > 0 ?
+    Result.iEntries / (Result.FullScan.dblMeanMS / 1000.0) : 0;
+  Result.iPaths = TEMPathPool::Global().Count();
+  Result.iPathBytes = TEMPathPool::Global().Bytes();
+  std::mt19937 Random(Options.iSeed);
+  TEMMacroCache MacroCache;
+  TEMInstallationScanner Scanner(Snapshot, FileSystem, MacroCache);
+  Samples.clear();
+  TEMEntryIDList EntryIDs;
+  for (int i = 0; i < iIterations * 10 && !Installations.empty(); i++) {
+    const std::wstring& strRegPath = Installations[Random() % Installations.size()];
+    std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+    FileSystem.Invalidate();
+    TEMInstallationResult Installation = Scanner.Scan(strRegPath);
+    for (int iSection = esExperts; iSection <= esKnownPackages; iSection++)
+      Installation.Entries->Section((TEMSection)iSection, EntryIDs);
+    Samples.push_back(ElapsedMS(Start));
+  }
+  Result.Selection = EMLatencyStats(Samples);
+  Samples.clear();
+  if (!Installations.empty()) {
+    const std::wstring& strRegPath = Installations[0];
+    TEMEntriesPtr Entries = Scanner.Scan(strRegPath).Entries;
+    for (int i = 0; i < iIterations * 100 && Entries->Count() > 0; i++) {
+      const int iEntryID = Random() % Entries->Count();
+      std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+      TEMEntry Entry = Entries->Entry(iEntryID);
+      Entry.boolEnabled = !Entry.boolEnabled;
+      TEMRegistryWriteBatch Batch;
+      EMDeleteEntry(Batch, strRegPath, Entries->Entry(iEntryID));
+      EMWriteEntry(Batch, strRegPath, Entry);
+      Batch.Apply(Store);
+      TEMEntryIDList Changed;
+      Entries->Update(iEntryID, Entry, Changed);
+      Entries->Validation();
+      Samples.push_back(ElapsedMS(Start));
+    }
+  }
+  Result.Edit = EMLatencyStats(Samples);
+  Samples.clear();
+  TEMSearchIndex SearchIndex;
+  TEMNameList Queries;
+  for (size_t i = 0; i < Installations.size(); i++) {
+    TEMInstallationResult Installation = Scanner.Scan(Installations[i]);
+    const TEMMacroTable& Macros = *MacroCache.Get(*Snapshot, Installations[i]);
+    SearchIndex.SetInstallation((int)i, *Installation.Entries, Macros);
+    for (size_t j = 0; j < Installation.Entries->Count(); j += 97)
+      if (!Installation.Entries->Entry((int)j).FileName.Empty())
+        Queries.push_back(Macros.Expand(Installation.Entries->Entry((int)j).FileName.Text()));
+  }
+  TEMUsageList Found;
+  for (int i = 0; i < iIterations * 100 && !Queries.empty(); i++) {
+    const std::wstring& strText = Queries[Random() % Queries.size()];
+    const size_t iStart = Random() % strText.length();
+    const std::wstring strQuery = strText.substr(iStart, 1 + Random() % 8);
+    for (size_t j = 1; j <= strQuery.length(); j++) {
+      std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+      SearchIndex.Search(strQuery.substr(0, j), 1000, Found);
+      Samples.push_back(ElapsedMS(Start));
+    }
+  }
+  Result.Search = EMLatencyStats(Samples);
+  return Result;
+}
+
+/**
+
+  This method writes a line of latency statistics to the given stream.
+
+  @precon  None.
+  @postcon The statistics are written.
+
+  @param   Stream  as a std::wostream as a reference
+  @param   strName as a wchar_t pointer as a constant
+  @param   Stats   as a TEMLatencyStats as a constant reference
+
+**/
+static void WriteLatencyStats(std::wostream& Stream, const wchar_t* strName,
+  const TEMLatencyStats& Stats) {
+  Stream << L"  " << strName << Stats.iSamples << L" samples, mean " << Stats.dblMeanMS
+    << L" ms, p50 " << Stats.dblP50MS << L" ms, p90 " << Stats.dblP90MS << L" ms, p99 "
+    << Stats.dblP99MS << L" ms, max " << Stats.dblMaxMS << L" ms" << std::endl;
+}
+
+/**
+
+  This method writes the given scan benchmark result to the given stream.
+
+  @precon  None.
+  @postcon The result is written as a short report.
+
+  @param   Stream as a std::wostream as a reference
+  @param   Result as a TEMScanBenchmarkResult as a constant reference
+
+**/
+void EMWriteScanBenchmark(std::wostream& Stream, const TEMScanBenchmarkResult& Result) {
+  const TEMSyntheticOptions& Options = Result.Options;
+  Stream << L"Scan: " << Options.iInstallations << L" installations x " << Options.iExperts
+    << L" experts x " << Options.iPackages << L" packages (" << Options.dblInvalid * 100
+    << L"% invalid, " << Options.dblDuplicates * 100 << L"% duplicates, " << Options.dblMacros * 100
+    << L"% macros)" << std::endl;
+  Stream << L"  Entries:    " << Result.iEntries << L" (" << Result.dblEntriesPerSecond
+    << L" entries/s)" << std::endl;
+  Stream << L"  Paths:      " << Result.iPaths << L" interned (" << Result.iPathBytes / 1024
+    << L" KB)" << std::endl;
+  WriteLatencyStats(Stream, L"Full scan:  ", Result.FullScan);
+  WriteLatencyStats(Stream, L"Selection:  ", Result.Selection);
+  WriteLatencyStats(Stream, L"Edit:       ", Result.Edit);
+  WriteLatencyStats(Stream, L"Search:     ", Result.Search);
+}
@@ -0,0 +1,65 @@
+#ifndef ExpertManagerBenchmarkH
+#define ExpertManagerBenchmarkH
+
+#include "ExpertManagerRegistryStore.h"
+#include "ExpertManagerFileSystem.h"
+#include <string>
+#include <ostream>
+#include <vector>
+
+/** A record to describe the result of timing the macro expansion of a set of filenames. **/
+struct TEMMacroBenchmarkResult {
+  size_t iFileNames;
+  int    iIterations;
+  double dblLegacyNS;
+  double dblExpandNS;
+  bool   boolIdentical;
+};
+
+TEMMacroBenchmarkResult EMBenchmarkMacroExpansion(const int iIterations);
+void EMWriteMacroBenchmark(std::wostream& Stream, const TEMMacroBenchmarkResult& Result);
+
+/** A record to describe the shape of a synthetic set of installations: the number of installations
+    and of experts and packages in each and the fractions of the entries whose files are missing,
+    that duplicate an earlier entry's filename and that use macros in their filenames. **/
+struct TEMSyntheticOptions {
+  int          iInstallations;
+  int          iExperts;
+  int          iPackages;
+  double       dblInvalid;
+  double       dblDuplicates;
+  double       dblMacros;
+  unsigned int iSeed;
+  TEMSyntheticOptions();
+};
+
+/** A record of the latency percentiles of a set of timed operations in milliseconds. **/
+struct TEMLatencyStats {
+  size_t iSamples;
+  double dblMeanMS;
+  double dblP50MS;
+  double dblP90MS;
+  double dblP99MS;
+  double dblMaxMS;
+};
+
+/** A record to describe the result of the end to end scan benchmark. **/
+struct TEMScanBenchmarkResult {
+  TEMSyntheticOptions Options;
+  size_t              iEntries;
+  double              dblEntriesPerSecond;
+  size_t              iPaths;
+  size_t              iPathBytes;
+  TEMLatencyStats     FullScan;
+  TEMLatencyStats     Selection;
+  TEMLatencyStats     Edit;
+  TEMLatencyStats     Search;
+};
+
+void EMGenerateInstallations(const TEMSyntheticOptions& Options, TEMMemoryRegistryStore& Store,
+  TEMMemoryFileSystem& FileSystem);
+TEMLatencyStats EMLatencyStats(std::vector<double>& Samples);
+TEMScanBenchmarkResult EMBenchmarkScan(const TEMSyntheticOptions& Options, const int iIterations);
+void EMWriteScanBenchmark(std::wostream& Stream, const TEMScanBenchmarkResult& Result);
+
+#endif
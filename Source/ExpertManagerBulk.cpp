@@ -0,0 +1,153 @@
+#pragma hdrstop
+
+#include "ExpertManagerBulk.h"
+#include <unordered_set>
+
+#pragma package(smart_init)
+
+/**
+
+  This is the constructor for the bulk filter record.
+
+  @precon  None.
+  @postcon The filter matches every entry in every section.
+
+**/
+TEMBulkFilter::TEMBulkFilter() : strMask(L"*"), boolInvalidOnly(false) {
+  for (int i = esExperts; i <= esKnownPackages; i++)
+    boolSections[i] = true;
+}
+
+/**
+
+  This method returns true if the given entry matches the filter.
+
+  @precon  iEntryID must be a valid entry ID.
+  @postcon Returns whether the entry matches.
+
+  @param   Entries  as a TEMInstallationEntries as a constant reference
+  @param   iEntryID as an int as a constant
+  @return  a bool
+
+**/
+bool TEMBulkFilter::Matches(const TEMInstallationEntries& Entries, const int iEntryID) const {
+  const TEMEntry& Entry = Entries.Entry(iEntryID);
+  if (Entry.boolDeleted || !boolSections[Entry.eSection])
+    return false;
+  if (boolInvalidOnly && Entries.EntryValidation(iEntryID) != evInvalidPaths)
+    return false;
+  return EMMatchesMask(Entry.Name.Text(), strMask) ||
+    EMMatchesMask(Entry.FileName.Text(), strMask);
+}
+
+/**
+
+  This method adds a change for each entry of the given installation that matches the filter and
+  would be changed by the plan's action (i.e. enabled entries are not enabled again). An expert
+  which would be moved to a key that already has an expert of the same name is added to the
+  collisions instead.
+
+  @precon  None.
+  @postcon The changes and collisions for the installation are added to the plan.
+
+  @param   strRegPath as a std::wstring as a constant reference
+  @param   Entries    as a TEMInstallationEntries as a constant reference
+  @param   Filter     as a TEMBulkFilter as a constant reference
+
+**/
+void TEMBulkPlan::Plan(const std::wstring& strRegPath, const TEMInstallationEntries& Entries,
+  const TEMBulkFilter& Filter) {
+  std::unordered_set<std::wstring> ExpertNames[2];
+  for (size_t i = 0; i < Entries.Count(); i++) {
+    const TEMEntry& Entry = Entries.Entry((int)i);
+    if (Entry.eSection == esExperts && !Entry.boolDeleted)
+      ExpertNames[Entry.boolEnabled].insert(EMFoldCase(Entry.Name.Text()));
+  }
+  for (size_t i = 0; i < Entries.Count(); i++) {
+    if (!Filter.Matches(Entries, (int)i))
+      continue;
+    TEMBulkChange Change;
+    Change.strRegPath = strRegPath;
+    Change.iEntryID = (int)i;
+    Change.OldEntry = Entries.Entry((int)i);
+    Change.NewEntry = Change.OldEntry;
+    switch (FAction) {
+      case baEnable:
+        Change.NewEntry.boolEnabled = true;
+        break;
+      case baDisable:
+        Change.NewEntry.boolEnabled = false;
+        break;
+      case baDelete:
+        Change.NewEntry.boolDeleted = true;
+        break;
+    }
+    if (Change.NewEntry.boolEnabled != Change.OldEntry.boolEnabled &&
+      Change.NewEntry.eSection == esExperts &&
+      ExpertNames[Change.NewEntry.boolEnabled].count(EMFoldCase(Change.NewEntry.Name.Text())) > 0)
+      FCollisions.push_back(Change);
+    else if (Change.NewEntry.boolEnabled != Change.OldEntry.boolEnabled ||
+      Change.NewEntry.boolDeleted != Change.OldEntry.boolDeleted)
+      FChanges.push_back(Change);
+  }
+}
+
+/**
+
+  This method returns the distinct installations that the plan changes in the order they were
+  planned.
+
+  @precon  None.
+  @postcon RegPaths contains the registry paths of the changed installations.
+
+  @param   RegPaths as a TEMNameList as a reference
+
+**/
+void TEMBulkPlan::Installations(TEMNameList& RegPaths) const {
+  RegPaths.clear();
+  std::unordered_set<std::wstring> Found;
+  for (size_t i = 0; i < FChanges.size(); i++)
+    if (Found.insert(EMFoldCase(FChanges[i].strRegPath)).second)
+      RegPaths.push_back(FChanges[i].strRegPath);
+}
+
+/**
+
+  This method queues the registry mutations for all the planned changes in the given batch.
+
+  @precon  None.
+  @postcon The batch contains a delete of each old entry and a write of each new entry that is not
+           deleted.
+
+  @param   Batch as a TEMRegistryWriteBatch as a reference
+
+**/
+void TEMBulkPlan::Build(TEMRegistryWriteBatch& Batch) const {
+  for (size_t i = 0; i < FChanges.size(); i++) {
+    EMDeleteEntry(Batch, FChanges[i].strRegPath, FChanges[i].OldEntry);
+    if (!FChanges[i].NewEntry.boolDeleted)
+      EMWriteEntry(Batch, FChanges[i].strRegPath, FChanges[i].NewEntry);
+  }
+}
+
+/**
+
+  This method plans the bulk operation against the in-memory entries of each of the given
+  installations (loaded from the scanner's snapshot).
+
+  @precon  None.
+  @postcon The changes for all the installations are added to the plan.
+
+  @param   Scanner  as a TEMInstallationScanner as a constant reference
+  @param   RegPaths as a TEMNameList as a constant reference
+  @param   Filter   as a TEMBulkFilter as a constant reference
+  @param   Plan     as a TEMBulkPlan as a reference
+
+**/
+void EMPlanBulkOperation(const TEMInstallationScanner& Scanner, const TEMNameList& RegPaths,
+  const TEMBulkFilter& Filter, TEMBulkPlan& Plan) {
+  for (size_t i = 0; i < RegPaths.size(); i++) {
+    TEMInstallationResult Result = Scanner.Scan(RegPaths[i]);
+    Plan.Plan(RegPaths[i], *Result.Entries, Filter);
+  }
+}
@@ -0,0 +1,55 @@
+#ifndef ExpertManagerBulkH
+#define ExpertManagerBulkH
+
+#include "ExpertManagerScanner.h"
+#include "ExpertManagerWriteBatch.h"
+#include <string>
+#include <vector>
+
+/** An enumerate to define the operations that can be applied to many entries at once. **/
+enum TEMBulkAction {baEnable, baDisable, baDelete};
+
+/** A record to describe which entries a bulk operation applies to. An entry matches if its name
+    or its filename matches the mask, it is in one of the chosen sections and (if required) its
+    file does not exist. **/
+struct TEMBulkFilter {
+  std::wstring strMask;
+  bool         boolSections[3];
+  bool         boolInvalidOnly;
+  TEMBulkFilter();
+  bool Matches(const TEMInstallationEntries& Entries, const int iEntryID) const;
+};
+
+/** A record to describe a single planned change to an entry. **/
+struct TEMBulkChange {
+  std::wstring strRegPath;
+  int          iEntryID;
+  TEMEntry     OldEntry;
+  TEMEntry     NewEntry;
+};
+
+/** This class holds the changes of a bulk operation which are planned against the in-memory
+    entries of the installations so that they can be reviewed and then committed as a single
+    registry write batch. Enabling or disabling an expert moves it between the Experts and
+    Experts\Disabled keys so an expert whose name is already in the other key is not changed
+    (which would overwrite the other entry) but is listed as a collision. **/
+class TEMBulkPlan {
+  private:
+    TEMBulkAction              FAction;
+    std::vector<TEMBulkChange> FChanges;
+    std::vector<TEMBulkChange> FCollisions;
+  public:
+    TEMBulkPlan(const TEMBulkAction eAction) : FAction(eAction) {};
+    void Plan(const std::wstring& strRegPath, const TEMInstallationEntries& Entries,
+      const TEMBulkFilter& Filter);
+    TEMBulkAction Action() const { return FAction; };
+    const std::vector<TEMBulkChange>& Changes() const { return FChanges; };
+    const std::vector<TEMBulkChange>& Collisions() const { return FCollisions; };
+    void Installations(TEMNameList& RegPaths) const;
+    void Build(TEMRegistryWriteBatch& Batch) const;
+};
+
+void EMPlanBulkOperation(const TEMInstallationScanner& Scanner, const TEMNameList& RegPaths,
+  const TEMBulkFilter& Filter, TEMBulkPlan& Plan);
+
+#endif
@@ -0,0 +1,316 @@
+#pragma hdrstop
+
+#include "ExpertManagerDependencies.h"
+#include "ExpertManagerTrace.h"
+#include <cwctype>
+
+#pragma package(smart_init)
+
+/** The machine of the modules the IDE can load: the IDE is a 32 bit (Win32) process. **/
+static const unsigned short iIDEMachine = 0x14C;
+
+/**
+
+  This is the constructor for the dependency graph class.
+
+  @precon  None.
+  @postcon Creates an empty graph.
+
+**/
+TEMDependencyGraph::TEMDependencyGraph() : FVersionsListed(false) {}
+
+/**
+
+  This method returns true if the given filename is a package (has a .bpl extension).
+
+  @precon  None.
+  @postcon Returns whether the file is a package.
+
+  @param   strFileName as a std::wstring as a constant reference
+  @return  a bool
+
+**/
+bool TEMDependencyGraph::IsPackage(const std::wstring& strFileName) {
+  return strFileName.length() > 4 && EMSameText(strFileName.substr(strFileName.length() - 4),
+    L".bpl");
+}
+
+/**
+
+  This method returns the name of a package without its path, extension and version number, e.g.
+  rtl for C:\Program Files\Embarcadero\Studio\23.0\bin\rtl290.bpl.
+
+  @precon  None.
+  @postcon Returns the case folded base name.
+
+  @param   strFileName as a std::wstring as a constant reference
+  @return  a std::wstring
+
+**/
+std::wstring TEMDependencyGraph::BaseName(const std::wstring& strFileName) {
+  std::wstring strName = EMFoldCase(EMExtractFileName(strFileName));
+  size_t iDot = strName.rfind(L'.');
+  if (iDot != std::wstring::npos)
+    strName.erase(iDot);
+  while (!strName.empty() && std::iswdigit(strName[strName.length() - 1]))
+    strName.erase(strName.length() - 1);
+  return strName;
+}
+
+/**
+
+  This method returns the platform name of the given PE machine type.
+
+  @precon  None.
+  @postcon Returns the name, e.g. Win64 for an x64 image.
+
+  @param   iMachine as an unsigned short as a constant
+  @return  a std::wstring
+
+**/
+std::wstring TEMDependencyGraph::MachineName(const unsigned short iMachine) {
+  switch (iMachine) {
+    case 0x14C:  return L"Win32";
+    case 0x8664: return L"Win64";
+    case 0xAA64: return L"WinARM64";
+    default:     return L"unknown machine";
+  }
+}
+
+/**
+
+  This method indexes the packages in the search folders and the installation's entries by their
+  base names so that a package of another version can be reported. The folders are only listed
+  the first time an import cannot be resolved.
+
+  @precon  None.
+  @postcon The versions index is built.
+
+  @param   FileSystem as a TEMFileSystem as a reference
+
+**/
+void TEMDependencyGraph::ListVersions(TEMFileSystem& FileSystem) {
+  if (FVersionsListed)
+    return;
+  FVersionsListed = true;
+  for (size_t i = 0; i < FSearchPath.size(); i++) {
+    TEMNameList FileNames;
+    if (FileSystem.ListDirectory(FSearchPath[i], FileNames))
+      for (size_t j = 0; j < FileNames.size(); j++)
+        if (IsPackage(FileNames[j]))
+          FVersions.insert(std::make_pair(BaseName(FileNames[j]), FileNames[j]));
+  }
+  for (std::unordered_map<std::wstring, int>::const_iterator i = FProviders.begin();
+    i != FProviders.end(); i++)
+    if (IsPackage(i->first))
+      FVersions.insert(std::make_pair(BaseName(i->first), i->first));
+}
+
+/**
+
+  This method resolves a package imported by a module in the given folder. The package is
+  resolved if it is an enabled entry of the installation or exists in one of the search folders or
+  the module's own folder.
+
+  @precon  None.
+  @postcon Returns the dependency with its state and (if it is an entry) its provider.
+
+  @param   strFileName  as a std::wstring as a constant reference
+  @param   strDirectory as a std::wstring as a constant reference
+  @param   FileSystem   as a TEMFileSystem as a reference
+  @return  a TEMDependency
+
+**/
+TEMDependency TEMDependencyGraph::Resolve(const std::wstring& strFileName,
+  const std::wstring& strDirectory, TEMFileSystem& FileSystem) {
+  TEMDependency Dependency;
+  Dependency.strFileName = strFileName;
+  Dependency.eState = dsResolved;
+  Dependency.iProviderID = -1;
+  std::wstring strKey = EMFoldCase(strFileName);
+  std::unordered_map<std::wstring, int>::const_iterator Provider = FProviders.find(strKey);
+  if (Provider != FProviders.end()) {
+    Dependency.iProviderID = Provider->second;
+    return Dependency;
+  }
+  for (size_t i = 0; i < FSearchPath.size(); i++)
+    if (FileSystem.FileExists(FSearchPath[i] + L"\\" + strFileName))
+      return Dependency;
+  if (!strDirectory.empty() && FileSystem.FileExists(strDirectory + L"\\" + strFileName))
+    return Dependency;
+  ListVersions(FileSystem);
+  std::unordered_map<std::wstring, std::wstring>::const_iterator Version =
+    FVersions.find(BaseName(strFileName));
+  if (Version != FVersions.end() && EMFoldCase(Version->second) != strKey) {
+    Dependency.eState = dsWrongVersion;
+    Dependency.strFound = Version->second;
+  } else
+    Dependency.eState = dsMissing;
+  return Dependency;
+}
+
+/**
+
+  This method adds the packages required by the given package's PACKAGEINFO resource which are not
+  already among its imports. A required package is named without its extension and possibly
+  without its version number (e.g. rtl for rtl290.bpl) so it is matched against the imports by its
+  base name.
+
+  @precon  iEntryID must be a valid entry ID whose imports have been added.
+  @postcon The missing required packages are added to the entry's dependencies.
+
+  @param   iEntryID     as a size_t as a constant
+  @param   Info         as a TEMModuleInfo as a constant reference
+  @param   strDirectory as a std::wstring as a constant reference
+  @param   FileSystem   as a TEMFileSystem as a reference
+
+**/
+void TEMDependencyGraph::AddRequires(const size_t iEntryID, const TEMModuleInfo& Info,
+  const std::wstring& strDirectory, TEMFileSystem& FileSystem) {
+  if (!Info.boolPackageInfo)
+    return;
+  TEMDependencyList& Dependencies = FDependencies[iEntryID];
+  for (size_t i = 0; i < Info.Requires.size(); i++) {
+    std::wstring strBaseName = BaseName(Info.Requires[i]);
+    bool boolImported = strBaseName.empty();
+    for (size_t j = 0; j < Dependencies.size() && !boolImported; j++)
+      boolImported = BaseName(Dependencies[j].strFileName) == strBaseName;
+    if (!boolImported)
+      Dependencies.push_back(Resolve(IsPackage(Info.Requires[i]) ? Info.Requires[i] :
+        Info.Requires[i] + L".bpl", strDirectory, FileSystem));
+  }
+}
+
+/**
+
+  This method determines whether the given entry can be loaded, i.e. all its imports are resolved
+  and all the entries that provide them can be loaded. An entry which is reached again through a
+  cycle of imports is taken to be loadable so that the cycle is only reported at its broken link.
+
+  @precon  iEntryID must be a valid entry ID.
+  @postcon Returns whether the entry can be loaded and imports of unloadable entries are marked.
+
+  @param   iEntryID as an int as a constant
+  @param   States   as a std::vector<char> as a reference
+  @return  a bool
+
+**/
+bool TEMDependencyGraph::Visit(const int iEntryID, std::vector<char>& States) {
+  if (States[iEntryID] != 0)
+    return FLoadable[iEntryID];
+  States[iEntryID] = 1;
+  bool boolLoadable = true;
+  TEMDependencyList& Dependencies = FDependencies[iEntryID];
+  for (size_t i = 0; i < Dependencies.size(); i++) {
+    if (Dependencies[i].eState == dsResolved && Dependencies[i].iProviderID >= 0 &&
+      !Visit(Dependencies[i].iProviderID, States))
+      Dependencies[i].eState = dsUnloadable;
+    if (Dependencies[i].eState != dsResolved)
+      boolLoadable = false;
+  }
+  FLoadable[iEntryID] = boolLoadable;
+  States[iEntryID] = 2;
+  return boolLoadable;
+}
+
+/**
+
+  This method builds the graph of the packages imported or required by the enabled entries of the
+  installation whose files exist. A module which is not built for the IDE's machine is given a
+  dependency on itself in the wrong machine state. Each module is read through the module cache
+  so that only new or changed files are parsed.
+
+  @precon  ModuleCache must be a valid instance.
+  @postcon The dependencies of each entry are resolved.
+
+  @param   Entries     as a TEMInstallationEntries as a constant reference
+  @param   Macros      as a TEMMacroTable as a constant reference
+  @param   FileSystem  as a TEMFileSystem as a reference
+  @param   ModuleCache as a TEMModuleCache as a reference
+
+**/
+void TEMDependencyGraph::Build(const TEMInstallationEntries& Entries, const TEMMacroTable& Macros,
+  TEMFileSystem& FileSystem, TEMModuleCache& ModuleCache) {
+  TEMTraceSpan Span("Dependencies.Build");
+  FDependencies.assign(Entries.Count(), TEMDependencyList());
+  FLoadable.assign(Entries.Count(), true);
+  FProviders.clear();
+  FVersions.clear();
+  FVersionsListed = false;
+  FSearchPath.clear();
+  FSearchPath.push_back(Macros.Expand(L"$(BDSBIN)"));
+  FSearchPath.push_back(Macros.Expand(L"$(BDSCOMMONDIR)\\Bpl"));
+  TEMNameList FileNames(Entries.Count());
+  for (size_t i = 0; i < Entries.Count(); i++) {
+    const TEMEntry& Entry = Entries.Entry((int)i);
+    if (Entry.boolEnabled && Entry.boolExists && !Entry.boolDeleted) {
+      FileNames[i] = Macros.Expand(Entry.FileName.Text());
+      FProviders.insert(std::make_pair(EMFoldCase(EMExtractFileName(FileNames[i])), (int)i));
+    }
+  }
+  for (size_t i = 0; i < FileNames.size(); i++) {
+    if (FileNames[i].empty())
+      continue;
+    TEMModuleInfoPtr Info = ModuleCache.Get(FileNames[i]);
+    if (!Info || !Info->boolValid)
+      continue;
+    size_t iSeparator = FileNames[i].find_last_of(L"\\/");
+    std::wstring strDirectory = iSeparator != std::wstring::npos ?
+      FileNames[i].substr(0, iSeparator) : std::wstring();
+    if (Info->iMachine != iIDEMachine) {
+      TEMDependency Dependency;
+      Dependency.strFileName = EMExtractFileName(FileNames[i]);
+      Dependency.eState = dsWrongMachine;
+      Dependency.iProviderID = -1;
+      Dependency.strFound = MachineName(Info->iMachine);
+      FDependencies[i].push_back(Dependency);
+    }
+    for (size_t j = 0; j < Info->Imports.size(); j++)
+      if (IsPackage(Info->Imports[j]))
+        FDependencies[i].push_back(Resolve(Info->Imports[j], strDirectory, FileSystem));
+    AddRequires(i, *Info, strDirectory, FileSystem);
+  }
+  std::vector<char> States(Entries.Count(), 0);
+  for (size_t i = 0; i < FDependencies.size(); i++)
+    Visit((int)i, States);
+}
+
+/**
+
+  This method sets the unresolved dependencies of each entry of the installation from the graph,
+  e.g. "rtl290.bpl (found rtl280.bpl)" for a package of the wrong version or
+  "MyExpert.dll (Win64 module)" for a module built for another machine.
+
+  @precon  The graph must have been built from the given entries.
+  @postcon The unresolved dependencies of the entries are updated.
+
+  @param   Entries as a TEMInstallationEntries as a reference
+
+**/
+void TEMDependencyGraph::Apply(TEMInstallationEntries& Entries) const {
+  for (size_t i = 0; i < FDependencies.size(); i++) {
+    TEMNameList Names;
+    const TEMDependencyList& Dependencies = FDependencies[i];
+    for (size_t j = 0; j < Dependencies.size(); j++)
+      switch (Dependencies[j].eState) {
+        case dsMissing:
+          Names.push_back(Dependencies[j].strFileName);
+          break;
+        case dsWrongVersion:
+          Names.push_back(Dependencies[j].strFileName + L" (found " + Dependencies[j].strFound +
+            L")");
+          break;
+        case dsUnloadable:
+          Names.push_back(Dependencies[j].strFileName + L" (cannot be loaded)");
+          break;
+        case dsWrongMachine:
+          Names.push_back(Dependencies[j].strFileName + L" (" + Dependencies[j].strFound +
+            L" module)");
+          break;
+        default:
+          break;
+      }
+    if (!Names.empty() || !Entries.UnresolvedDependencies((int)i).empty())
+      Entries.SetUnresolvedDependencies((int)i, Names);
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef ExpertManagerDependenciesH
+#define ExpertManagerDependenciesH
+
+#include "ExpertManagerEntries.h"
+#include "ExpertManagerPEFile.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/**
+  This is an enumerate to define how a package imported by an expert or package was resolved:
+    dsResolved     The package is an enabled entry of the installation or is in the IDE's bin
+                   folder, the common Bpl folder or the folder of the importing module.
+    dsMissing      No package with that filename could be found.
+    dsWrongVersion Only a package with the same name but a different version number was found.
+    dsUnloadable   The package is an entry of the installation which cannot itself be loaded.
+    dsWrongMachine The module itself (named by the dependency) is not built for the IDE's machine,
+                   e.g. a Win64 package in a Win32 IDE, so it cannot be loaded.
+**/
+enum TEMDependencyState {dsResolved, dsMissing, dsWrongVersion, dsUnloadable, dsWrongMachine};
+
+/** A record to describe a single package imported by an expert or package. **/
+struct TEMDependency {
+  std::wstring       strFileName;
+  TEMDependencyState eState;
+  int                iProviderID;
+  std::wstring       strFound;
+};
+
+/** A simplified type for the list of packages imported by an expert or package. **/
+typedef std::vector<TEMDependency> TEMDependencyList;
+
+/** This class builds the graph of the packages imported by the enabled experts and packages of an
+    installation from their PE import tables and the packages required by their PACKAGEINFO
+    resources. Each import is resolved against the installation's own entries first (which become
+    edges of the graph) and then against the IDE's search folders. A module which is not built for
+    the IDE's machine cannot be loaded and an entry which imports an entry that cannot be loaded
+    cannot be loaded either. **/
+class TEMDependencyGraph {
+  private:
+    std::vector<TEMDependencyList>                 FDependencies;
+    std::vector<bool>                              FLoadable;
+    TEMNameList                                    FSearchPath;
+    std::unordered_map<std::wstring, int>          FProviders;
+    std::unordered_map<std::wstring, std::wstring> FVersions;
+    bool                                           FVersionsListed;
+    static bool IsPackage(const std::wstring& strFileName);
+    static std::wstring BaseName(const std::wstring& strFileName);
+    static std::wstring MachineName(const unsigned short iMachine);
+    void AddRequires(const size_t iEntryID, const TEMModuleInfo& Info,
+      const std::wstring& strDirectory, TEMFileSystem& FileSystem);
+    void ListVersions(TEMFileSystem& FileSystem);
+    TEMDependency Resolve(const std::wstring& strFileName, const std::wstring& strDirectory,
+      TEMFileSystem& FileSystem);
+    bool Visit(const int iEntryID, std::vector<char>& States);
+  public:
+    TEMDependencyGraph();
+    void Build(const TEMInstallationEntries& Entries, const TEMMacroTable& Macros,
+      TEMFileSystem& FileSystem, TEMModuleCache& ModuleCache);
+    const TEMDependencyList& Dependencies(const int iEntryID) const {
+      return FDependencies[iEntryID]; };
+    bool Loadable(const int iEntryID) const { return FLoadable[iEntryID]; };
+    void Apply(TEMInstallationEntries& Entries) const;
+};
+
+#endif
+
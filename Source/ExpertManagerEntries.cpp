@@ -0,0 +1,474 @@
+#pragma hdrstop
+
+#include "ExpertManagerEntries.h"
+#include "ExpertManagerGlobals.h"
+#include "ExpertManagerTrace.h"
+
+#pragma package(smart_init)
+
+/**
+
+  This method adds the given entry to the group of the given key.
+
+  @precon  None.
+  @postcon The entry is a member of the group.
+
+  @param   iKey     as a TEMDuplicateKey as a constant
+  @param   iEntryID as an int as a constant
+
+**/
+void TEMDuplicateIndex::Add(const TEMDuplicateKey iKey, const int iEntryID) {
+  FGroups[iKey].push_back(iEntryID);
+}
+
+/**
+
+  This method removes the given entry from the group of the given key.
+
+  @precon  None.
+  @postcon The entry is no longer a member of the group and empty groups are removed.
+
+  @param   iKey     as a TEMDuplicateKey as a constant
+  @param   iEntryID as an int as a constant
+
+**/
+void TEMDuplicateIndex::Remove(const TEMDuplicateKey iKey, const int iEntryID) {
+  std::unordered_map<TEMDuplicateKey, TEMEntryIDList>::iterator i = FGroups.find(iKey);
+  if (i != FGroups.end()) {
+    TEMEntryIDList& Group = i->second;
+    for (size_t j = 0; j < Group.size(); j++)
+      if (Group[j] == iEntryID) {
+        Group.erase(Group.begin() + j);
+        break;
+      }
+    if (Group.empty())
+      FGroups.erase(i);
+  }
+}
+
+/**
+
+  This method returns the IDs of all the entries with the given key.
+
+  @precon  None.
+  @postcon Returns the group which is empty if there are no entries with the key.
+
+  @param   iKey as a TEMDuplicateKey as a constant
+  @return  a TEMEntryIDList as a constant reference
+
+**/
+const TEMEntryIDList& TEMDuplicateIndex::Group(const TEMDuplicateKey iKey) const {
+  static const TEMEntryIDList EmptyGroup;
+  std::unordered_map<TEMDuplicateKey, TEMEntryIDList>::const_iterator i = FGroups.find(iKey);
+  return i != FGroups.end() ? i->second : EmptyGroup;
+}
+
+/**
+
+  This method removes all the groups from the index.
+
+  @precon  None.
+  @postcon The index is empty.
+
+**/
+void TEMDuplicateIndex::Clear() {
+  FGroups.clear();
+}
+
+/**
+
+  This is the constructor for the installation entries class.
+
+  @precon  None.
+  @postcon Creates an empty set of entries.
+
+**/
+TEMInstallationEntries::TEMInstallationEntries() {
+  for (int i = esExperts; i <= esKnownPackages; i++) {
+    FMissing[i] = 0;
+    FDuplicateGroups[i] = 0;
+    FUnresolvedCount[i] = 0;
+  }
+}
+
+/**
+
+  This method adds the given entry to its section's duplicate index and aggregate counts.
+
+  @precon  iEntryID must be a valid entry ID.
+  @postcon The entry is indexed and if Changed is not null the IDs of the entries whose
+           validation may have changed are appended to it.
+
+  @param   iEntryID as an int as a constant
+  @param   Changed  as a TEMEntryIDList as a pointer
+
+**/
+void TEMInstallationEntries::Attach(const int iEntryID, TEMEntryIDList* Changed) {
+  const TEMEntry& Entry = FEntries[iEntryID];
+  const TEMDuplicateKey iKey = FKeys[iEntryID];
+  TEMDuplicateIndex& Duplicates = FDuplicates[Entry.eSection];
+  Duplicates.Add(iKey, iEntryID);
+  if (Entry.boolEnabled) {
+    if (++FEnabled[Entry.eSection][iKey] == 2)
+      FDuplicateGroups[Entry.eSection]++;
+    if (!Entry.boolExists)
+      FMissing[Entry.eSection]++;
+    if (!FUnresolved[iEntryID].empty())
+      FUnresolvedCount[Entry.eSection]++;
+  }
+  if (Changed != NULL) {
+    const TEMEntryIDList& Group = Duplicates.Group(iKey);
+    if (Group.size() == 2)
+      Changed->insert(Changed->end(), Group.begin(), Group.end());
+    else
+      Changed->push_back(iEntryID);
+  }
+}
+
+/**
+
+  This method removes the given entry from its section's duplicate index and aggregate counts.
+
+  @precon  iEntryID must be a valid entry ID.
+  @postcon The entry is no longer indexed and if Changed is not null the IDs of the entries whose
+           validation may have changed are appended to it.
+
+  @param   iEntryID as an int as a constant
+  @param   Changed  as a TEMEntryIDList as a pointer
+
+**/
+void TEMInstallationEntries::Detach(const int iEntryID, TEMEntryIDList* Changed) {
+  const TEMEntry& Entry = FEntries[iEntryID];
+  const TEMDuplicateKey iKey = FKeys[iEntryID];
+  TEMDuplicateIndex& Duplicates = FDuplicates[Entry.eSection];
+  Duplicates.Remove(iKey, iEntryID);
+  if (Entry.boolEnabled) {
+    int& iEnabled = FEnabled[Entry.eSection][iKey];
+    if (iEnabled-- == 2)
+      FDuplicateGroups[Entry.eSection]--;
+    if (iEnabled == 0)
+      FEnabled[Entry.eSection].erase(iKey);
+    if (!Entry.boolExists)
+      FMissing[Entry.eSection]--;
+    if (!FUnresolved[iEntryID].empty())
+      FUnresolvedCount[Entry.eSection]--;
+  }
+  if (Changed != NULL) {
+    const TEMEntryIDList& Group = Duplicates.Group(iKey);
+    if (Group.size() == 1)
+      Changed->push_back(Group[0]);
+    Changed->push_back(iEntryID);
+  }
+}
+
+/**
+
+  This method adds the values of the given registry section to the entries. Experts are stored as
+  Name=FileName and packages as FileName=Description where a description starting with a double
+  underscore denotes a disabled package.
+
+  @precon  None.
+  @postcon The entries of the section are added and indexed.
+
+  @param   Snapshot     as a TEMRegistrySnapshot as a constant reference
+  @param   strRegPath   as a std::wstring as a constant reference
+  @param   strSection   as a std::wstring as a constant reference
+  @param   eSection     as a TEMSection as a constant
+  @param   boolEnabled  as a bool as a constant
+  @param   boolPackages as a bool as a constant
+
+**/
+void TEMInstallationEntries::LoadSection(const TEMRegistrySnapshot& Snapshot,
+  const std::wstring& strRegPath, const std::wstring& strSection, const TEMSection eSection,
+  const bool boolEnabled, const bool boolPackages) {
+  TEMRegValueList Values;
+  Snapshot.ReadSectionValues(strRegPath, strSection, Values);
+  for (size_t i = 0; i < Values.size(); i++) {
+    TEMEntry Entry;
+    Entry.eSection = eSection;
+    Entry.boolEnabled = boolEnabled;
+    Entry.boolExists = false;
+    Entry.boolDeleted = false;
+    if (boolPackages) {
+      Entry.FileName = TEMPath(Values[i].first);
+      if (Values[i].second.compare(0, 2, L"__") == 0) {
+        Entry.Name = TEMPath(Values[i].second.substr(2));
+        Entry.boolEnabled = false;
+      } else
+        Entry.Name = TEMPath(Values[i].second);
+    } else {
+      Entry.Name = TEMPath(Values[i].first);
+      Entry.FileName = TEMPath(Values[i].second);
+    }
+    FKeys.push_back(TEMDuplicateIndex::Key(Entry.FileName));
+    FEntries.push_back(Entry);
+    FUnresolved.push_back(TEMNameList());
+  }
+}
+
+/**
+
+  This method loads the experts (enabled and disabled), known IDE packages and known packages of
+  the installation at the given registry path and checks whether their files exist. All the
+  filenames are expanded first so that their directories can be listed in one batch.
+
+  @precon  None.
+  @postcon The entries of the installation are loaded and indexed.
+
+  @param   Snapshot   as a TEMRegistrySnapshot as a constant reference
+  @param   strRegPath as a std::wstring as a constant reference
+  @param   Macros     as a TEMMacroTable as a constant reference
+  @param   FileSystem as a TEMFileSystem as a reference
+
+**/
+void TEMInstallationEntries::Load(const TEMRegistrySnapshot& Snapshot,
+  const std::wstring& strRegPath, const TEMMacroTable& Macros, TEMFileSystem& FileSystem) {
+  Clear();
+  {
+    TEMTraceSpan Span("Entries.ReadSections", strRegPath);
+    LoadSection(Snapshot, strRegPath, strExperts, esExperts, true, false);
+    LoadSection(Snapshot, strRegPath, strDisabledExperts, esExperts, false, false);
+    LoadSection(Snapshot, strRegPath, strKnownIDEPackages, esKnownIDEPackages, true, true);
+    LoadSection(Snapshot, strRegPath, strKnownPackages, esKnownPackages, true, true);
+  }
+  TEMNameList FileNames;
+  {
+    TEMTraceSpan Span("Macros.Expand", strRegPath);
+    for (size_t i = 0; i < FEntries.size(); i++)
+      FileNames.push_back(Macros.Expand(FEntries[i].FileName.Text()));
+  }
+  {
+    TEMTraceSpan Span("FileSystem.Probe", strRegPath);
+    FileSystem.Prefetch(FileNames);
+    for (size_t i = 0; i < FEntries.size(); i++)
+      FEntries[i].boolExists = FileSystem.FileExists(FileNames[i]);
+  }
+  TEMTraceSpan Span("Entries.Duplicates", strRegPath);
+  for (size_t i = 0; i < FEntries.size(); i++)
+    Attach((int)i, NULL);
+}
+
+/**
+
+  This method replaces the entries of the installation with the given (already validated)
+  entries and their unresolved dependencies, e.g. as restored from the scan cache. Deleted entries
+  are dropped so the entries are given new IDs in the order given.
+
+  @precon  Unresolved must have an item for each entry.
+  @postcon The entries are replaced and indexed.
+
+  @param   Entries    as a std::vector<TEMEntry> as a constant reference
+  @param   Unresolved as a std::vector<TEMNameList> as a constant reference
+
+**/
+void TEMInstallationEntries::Assign(const std::vector<TEMEntry>& Entries,
+  const std::vector<TEMNameList>& Unresolved) {
+  Clear();
+  for (size_t i = 0; i < Entries.size(); i++)
+    if (!Entries[i].boolDeleted) {
+      FEntries.push_back(Entries[i]);
+      FKeys.push_back(TEMDuplicateIndex::Key(Entries[i].FileName));
+      FUnresolved.push_back(Unresolved[i]);
+    }
+  for (size_t i = 0; i < FEntries.size(); i++)
+    Attach((int)i, NULL);
+}
+
+/**
+
+  This method removes all the entries and resets the aggregate counts of the sections.
+
+  @precon  None.
+  @postcon The installation has no entries.
+
+**/
+void TEMInstallationEntries::Clear() {
+  FEntries.clear();
+  FKeys.clear();
+  FUnresolved.clear();
+  for (int i = esExperts; i <= esKnownPackages; i++) {
+    FDuplicates[i].Clear();
+    FEnabled[i].clear();
+    FMissing[i] = 0;
+    FDuplicateGroups[i] = 0;
+    FUnresolvedCount[i] = 0;
+  }
+}
+
+/**
+
+  This method returns the IDs of the entries in the given section in the order they were loaded.
+
+  @precon  None.
+  @postcon EntryIDs contains the IDs of the section's entries (excluding deleted entries).
+
+  @param   eSection as a TEMSection as a constant
+  @param   EntryIDs as a TEMEntryIDList as a reference
+
+**/
+void TEMInstallationEntries::Section(const TEMSection eSection, TEMEntryIDList& EntryIDs) const {
+  EntryIDs.clear();
+  for (size_t i = 0; i < FEntries.size(); i++)
+    if (FEntries[i].eSection == eSection && !FEntries[i].boolDeleted)
+      EntryIDs.push_back((int)i);
+}
+
+/**
+
+  This method returns the validation of a single entry for colouring the list views. An entry
+  whose file does not exist is an invalid path, else an entry with unresolved package dependencies
+  is missing dependencies, else an entry which shares its filename with any other entry in its
+  section (enabled or disabled) is a duplicate.
+
+  @precon  iEntryID must be a valid entry ID.
+  @postcon Returns the validation of the entry.
+
+  @param   iEntryID as an int as a constant
+  @return  a TExpertValidation
+
+**/
+TExpertValidation TEMInstallationEntries::EntryValidation(const int iEntryID) const {
+  const TEMEntry& Entry = FEntries[iEntryID];
+  if (!Entry.boolExists)
+    return evInvalidPaths;
+  if (!FUnresolved[iEntryID].empty())
+    return evMissingDependencies;
+  if (FDuplicates[Entry.eSection].Group(FKeys[iEntryID]).size() > 1)
+    return evDuplication;
+  return evOkay;
+}
+
+/**
+
+  This method returns the collective validation of the enabled entries in the given section. If
+  any enabled entries have unresolved package dependencies then evMissingDependencies else if any
+  two or more enabled entries have the same filename (not path) then evDuplication else if any
+  enabled entries have invalid paths then evInvalidPaths.
+
+  @precon  None.
+  @postcon Returns the validation of the section.
+
+  @param   eSection as a TEMSection as a constant
+  @return  a TExpertValidation
+
+**/
+TExpertValidation TEMInstallationEntries::SectionValidation(const TEMSection eSection) const {
+  if (FUnresolvedCount[eSection] > 0)
+    return evMissingDependencies;
+  if (FDuplicateGroups[eSection] > 0)
+    return evDuplication;
+  if (FMissing[eSection] > 0)
+    return evInvalidPaths;
+  return evOkay;
+}
+
+/**
+
+  This method returns the highest validation of the three sections of the installation.
+
+  @precon  None.
+  @postcon Returns the highest validation.
+
+  @return  a TExpertValidation
+
+**/
+TExpertValidation TEMInstallationEntries::Validation() const {
+  TExpertValidation eValidation = evOkay;
+  for (int i = esExperts; i <= esKnownPackages; i++)
+    if (SectionValidation((TEMSection)i) > eValidation)
+      eValidation = SectionValidation((TEMSection)i);
+  return eValidation;
+}
+
+/**
+
+  This method adds a new entry to the installation.
+
+  @precon  None.
+  @postcon The entry is added and indexed and its ID is returned. Changed contains the IDs of the
+           entries whose validation may have changed.
+
+  @param   Entry   as a TEMEntry as a constant reference
+  @param   Changed as a TEMEntryIDList as a reference
+  @return  an int
+
+**/
+int TEMInstallationEntries::Add(const TEMEntry& Entry, TEMEntryIDList& Changed) {
+  int iEntryID = (int)FEntries.size();
+  FEntries.push_back(Entry);
+  FEntries.back().boolDeleted = false;
+  FKeys.push_back(TEMDuplicateIndex::Key(Entry.FileName));
+  FUnresolved.push_back(TEMNameList());
+  Attach(iEntryID, &Changed);
+  return iEntryID;
+}
+
+/**
+
+  This method replaces the name, filename, enabled and exists state of the given entry (its
+  section and ID are unchanged). The entry's unresolved dependencies are cleared if its filename
+  changes as they are only known again after the next scan.
+
+  @precon  iEntryID must be a valid entry ID.
+  @postcon The entry is updated and re-indexed. Changed contains the IDs of the entries whose
+           validation may have changed.
+
+  @param   iEntryID as an int as a constant
+  @param   Entry    as a TEMEntry as a constant reference
+  @param   Changed  as a TEMEntryIDList as a reference
+
+**/
+void TEMInstallationEntries::Update(const int iEntryID, const TEMEntry& Entry,
+  TEMEntryIDList& Changed) {
+  Detach(iEntryID, &Changed);
+  TEMEntry& Existing = FEntries[iEntryID];
+  if (Existing.FileName != Entry.FileName)
+    FUnresolved[iEntryID].clear();
+  Existing.Name = Entry.Name;
+  Existing.FileName = Entry.FileName;
+  Existing.boolEnabled = Entry.boolEnabled;
+  Existing.boolExists = Entry.boolExists;
+  FKeys[iEntryID] = TEMDuplicateIndex::Key(Entry.FileName);
+  Attach(iEntryID, &Changed);
+}
+
+/**
+
+  This method removes the given entry from the installation. The entry's ID is not reused.
+
+  @precon  iEntryID must be a valid entry ID.
+  @postcon The entry is marked as deleted and no longer indexed. Changed contains the IDs of the
+           entries whose validation may have changed.
+
+  @param   iEntryID as an int as a constant
+  @param   Changed  as a TEMEntryIDList as a reference
+
+**/
+void TEMInstallationEntries::Remove(const int iEntryID, TEMEntryIDList& Changed) {
+  if (!FEntries[iEntryID].boolDeleted) {
+    Detach(iEntryID, &Changed);
+    FEntries[iEntryID].boolDeleted = true;
+  }
+}
+
+/**
+
+  This method sets the package dependencies of the given entry that could not be resolved.
+
+  @precon  iEntryID must be a valid entry ID.
+  @postcon The entry's unresolved dependencies are replaced and its section's count updated.
+
+  @param   iEntryID     as an int as a constant
+  @param   Dependencies as a TEMNameList as a constant reference
+
+**/
+void TEMInstallationEntries::SetUnresolvedDependencies(const int iEntryID,
+  const TEMNameList& Dependencies) {
+  const TEMEntry& Entry = FEntries[iEntryID];
+  bool boolCounted = Entry.boolEnabled && !Entry.boolDeleted;
+  if (boolCounted && !FUnresolved[iEntryID].empty())
+    FUnresolvedCount[Entry.eSection]--;
+  FUnresolved[iEntryID] = Dependencies;
+  if (boolCounted && !FUnresolved[iEntryID].empty())
+    FUnresolvedCount[Entry.eSection]++;
+}
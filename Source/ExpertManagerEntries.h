@@ -0,0 +1,104 @@
+#ifndef ExpertManagerEntriesH
+#define ExpertManagerEntriesH
+
+#include "ExpertManagerRegistryStore.h"
+#include "ExpertManagerMacros.h"
+#include "ExpertManagerFileSystem.h"
+#include "ExpertManagerPathPool.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+
+/**
+  This is an enumerate to define the state of the tree nodes as follows:
+    evNone         Denotes a standard tree node which does not represent an expert
+                   instance.
+    evOkay         A node for an expert instance that has all valid entries.
+    evInvalidPath  A node for an expert instance that has invalid paths / filenames.
+    evDuplication  A node     for an expert instance that has duplicate filenames (not paths).
+    evMissingDependencies A node for an expert instance with experts or packages that import
+                   packages which cannot be found or are of the wrong version.
+**/
+enum TExpertValidation {evNone, evOkay, evInvalidPaths, evDuplication, evMissingDependencies};
+
+/** An enumerate to define the sections of an installation that contain entries. The experts
+    section includes both the enabled (Experts) and disabled (Experts\Disabled) experts. **/
+enum TEMSection {esExperts, esKnownIDEPackages, esKnownPackages};
+
+/** A record to describe a single expert or package of an installation. The name and filename are
+    handles to the global path pool so that text shared by many entries is held once. **/
+struct TEMEntry {
+  TEMSection eSection;
+  TEMPath    Name;
+  TEMPath    FileName;
+  bool       boolEnabled;
+  bool       boolExists;
+  bool       boolDeleted;
+};
+
+/** A simplified type for a list of entry IDs. **/
+typedef std::vector<int> TEMEntryIDList;
+
+/** A simplified type for the key of an entry's duplicate group (the path pool ID of its case
+    folded filename without the path). **/
+typedef unsigned int TEMDuplicateKey;
+
+/** This class indexes entries by their case folded filename (not path) so that the other members
+    of an entry's duplicate group are found in constant time. **/
+class TEMDuplicateIndex {
+  private:
+    std::unordered_map<TEMDuplicateKey, TEMEntryIDList> FGroups;
+  public:
+    static TEMDuplicateKey Key(const TEMPath& FileName) { return FileName.FileNameKey(); };
+    void Add(const TEMDuplicateKey iKey, const int iEntryID);
+    void Remove(const TEMDuplicateKey iKey, const int iEntryID);
+    const TEMEntryIDList& Group(const TEMDuplicateKey iKey) const;
+    void Clear();
+};
+
+/** This class holds the experts and packages of a single installation with a stable ID per entry
+    and a duplicate index per section. Both the validation of the installation and the colouring
+    of the list views are derived from it. Each section keeps a count of its enabled entries with
+    missing files, of its duplicate groups and of its enabled entries with unresolved package
+    dependencies so that an edit to a single entry revalidates the
+    section in constant time and reports only the entries whose validation may have changed. **/
+class TEMInstallationEntries {
+  private:
+    std::vector<TEMEntry>                FEntries;
+    std::vector<TEMDuplicateKey>         FKeys;
+    TEMDuplicateIndex                    FDuplicates[3];
+    std::unordered_map<TEMDuplicateKey, int> FEnabled[3];
+    int                                  FMissing[3];
+    int                                  FDuplicateGroups[3];
+    std::vector<TEMNameList>             FUnresolved;
+    int                                  FUnresolvedCount[3];
+    void Clear();
+    void Attach(const int iEntryID, TEMEntryIDList* Changed);
+    void Detach(const int iEntryID, TEMEntryIDList* Changed);
+    void LoadSection(const TEMRegistrySnapshot& Snapshot, const std::wstring& strRegPath,
+      const std::wstring& strSection, const TEMSection eSection, const bool boolEnabled,
+      const bool boolPackages);
+  public:
+    TEMInstallationEntries();
+    void Load(const TEMRegistrySnapshot& Snapshot, const std::wstring& strRegPath,
+      const TEMMacroTable& Macros, TEMFileSystem& FileSystem);
+    void Assign(const std::vector<TEMEntry>& Entries, const std::vector<TEMNameList>& Unresolved);
+    size_t Count() const { return FEntries.size(); };
+    const TEMEntry& Entry(const int iEntryID) const { return FEntries[iEntryID]; };
+    void Section(const TEMSection eSection, TEMEntryIDList& EntryIDs) const;
+    TExpertValidation EntryValidation(const int iEntryID) const;
+    TExpertValidation SectionValidation(const TEMSection eSection) const;
+    TExpertValidation Validation() const;
+    int Add(const TEMEntry& Entry, TEMEntryIDList& Changed);
+    void Update(const int iEntryID, const TEMEntry& Entry, TEMEntryIDList& Changed);
+    void Remove(const int iEntryID, TEMEntryIDList& Changed);
+    const TEMNameList& UnresolvedDependencies(const int iEntryID) const {
+      return FUnresolved[iEntryID]; };
+    void SetUnresolvedDependencies(const int iEntryID, const TEMNameList& Dependencies);
+};
+
+/** A simplified type for a shared instance of an installations entries. **/
+typedef std::shared_ptr<TEMInstallationEntries> TEMEntriesPtr;
+
+#endif
@@ -0,0 +1,340 @@
+#pragma hdrstop
+
+#include "ExpertManagerFileSystem.h"
+#include "ExpertManagerTrace.h"
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <sys/stat.h>
+  #include <dirent.h>
+#endif
+
+#pragma package(smart_init)
+
+/**
+
+  This method returns true if the given file exists and is not a directory.
+
+  @precon  None.
+  @postcon Returns whether the file exists.
+
+  @param   strFileName as a std::wstring as a constant reference
+  @return  a bool
+
+**/
+bool TEMNativeFileSystem::FileExists(const std::wstring& strFileName) {
+#ifdef _WIN32
+  DWORD iAttributes = GetFileAttributesW(strFileName.c_str());
+  return iAttributes != INVALID_FILE_ATTRIBUTES && (iAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0;
+#else
+  struct stat FileInfo;
+  return stat(EMWideToUTF8(strFileName).c_str(), &FileInfo) == 0 && S_ISREG(FileInfo.st_mode);
+#endif
+}
+
+/**
+
+  This method returns the last write time stamp of the given directory.
+
+  @precon  None.
+  @postcon Returns true with the time stamp if the directory exists else returns false.
+
+  @param   strDirectory as a std::wstring as a constant reference
+  @param   iTimeStamp   as a long long as a reference
+  @return  a bool
+
+**/
+bool TEMNativeFileSystem::GetTimeStamp(const std::wstring& strDirectory, long long& iTimeStamp) {
+#ifdef _WIN32
+  WIN32_FILE_ATTRIBUTE_DATA Info;
+  if (!GetFileAttributesExW(strDirectory.c_str(), GetFileExInfoStandard, &Info))
+    return false;
+  iTimeStamp = ((long long)Info.ftLastWriteTime.dwHighDateTime << 32) |
+    Info.ftLastWriteTime.dwLowDateTime;
+  return true;
+#else
+  struct stat FileInfo;
+  if (stat(EMWideToUTF8(strDirectory).c_str(), &FileInfo) != 0)
+    return false;
+  iTimeStamp = (long long)FileInfo.st_mtime;
+  return true;
+#endif
+}
+
+/**
+
+  This method returns the names of the files (not sub-directories) in the given directory.
+
+  @precon  None.
+  @postcon Returns true with the filenames if the directory exists else returns false.
+
+  @param   strDirectory as a std::wstring as a constant reference
+  @param   FileNames    as a TEMNameList as a reference
+  @return  a bool
+
+**/
+bool TEMNativeFileSystem::ListDirectory(const std::wstring& strDirectory, TEMNameList& FileNames) {
+  FileNames.clear();
+#ifdef _WIN32
+  WIN32_FIND_DATAW FindData;
+  HANDLE hFind = FindFirstFileExW((strDirectory + L"\\*").c_str(), FindExInfoBasic, &FindData,
+    FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+  if (hFind == INVALID_HANDLE_VALUE)
+    return false;
+  do {
+    if ((FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+      FileNames.push_back(FindData.cFileName);
+  } while (FindNextFileW(hFind, &FindData));
+  FindClose(hFind);
+  return true;
+#else
+  DIR* Dir = opendir(EMWideToUTF8(strDirectory).c_str());
+  if (Dir == NULL)
+    return false;
+  while (struct dirent* Entry = readdir(Dir))
+    if (Entry->d_type != DT_DIR)
+      FileNames.push_back(EMUTF8ToWide(Entry->d_name, std::char_traits<char>::length(Entry->d_name)));
+  closedir(Dir);
+  return true;
+#endif
+}
+
+/**
+
+  This method adds the given file (and so its directory) to the memory file system.
+
+  @precon  None.
+  @postcon The file exists.
+
+  @param   strFileName as a std::wstring as a constant reference
+
+**/
+void TEMMemoryFileSystem::AddFile(const std::wstring& strFileName) {
+  if (!FFiles.insert(EMFoldCase(strFileName)).second)
+    return;
+  size_t iPos = strFileName.find_last_of(L"\\/");
+  if (iPos != std::wstring::npos)
+    FDirectories[EMFoldCase(strFileName.substr(0, iPos))].push_back(strFileName.substr(iPos + 1));
+}
+
+/**
+
+  This method returns true if the given file has been added.
+
+  @precon  None.
+  @postcon Returns whether the file exists.
+
+  @param   strFileName as a std::wstring as a constant reference
+  @return  a bool
+
+**/
+bool TEMMemoryFileSystem::FileExists(const std::wstring& strFileName) {
+  return FFiles.find(EMFoldCase(strFileName)) != FFiles.end();
+}
+
+/**
+
+  This method returns a time stamp of zero for any directory that contains a file.
+
+  @precon  None.
+  @postcon Returns true if the directory exists.
+
+  @param   strDirectory as a std::wstring as a constant reference
+  @param   iTimeStamp   as a long long as a reference
+  @return  a bool
+
+**/
+bool TEMMemoryFileSystem::GetTimeStamp(const std::wstring& strDirectory, long long& iTimeStamp) {
+  iTimeStamp = 0;
+  return FDirectories.find(EMFoldCase(strDirectory)) != FDirectories.end();
+}
+
+/**
+
+  This method returns the names of the files in the given directory.
+
+  @precon  None.
+  @postcon Returns true with the file names if the directory exists.
+
+  @param   strDirectory as a std::wstring as a constant reference
+  @param   FileNames    as a TEMNameList as a reference
+  @return  a bool
+
+**/
+bool TEMMemoryFileSystem::ListDirectory(const std::wstring& strDirectory, TEMNameList& FileNames) {
+  auto Directory = FDirectories.find(EMFoldCase(strDirectory));
+  if (Directory == FDirectories.end()) {
+    FileNames.clear();
+    return false;
+  }
+  FileNames = Directory->second;
+  return true;
+}
+
+/**
+
+  This is the constructor for the cached file system class.
+
+  @precon  FileSystem must be a valid instance.
+  @postcon Takes ownership of the file system that is used to list the directories.
+
+  @param   FileSystem as a TEMFileSystem pointer
+
+**/
+TEMCachedFileSystem::TEMCachedFileSystem(TEMFileSystem* FileSystem) : FFileSystem(FileSystem),
+  FGeneration(0) {}
+
+/**
+
+  This method splits the given filename into its directory and name.
+
+  @precon  None.
+  @postcon Returns true if the filename has a directory.
+
+  @param   strFileName  as a std::wstring as a constant reference
+  @param   strDirectory as a std::wstring as a reference
+  @param   strName      as a std::wstring as a reference
+  @return  a bool
+
+**/
+bool TEMCachedFileSystem::SplitFileName(const std::wstring& strFileName, std::wstring& strDirectory,
+  std::wstring& strName) {
+  size_t iPos = strFileName.find_last_of(L"\\/");
+  if (iPos == std::wstring::npos || iPos == 0 || iPos == strFileName.length() - 1)
+    return false;
+  strDirectory = strFileName.substr(0, iPos);
+  strName = strFileName.substr(iPos + 1);
+  return true;
+}
+
+/**
+
+  This method returns the listing of the given directory. A listing from an earlier generation is
+  only re-read if the directory's time stamp has changed. The directory is listed outside the lock
+  so that workers probing different directories do not wait for each other.
+
+  @precon  None.
+  @postcon Returns the current listing of the directory.
+
+  @param   strDirectory as a std::wstring as a constant reference
+  @return  a TEMDirectoryListingPtr
+
+**/
+TEMCachedFileSystem::TEMDirectoryListingPtr TEMCachedFileSystem::GetListing(
+  const std::wstring& strDirectory) {
+  std::wstring strKey = EMFoldCase(strDirectory);
+  unsigned int iGeneration = FGeneration;
+  TEMDirectoryListingPtr Listing;
+  {
+    std::lock_guard<std::mutex> Lock(FLock);
+    std::unordered_map<std::wstring, TEMDirectoryListingPtr>::iterator i = FDirectories.find(strKey);
+    if (i != FDirectories.end())
+      Listing = i->second;
+  }
+  if (Listing && Listing->iGeneration == iGeneration)
+    return Listing;
+  TEMTraceSpan Span("FileSystem.ListDirectory", strDirectory);
+  long long iTimeStamp = 0;
+  bool boolExists = FFileSystem->GetTimeStamp(strDirectory, iTimeStamp);
+  if (Listing && Listing->boolExists == boolExists && Listing->iTimeStamp == iTimeStamp) {
+    Listing->iGeneration = iGeneration;
+    return Listing;
+  }
+  TEMDirectoryListingPtr NewListing(new TEMDirectoryListing());
+  NewListing->iTimeStamp = iTimeStamp;
+  NewListing->iGeneration = iGeneration;
+  TEMNameList FileNames;
+  NewListing->boolExists = boolExists && FFileSystem->ListDirectory(strDirectory, FileNames);
+  for (size_t i = 0; i < FileNames.size(); i++)
+    NewListing->FileNames.insert(EMFoldCase(FileNames[i]));
+  std::lock_guard<std::mutex> Lock(FLock);
+  FDirectories[strKey] = NewListing;
+  return NewListing;
+}
+
+/**
+
+  This method returns true if the given file exists by looking it up in the cached listing of its
+  directory.
+
+  @precon  None.
+  @postcon Returns whether the file exists.
+
+  @param   strFileName as a std::wstring as a constant reference
+  @return  a bool
+
+**/
+bool TEMCachedFileSystem::FileExists(const std::wstring& strFileName) {
+  std::wstring strDirectory, strName;
+  if (!SplitFileName(strFileName, strDirectory, strName))
+    return FFileSystem->FileExists(strFileName);
+  TEMDirectoryListingPtr Listing = GetListing(strDirectory);
+  return Listing->FileNames.find(EMFoldCase(strName)) != Listing->FileNames.end();
+}
+
+/**
+
+  This method returns the time stamp of the given directory from the underlying file system.
+
+  @precon  None.
+  @postcon Returns true with the time stamp if the directory exists.
+
+  @param   strDirectory as a std::wstring as a constant reference
+  @param   iTimeStamp   as a long long as a reference
+  @return  a bool
+
+**/
+bool TEMCachedFileSystem::GetTimeStamp(const std::wstring& strDirectory, long long& iTimeStamp) {
+  return FFileSystem->GetTimeStamp(strDirectory, iTimeStamp);
+}
+
+/**
+
+  This method returns the names of the files in the given directory from the underlying file
+  system.
+
+  @precon  None.
+  @postcon Returns true with the filenames if the directory exists.
+
+  @param   strDirectory as a std::wstring as a constant reference
+  @param   FileNames    as a TEMNameList as a reference
+  @return  a bool
+
+**/
+bool TEMCachedFileSystem::ListDirectory(const std::wstring& strDirectory, TEMNameList& FileNames) {
+  return FFileSystem->ListDirectory(strDirectory, FileNames);
+}
+
+/**
+
+  This method groups the given filenames by their directories and makes sure that each distinct
+  directory is listed once before the files are looked up.
+
+  @precon  None.
+  @postcon All the directories of the given files are cached.
+
+  @param   FileNames as a TEMNameList as a constant reference
+
+**/
+void TEMCachedFileSystem::Prefetch(const TEMNameList& FileNames) {
+  std::unordered_map<std::wstring, std::wstring> Directories;
+  std::wstring strDirectory, strName;
+  for (size_t i = 0; i < FileNames.size(); i++)
+    if (SplitFileName(FileNames[i], strDirectory, strName))
+      Directories.insert(std::make_pair(EMFoldCase(strDirectory), strDirectory));
+  for (auto Directory : Directories)
+    GetListing(Directory.second);
+}
+
+/**
+
+  This method starts a new generation so that the next lookup in each directory checks the
+  directory's time stamp and re-lists it if it has changed.
+
+  @precon  None.
+  @postcon The cached listings will be re-validated on their next use.
+
+**/
+void TEMCachedFileSystem::Invalidate() {
+  FGeneration++;
+}
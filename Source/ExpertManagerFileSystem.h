@@ -0,0 +1,74 @@
+#ifndef ExpertManagerFileSystemH
+#define ExpertManagerFileSystemH
+
+#include "ExpertManagerStrings.h"
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+/** This is an abstract class to represent the file system that expert and package filenames are
+    validated against. Implementations must be safe to call from any thread. **/
+class TEMFileSystem {
+  public:
+    virtual ~TEMFileSystem() {};
+    virtual bool FileExists(const std::wstring& strFileName) = 0;
+    virtual bool GetTimeStamp(const std::wstring& strDirectory, long long& iTimeStamp) = 0;
+    virtual bool ListDirectory(const std::wstring& strDirectory, TEMNameList& FileNames) = 0;
+    virtual void Prefetch(const TEMNameList& /*FileNames*/) {};
+};
+
+/** A file system which probes the operating system's file system directly. **/
+class TEMNativeFileSystem : public TEMFileSystem {
+  public:
+    bool FileExists(const std::wstring& strFileName);
+    bool GetTimeStamp(const std::wstring& strDirectory, long long& iTimeStamp);
+    bool ListDirectory(const std::wstring& strDirectory, TEMNameList& FileNames);
+};
+
+/** A file system held in memory (e.g. for benchmarks) whose files are all added before it is
+    shared with other threads. Directories exist if they contain a file and never change. **/
+class TEMMemoryFileSystem : public TEMFileSystem {
+  private:
+    std::unordered_set<std::wstring>              FFiles;
+    std::unordered_map<std::wstring, TEMNameList> FDirectories;
+  public:
+    void AddFile(const std::wstring& strFileName);
+    bool FileExists(const std::wstring& strFileName);
+    bool GetTimeStamp(const std::wstring& strDirectory, long long& iTimeStamp);
+    bool ListDirectory(const std::wstring& strDirectory, TEMNameList& FileNames);
+    size_t Count() const { return FFiles.size(); };
+};
+
+/** A file system which answers FileExists by listing each parent directory once into a case
+    insensitive hash set. The listings are shared by all installations and threads and are only
+    re-read when the directory's time stamp has changed since the last generation. **/
+class TEMCachedFileSystem : public TEMFileSystem {
+  private:
+    /** A record to describe the cached listing of a single directory. **/
+    struct TEMDirectoryListing {
+      bool                             boolExists;
+      long long                        iTimeStamp;
+      std::atomic<unsigned int>        iGeneration;
+      std::unordered_set<std::wstring> FileNames;
+    };
+    typedef std::shared_ptr<TEMDirectoryListing> TEMDirectoryListingPtr;
+    std::unique_ptr<TEMFileSystem>                         FFileSystem;
+    std::mutex                                             FLock;
+    std::unordered_map<std::wstring, TEMDirectoryListingPtr> FDirectories;
+    std::atomic<unsigned int>                              FGeneration;
+    static bool SplitFileName(const std::wstring& strFileName, std::wstring& strDirectory,
+      std::wstring& strName);
+    TEMDirectoryListingPtr GetListing(const std::wstring& strDirectory);
+  public:
+    TEMCachedFileSystem(TEMFileSystem* FileSystem);
+    bool FileExists(const std::wstring& strFileName);
+    bool GetTimeStamp(const std::wstring& strDirectory, long long& iTimeStamp);
+    bool ListDirectory(const std::wstring& strDirectory, TEMNameList& FileNames);
+    void Prefetch(const TEMNameList& FileNames);
+    void Invalidate();
+};
+
+#endif
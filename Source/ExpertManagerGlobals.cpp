@@ -26,4 +26,10 @@ wchar_t strKnownIDEPackagesListWidth[] = L"KnownIDEPackagesListWidth";
 wchar_t strKnownPackagesListWidth[] = L"KnownPackagesListWidth";
 wchar_t strFocusedPage[] = L"FocusedPage";
 wchar_t strSelectedNode[] = L"SelectedNode";
+/** A string constant for the setup value which turns on lazy validation of the installations. **/
+wchar_t strLazyValidation[] = L"LazyValidation";
+/** A string constant for the scan cache file relative to the user's application data folder. **/
+wchar_t strScanCacheFile[] = L"Season's Fall\\Expert Manager\\ScanCache.bin";
+/** A string constant for the expanded nodes file relative to the user's application data folder. **/
+wchar_t strExpandedNodesFile[] = L"Season's Fall\\Expert Manager\\ExpandedNodes.txt";
 
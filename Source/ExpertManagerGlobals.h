@@ -1,7 +1,6 @@
 #ifndef ExpertManagerGlobalsH
 #define ExpertManagerGlobalsH
 
-#include "system.hpp"
 #include <string>
 extern wchar_t strRegSettings[];
 extern wchar_t strExperts[];
@@ -19,6 +18,9 @@ extern wchar_t strKnownIDEPackagesListWidth[];
 extern wchar_t strKnownPackagesListWidth[];
 extern wchar_t strFocusedPage[];
 extern wchar_t strSelectedNode[];
+extern wchar_t strScanCacheFile[];
+extern wchar_t strExpandedNodesFile[];
+extern wchar_t strLazyValidation[];
 #endif
 
 
@@ -0,0 +1,242 @@
+#pragma hdrstop
+
+#include "ExpertManagerHeadless.h"
+#include "ExpertManagerWorkerPool.h"
+#include "ExpertManagerUsageIndex.h"
+#include <sstream>
+#include <algorithm>
+
+#pragma package(smart_init)
+
+/** The names used for the validations in the JSON records. **/
+static const char* strValidations[5] = {"none", "okay", "invalidPaths", "duplication",
+  "missingDependencies"};
+/** The names used for the sections in the JSON records. **/
+static const char* strSections[3] = {"experts", "knownIDEPackages", "knownPackages"};
+
+/** A record of the outcome of a single installation's headless scan job. **/
+struct TEMHeadlessResult {
+  size_t            iIndex;
+  TExpertValidation eValidation;
+  std::string       strJSON;
+};
+
+/**
+
+  This method returns the JSON lines for the given installation result. The first line is a record
+  of the installation and its section validations and it is followed by a record for each of its
+  experts and packages.
+
+  @precon  Result.Entries must be a valid instance.
+  @postcon Returns the JSON lines each terminated with a new line.
+
+  @param   Result as a TEMInstallationResult as a constant reference
+  @param   Macros as a TEMMacroTable as a constant reference
+  @return  a std::string
+
+**/
+std::string EMInstallationJSON(const TEMInstallationResult& Result, const TEMMacroTable& Macros) {
+  const TEMInstallationEntries& Entries = *Result.Entries;
+  std::string strPath = EMJSONString(Result.strRegPath);
+  std::ostringstream Stream;
+  Stream << "{\"type\":\"installation\",\"path\":" << strPath
+    << ",\"status\":\"" << strValidations[Entries.Validation()] << '"';
+  for (int i = esExperts; i <= esKnownPackages; i++)
+    Stream << ",\"" << strSections[i] << "\":\""
+      << strValidations[Entries.SectionValidation((TEMSection)i)] << '"';
+  Stream << ",\"entries\":" << Entries.Count() << "}\n";
+  for (size_t i = 0; i < Entries.Count(); i++) {
+    const TEMEntry& Entry = Entries.Entry((int)i);
+    const std::wstring strFileName = Entry.FileName.Text();
+    Stream << "{\"type\":\"entry\",\"installation\":" << strPath
+      << ",\"section\":\"" << strSections[Entry.eSection] << '"'
+      << ",\"name\":" << EMJSONString(Entry.Name.Text())
+      << ",\"fileName\":" << EMJSONString(strFileName)
+      << ",\"expandedFileName\":" << EMJSONString(Macros.Expand(strFileName))
+      << ",\"enabled\":" << (Entry.boolEnabled ? "true" : "false")
+      << ",\"exists\":" << (Entry.boolExists ? "true" : "false")
+      << ",\"status\":\"" << strValidations[Entries.EntryValidation((int)i)] << '"';
+    const TEMNameList& Unresolved = Entries.UnresolvedDependencies((int)i);
+    if (!Unresolved.empty()) {
+      Stream << ",\"missingDependencies\":[";
+      for (size_t j = 0; j < Unresolved.size(); j++)
+        Stream << (j > 0 ? "," : "") << EMJSONString(Unresolved[j]);
+      Stream << ']';
+    }
+    Stream << "}\n";
+  }
+  return Stream.str();
+}
+
+/**
+
+  This method reads the installation roots of the given registry store into a snapshot and finds
+  the RAD Studio installations in it as per the tree view.
+
+  @precon  None.
+  @postcon Returns the snapshot and Installations contains the installations' registry paths
+           sorted (ignoring case) so that the output does not depend on the store's order.
+
+  @param   Store         as a TEMRegistryStore as a reference
+  @param   Installations as a TEMNameList as a reference
+  @return  a TEMSnapshotPtr
+
+**/
+static TEMSnapshotPtr FindInstallations(TEMRegistryStore& Store, TEMNameList& Installations) {
+  const wchar_t* strInstallationRoots[3] = {L"Borland", L"CodeGear", L"Embarcadero"};
+  TEMNameList Roots;
+  for (auto strInstallation : strInstallationRoots)
+    Roots.push_back(std::wstring(L"Software\\") + strInstallation);
+  TEMSnapshotPtr Snapshot = TEMRegistrySnapshot::Create(Store, Roots,
+    TEMRegistrySnapshot::InstallationFilter);
+  EMFindInstallations(*Snapshot, Roots, Installations);
+  std::sort(Installations.begin(), Installations.end(),
+    [](const std::wstring& strRegPath1, const std::wstring& strRegPath2) {
+      return EMFoldCase(strRegPath1) < EMFoldCase(strRegPath2);
+    });
+  return Snapshot;
+}
+
+/**
+
+  This method scans the RAD Studio installations in the given registry store without any user
+  interface. The registry is read once into a snapshot, the installations are found as per the
+  tree view and each installation is validated as a job on a worker pool. The workers format their
+  own records and the calling thread writes each installation's records to the stream as soon as
+  it and all the installations before it (in registry path order) have completed.
+
+  @precon  None.
+  @postcon The JSON lines for each installation are written to the stream and the highest
+           validation of all the installations is returned.
+
+  @param   Store      as a TEMRegistryStore as a reference
+  @param   FileSystem as a TEMFileSystem as a reference
+  @param   Stream     as a std::ostream as a reference
+  @param   iThreads   as a size_t as a constant
+  @return  a TExpertValidation
+
+**/
+TExpertValidation EMHeadlessScan(TEMRegistryStore& Store, TEMFileSystem& FileSystem,
+  std::ostream& Stream, const size_t iThreads) {
+  TEMNameList Installations;
+  TEMSnapshotPtr Snapshot = FindInstallations(Store, Installations);
+  TEMMacroCache MacroCache;
+  TEMModuleCache ModuleCache;
+  TEMInstallationScanner Scanner(Snapshot, FileSystem, MacroCache, &ModuleCache);
+  TEMResultQueue<TEMHeadlessResult> Results;
+  TExpertValidation eValidation = evNone;
+  {
+    TEMWorkerPool WorkerPool(iThreads);
+    for (size_t i = 0; i < Installations.size(); i++) {
+      std::wstring strRegPath = Installations[i];
+      WorkerPool.Submit([&Snapshot, &MacroCache, &Scanner, &Results, strRegPath, i]() {
+        TEMHeadlessResult Result;
+        Result.iIndex = i;
+        try {
+          TEMMacroTablePtr Macros = MacroCache.Get(*Snapshot, strRegPath);
+          TEMInstallationResult Installation = Scanner.Scan(strRegPath, *Macros);
+          Result.eValidation = Installation.Validation();
+          Result.strJSON = EMInstallationJSON(Installation, *Macros);
+        } catch (...) {
+          Result.eValidation = evNone;
+          Result.strJSON = "{\"type\":\"error\",\"installation\":" + EMJSONString(strRegPath) +
+            "}\n";
+        }
+        Results.Push(Result);
+      });
+    }
+    std::vector<TEMHeadlessResult> Items;
+    std::vector<std::string> Completed(Installations.size());
+    std::vector<bool> Received(Installations.size(), false);
+    size_t iWritten = 0;
+    while (iWritten < Installations.size()) {
+      Results.Drain(Items, 100);
+      for (size_t i = 0; i < Items.size(); i++) {
+        Completed[Items[i].iIndex].swap(Items[i].strJSON);
+        Received[Items[i].iIndex] = true;
+        if (Items[i].eValidation > eValidation)
+          eValidation = Items[i].eValidation;
+      }
+      for (; iWritten < Installations.size() && Received[iWritten]; iWritten++) {
+        Stream << Completed[iWritten];
+        Completed[iWritten].clear();
+      }
+      Stream.flush();
+    }
+  }
+  return eValidation;
+}
+
+/**
+
+  This method scans the RAD Studio installations in the given registry store into a usage index
+  and writes a JSON record of type usage for each expert or package of any installation which
+  references the given file. If the filename includes a folder only entries whose expanded
+  filename is that path are written else entries with that filename in any folder are written.
+
+  @precon  None.
+  @postcon The usage records are written to the stream in installation order and the number of
+           usages is returned.
+
+  @param   Store       as a TEMRegistryStore as a reference
+  @param   FileSystem  as a TEMFileSystem as a reference
+  @param   strFileName as a std::wstring as a constant reference
+  @param   Stream      as a std::ostream as a reference
+  @param   iThreads    as a size_t as a constant
+  @return  a size_t
+
+**/
+size_t EMHeadlessUsedBy(TEMRegistryStore& Store, TEMFileSystem& FileSystem,
+  const std::wstring& strFileName, std::ostream& Stream, const size_t iThreads) {
+  TEMNameList Installations;
+  TEMSnapshotPtr Snapshot = FindInstallations(Store, Installations);
+  TEMMacroCache MacroCache;
+  TEMInstallationScanner Scanner(Snapshot, FileSystem, MacroCache);
+  TEMResultQueue<TEMInstallationResult> Results;
+  TEMUsageIndex Index;
+  {
+    TEMWorkerPool WorkerPool(iThreads);
+    for (size_t i = 0; i < Installations.size(); i++) {
+      std::wstring strRegPath = Installations[i];
+      int iID = (int)i;
+      WorkerPool.Submit([&Scanner, &Results, strRegPath, iID]() {
+        TEMInstallationResult Result;
+        try {
+          Result = Scanner.Scan(strRegPath);
+        } catch (...) {
+          Result.strRegPath = strRegPath;
+        }
+        Result.iID = iID;
+        Results.Push(Result);
+      });
+    }
+    std::vector<TEMInstallationResult> Items;
+    size_t iReceived = 0;
+    while (iReceived < Installations.size()) {
+      Results.Drain(Items, 100);
+      for (size_t i = 0; i < Items.size(); i++)
+        if (Items[i].Entries)
+          Index.SetInstallation(Items[i].iID, Items[i].Entries,
+            *MacroCache.Get(*Snapshot, Items[i].strRegPath));
+      iReceived += Items.size();
+    }
+  }
+  TEMUsageList Usages = strFileName.find_first_of(L"\\/") != std::wstring::npos ?
+    Index.FindPath(strFileName) : Index.FindFileName(strFileName);
+  std::sort(Usages.begin(), Usages.end(), EMUsageLess);
+  std::string strFile = EMJSONString(strFileName);
+  for (size_t i = 0; i < Usages.size(); i++) {
+    const std::wstring& strRegPath = Installations[Usages[i].iInstallationID];
+    const TEMEntry& Entry = Index.Entries(Usages[i].iInstallationID)->Entry(Usages[i].iEntryID);
+    const std::wstring strEntryFileName = Entry.FileName.Text();
+    Stream << "{\"type\":\"usage\",\"file\":" << strFile
+      << ",\"installation\":" << EMJSONString(strRegPath)
+      << ",\"section\":\"" << strSections[Entry.eSection] << '"'
+      << ",\"name\":" << EMJSONString(Entry.Name.Text())
+      << ",\"fileName\":" << EMJSONString(strEntryFileName)
+      << ",\"expandedFileName\":"
+      << EMJSONString(MacroCache.Get(*Snapshot, strRegPath)->Expand(strEntryFileName))
+      << ",\"enabled\":" << (Entry.boolEnabled ? "true" : "false") << "}\n";
+  }
+  return Usages.size();
+}
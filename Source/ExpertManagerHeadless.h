@@ -0,0 +1,14 @@
+#ifndef ExpertManagerHeadlessH
+#define ExpertManagerHeadlessH
+
+#include "ExpertManagerScanner.h"
+#include <string>
+#include <ostream>
+
+std::string EMInstallationJSON(const TEMInstallationResult& Result, const TEMMacroTable& Macros);
+TExpertValidation EMHeadlessScan(TEMRegistryStore& Store, TEMFileSystem& FileSystem,
+  std::ostream& Stream, const size_t iThreads = 0);
+size_t EMHeadlessUsedBy(TEMRegistryStore& Store, TEMFileSystem& FileSystem,
+  const std::wstring& strFileName, std::ostream& Stream, const size_t iThreads = 0);
+
+#endif
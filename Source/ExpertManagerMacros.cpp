@@ -0,0 +1,266 @@
+#pragma hdrstop
+
+#include "ExpertManagerMacros.h"
+#include "ExpertManagerTrace.h"
+#include <regex>
+#include <cstdlib>
+#include <cwctype>
+#ifdef _WIN32
+  #include <windows.h>
+#endif
+
+#pragma package(smart_init)
+
+/**
+
+  This is the default constructor for the macro table class.
+
+  @precon  None.
+  @postcon Creates an empty table which expands nothing.
+
+**/
+TEMMacroTable::TEMMacroTable() : FMaxValueLength(0) {}
+
+/**
+
+  This is the constructor for the macro table class. It creates the macros for the RAD Studio
+  installation at the given registry path from the installations RootDir and its Environment
+  Variables.
+
+  @precon  None.
+  @postcon The macro table is populated with the system and user macros for the installation.
+
+  @param   Snapshot   as a TEMRegistrySnapshot as a constant reference
+  @param   strRegPath as a std::wstring as a constant reference
+
+**/
+TEMMacroTable::TEMMacroTable(const TEMRegistrySnapshot& Snapshot, const std::wstring& strRegPath) :
+  FMaxValueLength(0) {
+  TEMTraceSpan Span("Macros.Build", strRegPath);
+  static const std::wregex BDSPathPattern(
+    L"((Embarcadero|CodeGear|Borland)\\\\[\\w\\s]+)\\\\(\\d+.\\d)", std::regex::icase);
+  // Create system wide enviroment variables
+  std::wstring strRootDir = Snapshot.ReadString(strRegPath, L"", L"RootDir", L"");
+  if (strRootDir.length() > 0) {
+    AddMacro(L"$(BDS)", strRootDir);
+    AddMacro(L"$(BCB)", strRootDir);
+    AddMacro(L"$(BDSBIN)", strRootDir + L"\\Bin");
+    AddMacro(L"$(BDSINCLUDE)", strRootDir + L"\\Include");
+    AddMacro(L"$(BDSLIB)", strRootDir + L"\\Lib");
+    AddMacro(L"$(DELPHI)", strRootDir);
+    // Disect path
+    std::wstring strName = L"Embarcadero\\Studio";
+    std::wstring strNumber = L"0.0";
+    std::wsmatch M;
+    if (std::regex_search(strRootDir, M, BDSPathPattern)) {
+      strName = M[1].str();
+      strNumber = M[3].str();
+    }
+    // Create extended paths
+    AddMacro(L"$(BDSCATALOGREPOSITORY)",
+      L"%userprofile%\\Documents\\" + strName + L"\\" + strNumber + L"\\CatalogRepository");
+    AddMacro(L"$(BDSCatalogRepositoryAllUsers)",
+      L"%public%\\Documents\\" + strName + L"\\" + strNumber + L"\\CatalogRepository");
+    AddMacro(L"$(BDSCOMMONDIR)", L"%public%\\Documents\\" + strName + L"\\" + strNumber);
+    AddMacro(L"$(BDSPLATFORMSDIR)", L"%userprofile%\\Documents\\" + strName + L"\\SDKs");
+    AddMacro(L"$(BDSPROFILEDIR)", L"%userprofile%\\Documents\\" + strName + L"\\Profiles");
+    AddMacro(L"$(BDSPROJECTDIR)", L"%userprofile%\\Documents\\" + strName + L"\\Projects");
+    AddMacro(L"$(BDSUSERDIR)", L"%userprofile%\\Documents\\" + strName + L"\\" + strNumber);
+    // Create user wide environment variables
+    TEMRegValueList Values;
+    Snapshot.ReadSectionValues(strRegPath, L"Environment Variables", Values);
+    for (size_t i = 0; i < Values.size(); i++)
+      AddMacro(Values[i].first, Values[i].second);
+  }
+}
+
+/**
+
+  This method attempts to add a macro to the table expanding any environment variables in the
+  value.
+
+  @precon  None.
+  @postcon The macro is added if it does not exist else the existing macro is updated to the new
+           value.
+
+  @param   strMacro as a std::wstring as a constant reference
+  @param   strValue as a std::wstring as a constant reference
+
+**/
+void TEMMacroTable::AddMacro(const std::wstring& strMacro, const std::wstring& strValue) {
+  std::wstring strExpanded = ExpandEnvironment(strValue);
+  if (strExpanded.length() > FMaxValueLength)
+    FMaxValueLength = strExpanded.length();
+  std::unordered_map<std::wstring, size_t>::iterator i = FIndex.find(EMFoldCase(strMacro));
+  if (i != FIndex.end()) {
+    FMacros[i->second].second = strExpanded;
+    return;
+  }
+  FIndex[EMFoldCase(strMacro)] = FMacros.size();
+  FMacros.push_back(TEMRegValue(strMacro, strExpanded));
+}
+
+/**
+
+  This method searches through the given filename for text matching any macros in the table and
+  replaces them with the actual path. The filename is scanned once from left to right and each
+  $(NAME) token is looked up in the case folded index and written straight into the result.
+  Filenames without any macros are returned untouched.
+
+  @precon  None.
+  @postcon Any macros which match the table are expanded.
+
+  @param   strFileName as a std::wstring as a constant reference
+  @return  a std::wstring
+
+**/
+std::wstring TEMMacroTable::Expand(const std::wstring& strFileName) const {
+  size_t iOpen = strFileName.find(L"$(");
+  if (iOpen == std::wstring::npos || FIndex.empty())
+    return strFileName;
+  std::wstring strResult;
+  strResult.reserve(strFileName.length() + FMaxValueLength);
+  std::wstring strMacro;
+  size_t iStart = 0;
+  while (iOpen != std::wstring::npos) {
+    size_t iClose = iOpen + 2;
+    while (iClose < strFileName.length() && (std::iswalnum(strFileName[iClose]) ||
+      strFileName[iClose] == L'_'))
+      iClose++;
+    if (iClose > iOpen + 2 && iClose < strFileName.length() && strFileName[iClose] == L')') {
+      strMacro.assign(strFileName, iOpen, iClose - iOpen + 1);
+      for (size_t i = 2; i < strMacro.length() - 1; i++)
+        strMacro[i] = (wchar_t)std::towupper(strMacro[i]);
+      std::unordered_map<std::wstring, size_t>::const_iterator i = FIndex.find(strMacro);
+      if (i != FIndex.end()) {
+        strResult.append(strFileName, iStart, iOpen - iStart);
+        strResult.append(FMacros[i->second].second);
+        iStart = iClose + 1;
+        iOpen = strFileName.find(L"$(", iStart);
+        continue;
+      }
+    }
+    iOpen = strFileName.find(L"$(", iOpen + 1);
+  }
+  strResult.append(strFileName, iStart, std::wstring::npos);
+  return strResult;
+}
+
+/**
+
+  This method expands any %NAME% environment variables in the given text.
+
+  @precon  None.
+  @postcon Returns the text with the environment variables expanded.
+
+  @param   strText as a std::wstring as a constant reference
+  @return  a std::wstring
+
+**/
+std::wstring TEMMacroTable::ExpandEnvironment(const std::wstring& strText) {
+  if (strText.find(L'%') == std::wstring::npos)
+    return strText;
+#ifdef _WIN32
+  DWORD iSize = ExpandEnvironmentStringsW(strText.c_str(), NULL, 0);
+  if (iSize == 0)
+    return strText;
+  std::vector<wchar_t> Buffer(iSize);
+  iSize = ExpandEnvironmentStringsW(strText.c_str(), &Buffer[0], iSize);
+  return std::wstring(&Buffer[0], iSize > 0 ? iSize - 1 : 0);
+#else
+  std::wstring strResult;
+  size_t iStart = 0;
+  while (iStart < strText.length()) {
+    size_t iOpen = strText.find(L'%', iStart);
+    size_t iClose = iOpen == std::wstring::npos ? iOpen : strText.find(L'%', iOpen + 1);
+    if (iClose == std::wstring::npos) {
+      strResult += strText.substr(iStart);
+      break;
+    }
+    std::string strName = EMWideToUTF8(strText.substr(iOpen + 1, iClose - iOpen - 1));
+    const char* pValue = std::getenv(strName.c_str());
+    strResult += strText.substr(iStart, iOpen - iStart);
+    if (pValue != NULL) {
+      strResult += EMUTF8ToWide(pValue, std::char_traits<char>::length(pValue));
+      iStart = iClose + 1;
+    } else {
+      strResult += L'%';
+      iStart = iOpen + 1;
+    }
+  }
+  return strResult;
+#endif
+}
+
+/**
+
+  This method returns a signature of the settings that the macro table of the installation at the
+  given registry path is built from (its RootDir and Environment Variables).
+
+  @precon  None.
+  @postcon Returns the signature.
+
+  @param   Snapshot   as a TEMRegistrySnapshot as a constant reference
+  @param   strRegPath as a std::wstring as a constant reference
+  @return  a std::wstring
+
+**/
+std::wstring TEMMacroCache::Signature(const TEMRegistrySnapshot& Snapshot,
+  const std::wstring& strRegPath) {
+  std::wstring strSignature = Snapshot.ReadString(strRegPath, L"", L"RootDir", L"");
+  TEMRegValueList Values;
+  Snapshot.ReadSectionValues(strRegPath, L"Environment Variables", Values);
+  for (size_t i = 0; i < Values.size(); i++) {
+    strSignature += L'\0';
+    strSignature += Values[i].first;
+    strSignature += L'=';
+    strSignature += Values[i].second;
+  }
+  return strSignature;
+}
+
+/**
+
+  This method returns the macro table for the installation at the given registry path, building
+  it only if it is not cached or the installation's RootDir or Environment Variables have changed.
+
+  @precon  None.
+  @postcon Returns the macro table for the installation.
+
+  @param   Snapshot   as a TEMRegistrySnapshot as a constant reference
+  @param   strRegPath as a std::wstring as a constant reference
+  @return  a TEMMacroTablePtr
+
+**/
+TEMMacroTablePtr TEMMacroCache::Get(const TEMRegistrySnapshot& Snapshot,
+  const std::wstring& strRegPath) {
+  std::wstring strKey = EMFoldCase(strRegPath);
+  while (strKey.length() > 0 && strKey[strKey.length() - 1] == L'\\')
+    strKey.erase(strKey.length() - 1);
+  std::wstring strSignature = Signature(Snapshot, strRegPath);
+  {
+    std::lock_guard<std::mutex> Lock(FLock);
+    std::unordered_map<std::wstring, TEMMacroCacheEntry>::iterator i = FEntries.find(strKey);
+    if (i != FEntries.end() && i->second.strSignature == strSignature)
+      return i->second.Macros;
+  }
+  TEMMacroCacheEntry Entry;
+  Entry.strSignature = strSignature;
+  Entry.Macros = TEMMacroTablePtr(new TEMMacroTable(Snapshot, strRegPath));
+  std::lock_guard<std::mutex> Lock(FLock);
+  FEntries[strKey] = Entry;
+  return Entry.Macros;
+}
+
+/**
+
+  This method removes all the cached macro tables.
+
+  @precon  None.
+  @postcon The cache is empty.
+
+**/
+void TEMMacroCache::Clear() {
+  std::lock_guard<std::mutex> Lock(FLock);
+  FEntries.clear();
+}
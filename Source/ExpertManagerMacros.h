@@ -0,0 +1,50 @@
+#ifndef ExpertManagerMacrosH
+#define ExpertManagerMacrosH
+
+#include "ExpertManagerRegistryStore.h"
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+
+/** This class represents the RAD Studio macros (e.g. $(BDS)) for a single installation and
+    expands them in filenames. The macros are indexed by their case folded names so that a
+    filename is expanded in a single forward scan. Once constructed it is read only so can be used
+    from any thread. **/
+class TEMMacroTable {
+  private:
+    TEMRegValueList                         FMacros;
+    std::unordered_map<std::wstring, size_t> FIndex;
+    size_t                                  FMaxValueLength;
+    void AddMacro(const std::wstring& strMacro, const std::wstring& strValue);
+  public:
+    TEMMacroTable();
+    TEMMacroTable(const TEMRegistrySnapshot& Snapshot, const std::wstring& strRegPath);
+    std::wstring Expand(const std::wstring& strFileName) const;
+    const TEMRegValueList& Macros() const { return FMacros; };
+    static std::wstring ExpandEnvironment(const std::wstring& strText);
+};
+
+/** A simplified type for a shared immutable macro table. **/
+typedef std::shared_ptr<const TEMMacroTable> TEMMacroTablePtr;
+
+/** This class caches the macro table of each installation by its registry path. A table is only
+    rebuilt when the installation's RootDir or Environment Variables have changed so that
+    validating and rendering an installation never pays for constructing its macros twice. **/
+class TEMMacroCache {
+  private:
+    /** A record to describe a cached macro table and the settings it was built from. **/
+    struct TEMMacroCacheEntry {
+      std::wstring     strSignature;
+      TEMMacroTablePtr Macros;
+    };
+    std::mutex                                          FLock;
+    std::unordered_map<std::wstring, TEMMacroCacheEntry> FEntries;
+    static std::wstring Signature(const TEMRegistrySnapshot& Snapshot,
+      const std::wstring& strRegPath);
+  public:
+    TEMMacroTablePtr Get(const TEMRegistrySnapshot& Snapshot, const std::wstring& strRegPath);
+    void Clear();
+};
+
+#endif
@@ -0,0 +1,128 @@
+#pragma hdrstop
+
+#include "ExpertManagerMappedFile.h"
+#include "ExpertManagerStrings.h"
+#ifndef _WIN32
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+#endif
+
+#pragma package(smart_init)
+
+#ifdef _WIN32
+/**
+
+  This is the constructor for the mapped file class which opens the file for sequential reading
+  and maps a view of the whole file.
+
+  @precon  None.
+  @postcon The file is mapped if it could be opened (an empty file is opened but not mapped).
+
+  @param   strFileName as a std::wstring as a constant reference
+
+**/
+TEMMappedFile::TEMMappedFile(const std::wstring& strFileName) :
+  FFile(INVALID_HANDLE_VALUE), FMapping(NULL), FData(NULL), FSize(0) {
+  FFile = CreateFileW(strFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (FFile == INVALID_HANDLE_VALUE)
+    return;
+  LARGE_INTEGER iSize;
+  if (!GetFileSizeEx(FFile, &iSize) || iSize.QuadPart == 0)
+    return;
+  FMapping = CreateFileMappingW(FFile, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (FMapping == NULL)
+    return;
+  FData = (const char*)MapViewOfFile(FMapping, FILE_MAP_READ, 0, 0, 0);
+  if (FData != NULL)
+    FSize = (size_t)iSize.QuadPart;
+}
+
+/**
+
+  This is the destructor for the mapped file class.
+
+  @precon  None.
+  @postcon The view, mapping and file are closed.
+
+**/
+TEMMappedFile::~TEMMappedFile() {
+  if (FData != NULL)
+    UnmapViewOfFile(FData);
+  if (FMapping != NULL)
+    CloseHandle(FMapping);
+  if (FFile != INVALID_HANDLE_VALUE)
+    CloseHandle(FFile);
+}
+
+/**
+
+  This method returns true if the file was opened.
+
+  @precon  None.
+  @postcon Returns whether the file was opened.
+
+  @return  a bool
+
+**/
+bool TEMMappedFile::Opened() const {
+  return FFile != INVALID_HANDLE_VALUE;
+}
+#else
+/**
+
+  This is the constructor for the mapped file class which opens the file and maps the whole file
+  for sequential reading.
+
+  @precon  None.
+  @postcon The file is mapped if it could be opened (an empty file is opened but not mapped).
+
+  @param   strFileName as a std::wstring as a constant reference
+
+**/
+TEMMappedFile::TEMMappedFile(const std::wstring& strFileName) : FFile(-1), FData(NULL), FSize(0) {
+  FFile = open(EMWideToUTF8(strFileName).c_str(), O_RDONLY);
+  if (FFile < 0)
+    return;
+  struct stat Status;
+  if (fstat(FFile, &Status) != 0 || Status.st_size == 0)
+    return;
+  void* pData = mmap(NULL, (size_t)Status.st_size, PROT_READ, MAP_PRIVATE, FFile, 0);
+  if (pData == MAP_FAILED)
+    return;
+  madvise(pData, (size_t)Status.st_size, MADV_SEQUENTIAL);
+  FData = (const char*)pData;
+  FSize = (size_t)Status.st_size;
+}
+
+/**
+
+  This is the destructor for the mapped file class.
+
+  @precon  None.
+  @postcon The mapping and file are closed.
+
+**/
+TEMMappedFile::~TEMMappedFile() {
+  if (FData != NULL)
+    munmap((void*)FData, FSize);
+  if (FFile >= 0)
+    close(FFile);
+}
+
+/**
+
+  This method returns true if the file was opened.
+
+  @precon  None.
+  @postcon Returns whether the file was opened.
+
+  @return  a bool
+
+**/
+bool TEMMappedFile::Opened() const {
+  return FFile >= 0;
+}
+#endif
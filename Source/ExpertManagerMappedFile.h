@@ -0,0 +1,32 @@
+#ifndef ExpertManagerMappedFileH
+#define ExpertManagerMappedFileH
+
+#include <string>
+#include <cstddef>
+#ifdef _WIN32
+  #include <windows.h>
+#endif
+
+/** This class maps a file read-only into memory so that large files can be read in a single
+    sequential pass without copying them onto the heap. **/
+class TEMMappedFile {
+  private:
+#ifdef _WIN32
+    HANDLE      FFile;
+    HANDLE      FMapping;
+#else
+    int         FFile;
+#endif
+    const char* FData;
+    size_t      FSize;
+    TEMMappedFile(const TEMMappedFile&);
+    TEMMappedFile& operator=(const TEMMappedFile&);
+  public:
+    TEMMappedFile(const std::wstring& strFileName);
+    ~TEMMappedFile();
+    bool Opened() const;
+    const char* Data() const { return FData; };
+    size_t Size() const { return FSize; };
+};
+
+#endif
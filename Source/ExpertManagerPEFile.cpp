@@ -0,0 +1,459 @@
+#pragma hdrstop
+
+#include "ExpertManagerPEFile.h"
+#include "ExpertManagerMappedFile.h"
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <sys/stat.h>
+#endif
+
+#pragma package(smart_init)
+
+/** The most import descriptors, required packages and sections that are read from an image so
+    that a corrupt image cannot make the parser loop for long. **/
+static const unsigned int iMaxItems = 4096;
+/** The resource type of the PACKAGEINFO resource (RT_RCDATA). **/
+static const unsigned int iRCDataResource = 10;
+/** The indexes of the import and resource tables in the optional header's data directories. **/
+static const unsigned int iImportDirectory = 1;
+static const unsigned int iResourceDirectory = 2;
+
+/** A record of the parts of a section header needed to map RVAs to file offsets. **/
+struct TEMPESection {
+  unsigned int iVirtualAddress;
+  unsigned int iVirtualSize;
+  unsigned int iRawOffset;
+  unsigned int iRawSize;
+};
+
+/** A simplified type for the section table of an image. **/
+typedef std::vector<TEMPESection> TEMPESectionList;
+
+/**
+
+  This is the constructor for the module information record.
+
+  @precon  None.
+  @postcon The record describes an invalid image with no imports or package information.
+
+**/
+TEMModuleInfo::TEMModuleInfo() : boolValid(false), iMachine(0), boolPackageInfo(false) {}
+
+/**
+
+  This method reads a little endian 16 bit integer from the buffer.
+
+  @precon  pData must be a valid buffer of iSize bytes.
+  @postcon Returns true with the value if it is within the buffer.
+
+  @param   pData   as an unsigned char pointer as a constant
+  @param   iSize   as a size_t as a constant
+  @param   iOffset as a size_t as a constant
+  @param   iValue  as an unsigned int as a reference
+  @return  a bool
+
+**/
+static bool Read16(const unsigned char* pData, const size_t iSize, const size_t iOffset,
+  unsigned int& iValue) {
+  if (iOffset > iSize || iSize - iOffset < 2)
+    return false;
+  iValue = pData[iOffset] | (pData[iOffset + 1] << 8);
+  return true;
+}
+
+/**
+
+  This method reads a little endian 32 bit integer from the buffer.
+
+  @precon  pData must be a valid buffer of iSize bytes.
+  @postcon Returns true with the value if it is within the buffer.
+
+  @param   pData   as an unsigned char pointer as a constant
+  @param   iSize   as a size_t as a constant
+  @param   iOffset as a size_t as a constant
+  @param   iValue  as an unsigned int as a reference
+  @return  a bool
+
+**/
+static bool Read32(const unsigned char* pData, const size_t iSize, const size_t iOffset,
+  unsigned int& iValue) {
+  if (iOffset > iSize || iSize - iOffset < 4)
+    return false;
+  iValue = pData[iOffset] | (pData[iOffset + 1] << 8) | (pData[iOffset + 2] << 16) |
+    ((unsigned int)pData[iOffset + 3] << 24);
+  return true;
+}
+
+/**
+
+  This method reads a null terminated (UTF-8 or ASCII) string from the buffer.
+
+  @precon  pData must be a valid buffer of iSize bytes.
+  @postcon Returns true with the string and the offset after its terminator if the terminator is
+           within the buffer.
+
+  @param   pData   as an unsigned char pointer as a constant
+  @param   iSize   as a size_t as a constant
+  @param   iOffset as a size_t as a constant
+  @param   strText as a std::wstring as a reference
+  @param   iNext   as a size_t as a reference
+  @return  a bool
+
+**/
+static bool ReadString(const unsigned char* pData, const size_t iSize, const size_t iOffset,
+  std::wstring& strText, size_t& iNext) {
+  if (iOffset >= iSize)
+    return false;
+  const unsigned char* pEnd = (const unsigned char*)std::memchr(pData + iOffset, 0,
+    std::min(iSize - iOffset, (size_t)1024));
+  if (pEnd == NULL)
+    return false;
+  strText = EMUTF8ToWide((const char*)pData + iOffset, pEnd - (pData + iOffset));
+  iNext = pEnd - pData + 1;
+  return true;
+}
+
+/**
+
+  This method converts a relative virtual address to an offset in the image file.
+
+  @precon  None.
+  @postcon Returns true with the offset if the address is within a section's raw data.
+
+  @param   Sections as a TEMPESectionList as a constant reference
+  @param   iSize    as a size_t as a constant
+  @param   iRVA     as an unsigned int as a constant
+  @param   iOffset  as a size_t as a reference
+  @return  a bool
+
+**/
+static bool RVAToOffset(const TEMPESectionList& Sections, const size_t iSize,
+  const unsigned int iRVA, size_t& iOffset) {
+  for (size_t i = 0; i < Sections.size(); i++) {
+    const TEMPESection& Section = Sections[i];
+    if (iRVA < Section.iVirtualAddress ||
+      iRVA - Section.iVirtualAddress >= std::max(Section.iVirtualSize, Section.iRawSize))
+      continue;
+    unsigned int iDelta = iRVA - Section.iVirtualAddress;
+    if (iDelta >= Section.iRawSize)
+      return false;
+    iOffset = (size_t)Section.iRawOffset + iDelta;
+    return iOffset < iSize;
+  }
+  return false;
+}
+
+/**
+
+  This method adds the names of the modules in the image's import table to the list.
+
+  @precon  pData must be a valid buffer of iSize bytes.
+  @postcon Imports contains the imported module names.
+
+  @param   pData    as an unsigned char pointer as a constant
+  @param   iSize    as a size_t as a constant
+  @param   Sections as a TEMPESectionList as a constant reference
+  @param   iRVA     as an unsigned int as a constant
+  @param   Imports  as a TEMNameList as a reference
+
+**/
+static void ReadImports(const unsigned char* pData, const size_t iSize,
+  const TEMPESectionList& Sections, const unsigned int iRVA, TEMNameList& Imports) {
+  size_t iOffset;
+  if (iRVA == 0 || !RVAToOffset(Sections, iSize, iRVA, iOffset))
+    return;
+  for (unsigned int i = 0; i < iMaxItems; i++, iOffset += 20) {
+    unsigned int iLookup, iName, iThunk;
+    if (!Read32(pData, iSize, iOffset, iLookup) || !Read32(pData, iSize, iOffset + 12, iName) ||
+      !Read32(pData, iSize, iOffset + 16, iThunk))
+      return;
+    if (iLookup == 0 && iName == 0 && iThunk == 0)
+      return;
+    size_t iNameOffset, iNext;
+    std::wstring strName;
+    if (RVAToOffset(Sections, iSize, iName, iNameOffset) &&
+      ReadString(pData, iSize, iNameOffset, strName, iNext) && !strName.empty())
+      Imports.push_back(strName);
+  }
+}
+
+/**
+
+  This method finds an entry in a resource directory by its ID or (if strName is not null) by its
+  name ignoring case, or the first entry if iID is zero and strName is null.
+
+  @precon  pData must be a valid buffer of iSize bytes.
+  @postcon Returns true with the entry's offset field if found.
+
+  @param   pData     as an unsigned char pointer as a constant
+  @param   iSize     as a size_t as a constant
+  @param   iBase     as a size_t as a constant
+  @param   iDirectory as an unsigned int as a constant
+  @param   iID       as an unsigned int as a constant
+  @param   strName   as a wchar_t pointer as a constant
+  @param   iTarget   as an unsigned int as a reference
+  @return  a bool
+
+**/
+static bool FindResourceEntry(const unsigned char* pData, const size_t iSize, const size_t iBase,
+  const unsigned int iDirectory, const unsigned int iID, const wchar_t* strName,
+  unsigned int& iTarget) {
+  size_t iOffset = iBase + iDirectory;
+  unsigned int iNamed, iIDs;
+  if (!Read16(pData, iSize, iOffset + 12, iNamed) || !Read16(pData, iSize, iOffset + 14, iIDs))
+    return false;
+  for (unsigned int i = 0; i < std::min(iNamed + iIDs, iMaxItems); i++) {
+    unsigned int iNameField, iOffsetField;
+    if (!Read32(pData, iSize, iOffset + 16 + i * 8, iNameField) ||
+      !Read32(pData, iSize, iOffset + 20 + i * 8, iOffsetField))
+      return false;
+    bool boolMatch = iID == 0 && strName == NULL;
+    if (strName != NULL && (iNameField & 0x80000000) != 0) {
+      size_t iString = iBase + (iNameField & 0x7FFFFFFF);
+      unsigned int iLength, iChar;
+      std::wstring strEntry;
+      if (Read16(pData, iSize, iString, iLength))
+        for (unsigned int j = 0; j < iLength; j++) {
+          if (!Read16(pData, iSize, iString + 2 + j * 2, iChar))
+            break;
+          strEntry += (wchar_t)iChar;
+        }
+      boolMatch = EMSameText(strEntry, strName);
+    } else if (strName == NULL && iID != 0)
+      boolMatch = iNameField == iID;
+    if (boolMatch) {
+      iTarget = iOffsetField;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+
+  This method reads the list of required packages from the image's PACKAGEINFO resource. The
+  resource starts with the package flags (which are not needed) and the number of required
+  packages which is followed by a hash byte and a null terminated name for each required package.
+
+  @precon  pData must be a valid buffer of iSize bytes.
+  @postcon If the resource exists and is well formed Info holds the required packages.
+
+  @param   pData    as an unsigned char pointer as a constant
+  @param   iSize    as a size_t as a constant
+  @param   Sections as a TEMPESectionList as a constant reference
+  @param   iRVA     as an unsigned int as a constant
+  @param   Info     as a TEMModuleInfo as a reference
+
+**/
+static void ReadPackageInfo(const unsigned char* pData, const size_t iSize,
+  const TEMPESectionList& Sections, const unsigned int iRVA, TEMModuleInfo& Info) {
+  size_t iBase;
+  unsigned int iTypeDirectory, iNameDirectory, iDataEntry, iDataRVA, iDataSize;
+  if (iRVA == 0 || !RVAToOffset(Sections, iSize, iRVA, iBase) ||
+    !FindResourceEntry(pData, iSize, iBase, 0, iRCDataResource, NULL, iTypeDirectory) ||
+    (iTypeDirectory & 0x80000000) == 0 ||
+    !FindResourceEntry(pData, iSize, iBase, iTypeDirectory & 0x7FFFFFFF, 0, L"PACKAGEINFO",
+      iNameDirectory) || (iNameDirectory & 0x80000000) == 0 ||
+    !FindResourceEntry(pData, iSize, iBase, iNameDirectory & 0x7FFFFFFF, 0, NULL, iDataEntry) ||
+    (iDataEntry & 0x80000000) != 0 ||
+    !Read32(pData, iSize, iBase + iDataEntry, iDataRVA) ||
+    !Read32(pData, iSize, iBase + iDataEntry + 4, iDataSize))
+    return;
+  size_t iOffset;
+  if (!RVAToOffset(Sections, iSize, iDataRVA, iOffset) || iSize - iOffset < iDataSize)
+    return;
+  const unsigned char* pInfo = pData + iOffset;
+  unsigned int iCount;
+  if (!Read32(pInfo, iDataSize, 4, iCount))
+    return;
+  Info.boolPackageInfo = true;
+  size_t iPos = 8;
+  std::wstring strName;
+  for (unsigned int i = 0; i < std::min(iCount, iMaxItems); i++) {
+    if (!ReadString(pInfo, iDataSize, iPos + 1, strName, iPos))
+      return;
+    Info.Requires.push_back(strName);
+  }
+}
+
+/**
+
+  This method parses the PE image (32 or 64 bit) in the given buffer without copying it. Every
+  offset is checked against the buffer so truncated or corrupt files are rejected rather than
+  read beyond their end.
+
+  @precon  pData must be a valid buffer of iSize bytes.
+  @postcon Returns true with the image's machine, imports and package information if the buffer
+           holds a PE image.
+
+  @param   pData as an unsigned char pointer as a constant
+  @param   iSize as a size_t as a constant
+  @param   Info  as a TEMModuleInfo as a reference
+  @return  a bool
+
+**/
+bool EMParsePEImage(const unsigned char* pData, const size_t iSize, TEMModuleInfo& Info) {
+  Info = TEMModuleInfo();
+  unsigned int iMZ, iPEOffset, iSignature, iMachine, iSectionCount, iOptionalSize, iMagic;
+  if (!Read16(pData, iSize, 0, iMZ) || iMZ != 0x5A4D || !Read32(pData, iSize, 0x3C, iPEOffset) ||
+    !Read32(pData, iSize, iPEOffset, iSignature) || iSignature != 0x00004550)
+    return false;
+  size_t iHeader = (size_t)iPEOffset + 4;
+  size_t iOptional = iHeader + 20;
+  if (!Read16(pData, iSize, iHeader, iMachine) ||
+    !Read16(pData, iSize, iHeader + 2, iSectionCount) ||
+    !Read16(pData, iSize, iHeader + 16, iOptionalSize) ||
+    !Read16(pData, iSize, iOptional, iMagic))
+    return false;
+  size_t iDirectories;
+  if (iMagic == 0x10B)
+    iDirectories = iOptional + 96;
+  else if (iMagic == 0x20B)
+    iDirectories = iOptional + 112;
+  else
+    return false;
+  unsigned int iDirectoryCount;
+  if (!Read32(pData, iSize, iDirectories - 4, iDirectoryCount))
+    return false;
+  unsigned int iRVAs[iResourceDirectory + 1] = {0, 0, 0};
+  for (unsigned int i = 0; i <= iResourceDirectory && i < iDirectoryCount; i++)
+    if (iDirectories + i * 8 + 8 <= iOptional + iOptionalSize)
+      Read32(pData, iSize, iDirectories + i * 8, iRVAs[i]);
+  TEMPESectionList Sections;
+  size_t iTable = iOptional + iOptionalSize;
+  for (unsigned int i = 0; i < std::min(iSectionCount, iMaxItems); i++) {
+    TEMPESection Section;
+    if (!Read32(pData, iSize, iTable + i * 40 + 8, Section.iVirtualSize) ||
+      !Read32(pData, iSize, iTable + i * 40 + 12, Section.iVirtualAddress) ||
+      !Read32(pData, iSize, iTable + i * 40 + 16, Section.iRawSize) ||
+      !Read32(pData, iSize, iTable + i * 40 + 20, Section.iRawOffset))
+      return false;
+    Sections.push_back(Section);
+  }
+  Info.boolValid = true;
+  Info.iMachine = (unsigned short)iMachine;
+  ReadImports(pData, iSize, Sections, iRVAs[iImportDirectory], Info.Imports);
+  ReadPackageInfo(pData, iSize, Sections, iRVAs[iResourceDirectory], Info);
+  return true;
+}
+
+/**
+
+  This method maps the named file into memory and parses it as a PE image.
+
+  @precon  None.
+  @postcon Returns true with the module information if the file is a PE image.
+
+  @param   strFileName as a std::wstring as a constant reference
+  @param   Info        as a TEMModuleInfo as a reference
+  @return  a bool
+
+**/
+bool EMReadModuleInfo(const std::wstring& strFileName, TEMModuleInfo& Info) {
+  TEMMappedFile File(strFileName);
+  if (!File.Opened()) {
+    Info = TEMModuleInfo();
+    return false;
+  }
+  return EMParsePEImage((const unsigned char*)File.Data(), File.Size(), Info);
+}
+
+/**
+
+  This method returns the size and last write time of the named file.
+
+  @precon  None.
+  @postcon Returns true with the size and time if the file exists and is not a directory.
+
+  @param   strFileName as a std::wstring as a constant reference
+  @param   iSize       as an unsigned long long as a reference
+  @param   iWriteTime  as a long long as a reference
+  @return  a bool
+
+**/
+bool TEMModuleCache::FileStamp(const std::wstring& strFileName, unsigned long long& iSize,
+  long long& iWriteTime) {
+#ifdef _WIN32
+  WIN32_FILE_ATTRIBUTE_DATA Info;
+  if (!GetFileAttributesExW(strFileName.c_str(), GetFileExInfoStandard, &Info) ||
+    (Info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+    return false;
+  iSize = ((unsigned long long)Info.nFileSizeHigh << 32) | Info.nFileSizeLow;
+  iWriteTime = ((long long)Info.ftLastWriteTime.dwHighDateTime << 32) |
+    Info.ftLastWriteTime.dwLowDateTime;
+  return true;
+#else
+  struct stat FileInfo;
+  if (stat(EMWideToUTF8(strFileName).c_str(), &FileInfo) != 0 || !S_ISREG(FileInfo.st_mode))
+    return false;
+  iSize = (unsigned long long)FileInfo.st_size;
+  iWriteTime = (long long)FileInfo.st_mtime;
+  return true;
+#endif
+}
+
+/**
+
+  This method returns the module information of the named file parsing the file only if it is not
+  cached or its size or last write time has changed. Files which are not PE images are cached as
+  invalid modules.
+
+  @precon  None.
+  @postcon Returns the module information or null if the file does not exist.
+
+  @param   strFileName as a std::wstring as a constant reference
+  @return  a TEMModuleInfoPtr
+
+**/
+TEMModuleInfoPtr TEMModuleCache::Get(const std::wstring& strFileName) {
+  unsigned long long iSize;
+  long long iWriteTime;
+  if (!FileStamp(strFileName, iSize, iWriteTime))
+    return TEMModuleInfoPtr();
+  std::wstring strKey = EMFoldCase(strFileName);
+  {
+    std::lock_guard<std::mutex> Lock(FLock);
+    auto Item = FEntries.find(strKey);
+    if (Item != FEntries.end() && Item->second.iSize == iSize &&
+      Item->second.iWriteTime == iWriteTime)
+      return Item->second.Info;
+  }
+  std::shared_ptr<TEMModuleInfo> Info(new TEMModuleInfo());
+  EMReadModuleInfo(strFileName, *Info);
+  TEMModuleCacheEntry Entry = {iSize, iWriteTime, Info};
+  std::lock_guard<std::mutex> Lock(FLock);
+  FEntries[strKey] = Entry;
+  return Info;
+}
+
+/**
+
+  This method returns the number of cached files.
+
+  @precon  None.
+  @postcon Returns the number of cached files.
+
+  @return  a size_t
+
+**/
+size_t TEMModuleCache::Count() {
+  std::lock_guard<std::mutex> Lock(FLock);
+  return FEntries.size();
+}
+
+/**
+
+  This method removes all the cached module information.
+
+  @precon  None.
+  @postcon The cache is empty.
+
+**/
+void TEMModuleCache::Clear() {
+  std::lock_guard<std::mutex> Lock(FLock);
+  FEntries.clear();
+}
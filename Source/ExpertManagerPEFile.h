@@ -0,0 +1,49 @@
+#ifndef ExpertManagerPEFileH
+#define ExpertManagerPEFileH
+
+#include "ExpertManagerStrings.h"
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/** A record of the parts of a PE image (an expert DLL or a package BPL) that are needed to check
+    whether it can be loaded: the modules named in its import table and, for Delphi packages and
+    modules built with runtime packages, the packages listed in its PACKAGEINFO resource. **/
+struct TEMModuleInfo {
+  bool           boolValid;
+  unsigned short iMachine;
+  TEMNameList    Imports;
+  bool           boolPackageInfo;
+  TEMNameList    Requires;
+  TEMModuleInfo();
+};
+
+/** A simplified type for a shared instance of a module's information. **/
+typedef std::shared_ptr<const TEMModuleInfo> TEMModuleInfoPtr;
+
+bool EMParsePEImage(const unsigned char* pData, const size_t iSize, TEMModuleInfo& Info);
+bool EMReadModuleInfo(const std::wstring& strFileName, TEMModuleInfo& Info);
+
+/** This class caches the module information of each file by its path, size and last write time
+    so that a file is only mapped and parsed again when it changes. It is safe to use from many
+    threads at once. **/
+class TEMModuleCache {
+  private:
+    /** A record of a cached file's stamp and module information. **/
+    struct TEMModuleCacheEntry {
+      unsigned long long iSize;
+      long long          iWriteTime;
+      TEMModuleInfoPtr   Info;
+    };
+    std::mutex                                            FLock;
+    std::unordered_map<std::wstring, TEMModuleCacheEntry> FEntries;
+    static bool FileStamp(const std::wstring& strFileName, unsigned long long& iSize,
+      long long& iWriteTime);
+  public:
+    TEMModuleInfoPtr Get(const std::wstring& strFileName);
+    size_t Count();
+    void Clear();
+};
+
+#endif
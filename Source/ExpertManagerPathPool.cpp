@@ -0,0 +1,359 @@
+#pragma hdrstop
+
+#include "ExpertManagerPathPool.h"
+#include "ExpertManagerStrings.h"
+
+#pragma package(smart_init)
+
+/**
+
+  This is the constructor for the path pool class.
+
+  @precon  None.
+  @postcon Creates a pool holding only the empty path (ID 0) and the root directory (ID 0).
+
+**/
+TEMPathPool::TEMPathPool() : FCharacters(0) {
+  InternComponent(L"", 0, 0);
+  TEMDirectoryRecord& Root = FDirectories.Append();
+  Root.iParent = 0;
+  Root.iName = 0;
+  TEMPathRecord& Empty = FPaths.Append();
+  Empty.iDirectory = 0;
+  Empty.iFileName = 0;
+  Empty.iFolded = 0;
+}
+
+/**
+
+  This method returns the process wide path pool.
+
+  @precon  None.
+  @postcon Returns the pool (created on first use so that it is safe to use during start up).
+
+  @return  a TEMPathPool as a reference
+
+**/
+TEMPathPool& TEMPathPool::Global() {
+  static TEMPathPool Pool;
+  return Pool;
+}
+
+/**
+
+  This method returns whether the text of the given path is the given text by comparing its
+  components from the end of the text.
+
+  @precon  iPath must be an ID returned by the pool.
+  @postcon Returns true if the texts are the same (including case).
+
+  @param   iPath   as a TEMPathID as a constant
+  @param   strText as a std::wstring as a constant reference
+  @return  a bool
+
+**/
+bool TEMPathPool::SameText(const TEMPathID iPath, const std::wstring& strText) const {
+  size_t iEnd = strText.length();
+  unsigned int iName = FPaths[iPath].iFileName;
+  unsigned int iDirectory = FPaths[iPath].iDirectory;
+  for (;;) {
+    const std::wstring& strName = *FComponents[iName];
+    if (strName.length() > iEnd ||
+      strText.compare(iEnd - strName.length(), strName.length(), strName) != 0)
+      return false;
+    iEnd -= strName.length();
+    if (iDirectory == 0)
+      return iEnd == 0;
+    if (iEnd == 0 || strText[iEnd - 1] != L'\\')
+      return false;
+    iEnd--;
+    iName = FDirectories[iDirectory].iName;
+    iDirectory = FDirectories[iDirectory].iParent;
+  }
+}
+
+/**
+
+  This method returns the ID of the given part of the text as a component adding it (and its case
+  folded component) if it is new. The component's text is held once as the key of the component
+  map.
+
+  @precon  FLock must be held.
+  @postcon Returns the ID of the component.
+
+  @param   strText as a std::wstring as a constant reference
+  @param   iStart  as a size_t as a constant
+  @param   iEnd    as a size_t as a constant
+  @return  an unsigned int
+
+**/
+unsigned int TEMPathPool::InternComponent(const std::wstring& strText, const size_t iStart,
+  const size_t iEnd) {
+  std::pair<std::unordered_map<std::wstring, unsigned int>::iterator, bool> Component =
+    FComponentIDs.insert(std::make_pair(strText.substr(iStart, iEnd - iStart),
+    (unsigned int)FComponents.Size()));
+  const unsigned int iComponent = Component.first->second;
+  if (Component.second) {
+    FComponents.Append() = &Component.first->first;
+    unsigned int& iFolded = FFoldedComponents.Append();
+    iFolded = iComponent;
+    FCharacters += iEnd - iStart;
+    std::wstring strFolded = EMFoldCase(Component.first->first);
+    if (strFolded != Component.first->first)
+      iFolded = InternComponent(strFolded, 0, strFolded.length());
+  }
+  return iComponent;
+}
+
+/**
+
+  This method returns the ID of the given path if it is in the pool.
+
+  @precon  FLock must be held and iHash must be the hash of the text.
+  @postcon Returns the ID of the path or 0 if it is not in the pool.
+
+  @param   strText as a std::wstring as a constant reference
+  @param   iHash   as a size_t as a constant
+  @return  a TEMPathID
+
+**/
+TEMPathID TEMPathPool::FindPath(const std::wstring& strText, const size_t iHash) const {
+  typedef std::unordered_multimap<size_t, TEMPathID>::const_iterator TEMPathIterator;
+  std::pair<TEMPathIterator, TEMPathIterator> Paths = FPathIDs.equal_range(iHash);
+  for (TEMPathIterator i = Paths.first; i != Paths.second; i++)
+    if (SameText(i->second, strText))
+      return i->second;
+  return 0;
+}
+
+/**
+
+  This method returns the ID of the given path adding it (and any new directories and components)
+  if it is new. A new path whose components are all case folded is its own folded path.
+
+  @precon  FLock must be held and iHash must be the hash of the text.
+  @postcon Returns the ID of the path.
+
+  @param   strText as a std::wstring as a constant reference
+  @param   iHash   as a size_t as a constant
+  @return  a TEMPathID
+
+**/
+TEMPathID TEMPathPool::InternPath(const std::wstring& strText, const size_t iHash) {
+  TEMPathID iPath = FindPath(strText, iHash);
+  if (iPath != 0)
+    return iPath;
+  unsigned int iDirectory = 0;
+  bool boolFolded = true;
+  size_t iStart = 0;
+  for (size_t iEnd = strText.find(L'\\'); iEnd != std::wstring::npos;
+    iEnd = strText.find(L'\\', iStart)) {
+    TEMDirectoryRecord Directory = {iDirectory, InternComponent(strText, iStart, iEnd)};
+    boolFolded = boolFolded && FFoldedComponents[Directory.iName] == Directory.iName;
+    std::pair<std::unordered_map<unsigned long long, unsigned int>::iterator, bool> Item =
+      FDirectoryIDs.insert(std::make_pair(((unsigned long long)Directory.iParent << 32) |
+      Directory.iName, (unsigned int)FDirectories.Size()));
+    if (Item.second)
+      FDirectories.Append() = Directory;
+    iDirectory = Item.first->second;
+    iStart = iEnd + 1;
+  }
+  const unsigned int iFileName = InternComponent(strText, iStart, strText.length());
+  iPath = (TEMPathID)FPaths.Size();
+  TEMPathRecord& Path = FPaths.Append();
+  Path.iDirectory = iDirectory;
+  Path.iFileName = iFileName;
+  Path.iFolded = boolFolded && FFoldedComponents[iFileName] == iFileName ? iPath : 0;
+  FPathIDs.insert(std::make_pair(iHash, iPath));
+  return iPath;
+}
+
+/**
+
+  This method returns the ID of the given text adding it to the pool if it is new.
+
+  @precon  None.
+  @postcon Returns the ID of the text (0 for empty text).
+
+  @param   strText as a std::wstring as a constant reference
+  @return  a TEMPathID
+
+**/
+TEMPathID TEMPathPool::Intern(const std::wstring& strText) {
+  if (strText.empty())
+    return 0;
+  size_t iHash = std::hash<std::wstring>()(strText);
+  std::lock_guard<std::mutex> Lock(FLock);
+  return InternPath(strText, iHash);
+}
+
+/**
+
+  This method returns the ID of the given text without adding it to the pool (e.g. for the text
+  of a query which may match nothing).
+
+  @precon  None.
+  @postcon Returns the ID of the text or 0 if it is empty or not in the pool.
+
+  @param   strText as a std::wstring as a constant reference
+  @return  a TEMPathID
+
+**/
+TEMPathID TEMPathPool::Find(const std::wstring& strText) const {
+  if (strText.empty())
+    return 0;
+  size_t iHash = std::hash<std::wstring>()(strText);
+  std::lock_guard<std::mutex> Lock(FLock);
+  return FindPath(strText, iHash);
+}
+
+/**
+
+  This method returns the key which the paths with the given file name (ignoring case) have
+  without adding the file name to the pool. Any text before the last backslash is ignored.
+
+  @precon  None.
+  @postcon Returns true with the key if a path with the file name is in the pool.
+
+  @param   strFileName as a std::wstring as a constant reference
+  @param   iKey        as an unsigned int as a reference
+  @return  a bool
+
+**/
+bool TEMPathPool::FindFileNameKey(const std::wstring& strFileName, unsigned int& iKey) const {
+  size_t iStart = strFileName.rfind(L'\\');
+  std::wstring strFolded = EMFoldCase(iStart == std::wstring::npos ? strFileName :
+    strFileName.substr(iStart + 1));
+  std::lock_guard<std::mutex> Lock(FLock);
+  std::unordered_map<std::wstring, unsigned int>::const_iterator i =
+    FComponentIDs.find(strFolded);
+  if (i == FComponentIDs.end())
+    return false;
+  iKey = i->second;
+  return true;
+}
+
+/**
+
+  This method returns the text of the given path by joining its components.
+
+  @precon  iPath must be an ID returned by the pool.
+  @postcon Returns the text of the path.
+
+  @param   iPath as a TEMPathID as a constant
+  @return  a std::wstring
+
+**/
+std::wstring TEMPathPool::Text(const TEMPathID iPath) const {
+  std::wstring strText;
+  if (iPath == 0)
+    return strText;
+  const TEMPathRecord& Path = FPaths[iPath];
+  size_t iLength = FComponents[Path.iFileName]->length();
+  for (unsigned int i = Path.iDirectory; i != 0; i = FDirectories[i].iParent)
+    iLength += FComponents[FDirectories[i].iName]->length() + 1;
+  strText.resize(iLength);
+  const std::wstring* strName = FComponents[Path.iFileName];
+  strText.replace(iLength - strName->length(), strName->length(), *strName);
+  iLength -= strName->length();
+  for (unsigned int i = Path.iDirectory; i != 0; i = FDirectories[i].iParent) {
+    strText[--iLength] = L'\\';
+    strName = FComponents[FDirectories[i].iName];
+    strText.replace(iLength - strName->length(), strName->length(), *strName);
+    iLength -= strName->length();
+  }
+  return strText;
+}
+
+/**
+
+  This method returns the file name of the given path, i.e. its text after the last backslash.
+
+  @precon  iPath must be an ID returned by the pool.
+  @postcon Returns the interned file name (which is never moved or freed).
+
+  @param   iPath as a TEMPathID as a constant
+  @return  a std::wstring as a constant reference
+
+**/
+const std::wstring& TEMPathPool::FileName(const TEMPathID iPath) const {
+  return *FComponents[FPaths[iPath].iFileName];
+}
+
+/**
+
+  This method returns the ID of the case folded text of the given path so that two paths are the
+  same ignoring case if their folded IDs are equal. The folded path is interned the first time it
+  is asked for.
+
+  @precon  iPath must be an ID returned by the pool.
+  @postcon Returns the folded ID.
+
+  @param   iPath as a TEMPathID as a constant
+  @return  a TEMPathID
+
+**/
+TEMPathID TEMPathPool::Folded(const TEMPathID iPath) {
+  TEMPathID iFolded = FPaths[iPath].iFolded.load(std::memory_order_acquire);
+  if (iFolded != 0 || iPath == 0)
+    return iFolded;
+  std::wstring strFolded = EMFoldCase(Text(iPath));
+  size_t iHash = std::hash<std::wstring>()(strFolded);
+  std::lock_guard<std::mutex> Lock(FLock);
+  iFolded = InternPath(strFolded, iHash);
+  FPaths[iPath].iFolded.store(iFolded, std::memory_order_release);
+  return iFolded;
+}
+
+/**
+
+  This method returns the ID of the case folded file name of the given path so that two paths
+  have the same file name (in any folder and ignoring case) if their keys are equal.
+
+  @precon  iPath must be an ID returned by the pool.
+  @postcon Returns the ID of the folded file name component.
+
+  @param   iPath as a TEMPathID as a constant
+  @return  an unsigned int
+
+**/
+unsigned int TEMPathPool::FileNameKey(const TEMPathID iPath) const {
+  return FFoldedComponents[FPaths[iPath].iFileName];
+}
+
+/**
+
+  This method returns the number of distinct paths in the pool (including the case folded paths
+  that have been asked for).
+
+  @precon  None.
+  @postcon Returns the number of paths.
+
+  @return  a size_t
+
+**/
+size_t TEMPathPool::Count() const {
+  return FPaths.Size() - 1;
+}
+
+/**
+
+  This method returns an estimate of the memory held by the pool: the component text, the records
+  and a node (key, value and link) for each entry of the three maps.
+
+  @precon  None.
+  @postcon Returns the number of bytes.
+
+  @return  a size_t
+
+**/
+size_t TEMPathPool::Bytes() const {
+  std::lock_guard<std::mutex> Lock(FLock);
+  const size_t iNode = 2 * sizeof(void*);
+  return FCharacters * sizeof(wchar_t) +
+    FComponents.Size() * (sizeof(const std::wstring*) + sizeof(unsigned int) +
+      sizeof(std::wstring) + sizeof(unsigned int) + iNode) +
+    FDirectories.Size() * (sizeof(TEMDirectoryRecord) + sizeof(unsigned long long) +
+      sizeof(unsigned int) + iNode) +
+    FPaths.Size() * (sizeof(TEMPathRecord) + sizeof(size_t) + sizeof(TEMPathID) + iNode);
+}
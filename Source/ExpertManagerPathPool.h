@@ -0,0 +1,147 @@
+#ifndef ExpertManagerPathPoolH
+#define ExpertManagerPathPoolH
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <stdexcept>
+#include <unordered_map>
+
+/** A simplified type for the ID of an interned path (0 is the empty path). **/
+typedef unsigned int TEMPathID;
+
+/** This class is an array which only grows. Its items are held in fixed size chunks which are
+    never moved or freed so that an item can be read without a lock while another thread (holding
+    the owner's lock) appends to the array. **/
+template <class T>
+class TEMChunkArray {
+  private:
+    static const size_t iChunkBits = 12;
+    static const size_t iChunkSize = (size_t)1 << iChunkBits;
+    static const size_t iMaxChunks = 4096;
+    std::atomic<T*>     FChunks[iMaxChunks];
+    std::atomic<size_t> FCount;
+    TEMChunkArray(const TEMChunkArray&);
+    TEMChunkArray& operator=(const TEMChunkArray&);
+  public:
+    TEMChunkArray() : FCount(0) {
+      for (size_t i = 0; i < iMaxChunks; i++)
+        FChunks[i].store(NULL, std::memory_order_relaxed);
+    };
+    ~TEMChunkArray() {
+      for (size_t i = 0; i < iMaxChunks; i++)
+        delete [] FChunks[i].load(std::memory_order_relaxed);
+    };
+    /**
+
+      This method adds an item to the end of the array allocating a new chunk if the last is full.
+
+      @precon  Only one thread may append at a time and the new item must be filled in before its
+               index is passed to another thread.
+      @postcon Returns the new item.
+
+      @return  a T as a reference
+
+    **/
+    T& Append() {
+      const size_t iIndex = FCount.load(std::memory_order_relaxed);
+      if (iIndex >> iChunkBits >= iMaxChunks)
+        throw std::length_error("The chunk array is full");
+      T* Chunk = FChunks[iIndex >> iChunkBits].load(std::memory_order_relaxed);
+      if (Chunk == NULL) {
+        Chunk = new T[iChunkSize];
+        FChunks[iIndex >> iChunkBits].store(Chunk, std::memory_order_release);
+      }
+      FCount.store(iIndex + 1, std::memory_order_release);
+      return Chunk[iIndex & (iChunkSize - 1)];
+    };
+    T& operator[](const size_t iIndex) {
+      return FChunks[iIndex >> iChunkBits].load(std::memory_order_acquire)[iIndex &
+        (iChunkSize - 1)];
+    };
+    const T& operator[](const size_t iIndex) const {
+      return FChunks[iIndex >> iChunkBits].load(std::memory_order_acquire)[iIndex &
+        (iChunkSize - 1)];
+    };
+    size_t Size() const { return FCount.load(std::memory_order_acquire); };
+};
+
+/** This class interns the paths (and names) of the experts and packages of all installations. A
+    path is split at its backslashes and each distinct component is held once, each distinct
+    directory once as its parent directory and last component, and each distinct path once as its
+    directory and file name so that the prefixes which repeat across installations (e.g.
+    $(BDS)\bin or C:\Program Files (x86)\Embarcadero\Studio\NN.0) are shared. Paths are found
+    by the hash of their text (checked against their components) so that interning text which is
+    already in the pool allocates nothing. Each component records the ID of its case folded
+    component (so file names are compared without case as integers) and each path the ID of its
+    case folded path, which is interned the first time it is asked for. There is a single pool
+    for the process which only grows and which is safe to use from many threads at once: the
+    records are held in chunk arrays which are never moved so that reading a path takes no lock
+    and only interning text (including a path's folded path the first time it is asked for) and
+    finding text take the lock. **/
+class TEMPathPool {
+  private:
+    /** A record of an interned path (iFolded is 0 until the folded path is interned). **/
+    struct TEMPathRecord {
+      unsigned int iDirectory;
+      unsigned int iFileName;
+      std::atomic<TEMPathID> iFolded;
+    };
+    /** A record of an interned directory (directory 0 is the root of relative paths). **/
+    struct TEMDirectoryRecord {
+      unsigned int iParent;
+      unsigned int iName;
+    };
+    mutable std::mutex                                   FLock;
+    std::unordered_map<std::wstring, unsigned int>       FComponentIDs;
+    TEMChunkArray<const std::wstring*>                   FComponents;
+    TEMChunkArray<unsigned int>                          FFoldedComponents;
+    std::unordered_map<unsigned long long, unsigned int> FDirectoryIDs;
+    TEMChunkArray<TEMDirectoryRecord>                    FDirectories;
+    std::unordered_multimap<size_t, TEMPathID>           FPathIDs;
+    TEMChunkArray<TEMPathRecord>                         FPaths;
+    size_t                                               FCharacters;
+    bool SameText(const TEMPathID iPath, const std::wstring& strText) const;
+    TEMPathID FindPath(const std::wstring& strText, const size_t iHash) const;
+    unsigned int InternComponent(const std::wstring& strText, const size_t iStart,
+      const size_t iEnd);
+    TEMPathID InternPath(const std::wstring& strText, const size_t iHash);
+  public:
+    TEMPathPool();
+    static TEMPathPool& Global();
+    TEMPathID Intern(const std::wstring& strText);
+    TEMPathID Find(const std::wstring& strText) const;
+    bool FindFileNameKey(const std::wstring& strFileName, unsigned int& iKey) const;
+    std::wstring Text(const TEMPathID iPath) const;
+    const std::wstring& FileName(const TEMPathID iPath) const;
+    TEMPathID Folded(const TEMPathID iPath);
+    unsigned int FileNameKey(const TEMPathID iPath) const;
+    size_t Count() const;
+    size_t Bytes() const;
+};
+
+/** This class is a handle to a path or name in the global path pool. It is the size of an int, it
+    is compared by ID and its text is only built when asked for. Text is only interned when a path
+    is explicitly constructed from it as the pool never forgets a path (queries use the pool's
+    Find methods instead). **/
+class TEMPath {
+  private:
+    TEMPathID FID;
+  public:
+    TEMPath() : FID(0) {};
+    explicit TEMPath(const std::wstring& strText) : FID(TEMPathPool::Global().Intern(strText)) {};
+    explicit TEMPath(const wchar_t* strText) : FID(TEMPathPool::Global().Intern(strText)) {};
+    TEMPathID ID() const { return FID; };
+    bool Empty() const { return FID == 0; };
+    std::wstring Text() const { return TEMPathPool::Global().Text(FID); };
+    const std::wstring& FileName() const { return TEMPathPool::Global().FileName(FID); };
+    TEMPathID FoldedID() const { return TEMPathPool::Global().Folded(FID); };
+    unsigned int FileNameKey() const { return TEMPathPool::Global().FileNameKey(FID); };
+    bool SameText(const TEMPath& Path) const { return FoldedID() == Path.FoldedID(); };
+    bool operator==(const TEMPath& Path) const { return FID == Path.FID; };
+    bool operator!=(const TEMPath& Path) const { return FID != Path.FID; };
+};
+
+#endif
+
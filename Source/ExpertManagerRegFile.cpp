@@ -0,0 +1,327 @@
+#pragma hdrstop
+
+#include "ExpertManagerRegFile.h"
+#include "ExpertManagerMappedFile.h"
+#include <cstring>
+
+#pragma package(smart_init)
+
+/** A class to return the physical lines of a mapped .reg file decoded from either UTF-16LE (as
+    written by REGEDIT5) or UTF-8 / ASCII (as written by REGEDIT4). **/
+class TEMRegFileLines {
+  private:
+    const char* FData;
+    size_t      FSize;
+    size_t      FPos;
+    bool        FUTF16;
+  public:
+    /**
+
+      This is the constructor for the line reader which detects the encoding from the byte order
+      mark.
+
+      @precon  pData must be valid for iSize bytes.
+      @postcon The reader is positioned after any byte order mark.
+
+      @param   pData as a char pointer as a constant
+      @param   iSize as a size_t as a constant
+
+    **/
+    TEMRegFileLines(const char* pData, const size_t iSize) :
+      FData(pData), FSize(iSize), FPos(0), FUTF16(false) {
+      if (FSize >= 2 && (unsigned char)FData[0] == 0xFF && (unsigned char)FData[1] == 0xFE) {
+        FUTF16 = true;
+        FPos = 2;
+      } else if (FSize >= 3 && std::memcmp(FData, "\xEF\xBB\xBF", 3) == 0)
+        FPos = 3;
+    };
+    /**
+
+      This method returns the next physical line without its line ending.
+
+      @precon  None.
+      @postcon Returns true and the line if there is one else false.
+
+      @param   strLine as a std::wstring as a reference
+      @return  a bool
+
+    **/
+    bool Next(std::wstring& strLine) {
+      strLine.clear();
+      if (FPos >= FSize)
+        return false;
+      if (FUTF16) {
+        while (FPos + 1 < FSize) {
+          wchar_t c = (wchar_t)((unsigned char)FData[FPos] | (unsigned char)FData[FPos + 1] << 8);
+          FPos += 2;
+          if (c == L'\n')
+            break;
+          strLine += c;
+        }
+        if (FPos + 1 == FSize)
+          FPos++;
+      } else {
+        const char* pEnd = (const char*)std::memchr(FData + FPos, '\n', FSize - FPos);
+        size_t iEnd = pEnd != NULL ? pEnd - FData : FSize;
+        strLine = EMUTF8ToWide(FData + FPos, iEnd - FPos);
+        FPos = iEnd + 1;
+      }
+      if (strLine.length() > 0 && strLine[strLine.length() - 1] == L'\r')
+        strLine.erase(strLine.length() - 1);
+      return true;
+    };
+};
+
+/**
+
+  This method returns the value of the given hexadecimal digit or -1 if it is not one.
+
+  @precon  None.
+  @postcon Returns the digit's value.
+
+  @param   c as a wchar_t as a constant
+  @return  an int
+
+**/
+static int HexDigit(const wchar_t c) {
+  if (c >= L'0' && c <= L'9')
+    return c - L'0';
+  if (c >= L'a' && c <= L'f')
+    return c - L'a' + 10;
+  if (c >= L'A' && c <= L'F')
+    return c - L'A' + 10;
+  return -1;
+}
+
+/**
+
+  This method parses the quoted string starting at the given position (which must be the opening
+  quote) un-escaping \\ and \".
+
+  @precon  strLine[iPos] must be a double quote.
+  @postcon Returns true with the string and iPos after the closing quote if it is terminated.
+
+  @param   strLine as a std::wstring as a constant reference
+  @param   iPos    as a size_t as a reference
+  @param   strText as a std::wstring as a reference
+  @return  a bool
+
+**/
+static bool ParseQuoted(const std::wstring& strLine, size_t& iPos, std::wstring& strText) {
+  strText.clear();
+  for (iPos++; iPos < strLine.length(); iPos++) {
+    wchar_t c = strLine[iPos];
+    if (c == L'"') {
+      iPos++;
+      return true;
+    }
+    if (c == L'\\' && iPos + 1 < strLine.length())
+      c = strLine[++iPos];
+    strText += c;
+  }
+  return false;
+}
+
+/**
+
+  This is the constructor for the .reg file registry store.
+
+  @precon  None.
+  @postcon The store is empty. If a filter is given only the keys it accepts will be loaded.
+
+  @param   Filter as a TEMSnapshotFilter as a constant reference
+
+**/
+TEMRegFileRegistryStore::TEMRegFileRegistryStore(const TEMSnapshotFilter& Filter) :
+  FFilter(Filter), FKey(NULL), FKeyHadValues(false) {
+}
+
+/**
+
+  This method memory maps the given .reg file and loads its keys and values.
+
+  @precon  None.
+  @postcon Returns true if the file was opened and is a registry editor export.
+
+  @param   strFileName as a std::wstring as a constant reference
+  @return  a bool
+
+**/
+bool TEMRegFileRegistryStore::LoadFromFile(const std::wstring& strFileName) {
+  TEMMappedFile File(strFileName);
+  return File.Opened() && LoadFromBuffer(File.Data(), File.Size());
+}
+
+/**
+
+  This method loads the keys and values of the given .reg file contents in a single pass. Lines
+  ending in a backslash are joined with the following line (less its indentation) before they are
+  parsed. Deleted keys ([-Key]) are skipped and deleted values ("Name"=-) are removed.
+
+  @precon  pData must be valid for iSize bytes.
+  @postcon Returns true if the contents start with a registry editor header.
+
+  @param   pData as a char pointer as a constant
+  @param   iSize as a size_t as a constant
+  @return  a bool
+
+**/
+bool TEMRegFileRegistryStore::LoadFromBuffer(const char* pData, const size_t iSize) {
+  TEMRegFileLines Lines(pData, iSize);
+  std::wstring strLine, strNext;
+  if (!Lines.Next(strLine) || (strLine != L"Windows Registry Editor Version 5.00" &&
+    strLine != L"REGEDIT4"))
+    return false;
+  FKey = NULL;
+  while (Lines.Next(strLine)) {
+    while (strLine.length() > 0 && strLine[strLine.length() - 1] == L'\\' && strLine[0] != L'[' &&
+      Lines.Next(strNext)) {
+      strLine.erase(strLine.length() - 1);
+      size_t iStart = strNext.find_first_not_of(L" \t");
+      if (iStart != std::wstring::npos)
+        strLine.append(strNext, iStart, std::wstring::npos);
+    }
+    if (strLine.length() == 0 || strLine[0] == L';')
+      continue;
+    if (strLine[0] == L'[')
+      ParseKey(strLine);
+    else if (FKey != NULL)
+      ParseValue(strLine);
+  }
+  FKey = NULL;
+  return true;
+}
+
+/**
+
+  This method makes the key in the given [Key\Path] line the current key (creating it) unless it
+  is a deleted key or it or any of its parent keys is rejected by the filter (as a snapshot would
+  never reach it) in which case the following values are skipped.
+
+  @precon  strLine must start with an open square bracket.
+  @postcon The current key is set.
+
+  @param   strLine as a std::wstring as a constant reference
+
+**/
+void TEMRegFileRegistryStore::ParseKey(const std::wstring& strLine) {
+  FKey = NULL;
+  size_t iEnd = strLine.rfind(L']');
+  if (iEnd == std::wstring::npos || iEnd < 2 || strLine[1] == L'-')
+    return;
+  std::wstring strPath = strLine.substr(1, iEnd - 1);
+  if (strPath.compare(0, 5, L"HKEY_") == 0) {
+    size_t iSlash = strPath.find(L'\\');
+    strPath.erase(0, iSlash == std::wstring::npos ? strPath.length() : iSlash + 1);
+  }
+  TEMNameList Parts;
+  EMSplitPath(strPath, Parts);
+  if (Parts.empty())
+    return;
+  if (FFilter) {
+    TEMNameList Prefix;
+    for (size_t i = 0; i < Parts.size(); i++) {
+      Prefix.push_back(Parts[i]);
+      if (!FFilter(Prefix))
+        return;
+    }
+  }
+  FKey = &GetKey(strPath);
+  FKeyHadValues = !FKey->Values.empty();
+}
+
+/**
+
+  This method parses a "Name"=Data (or @=Data for the default value) line and adds the value to
+  the current key.
+
+  @precon  FKey must be a valid key.
+  @postcon The value is added, updated or removed.
+
+  @param   strLine as a std::wstring as a constant reference
+
+**/
+void TEMRegFileRegistryStore::ParseValue(const std::wstring& strLine) {
+  size_t iPos = 0;
+  if (strLine[0] == L'@') {
+    FName.clear();
+    iPos = 1;
+  } else if (strLine[0] != L'"' || !ParseQuoted(strLine, iPos, FName))
+    return;
+  if (iPos >= strLine.length() || strLine[iPos] != L'=')
+    return;
+  iPos++;
+  if (iPos < strLine.length() && strLine[iPos] == L'-') {
+    for (size_t i = 0; i < FKey->Values.size(); i++)
+      if (EMSameText(FKey->Values[i].first, FName)) {
+        FKey->Values.erase(FKey->Values.begin() + i);
+        break;
+      }
+    return;
+  }
+  if (ParseValueData(strLine, iPos))
+    AddValue();
+}
+
+/**
+
+  This method decodes the data of a value. Strings (quoted, hex(1) and expandable hex(2)) are
+  decoded from UTF-16LE and DWORDs are converted to decimal as per the live registry store. Other
+  types of value are kept with an empty value.
+
+  @precon  None.
+  @postcon Returns true with the value in FValue if the data is well formed.
+
+  @param   strLine as a std::wstring as a constant reference
+  @param   iPos    as a size_t
+  @return  a bool
+
+**/
+bool TEMRegFileRegistryStore::ParseValueData(const std::wstring& strLine, size_t iPos) {
+  FValue.clear();
+  if (iPos < strLine.length() && strLine[iPos] == L'"')
+    return ParseQuoted(strLine, iPos, FValue);
+  if (strLine.compare(iPos, 6, L"dword:") == 0) {
+    unsigned long iValue = 0;
+    for (iPos += 6; iPos < strLine.length() && HexDigit(strLine[iPos]) >= 0; iPos++)
+      iValue = iValue << 4 | HexDigit(strLine[iPos]);
+    FValue = std::to_wstring(iValue & 0xFFFFFFFFUL);
+    return true;
+  }
+  bool boolString = strLine.compare(iPos, 7, L"hex(1):") == 0 ||
+    strLine.compare(iPos, 7, L"hex(2):") == 0;
+  if (!boolString)
+    return strLine.compare(iPos, 3, L"hex") == 0;
+  FBytes.clear();
+  for (iPos += 7; iPos + 1 < strLine.length(); iPos += 3) {
+    int iHigh = HexDigit(strLine[iPos]), iLow = HexDigit(strLine[iPos + 1]);
+    if (iHigh < 0 || iLow < 0)
+      return false;
+    FBytes += (char)(iHigh << 4 | iLow);
+  }
+  for (size_t i = 0; i + 1 < FBytes.length(); i += 2)
+    FValue += (wchar_t)((unsigned char)FBytes[i] | (unsigned char)FBytes[i + 1] << 8);
+  while (FValue.length() > 0 && FValue[FValue.length() - 1] == L'\0')
+    FValue.erase(FValue.length() - 1);
+  return true;
+}
+
+/**
+
+  This method adds the parsed value to the current key. Only keys that already had values before
+  this section need to be searched for an existing value of the same name as a registry editor
+  export does not repeat values within a key.
+
+  @precon  FKey must be a valid key.
+  @postcon The value is added or updated.
+
+**/
+void TEMRegFileRegistryStore::AddValue() {
+  if (FKeyHadValues)
+    for (size_t i = 0; i < FKey->Values.size(); i++)
+      if (EMSameText(FKey->Values[i].first, FName)) {
+        FKey->Values[i].second = FValue;
+        return;
+      }
+  FKey->Values.push_back(TEMRegValue(FName, FValue));
+}
@@ -0,0 +1,30 @@
+#ifndef ExpertManagerRegFileH
+#define ExpertManagerRegFileH
+
+#include "ExpertManagerRegistryStore.h"
+#include <string>
+
+/** A memory registry store which is loaded from a registry editor export (.reg) file so that
+    installations exported from other machines can be validated offline. The file is memory mapped
+    and decoded and parsed a line at a time so only the keys and values that are kept (as decided
+    by the optional filter) use memory. The hive name at the start of each key (e.g.
+    HKEY_CURRENT_USER) is removed so the keys match the live registry store's paths. **/
+class TEMRegFileRegistryStore : public TEMMemoryRegistryStore {
+  private:
+    TEMSnapshotFilter FFilter;
+    TEMMemoryKey*     FKey;
+    bool              FKeyHadValues;
+    std::wstring      FName;
+    std::wstring      FValue;
+    std::string       FBytes;
+    void ParseKey(const std::wstring& strLine);
+    void ParseValue(const std::wstring& strLine);
+    bool ParseValueData(const std::wstring& strLine, size_t iPos);
+    void AddValue();
+  public:
+    TEMRegFileRegistryStore(const TEMSnapshotFilter& Filter = TEMSnapshotFilter());
+    bool LoadFromFile(const std::wstring& strFileName);
+    bool LoadFromBuffer(const char* pData, const size_t iSize);
+};
+
+#endif
@@ -0,0 +1,1065 @@
+#pragma hdrstop
+
+#include "ExpertManagerRegistryStore.h"
+#include "ExpertManagerTrace.h"
+#include <fstream>
+#include <cwchar>
+#include <sstream>
+
+#pragma package(smart_init)
+
+#ifdef _WIN32
+/**
+
+  This is the constructor for the Windows registry store class.
+
+  @precon  None.
+  @postcon Stores the root key (defaults to HKEY_CURRENT_USER as per TRegIniFile).
+
+  @param   RootKey as a HKEY
+
+**/
+TEMWinRegistryStore::TEMWinRegistryStore(HKEY RootKey) : FRootKey(RootKey), FCurrentKey(NULL) {}
+
+/**
+
+  This is the destructor for the Windows registry store class.
+
+  @precon  None.
+  @postcon Closes the current key.
+
+**/
+TEMWinRegistryStore::~TEMWinRegistryStore() {
+  CloseKey();
+}
+
+/**
+
+  This method reads the sub-key names and the values of the given registry key with a single open
+  of the key. String values are returned as is (expandable strings are not expanded), DWORD values
+  are returned as decimal text and any other value types are returned as empty strings.
+
+  @precon  None.
+  @postcon Keys and Values are filled with the contents of the registry key and true is returned if
+           the key exists else false is returned.
+
+  @param   strPath as a std::wstring as a constant reference
+  @param   Keys    as a TEMNameList as a reference
+  @param   Values  as a TEMRegValueList as a reference
+  @return  a bool
+
+**/
+bool TEMWinRegistryStore::ReadKey(const std::wstring& strPath, TEMNameList& Keys,
+  TEMRegValueList& Values) {
+  Keys.clear();
+  Values.clear();
+  HKEY hKey = NULL;
+  if (RegOpenKeyExW(FRootKey, strPath.c_str(), 0, KEY_READ, &hKey) != ERROR_SUCCESS)
+    return false;
+  DWORD iKeyCount = 0, iMaxKeyLen = 0, iValueCount = 0, iMaxNameLen = 0, iMaxDataLen = 0;
+  RegQueryInfoKeyW(hKey, NULL, NULL, NULL, &iKeyCount, &iMaxKeyLen, NULL, &iValueCount,
+    &iMaxNameLen, &iMaxDataLen, NULL, NULL);
+  std::vector<wchar_t> Name((iMaxKeyLen > iMaxNameLen ? iMaxKeyLen : iMaxNameLen) + 1);
+  for (DWORD i = 0; i < iKeyCount; i++) {
+    DWORD iLen = (DWORD)Name.size();
+    if (RegEnumKeyExW(hKey, i, &Name[0], &iLen, NULL, NULL, NULL, NULL) == ERROR_SUCCESS)
+      Keys.push_back(std::wstring(&Name[0], iLen));
+  }
+  std::vector<BYTE> Data(iMaxDataLen + sizeof(wchar_t));
+  for (DWORD i = 0; i < iValueCount; i++) {
+    DWORD iLen = (DWORD)Name.size();
+    DWORD iDataLen = (DWORD)Data.size();
+    DWORD iType = REG_NONE;
+    if (RegEnumValueW(hKey, i, &Name[0], &iLen, NULL, &iType, &Data[0], &iDataLen) == ERROR_SUCCESS) {
+      std::wstring strValue;
+      if (iType == REG_SZ || iType == REG_EXPAND_SZ) {
+        strValue.assign((const wchar_t*)&Data[0], iDataLen / sizeof(wchar_t));
+        while (strValue.length() > 0 && strValue[strValue.length() - 1] == L'\0')
+          strValue.erase(strValue.length() - 1);
+      } else if (iType == REG_DWORD && iDataLen == sizeof(DWORD))
+        strValue = std::to_wstring(*(DWORD*)&Data[0]);
+      Values.push_back(TEMRegValue(std::wstring(&Name[0], iLen), strValue));
+    }
+  }
+  RegCloseKey(hKey);
+  return true;
+}
+
+/**
+
+  This method opens the given key for reading and writing values creating it if required.
+
+  @precon  None.
+  @postcon Returns true if the key was opened (any previously open key is closed).
+
+  @param   strPath    as a std::wstring as a constant reference
+  @param   boolCreate as a bool as a constant
+  @return  a bool
+
+**/
+bool TEMWinRegistryStore::OpenKey(const std::wstring& strPath, const bool boolCreate) {
+  CloseKey();
+  LONG iResult;
+  if (boolCreate)
+    iResult = RegCreateKeyExW(FRootKey, strPath.c_str(), 0, NULL, REG_OPTION_NON_VOLATILE,
+      KEY_READ | KEY_WRITE, NULL, &FCurrentKey, NULL);
+  else
+    iResult = RegOpenKeyExW(FRootKey, strPath.c_str(), 0, KEY_READ | KEY_WRITE, &FCurrentKey);
+  if (iResult != ERROR_SUCCESS)
+    FCurrentKey = NULL;
+  return FCurrentKey != NULL;
+}
+
+/**
+
+  This method closes the current key.
+
+  @precon  None.
+  @postcon No key is open.
+
+**/
+void TEMWinRegistryStore::CloseKey() {
+  if (FCurrentKey != NULL)
+    RegCloseKey(FCurrentKey);
+  FCurrentKey = NULL;
+}
+
+/**
+
+  This method reads the named string value of the current key.
+
+  @precon  A key must be open.
+  @postcon Returns true with the value if it exists.
+
+  @param   strName  as a std::wstring as a constant reference
+  @param   strValue as a std::wstring as a reference
+  @return  a bool
+
+**/
+bool TEMWinRegistryStore::ReadValue(const std::wstring& strName, std::wstring& strValue) {
+  DWORD iType = REG_NONE, iDataLen = 0;
+  if (RegQueryValueExW(FCurrentKey, strName.c_str(), NULL, &iType, NULL, &iDataLen) != ERROR_SUCCESS)
+    return false;
+  std::vector<BYTE> Data(iDataLen + sizeof(wchar_t));
+  if (RegQueryValueExW(FCurrentKey, strName.c_str(), NULL, &iType, &Data[0], &iDataLen) != ERROR_SUCCESS)
+    return false;
+  strValue.clear();
+  if (iType == REG_SZ || iType == REG_EXPAND_SZ) {
+    strValue.assign((const wchar_t*)&Data[0], iDataLen / sizeof(wchar_t));
+    while (strValue.length() > 0 && strValue[strValue.length() - 1] == L'\0')
+      strValue.erase(strValue.length() - 1);
+  } else if (iType == REG_DWORD && iDataLen == sizeof(DWORD))
+    strValue = std::to_wstring(*(DWORD*)&Data[0]);
+  return true;
+}
+
+/**
+
+  This method writes the named string value (as REG_SZ as per TRegIniFile) to the current key.
+
+  @precon  A key must be open.
+  @postcon Returns true if the value was written.
+
+  @param   strName  as a std::wstring as a constant reference
+  @param   strValue as a std::wstring as a constant reference
+  @return  a bool
+
+**/
+bool TEMWinRegistryStore::WriteValue(const std::wstring& strName, const std::wstring& strValue) {
+  return RegSetValueExW(FCurrentKey, strName.c_str(), 0, REG_SZ, (const BYTE*)strValue.c_str(),
+    (DWORD)((strValue.length() + 1) * sizeof(wchar_t))) == ERROR_SUCCESS;
+}
+
+/**
+
+  This method deletes the named value from the current key.
+
+  @precon  A key must be open.
+  @postcon Returns true if the value was deleted or did not exist.
+
+  @param   strName as a std::wstring as a constant reference
+  @return  a bool
+
+**/
+bool TEMWinRegistryStore::DeleteValue(const std::wstring& strName) {
+  LONG iResult = RegDeleteValueW(FCurrentKey, strName.c_str());
+  return iResult == ERROR_SUCCESS || iResult == ERROR_FILE_NOT_FOUND;
+}
+
+/**
+
+  This method reads the type and raw data of the named value of the current key.
+
+  @precon  A key must be open.
+  @postcon Returns true with the value if it exists.
+
+  @param   strName as a std::wstring as a constant reference
+  @param   Value   as a TEMRegRawValue as a reference
+  @return  a bool
+
+**/
+bool TEMWinRegistryStore::ReadRawValue(const std::wstring& strName, TEMRegRawValue& Value) {
+  DWORD iType = REG_NONE, iDataLen = 0;
+  if (RegQueryValueExW(FCurrentKey, strName.c_str(), NULL, &iType, NULL, &iDataLen) != ERROR_SUCCESS)
+    return false;
+  Value.Data.resize(iDataLen + 1);
+  if (RegQueryValueExW(FCurrentKey, strName.c_str(), NULL, &iType, &Value.Data[0], &iDataLen) !=
+    ERROR_SUCCESS)
+    return false;
+  Value.Data.resize(iDataLen);
+  Value.iType = iType;
+  return true;
+}
+
+/**
+
+  This method writes the named value with the given type and raw data to the current key.
+
+  @precon  A key must be open.
+  @postcon Returns true if the value was written.
+
+  @param   strName as a std::wstring as a constant reference
+  @param   Value   as a TEMRegRawValue as a constant reference
+  @return  a bool
+
+**/
+bool TEMWinRegistryStore::WriteRawValue(const std::wstring& strName, const TEMRegRawValue& Value) {
+  return RegSetValueExW(FCurrentKey, strName.c_str(), 0, Value.iType,
+    Value.Data.empty() ? NULL : &Value.Data[0], (DWORD)Value.Data.size()) == ERROR_SUCCESS;
+}
+
+/**
+
+  This method deletes the given key with all of its sub-keys and values.
+
+  @precon  None.
+  @postcon Returns true if the key was deleted or did not exist.
+
+  @param   strPath as a std::wstring as a constant reference
+  @return  a bool
+
+**/
+bool TEMWinRegistryStore::DeleteKey(const std::wstring& strPath) {
+  CloseKey();
+  LONG iResult = RegDeleteTreeW(FRootKey, strPath.c_str());
+  return iResult == ERROR_SUCCESS || iResult == ERROR_FILE_NOT_FOUND;
+}
+
+/**
+
+  This method returns the time that the given key (its values or its list of sub-keys) was last
+  written to.
+
+  @precon  None.
+  @postcon Returns true with the last write time (as a FILETIME) if the key exists.
+
+  @param   strPath    as a std::wstring as a constant reference
+  @param   iWriteTime as an unsigned long long as a reference
+  @return  a bool
+
+**/
+bool TEMWinRegistryStore::KeyWriteTime(const std::wstring& strPath, unsigned long long& iWriteTime) {
+  HKEY hKey = NULL;
+  if (RegOpenKeyExW(FRootKey, strPath.c_str(), 0, KEY_QUERY_VALUE, &hKey) != ERROR_SUCCESS)
+    return false;
+  FILETIME LastWriteTime;
+  LONG iResult = RegQueryInfoKeyW(hKey, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    &LastWriteTime);
+  RegCloseKey(hKey);
+  if (iResult != ERROR_SUCCESS)
+    return false;
+  iWriteTime = (unsigned long long)LastWriteTime.dwHighDateTime << 32 | LastWriteTime.dwLowDateTime;
+  return true;
+}
+#endif
+
+/**
+
+  This function returns the case folded path of the given key path (as the memory store's keys are
+  held).
+
+  @precon  None.
+  @postcon Returns the folded path.
+
+  @param   strPath as a std::wstring as a constant reference
+  @return  a std::wstring
+
+**/
+static std::wstring FoldedKeyPath(const std::wstring& strPath) {
+  TEMNameList Parts;
+  EMSplitPath(strPath, Parts);
+  std::wstring strFolded;
+  for (size_t i = 0; i < Parts.size(); i++) {
+    if (strFolded.length() > 0)
+      strFolded += L'\\';
+    strFolded += EMFoldCase(Parts[i]);
+  }
+  return strFolded;
+}
+
+/**
+
+  This method returns the memory key for the given path creating it and any missing parent keys.
+
+  @precon  None.
+  @postcon Returns a reference to the memory key for the path.
+
+  @param   strPath as a std::wstring as a constant reference
+  @return  a TEMMemoryKey reference
+
+**/
+TEMMemoryRegistryStore::TEMMemoryKey& TEMMemoryRegistryStore::GetKey(const std::wstring& strPath) {
+  TEMNameList Parts;
+  EMSplitPath(strPath, Parts);
+  std::wstring strFolded;
+  TEMMemoryKey* Key = &FKeys[strFolded];
+  for (size_t i = 0; i < Parts.size(); i++) {
+    if (strFolded.length() > 0)
+      strFolded += L'\\';
+    strFolded += EMFoldCase(Parts[i]);
+    if (FKeys.find(strFolded) == FKeys.end()) {
+      Key->Keys.push_back(Parts[i]);
+      Touch(*Key);
+      Key = &FKeys[strFolded];
+      Touch(*Key);
+    } else
+      Key = &FKeys[strFolded];
+  }
+  return *Key;
+}
+
+/**
+
+  This method creates the key at the given path if it does not already exist.
+
+  @precon  None.
+  @postcon The key and any missing parent keys exist.
+
+  @param   strPath as a std::wstring as a constant reference
+
+**/
+void TEMMemoryRegistryStore::CreateKey(const std::wstring& strPath) {
+  GetKey(strPath);
+}
+
+/**
+
+  This method adds or updates the named value in the key at the given path.
+
+  @precon  None.
+  @postcon The value is stored in the key.
+
+  @param   strPath  as a std::wstring as a constant reference
+  @param   strName  as a std::wstring as a constant reference
+  @param   strValue as a std::wstring as a constant reference
+  @param   iType    as an unsigned int as a constant
+
+**/
+void TEMMemoryRegistryStore::SetValue(const std::wstring& strPath, const std::wstring& strName,
+  const std::wstring& strValue, const unsigned int iType) {
+  TEMMemoryKey& Key = GetKey(strPath);
+  if (iType == rvString)
+    Key.Types.erase(EMFoldCase(strName));
+  else
+    Key.Types[EMFoldCase(strName)] = iType;
+  for (size_t i = 0; i < Key.Values.size(); i++)
+    if (EMSameText(Key.Values[i].first, strName)) {
+      Key.Values[i].second = strValue;
+      Touch(Key);
+      return;
+    }
+  Key.Values.push_back(TEMRegValue(strName, strValue));
+  Touch(Key);
+}
+
+/**
+
+  This method returns the type of the named value in the key at the given path.
+
+  @precon  None.
+  @postcon Returns the type of the value or 0 if it does not exist.
+
+  @param   strPath as a std::wstring as a constant reference
+  @param   strName as a std::wstring as a constant reference
+  @return  an unsigned int
+
+**/
+unsigned int TEMMemoryRegistryStore::ValueType(const std::wstring& strPath,
+  const std::wstring& strName) {
+  TEMMemoryKey* Key = FindKey(strPath);
+  if (Key == NULL)
+    return 0;
+  for (size_t i = 0; i < Key->Values.size(); i++)
+    if (EMSameText(Key->Values[i].first, strName)) {
+      std::unordered_map<std::wstring, unsigned int>::const_iterator Type =
+        Key->Types.find(EMFoldCase(strName));
+      return Type != Key->Types.end() ? Type->second : (unsigned int)rvString;
+    }
+  return 0;
+}
+
+/**
+
+  This method reads the sub-key names and the values of the given key.
+
+  @precon  None.
+  @postcon Keys and Values are filled with the contents of the key and true is returned if the key
+           exists else false is returned.
+
+  @param   strPath as a std::wstring as a constant reference
+  @param   Keys    as a TEMNameList as a reference
+  @param   Values  as a TEMRegValueList as a reference
+  @return  a bool
+
+**/
+bool TEMMemoryRegistryStore::ReadKey(const std::wstring& strPath, TEMNameList& Keys,
+  TEMRegValueList& Values) {
+  TEMMemoryKey* Key = FindKey(strPath);
+  if (Key == NULL) {
+    Keys.clear();
+    Values.clear();
+    return false;
+  }
+  Keys = Key->Keys;
+  Values = Key->Values;
+  return true;
+}
+
+/**
+
+  This method returns the memory key for the given path or NULL if it does not exist.
+
+  @precon  None.
+  @postcon Returns the memory key or NULL.
+
+  @param   strPath as a std::wstring as a constant reference
+  @return  a TEMMemoryKey pointer
+
+**/
+TEMMemoryRegistryStore::TEMMemoryKey* TEMMemoryRegistryStore::FindKey(const std::wstring& strPath) {
+  std::map<std::wstring, TEMMemoryKey>::iterator Key = FKeys.find(FoldedKeyPath(strPath));
+  if (Key == FKeys.end())
+    return NULL;
+  return &Key->second;
+}
+
+/**
+
+  This method opens the given key for reading and writing values creating it if required.
+
+  @precon  None.
+  @postcon Returns true if the key was opened.
+
+  @param   strPath    as a std::wstring as a constant reference
+  @param   boolCreate as a bool as a constant
+  @return  a bool
+
+**/
+bool TEMMemoryRegistryStore::OpenKey(const std::wstring& strPath, const bool boolCreate) {
+  FCurrentKey = boolCreate ? &GetKey(strPath) : FindKey(strPath);
+  return FCurrentKey != NULL;
+}
+
+/**
+
+  This method closes the current key.
+
+  @precon  None.
+  @postcon No key is open.
+
+**/
+void TEMMemoryRegistryStore::CloseKey() {
+  FCurrentKey = NULL;
+}
+
+/**
+
+  This method reads the named value of the current key.
+
+  @precon  A key must be open.
+  @postcon Returns true with the value if it exists.
+
+  @param   strName  as a std::wstring as a constant reference
+  @param   strValue as a std::wstring as a reference
+  @return  a bool
+
+**/
+bool TEMMemoryRegistryStore::ReadValue(const std::wstring& strName, std::wstring& strValue) {
+  for (size_t i = 0; i < FCurrentKey->Values.size(); i++)
+    if (EMSameText(FCurrentKey->Values[i].first, strName)) {
+      strValue = FCurrentKey->Values[i].second;
+      return true;
+    }
+  return false;
+}
+
+/**
+
+  This method adds or updates the named value in the current key.
+
+  @precon  A key must be open.
+  @postcon The value is stored in the key and true is returned.
+
+  @param   strName  as a std::wstring as a constant reference
+  @param   strValue as a std::wstring as a constant reference
+  @return  a bool
+
+**/
+bool TEMMemoryRegistryStore::WriteValue(const std::wstring& strName, const std::wstring& strValue) {
+  FCurrentKey->Types.erase(EMFoldCase(strName));
+  for (size_t i = 0; i < FCurrentKey->Values.size(); i++)
+    if (EMSameText(FCurrentKey->Values[i].first, strName)) {
+      FCurrentKey->Values[i].second = strValue;
+      Touch(*FCurrentKey);
+      return true;
+    }
+  FCurrentKey->Values.push_back(TEMRegValue(strName, strValue));
+  Touch(*FCurrentKey);
+  return true;
+}
+
+/**
+
+  This method deletes the named value from the current key.
+
+  @precon  A key must be open.
+  @postcon The value is removed from the key and true is returned.
+
+  @param   strName as a std::wstring as a constant reference
+  @return  a bool
+
+**/
+bool TEMMemoryRegistryStore::DeleteValue(const std::wstring& strName) {
+  FCurrentKey->Types.erase(EMFoldCase(strName));
+  for (size_t i = 0; i < FCurrentKey->Values.size(); i++)
+    if (EMSameText(FCurrentKey->Values[i].first, strName)) {
+      FCurrentKey->Values.erase(FCurrentKey->Values.begin() + i);
+      Touch(*FCurrentKey);
+      break;
+    }
+  return true;
+}
+
+/**
+
+  This method reads the type and raw data of the named value of the current key. Strings are
+  returned as null terminated UTF-16LE and DWORDs as four little endian bytes (as per the live
+  registry). Other types of value hold no data in a memory store.
+
+  @precon  A key must be open.
+  @postcon Returns true with the value if it exists.
+
+  @param   strName as a std::wstring as a constant reference
+  @param   Value   as a TEMRegRawValue as a reference
+  @return  a bool
+
+**/
+bool TEMMemoryRegistryStore::ReadRawValue(const std::wstring& strName, TEMRegRawValue& Value) {
+  std::wstring strValue;
+  if (!ReadValue(strName, strValue))
+    return false;
+  std::unordered_map<std::wstring, unsigned int>::const_iterator Type =
+    FCurrentKey->Types.find(EMFoldCase(strName));
+  Value.iType = Type != FCurrentKey->Types.end() ? Type->second : (unsigned int)rvString;
+  Value.Data.clear();
+  if (Value.iType == rvString || Value.iType == rvExpandString) {
+    for (size_t i = 0; i <= strValue.length(); i++) {
+      unsigned int iChar = i < strValue.length() ? (unsigned int)strValue[i] : 0;
+      Value.Data.push_back((unsigned char)iChar);
+      Value.Data.push_back((unsigned char)(iChar >> 8));
+    }
+  } else if (Value.iType == rvDWord) {
+    unsigned long iValue = std::wcstoul(strValue.c_str(), NULL, 10);
+    for (size_t i = 0; i < 4; i++)
+      Value.Data.push_back((unsigned char)(iValue >> (8 * i)));
+  }
+  return true;
+}
+
+/**
+
+  This method writes the named value with the given type and raw data to the current key
+  converting strings and DWORDs to text as the live registry store reads them.
+
+  @precon  A key must be open.
+  @postcon The value is stored in the key and true is returned.
+
+  @param   strName as a std::wstring as a constant reference
+  @param   Value   as a TEMRegRawValue as a constant reference
+  @return  a bool
+
+**/
+bool TEMMemoryRegistryStore::WriteRawValue(const std::wstring& strName,
+  const TEMRegRawValue& Value) {
+  std::wstring strValue;
+  if (Value.iType == rvString || Value.iType == rvExpandString) {
+    for (size_t i = 0; i + 1 < Value.Data.size(); i += 2)
+      strValue += (wchar_t)(Value.Data[i] | Value.Data[i + 1] << 8);
+    while (strValue.length() > 0 && strValue[strValue.length() - 1] == L'\0')
+      strValue.erase(strValue.length() - 1);
+  } else if (Value.iType == rvDWord && Value.Data.size() == 4)
+    strValue = std::to_wstring((unsigned long)Value.Data[0] | (unsigned long)Value.Data[1] << 8 |
+      (unsigned long)Value.Data[2] << 16 | (unsigned long)Value.Data[3] << 24);
+  WriteValue(strName, strValue);
+  if (Value.iType != rvString)
+    FCurrentKey->Types[EMFoldCase(strName)] = Value.iType;
+  return true;
+}
+
+/**
+
+  This method deletes the given key with all of its sub-keys and values.
+
+  @precon  None.
+  @postcon The key is removed from its parent and true is returned (false for the root key).
+
+  @param   strPath as a std::wstring as a constant reference
+  @return  a bool
+
+**/
+bool TEMMemoryRegistryStore::DeleteKey(const std::wstring& strPath) {
+  const std::wstring strFolded = FoldedKeyPath(strPath);
+  if (strFolded.empty())
+    return false;
+  if (FKeys.find(strFolded) == FKeys.end())
+    return true;
+  FCurrentKey = NULL;
+  FKeys.erase(strFolded);
+  const std::wstring strPrefix = strFolded + L'\\';
+  std::map<std::wstring, TEMMemoryKey>::iterator Key = FKeys.lower_bound(strPrefix);
+  while (Key != FKeys.end() && Key->first.compare(0, strPrefix.length(), strPrefix) == 0)
+    Key = FKeys.erase(Key);
+  size_t iSlash = strFolded.rfind(L'\\');
+  TEMMemoryKey& Parent = FKeys[iSlash == std::wstring::npos ? L"" : strFolded.substr(0, iSlash)];
+  const std::wstring strName = strFolded.substr(iSlash == std::wstring::npos ? 0 : iSlash + 1);
+  for (size_t i = 0; i < Parent.Keys.size(); i++)
+    if (EMFoldCase(Parent.Keys[i]) == strName) {
+      Parent.Keys.erase(Parent.Keys.begin() + i);
+      break;
+    }
+  Touch(Parent);
+  return true;
+}
+
+/**
+
+  This method returns the write counter of the given key which is incremented whenever the key's
+  values or list of sub-keys change.
+
+  @precon  None.
+  @postcon Returns true with the key's write counter if the key exists.
+
+  @param   strPath    as a std::wstring as a constant reference
+  @param   iWriteTime as an unsigned long long as a reference
+  @return  a bool
+
+**/
+bool TEMMemoryRegistryStore::KeyWriteTime(const std::wstring& strPath,
+  unsigned long long& iWriteTime) {
+  TEMMemoryKey* Key = FindKey(strPath);
+  if (Key == NULL)
+    return false;
+  iWriteTime = Key->iWriteTime;
+  return true;
+}
+
+/**
+
+  This is the constructor for the file registry store class.
+
+  @precon  None.
+  @postcon Loads the keys and values from the given UTF-8 text file. A missing file results in an
+           empty store.
+
+  @param   strFileName as a std::string as a constant reference
+
+**/
+TEMFileRegistryStore::TEMFileRegistryStore(const std::string& strFileName) {
+  std::ifstream File(strFileName.c_str(), std::ios::in | std::ios::binary);
+  std::stringstream Buffer;
+  Buffer << File.rdbuf();
+  LoadFromUTF8(Buffer.str());
+}
+
+/**
+
+  This method loads keys and values from the given UTF-8 text skipping any byte order mark.
+
+  @precon  None.
+  @postcon The keys and values in the text are added to the store.
+
+  @param   strText as a std::string as a constant reference
+
+**/
+void TEMFileRegistryStore::LoadFromUTF8(const std::string& strText) {
+  size_t iStart = 0;
+  if (strText.length() >= 3 && strText.compare(0, 3, "\xEF\xBB\xBF") == 0)
+    iStart = 3;
+  LoadFromText(EMUTF8ToWide(strText.c_str() + iStart, strText.length() - iStart));
+}
+
+/**
+
+  This method loads keys and values from the given text. Lines of the form [Key\Path] start a new
+  key, lines of the form Name=Value add a value to the current key and blank lines or lines
+  starting with a semi-colon are ignored.
+
+  @precon  None.
+  @postcon The keys and values in the text are added to the store.
+
+  @param   strText as a std::wstring as a constant reference
+
+**/
+void TEMFileRegistryStore::LoadFromText(const std::wstring& strText) {
+  std::wstring strKey;
+  size_t iStart = 0;
+  while (iStart < strText.length()) {
+    size_t iEnd = strText.find(L'\n', iStart);
+    if (iEnd == std::wstring::npos)
+      iEnd = strText.length();
+    std::wstring strLine = strText.substr(iStart, iEnd - iStart);
+    iStart = iEnd + 1;
+    if (strLine.length() > 0 && strLine[strLine.length() - 1] == L'\r')
+      strLine.erase(strLine.length() - 1);
+    if (strLine.length() == 0 || strLine[0] == L';')
+      continue;
+    if (strLine[0] == L'[' && strLine[strLine.length() - 1] == L']') {
+      strKey = strLine.substr(1, strLine.length() - 2);
+      CreateKey(strKey);
+    } else {
+      size_t iEquals = strLine.find(L'=');
+      if (iEquals != std::wstring::npos)
+        SetValue(strKey, strLine.substr(0, iEquals), strLine.substr(iEquals + 1));
+    }
+  }
+}
+
+/**
+
+  This method returns the named sub-key of this key or NULL if not found.
+
+  @precon  None.
+  @postcon Returns the sub-key or NULL.
+
+  @param   strName as a std::wstring as a constant reference
+  @return  a TEMRegistryKey pointer as a constant
+
+**/
+const TEMRegistryKey* TEMRegistryKey::FindKey(const std::wstring& strName) const {
+  std::unordered_map<std::wstring, size_t>::const_iterator i = FKeyIndex.find(EMFoldCase(strName));
+  if (i != FKeyIndex.end())
+    return FKeys[i->second].get();
+  return NULL;
+}
+
+/**
+
+  This method returns a pointer to the named value of this key or NULL if not found.
+
+  @precon  None.
+  @postcon Returns the value or NULL.
+
+  @param   strName as a std::wstring as a constant reference
+  @return  a std::wstring pointer as a constant
+
+**/
+const std::wstring* TEMRegistryKey::FindValue(const std::wstring& strName) const {
+  std::unordered_map<std::wstring, size_t>::const_iterator i = FValueIndex.find(EMFoldCase(strName));
+  if (i != FValueIndex.end())
+    return &FValues[i->second].second;
+  return NULL;
+}
+
+/**
+
+  This is the constructor for the registry snapshot class.
+
+  @precon  Root must be a valid instance.
+  @postcon Stores the root key and the filter used to build the snapshot.
+
+  @param   Root   as a TEMRegistryKeyPtr
+  @param   Filter as a TEMSnapshotFilter as a constant reference
+
+**/
+TEMRegistrySnapshot::TEMRegistrySnapshot(TEMRegistryKeyPtr Root, const TEMSnapshotFilter& Filter) :
+  FRoot(Root), FFilter(Filter) {}
+
+/**
+
+  This method reads the key at the given path from the store along with all its sub-keys that pass
+  the filter.
+
+  @precon  None.
+  @postcon Returns the loaded key or NULL if the key does not exist in the store.
+
+  @param   Store  as a TEMRegistryStore as a reference
+  @param   Parts  as a TEMNameList as a reference
+  @param   Filter as a TEMSnapshotFilter as a constant reference
+  @return  a std::shared_ptr<TEMRegistryKey>
+
+**/
+std::shared_ptr<TEMRegistryKey> TEMRegistrySnapshot::LoadKey(TEMRegistryStore& Store,
+  TEMNameList& Parts, const TEMSnapshotFilter& Filter) {
+  std::wstring strPath;
+  for (size_t i = 0; i < Parts.size(); i++) {
+    if (i > 0)
+      strPath += L'\\';
+    strPath += Parts[i];
+  }
+  TEMNameList Keys;
+  std::shared_ptr<TEMRegistryKey> Key(new TEMRegistryKey(Parts.size() > 0 ? Parts.back() : L""));
+  if (!Store.ReadKey(strPath, Keys, Key->FValues))
+    return std::shared_ptr<TEMRegistryKey>();
+  for (size_t i = 0; i < Key->FValues.size(); i++)
+    Key->FValueIndex[EMFoldCase(Key->FValues[i].first)] = i;
+  for (size_t i = 0; i < Keys.size(); i++) {
+    Parts.push_back(Keys[i]);
+    if (!Filter || Filter(Parts)) {
+      TEMRegistryKeyPtr SubKey = LoadKey(Store, Parts, Filter);
+      if (SubKey)
+        AddKey(*Key, SubKey);
+    }
+    Parts.pop_back();
+  }
+  return Key;
+}
+
+/**
+
+  This method adds the given key as a sub-key of the parent key being built.
+
+  @precon  Key must be a valid instance.
+  @postcon The key is added to the parent and indexed by its case folded name.
+
+  @param   Parent as a TEMRegistryKey as a reference
+  @param   Key    as a TEMRegistryKeyPtr
+
+**/
+void TEMRegistrySnapshot::AddKey(TEMRegistryKey& Parent, TEMRegistryKeyPtr Key) {
+  Parent.FKeyIndex[EMFoldCase(Key->Name())] = Parent.FKeys.size();
+  Parent.FKeys.push_back(Key);
+}
+
+/**
+
+  This method returns a copy of the given key with the sub-key at the given path replaced by the
+  new key (or removed if the new key is NULL). Only the keys along the path are copied, all other
+  keys are shared with the original.
+
+  @precon  None.
+  @postcon Returns the new key.
+
+  @param   Key      as a TEMRegistryKeyPtr as a constant reference
+  @param   Parts    as a TEMNameList as a constant reference
+  @param   iPart    as a size_t
+  @param   NewKey   as a TEMRegistryKeyPtr
+  @return  a TEMRegistryKeyPtr
+
+**/
+TEMRegistryKeyPtr TEMRegistrySnapshot::ReplaceKey(const TEMRegistryKeyPtr& Key,
+  const TEMNameList& Parts, size_t iPart, TEMRegistryKeyPtr NewKey) {
+  if (iPart == Parts.size())
+    return NewKey;
+  std::shared_ptr<TEMRegistryKey> Copy(Key ? new TEMRegistryKey(*Key) :
+    new TEMRegistryKey(Parts[iPart - 1]));
+  TEMRegistryKeyPtr OldSubKey;
+  std::unordered_map<std::wstring, size_t>::iterator i = Copy->FKeyIndex.find(EMFoldCase(Parts[iPart]));
+  if (i != Copy->FKeyIndex.end())
+    OldSubKey = Copy->FKeys[i->second];
+  if (!OldSubKey && !NewKey)
+    return Copy;
+  TEMRegistryKeyPtr SubKey = ReplaceKey(OldSubKey, Parts, iPart + 1, NewKey);
+  if (i != Copy->FKeyIndex.end() && SubKey)
+    Copy->FKeys[i->second] = SubKey;
+  else if (i != Copy->FKeyIndex.end()) {
+    Copy->FKeys.erase(Copy->FKeys.begin() + i->second);
+    Copy->FKeyIndex.clear();
+    for (size_t iKey = 0; iKey < Copy->FKeys.size(); iKey++)
+      Copy->FKeyIndex[EMFoldCase(Copy->FKeys[iKey]->Name())] = iKey;
+  } else if (SubKey)
+    AddKey(*Copy, SubKey);
+  return Copy;
+}
+
+/**
+
+  This method creates a snapshot of the given root keys (e.g. Software\Embarcadero) by reading
+  each key in the store once.
+
+  @precon  None.
+  @postcon Returns a new immutable snapshot.
+
+  @param   Store  as a TEMRegistryStore as a reference
+  @param   Roots  as a TEMNameList as a constant reference
+  @param   Filter as a TEMSnapshotFilter as a constant reference
+  @return  a TEMSnapshotPtr
+
+**/
+TEMSnapshotPtr TEMRegistrySnapshot::Create(TEMRegistryStore& Store, const TEMNameList& Roots,
+  const TEMSnapshotFilter& Filter) {
+  TEMTraceSpan Span("Registry.Snapshot");
+  TEMRegistryKeyPtr Root(new TEMRegistryKey(L""));
+  for (size_t i = 0; i < Roots.size(); i++) {
+    TEMNameList Parts;
+    EMSplitPath(Roots[i], Parts);
+    TEMRegistryKeyPtr Key = LoadKey(Store, Parts, Filter);
+    if (Key)
+      Root = ReplaceKey(Root, Parts, 0, Key);
+  }
+  return TEMSnapshotPtr(new TEMRegistrySnapshot(Root, Filter));
+}
+
+/**
+
+  This is the default snapshot filter which keeps the company, sub-installation and version keys
+  but below a version only keeps the keys that Expert Manager reads (experts, packages and
+  environment variables) and their immediate sub-keys.
+
+  @precon  None.
+  @postcon Returns true if the key at the given path should be in the snapshot.
+
+  @param   Parts as a TEMNameList as a constant reference
+  @return  a bool
+
+**/
+bool TEMRegistrySnapshot::InstallationFilter(const TEMNameList& Parts) {
+  // Software\Company\SubInstallation\Version\Section\SubSection
+  if (Parts.size() <= 4)
+    return true;
+  if (Parts.size() == 5)
+    return
+      EMSameText(Parts[4], L"Experts") ||
+      EMSameText(Parts[4], L"Known IDE Packages") ||
+      EMSameText(Parts[4], L"Known Packages") ||
+      EMSameText(Parts[4], L"Environment Variables");
+  return Parts.size() == 6;
+}
+
+/**
+
+  This method returns a new snapshot where the key at the given path has been re-read from the
+  store. All other keys are shared with this snapshot.
+
+  @precon  None.
+  @postcon Returns the refreshed snapshot.
+
+  @param   Store   as a TEMRegistryStore as a reference
+  @param   strPath as a std::wstring as a constant reference
+  @return  a TEMSnapshotPtr
+
+**/
+TEMSnapshotPtr TEMRegistrySnapshot::Refresh(TEMRegistryStore& Store, const std::wstring& strPath) const {
+  TEMTraceSpan Span("Registry.Refresh", strPath);
+  TEMNameList Parts;
+  EMSplitPath(strPath, Parts);
+  TEMRegistryKeyPtr Key = LoadKey(Store, Parts, FFilter);
+  return TEMSnapshotPtr(new TEMRegistrySnapshot(ReplaceKey(FRoot, Parts, 0, Key), FFilter));
+}
+
+/**
+
+  This method returns the key at the given path or NULL if not found.
+
+  @precon  None.
+  @postcon Returns the key or NULL.
+
+  @param   strPath as a std::wstring as a constant reference
+  @return  a TEMRegistryKey pointer as a constant
+
+**/
+const TEMRegistryKey* TEMRegistrySnapshot::FindKey(const std::wstring& strPath) const {
+  TEMNameList Parts;
+  EMSplitPath(strPath, Parts);
+  const TEMRegistryKey* Key = FRoot.get();
+  for (size_t i = 0; i < Parts.size() && Key != NULL; i++)
+    Key = Key->FindKey(Parts[i]);
+  return Key;
+}
+
+/**
+
+  This method returns the names of the sub-keys of the given key (as per TRegIniFile::ReadSections).
+
+  @precon  None.
+  @postcon Sections is filled with the sub-key names.
+
+  @param   strPath  as a std::wstring as a constant reference
+  @param   Sections as a TEMNameList as a reference
+
+**/
+void TEMRegistrySnapshot::ReadSections(const std::wstring& strPath, TEMNameList& Sections) const {
+  Sections.clear();
+  const TEMRegistryKey* Key = FindKey(strPath);
+  if (Key != NULL)
+    for (size_t i = 0; i < Key->Keys().size(); i++)
+      Sections.push_back(Key->Keys()[i]->Name());
+}
+
+/**
+
+  This method returns the names of the values in the given section of the given key (as per
+  TRegIniFile::ReadSection).
+
+  @precon  None.
+  @postcon Names is filled with the value names.
+
+  @param   strPath    as a std::wstring as a constant reference
+  @param   strSection as a std::wstring as a constant reference
+  @param   Names      as a TEMNameList as a reference
+
+**/
+void TEMRegistrySnapshot::ReadSection(const std::wstring& strPath, const std::wstring& strSection,
+  TEMNameList& Names) const {
+  Names.clear();
+  const TEMRegistryKey* Key = FindKey(strPath + L"\\" + strSection);
+  if (Key != NULL)
+    for (size_t i = 0; i < Key->Values().size(); i++)
+      Names.push_back(Key->Values()[i].first);
+}
+
+/**
+
+  This method returns the names and values in the given section of the given key.
+
+  @precon  None.
+  @postcon Values is filled with the name / value pairs.
+
+  @param   strPath    as a std::wstring as a constant reference
+  @param   strSection as a std::wstring as a constant reference
+  @param   Values     as a TEMRegValueList as a reference
+
+**/
+void TEMRegistrySnapshot::ReadSectionValues(const std::wstring& strPath,
+  const std::wstring& strSection, TEMRegValueList& Values) const {
+  const TEMRegistryKey* Key = FindKey(strPath + L"\\" + strSection);
+  if (Key != NULL)
+    Values = Key->Values();
+  else
+    Values.clear();
+}
+
+/**
+
+  This method returns the named value from the given section of the given key or the default if
+  not found (as per TRegIniFile::ReadString).
+
+  @precon  None.
+  @postcon Returns the value or the default.
+
+  @param   strPath    as a std::wstring as a constant reference
+  @param   strSection as a std::wstring as a constant reference
+  @param   strName    as a std::wstring as a constant reference
+  @param   strDefault as a std::wstring as a constant reference
+  @return  a std::wstring
+
+**/
+std::wstring TEMRegistrySnapshot::ReadString(const std::wstring& strPath,
+  const std::wstring& strSection, const std::wstring& strName, const std::wstring& strDefault) const {
+  const TEMRegistryKey* Key = FindKey(strPath + L"\\" + strSection);
+  if (Key != NULL) {
+    const std::wstring* pValue = Key->FindValue(strName);
+    if (pValue != NULL)
+      return *pValue;
+  }
+  return strDefault;
+}
@@ -0,0 +1,175 @@
+#ifndef ExpertManagerRegistryStoreH
+#define ExpertManagerRegistryStoreH
+
+#include "ExpertManagerStrings.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <functional>
+#ifdef _WIN32
+  #include <windows.h>
+#endif
+
+/** A name / value pair as read from a registry key. **/
+typedef std::pair<std::wstring, std::wstring> TEMRegValue;
+/** A simplified type for a list of registry name / value pairs. **/
+typedef std::vector<TEMRegValue> TEMRegValueList;
+
+/** The types of registry value (the same as the Windows REG_ constants) which the stores read as
+    text. **/
+enum TEMRegValueType {rvString = 1, rvExpandString = 2, rvDWord = 4};
+
+/** A record of a registry value's type and raw data so that a value can be restored exactly as it
+    was (the type is held as a number so that any type of value can be restored). **/
+struct TEMRegRawValue {
+  unsigned int               iType;
+  std::vector<unsigned char> Data;
+};
+
+/** This is an abstract class to represent a hierarchical store of keys and string values from which
+    registry snapshots can be taken. Values are written to (as per TRegistry) the key that is
+    currently open. **/
+class TEMRegistryStore {
+  public:
+    virtual ~TEMRegistryStore() {};
+    virtual bool ReadKey(const std::wstring& strPath, TEMNameList& Keys, TEMRegValueList& Values) = 0;
+    virtual bool OpenKey(const std::wstring& strPath, const bool boolCreate) = 0;
+    virtual void CloseKey() = 0;
+    virtual bool ReadValue(const std::wstring& strName, std::wstring& strValue) = 0;
+    virtual bool WriteValue(const std::wstring& strName, const std::wstring& strValue) = 0;
+    virtual bool DeleteValue(const std::wstring& strName) = 0;
+    virtual bool ReadRawValue(const std::wstring& strName, TEMRegRawValue& Value) = 0;
+    virtual bool WriteRawValue(const std::wstring& strName, const TEMRegRawValue& Value) = 0;
+    virtual bool DeleteKey(const std::wstring& strPath) = 0;
+    virtual bool KeyWriteTime(const std::wstring& strPath, unsigned long long& iWriteTime) = 0;
+};
+
+#ifdef _WIN32
+/** A registry store which reads directly from the Windows registry. **/
+class TEMWinRegistryStore : public TEMRegistryStore {
+  private:
+    HKEY FRootKey;
+    HKEY FCurrentKey;
+  public:
+    TEMWinRegistryStore(HKEY RootKey = HKEY_CURRENT_USER);
+    ~TEMWinRegistryStore();
+    bool ReadKey(const std::wstring& strPath, TEMNameList& Keys, TEMRegValueList& Values);
+    bool OpenKey(const std::wstring& strPath, const bool boolCreate);
+    void CloseKey();
+    bool ReadValue(const std::wstring& strName, std::wstring& strValue);
+    bool WriteValue(const std::wstring& strName, const std::wstring& strValue);
+    bool DeleteValue(const std::wstring& strName);
+    bool ReadRawValue(const std::wstring& strName, TEMRegRawValue& Value);
+    bool WriteRawValue(const std::wstring& strName, const TEMRegRawValue& Value);
+    bool DeleteKey(const std::wstring& strPath);
+    bool KeyWriteTime(const std::wstring& strPath, unsigned long long& iWriteTime);
+};
+#endif
+
+/** A registry store which holds its keys and values in memory. Values are held as text (as they
+    are read from the live registry) with the type of each value which is not a string. **/
+class TEMMemoryRegistryStore : public TEMRegistryStore {
+  protected:
+    /** A record to describe a single key in the memory store (Types holds the type of the values
+        which are not REG_SZ by their case folded name). **/
+    struct TEMMemoryKey {
+      TEMNameList                                    Keys;
+      TEMRegValueList                                Values;
+      std::unordered_map<std::wstring, unsigned int> Types;
+      unsigned long long                             iWriteTime;
+    };
+  private:
+    std::map<std::wstring, TEMMemoryKey> FKeys;
+    TEMMemoryKey*                        FCurrentKey;
+    unsigned long long                   FWriteTime;
+  protected:
+    TEMMemoryKey& GetKey(const std::wstring& strPath);
+    TEMMemoryKey* FindKey(const std::wstring& strPath);
+    void Touch(TEMMemoryKey& Key) { Key.iWriteTime = ++FWriteTime; };
+  public:
+    TEMMemoryRegistryStore() : FCurrentKey(NULL), FWriteTime(0) {};
+    void CreateKey(const std::wstring& strPath);
+    void SetValue(const std::wstring& strPath, const std::wstring& strName,
+      const std::wstring& strValue, const unsigned int iType = rvString);
+    unsigned int ValueType(const std::wstring& strPath, const std::wstring& strName);
+    bool ReadKey(const std::wstring& strPath, TEMNameList& Keys, TEMRegValueList& Values);
+    bool OpenKey(const std::wstring& strPath, const bool boolCreate);
+    void CloseKey();
+    bool ReadValue(const std::wstring& strName, std::wstring& strValue);
+    bool WriteValue(const std::wstring& strName, const std::wstring& strValue);
+    bool DeleteValue(const std::wstring& strName);
+    bool ReadRawValue(const std::wstring& strName, TEMRegRawValue& Value);
+    bool WriteRawValue(const std::wstring& strName, const TEMRegRawValue& Value);
+    bool DeleteKey(const std::wstring& strPath);
+    bool KeyWriteTime(const std::wstring& strPath, unsigned long long& iWriteTime);
+};
+
+/** A memory registry store which is loaded from a text file of [Key\Path] sections with Name=Value
+    lines so that the scanning code can be exercised without the Windows registry. **/
+class TEMFileRegistryStore : public TEMMemoryRegistryStore {
+  public:
+    TEMFileRegistryStore() {};
+    TEMFileRegistryStore(const std::string& strFileName);
+    void LoadFromUTF8(const std::string& strText);
+    void LoadFromText(const std::wstring& strText);
+};
+
+class TEMRegistryKey;
+/** A simplified type for a shared immutable registry key. **/
+typedef std::shared_ptr<const TEMRegistryKey> TEMRegistryKeyPtr;
+
+/** This class represents a single immutable key in a registry snapshot. **/
+class TEMRegistryKey {
+  private:
+    std::wstring                            FName;
+    TEMRegValueList                         FValues;
+    std::unordered_map<std::wstring, size_t> FValueIndex;
+    std::vector<TEMRegistryKeyPtr>          FKeys;
+    std::unordered_map<std::wstring, size_t> FKeyIndex;
+    friend class TEMRegistrySnapshot;
+  public:
+    TEMRegistryKey(const std::wstring& strName) : FName(strName) {};
+    const std::wstring& Name() const { return FName; };
+    const TEMRegValueList& Values() const { return FValues; };
+    const std::vector<TEMRegistryKeyPtr>& Keys() const { return FKeys; };
+    const TEMRegistryKey* FindKey(const std::wstring& strName) const;
+    const std::wstring* FindValue(const std::wstring& strName) const;
+};
+
+/** A function type to decide whether the key at the given path should be included in a snapshot. **/
+typedef std::function<bool(const TEMNameList& Parts)> TEMSnapshotFilter;
+
+class TEMRegistrySnapshot;
+/** A simplified type for a shared immutable registry snapshot. **/
+typedef std::shared_ptr<const TEMRegistrySnapshot> TEMSnapshotPtr;
+
+/** This class represents an immutable in-memory copy of the RAD Studio registry keys which is read
+    once from a registry store and then shared by all the code that needs registry information. **/
+class TEMRegistrySnapshot {
+  private:
+    TEMRegistryKeyPtr FRoot;
+    TEMSnapshotFilter FFilter;
+    static std::shared_ptr<TEMRegistryKey> LoadKey(TEMRegistryStore& Store, TEMNameList& Parts,
+      const TEMSnapshotFilter& Filter);
+    static void AddKey(TEMRegistryKey& Parent, TEMRegistryKeyPtr Key);
+    static TEMRegistryKeyPtr ReplaceKey(const TEMRegistryKeyPtr& Key, const TEMNameList& Parts,
+      size_t iPart, TEMRegistryKeyPtr NewKey);
+  public:
+    TEMRegistrySnapshot(TEMRegistryKeyPtr Root, const TEMSnapshotFilter& Filter);
+    static TEMSnapshotPtr Create(TEMRegistryStore& Store, const TEMNameList& Roots,
+      const TEMSnapshotFilter& Filter);
+    static bool InstallationFilter(const TEMNameList& Parts);
+    TEMSnapshotPtr Refresh(TEMRegistryStore& Store, const std::wstring& strPath) const;
+    const TEMRegistryKey* FindKey(const std::wstring& strPath) const;
+    void ReadSections(const std::wstring& strPath, TEMNameList& Sections) const;
+    void ReadSection(const std::wstring& strPath, const std::wstring& strSection,
+      TEMNameList& Names) const;
+    void ReadSectionValues(const std::wstring& strPath, const std::wstring& strSection,
+      TEMRegValueList& Values) const;
+    std::wstring ReadString(const std::wstring& strPath, const std::wstring& strSection,
+      const std::wstring& strName, const std::wstring& strDefault) const;
+};
+
+#endif
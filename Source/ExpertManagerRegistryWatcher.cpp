@@ -0,0 +1,445 @@
+#pragma hdrstop
+
+#include "ExpertManagerRegistryWatcher.h"
+#include "ExpertManagerGlobals.h"
+#include "ExpertManagerTrace.h"
+#include <cstring>
+#include <exception>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+
+#pragma package(smart_init)
+
+/** The time to wait after a change for any further changes before they are reported together
+    (installers write many values at once). **/
+const int iSettleMS = 250;
+
+/**
+
+  This function calls the given change handler with the given owners. An exception raised by the
+  handler is recorded as a trace span so that the notifier's thread survives it.
+
+  @precon  None.
+  @postcon The handler has been called.
+
+  @param   Handler as a TEMRegistryChangeHandler as a constant reference
+  @param   Owners  as a TEMNameList as a constant reference
+
+**/
+static void CallHandler(const TEMRegistryChangeHandler& Handler, const TEMNameList& Owners) {
+  try {
+    Handler(Owners);
+  } catch (std::exception& E) {
+    TEMTraceSpan Span("RegistryWatcher.HandlerFailed", EMUTF8ToWide(E.what(),
+      std::strlen(E.what())));
+  } catch (...) {
+    TEMTraceSpan Span("RegistryWatcher.HandlerFailed", L"Unknown exception");
+  }
+}
+
+/**
+
+  This method adds the given string to the given hash value.
+
+  @precon  None.
+  @postcon The hash is combined with the hash of the string.
+
+  @param   iHash   as a size_t as a reference
+  @param   strText as a std::wstring as a constant reference
+
+**/
+static void HashCombine(size_t& iHash, const std::wstring& strText) {
+  iHash ^= std::hash<std::wstring>()(strText) + 0x9e3779b9 + (iHash << 6) + (iHash >> 2);
+}
+
+/**
+
+  This method returns a hash of the sub-key names and values of the given key (and if required all
+  the keys beneath it) so that changes to the key can be detected by comparison.
+
+  @precon  None.
+  @postcon Returns the fingerprint of the key or zero if the key does not exist.
+
+  @param   Store       as a TEMRegistryStore as a reference
+  @param   strPath     as a std::wstring as a constant reference
+  @param   boolSubTree as a bool as a constant
+  @return  a size_t
+
+**/
+size_t EMKeyFingerprint(TEMRegistryStore& Store, const std::wstring& strPath,
+  const bool boolSubTree) {
+  TEMNameList Keys;
+  TEMRegValueList Values;
+  if (!Store.ReadKey(strPath, Keys, Values))
+    return 0;
+  size_t iHash = 1;
+  for (size_t i = 0; i < Values.size(); i++) {
+    HashCombine(iHash, Values[i].first);
+    HashCombine(iHash, Values[i].second);
+  }
+  for (size_t i = 0; i < Keys.size(); i++) {
+    HashCombine(iHash, Keys[i]);
+    if (boolSubTree)
+      iHash ^= EMKeyFingerprint(Store, strPath + L'\\' + Keys[i], true) + (iHash << 6);
+  }
+  return iHash;
+}
+
+/** The sections of an installation which are watched with their sub-keys. **/
+static const wchar_t* strWatchedSections[4] = {strExperts, strKnownIDEPackages, strKnownPackages,
+  L"Environment Variables"};
+
+/**
+
+  This method returns a hash of the installation's own values and of its expert, package and
+  environment variable keys (i.e. the keys that are watched for it) so that the application can
+  tell whether the installation still holds what it last wrote to it.
+
+  @precon  None.
+  @postcon Returns the fingerprint of the installation's keys.
+
+  @param   Store      as a TEMRegistryStore as a reference
+  @param   strRegPath as a std::wstring as a constant reference
+  @return  a size_t
+
+**/
+size_t EMInstallationFingerprint(TEMRegistryStore& Store, const std::wstring& strRegPath) {
+  std::wstring strKey = EMKeyPath(strRegPath);
+  size_t iHash = EMKeyFingerprint(Store, strKey, false);
+  for (size_t i = 0; i < 4; i++)
+    iHash ^= EMKeyFingerprint(Store, strKey + L'\\' + strWatchedSections[i], true) + (iHash << 6);
+  return iHash;
+}
+
+/**
+
+  This method builds the list of registry keys to watch for the given company roots and
+  installations. Each company root and product key is watched (without its sub-keys) for new or
+  removed installations which are reported against the root. Each installation key is watched for
+  changes to its own values (e.g. RootDir) and its expert, package and environment variable keys
+  (those in the snapshot) are watched with their sub-keys. These are reported against the
+  installation. As a section key which is created later is only reported by its installation key
+  the watches should be rebuilt when an installation's sections change.
+
+  @precon  None.
+  @postcon Watches contains the keys to watch.
+
+  @param   Roots         as a TEMNameList as a constant reference
+  @param   Installations as a TEMNameList as a constant reference
+  @param   Snapshot      as a TEMRegistrySnapshot as a constant reference
+  @param   Watches       as a TEMRegistryWatchList as a reference
+
+**/
+void EMInstallationWatches(const TEMNameList& Roots, const TEMNameList& Installations,
+  const TEMRegistrySnapshot& Snapshot, TEMRegistryWatchList& Watches) {
+  Watches.clear();
+  TEMRegistryWatch Watch;
+  for (size_t i = 0; i < Roots.size(); i++) {
+    std::wstring strKey = EMKeyPath(Roots[i]);
+    Watch.strOwner = Roots[i];
+    Watch.strKey = strKey;
+    Watch.boolSubTree = false;
+    Watches.push_back(Watch);
+    TEMNameList Products;
+    Snapshot.ReadSections(Roots[i], Products);
+    for (size_t j = 0; j < Products.size(); j++) {
+      Watch.strKey = strKey + L'\\' + Products[j];
+      Watches.push_back(Watch);
+    }
+  }
+  for (size_t i = 0; i < Installations.size(); i++) {
+    std::wstring strKey = EMKeyPath(Installations[i]);
+    Watch.strOwner = Installations[i];
+    Watch.strKey = strKey;
+    Watch.boolSubTree = false;
+    Watches.push_back(Watch);
+    Watch.boolSubTree = true;
+    for (size_t j = 0; j < 4; j++) {
+      Watch.strKey = strKey + L'\\' + strWatchedSections[j];
+      if (Snapshot.FindKey(Watch.strKey))
+        Watches.push_back(Watch);
+    }
+  }
+}
+
+#ifdef _WIN32
+/**
+
+  This method requests a notification on the given event when the given key changes.
+
+  @precon  None.
+  @postcon Returns true if the notification was registered.
+
+  @param   hKey        as a HKEY as a constant
+  @param   hEvent      as a HANDLE as a constant
+  @param   boolSubTree as a bool as a constant
+  @return  a bool
+
+**/
+static bool ArmNotification(const HKEY hKey, const HANDLE hEvent, const bool boolSubTree) {
+  return RegNotifyChangeKeyValue(hKey, boolSubTree,
+    REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET, hEvent, TRUE) == ERROR_SUCCESS;
+}
+
+/**
+
+  This is the constructor for the Windows registry notifier class.
+
+  @precon  None.
+  @postcon Stores the root key and the handler that changes are reported to.
+
+  @param   RootKey as a HKEY
+  @param   Handler as a TEMRegistryChangeHandler as a constant reference
+
+**/
+TEMWinRegistryNotifier::TEMWinRegistryNotifier(HKEY RootKey,
+  const TEMRegistryChangeHandler& Handler) :
+  FRootKey(RootKey), FHandler(Handler) {
+  FStopEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+}
+
+/**
+
+  This is the destructor for the Windows registry notifier class.
+
+  @precon  None.
+  @postcon Stops all the watching threads.
+
+**/
+TEMWinRegistryNotifier::~TEMWinRegistryNotifier() {
+  Stop();
+  CloseHandle(FStopEvent);
+}
+
+/**
+
+  This method stops all the watching threads and waits for them to finish.
+
+  @precon  None.
+  @postcon No keys are being watched.
+
+**/
+void TEMWinRegistryNotifier::Stop() {
+  SetEvent(FStopEvent);
+  for (size_t i = 0; i < FThreads.size(); i++)
+    FThreads[i].join();
+  FThreads.clear();
+  ResetEvent(FStopEvent);
+}
+
+/**
+
+  This method replaces the watched keys with the given list.
+
+  @precon  None.
+  @postcon A thread is started to watch each group of up to MAXIMUM_WAIT_OBJECTS - 1 keys (one
+           handle is needed for the stop event).
+
+  @param   Watches as a TEMRegistryWatchList as a constant reference
+
+**/
+void TEMWinRegistryNotifier::Watch(const TEMRegistryWatchList& Watches) {
+  Stop();
+  const size_t iGroupSize = MAXIMUM_WAIT_OBJECTS - 1;
+  for (size_t i = 0; i < Watches.size(); i += iGroupSize) {
+    TEMRegistryWatchList Group(Watches.begin() + i,
+      Watches.begin() + std::min(i + iGroupSize, Watches.size()));
+    FThreads.push_back(std::thread(&TEMWinRegistryNotifier::Execute, this, Group));
+  }
+}
+
+/**
+
+  This is the main loop of each watching thread. It waits for any of its keys to change,
+  re-registers the notification for that key and once the keys have been quiet for a short time
+  reports the owners of the changed keys to the handler. Keys that cannot be opened (or that have
+  been deleted) are dropped as their owners parent key will report their removal.
+
+  @precon  None.
+  @postcon Runs until the stop event is signalled.
+
+  @param   Watches as a TEMRegistryWatchList as a constant
+
+**/
+void TEMWinRegistryNotifier::Execute(const TEMRegistryWatchList Watches) {
+  std::vector<HANDLE> Events(1, FStopEvent);
+  std::vector<HKEY> Keys;
+  std::vector<const TEMRegistryWatch*> Owners;
+  for (size_t i = 0; i < Watches.size(); i++) {
+    HKEY hKey = NULL;
+    if (RegOpenKeyExW(FRootKey, Watches[i].strKey.c_str(), 0, KEY_NOTIFY, &hKey) != ERROR_SUCCESS)
+      continue;
+    HANDLE hEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+    if (ArmNotification(hKey, hEvent, Watches[i].boolSubTree)) {
+      Events.push_back(hEvent);
+      Keys.push_back(hKey);
+      Owners.push_back(&Watches[i]);
+    } else {
+      CloseHandle(hEvent);
+      RegCloseKey(hKey);
+    }
+  }
+  TEMNameList Changed;
+  for (;;) {
+    DWORD iResult = WaitForMultipleObjects((DWORD)Events.size(), &Events[0], FALSE,
+      Changed.empty() ? INFINITE : iSettleMS);
+    if (iResult == WAIT_TIMEOUT) {
+      CallHandler(FHandler, Changed);
+      Changed.clear();
+      continue;
+    }
+    if (iResult == WAIT_OBJECT_0 || iResult == WAIT_FAILED)
+      break;
+    size_t i = iResult - WAIT_OBJECT_0 - 1;
+    if (std::find(Changed.begin(), Changed.end(), Owners[i]->strOwner) == Changed.end())
+      Changed.push_back(Owners[i]->strOwner);
+    if (!ArmNotification(Keys[i], Events[i + 1], Owners[i]->boolSubTree)) {
+      CloseHandle(Events[i + 1]);
+      RegCloseKey(Keys[i]);
+      Events.erase(Events.begin() + i + 1);
+      Keys.erase(Keys.begin() + i);
+      Owners.erase(Owners.begin() + i);
+    }
+  }
+  for (size_t i = 0; i < Keys.size(); i++) {
+    CloseHandle(Events[i + 1]);
+    RegCloseKey(Keys[i]);
+  }
+}
+#endif
+
+/**
+
+  This is the constructor for the file registry notifier class.
+
+  @precon  None.
+  @postcon Starts the thread which polls the file at the given interval.
+
+  @param   strFileName as a std::string as a constant reference
+  @param   Handler     as a TEMRegistryChangeHandler as a constant reference
+  @param   iIntervalMS as an int as a constant
+
+**/
+TEMFileRegistryNotifier::TEMFileRegistryNotifier(const std::string& strFileName,
+  const TEMRegistryChangeHandler& Handler, const int iIntervalMS) : FFileName(strFileName),
+  FHandler(Handler), FIntervalMS(iIntervalMS), FTerminated(false) {
+  ReadFile(FText);
+  FThread = std::thread(&TEMFileRegistryNotifier::Execute, this);
+}
+
+/**
+
+  This is the destructor for the file registry notifier class.
+
+  @precon  None.
+  @postcon Stops the polling thread.
+
+**/
+TEMFileRegistryNotifier::~TEMFileRegistryNotifier() {
+  {
+    std::lock_guard<std::mutex> Lock(FLock);
+    FTerminated = true;
+  }
+  FWakeUp.notify_all();
+  FThread.join();
+}
+
+/**
+
+  This method reads the contents of the file.
+
+  @precon  None.
+  @postcon Returns true with the text if the file could be read.
+
+  @param   strText as a std::string as a reference
+  @return  a bool
+
+**/
+bool TEMFileRegistryNotifier::ReadFile(std::string& strText) const {
+  std::ifstream File(FFileName.c_str(), std::ios::in | std::ios::binary);
+  if (!File)
+    return false;
+  std::stringstream Buffer;
+  Buffer << File.rdbuf();
+  strText = Buffer.str();
+  return true;
+}
+
+/**
+
+  This method returns the fingerprint of each watched key in the given version of the file.
+
+  @precon  FLock must be held.
+  @postcon Fingerprints contains a fingerprint for each watch.
+
+  @param   strText      as a std::string as a constant reference
+  @param   Fingerprints as a std::vector<size_t> as a reference
+
+**/
+void TEMFileRegistryNotifier::Fingerprint(const std::string& strText,
+  std::vector<size_t>& Fingerprints) const {
+  TEMFileRegistryStore Store;
+  Store.LoadFromUTF8(strText);
+  Fingerprints.clear();
+  for (size_t i = 0; i < FWatches.size(); i++)
+    Fingerprints.push_back(EMKeyFingerprint(Store, FWatches[i].strKey, FWatches[i].boolSubTree));
+}
+
+/**
+
+  This method replaces the watched keys with the given list.
+
+  @precon  None.
+  @postcon The keys are fingerprinted in the current version of the file so that only later
+           changes are reported.
+
+  @param   Watches as a TEMRegistryWatchList as a constant reference
+
+**/
+void TEMFileRegistryNotifier::Watch(const TEMRegistryWatchList& Watches) {
+  std::string strText;
+  bool boolRead = ReadFile(strText);
+  std::lock_guard<std::mutex> Lock(FLock);
+  if (boolRead)
+    FText = strText;
+  FWatches = Watches;
+  Fingerprint(FText, FFingerprints);
+}
+
+/**
+
+  This is the main loop of the polling thread. Each time the file's contents change the watched
+  keys are fingerprinted again and the owners of any keys that differ are reported to the handler.
+
+  @precon  None.
+  @postcon Runs until the notifier is destroyed.
+
+**/
+void TEMFileRegistryNotifier::Execute() {
+  std::unique_lock<std::mutex> Lock(FLock);
+  while (!FWakeUp.wait_for(Lock, std::chrono::milliseconds(FIntervalMS),
+    [this]() { return FTerminated; })) {
+    Lock.unlock();
+    std::string strText;
+    bool boolRead = ReadFile(strText);
+    Lock.lock();
+    if (!boolRead || strText == FText)
+      continue;
+    FText = strText;
+    std::vector<size_t> Fingerprints;
+    Fingerprint(FText, Fingerprints);
+    TEMNameList Changed;
+    for (size_t i = 0; i < FWatches.size(); i++)
+      if (Fingerprints[i] != FFingerprints[i] &&
+        std::find(Changed.begin(), Changed.end(), FWatches[i].strOwner) == Changed.end())
+        Changed.push_back(FWatches[i].strOwner);
+    FFingerprints.swap(Fingerprints);
+    if (Changed.empty())
+      continue;
+    Lock.unlock();
+    CallHandler(FHandler, Changed);
+    Lock.lock();
+  }
+}
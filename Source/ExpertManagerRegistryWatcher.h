@@ -0,0 +1,92 @@
+#ifndef ExpertManagerRegistryWatcherH
+#define ExpertManagerRegistryWatcherH
+
+#include "ExpertManagerRegistryStore.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/** A record to describe a single registry key to be watched for changes. Changes are reported
+    against the owner path (the company root or the installation the key belongs to) so that the
+    consumer knows what to re-read. **/
+struct TEMRegistryWatch {
+  std::wstring strKey;
+  std::wstring strOwner;
+  bool         boolSubTree;
+  bool operator==(const TEMRegistryWatch& Watch) const {
+    return strKey == Watch.strKey && strOwner == Watch.strOwner &&
+      boolSubTree == Watch.boolSubTree;
+  };
+};
+
+/** A simplified type for a list of registry watches. **/
+typedef std::vector<TEMRegistryWatch> TEMRegistryWatchList;
+
+/** A function type which is called (on the notifier's thread) with the distinct owner paths of
+    the watches that have changed. **/
+typedef std::function<void(const TEMNameList& Owners)> TEMRegistryChangeHandler;
+
+/** This is an abstract class to represent a source of registry change notifications. **/
+class TEMRegistryNotifier {
+  public:
+    virtual ~TEMRegistryNotifier() {};
+    virtual void Watch(const TEMRegistryWatchList& Watches) = 0;
+};
+
+/** A simplified type for an owned registry notifier. **/
+typedef std::unique_ptr<TEMRegistryNotifier> TEMRegistryNotifierPtr;
+
+#ifdef _WIN32
+/** A registry notifier which waits on RegNotifyChangeKeyValue events. As a single wait can only
+    cover MAXIMUM_WAIT_OBJECTS handles the watches are split across as many threads as needed. **/
+class TEMWinRegistryNotifier : public TEMRegistryNotifier {
+  private:
+    HKEY                     FRootKey;
+    TEMRegistryChangeHandler FHandler;
+    HANDLE                   FStopEvent;
+    std::vector<std::thread> FThreads;
+    void Stop();
+    void Execute(const TEMRegistryWatchList Watches);
+  public:
+    TEMWinRegistryNotifier(HKEY RootKey, const TEMRegistryChangeHandler& Handler);
+    ~TEMWinRegistryNotifier();
+    void Watch(const TEMRegistryWatchList& Watches);
+};
+#endif
+
+/** A registry notifier which polls the text file behind a TEMFileRegistryStore and reports the
+    watches whose keys differ between successive versions of the file. This stands in for the
+    Windows notifier so that the refresh logic can be exercised on other platforms. **/
+class TEMFileRegistryNotifier : public TEMRegistryNotifier {
+  private:
+    std::string              FFileName;
+    TEMRegistryChangeHandler FHandler;
+    int                      FIntervalMS;
+    std::mutex               FLock;
+    std::condition_variable  FWakeUp;
+    bool                     FTerminated;
+    TEMRegistryWatchList     FWatches;
+    std::vector<size_t>      FFingerprints;
+    std::string              FText;
+    std::thread              FThread;
+    bool ReadFile(std::string& strText) const;
+    void Fingerprint(const std::string& strText, std::vector<size_t>& Fingerprints) const;
+    void Execute();
+  public:
+    TEMFileRegistryNotifier(const std::string& strFileName, const TEMRegistryChangeHandler& Handler,
+      const int iIntervalMS = 500);
+    ~TEMFileRegistryNotifier();
+    void Watch(const TEMRegistryWatchList& Watches);
+};
+
+size_t EMKeyFingerprint(TEMRegistryStore& Store, const std::wstring& strPath,
+  const bool boolSubTree);
+size_t EMInstallationFingerprint(TEMRegistryStore& Store, const std::wstring& strRegPath);
+void EMInstallationWatches(const TEMNameList& Roots, const TEMNameList& Installations,
+  const TEMRegistrySnapshot& Snapshot, TEMRegistryWatchList& Watches);
+
+#endif
@@ -0,0 +1,477 @@
+#pragma hdrstop
+
+#include "ExpertManagerScanCache.h"
+#include "ExpertManagerMappedFile.h"
+#include "ExpertManagerGlobals.h"
+#include "ExpertManagerTrace.h"
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <unordered_set>
+
+#pragma package(smart_init)
+
+/** The signature at the start of a scan cache file. **/
+static const char strCacheSignature[4] = {'E', 'M', 'S', 'C'};
+/** The version of the scan cache file format. Files of any other version are ignored. **/
+static const unsigned int iCacheVersion = 2;
+
+/**
+
+  This method returns the FNV-1a hash of the given bytes which is used as the checksum of the
+  cache file.
+
+  @precon  pData must be valid for iSize bytes.
+  @postcon Returns the hash.
+
+  @param   pData as a char pointer as a constant
+  @param   iSize as a size_t as a constant
+  @return  an unsigned int
+
+**/
+static unsigned int Checksum(const char* pData, const size_t iSize) {
+  unsigned int iHash = 2166136261U;
+  for (size_t i = 0; i < iSize; i++)
+    iHash = (iHash ^ (unsigned char)pData[i]) * 16777619U;
+  return iHash;
+}
+
+/**
+
+  This method appends the given unsigned integer to the buffer in little endian order.
+
+  @precon  None.
+  @postcon The integer's bytes are appended.
+
+  @param   strBuffer as a std::string as a reference
+  @param   iValue    as an unsigned long long as a constant
+  @param   iBytes    as a size_t as a constant
+
+**/
+static void WriteInt(std::string& strBuffer, const unsigned long long iValue, const size_t iBytes) {
+  for (size_t i = 0; i < iBytes; i++)
+    strBuffer += (char)(iValue >> (8 * i) & 0xFF);
+}
+
+/**
+
+  This method reads an unsigned little endian integer from the buffer.
+
+  @precon  None.
+  @postcon Returns true with the integer and iPos after it if there are enough bytes.
+
+  @param   pData  as a char pointer as a constant
+  @param   iSize  as a size_t as a constant
+  @param   iPos   as a size_t as a reference
+  @param   iBytes as a size_t as a constant
+  @param   iValue as an unsigned long long as a reference
+  @return  a bool
+
+**/
+static bool ReadInt(const char* pData, const size_t iSize, size_t& iPos, const size_t iBytes,
+  unsigned long long& iValue) {
+  if (iSize - iPos < iBytes)
+    return false;
+  iValue = 0;
+  for (size_t i = 0; i < iBytes; i++)
+    iValue |= (unsigned long long)(unsigned char)pData[iPos + i] << (8 * i);
+  iPos += iBytes;
+  return true;
+}
+
+/**
+
+  This method appends the given string to the buffer as its length followed by its UTF-16
+  characters.
+
+  @precon  None.
+  @postcon The string is appended.
+
+  @param   strBuffer as a std::string as a reference
+  @param   strText   as a std::wstring as a constant reference
+
+**/
+static void WriteString(std::string& strBuffer, const std::wstring& strText) {
+  WriteInt(strBuffer, strText.length(), 4);
+  for (size_t i = 0; i < strText.length(); i++)
+    WriteInt(strBuffer, strText[i], 2);
+}
+
+/**
+
+  This method reads a length prefixed UTF-16 string from the buffer.
+
+  @precon  None.
+  @postcon Returns true with the string and iPos after it if there are enough bytes.
+
+  @param   pData   as a char pointer as a constant
+  @param   iSize   as a size_t as a constant
+  @param   iPos    as a size_t as a reference
+  @param   strText as a std::wstring as a reference
+  @return  a bool
+
+**/
+static bool ReadString(const char* pData, const size_t iSize, size_t& iPos,
+  std::wstring& strText) {
+  unsigned long long iLength, iChar = 0;
+  if (!ReadInt(pData, iSize, iPos, 4, iLength) || (iSize - iPos) / 2 < iLength)
+    return false;
+  strText.clear();
+  strText.reserve((size_t)iLength);
+  for (unsigned long long i = 0; i < iLength; i++) {
+    ReadInt(pData, iSize, iPos, 2, iChar);
+    strText += (wchar_t)iChar;
+  }
+  return true;
+}
+
+/**
+
+  This method returns the encoded entries of an installation: the entry count and for each entry
+  (that is not deleted) its section, its enabled and exists flags, its name, its filename and its
+  unresolved dependencies.
+
+  @precon  None.
+  @postcon Returns the encoded entries.
+
+  @param   Entries as a TEMInstallationEntries as a constant reference
+  @return  a std::string
+
+**/
+static std::string EncodeEntries(const TEMInstallationEntries& Entries) {
+  std::string strBuffer;
+  size_t iCount = 0;
+  for (size_t i = 0; i < Entries.Count(); i++)
+    if (!Entries.Entry((int)i).boolDeleted)
+      iCount++;
+  WriteInt(strBuffer, iCount, 4);
+  for (size_t i = 0; i < Entries.Count(); i++) {
+    const TEMEntry& Entry = Entries.Entry((int)i);
+    if (Entry.boolDeleted)
+      continue;
+    WriteInt(strBuffer, Entry.eSection, 1);
+    WriteInt(strBuffer, (Entry.boolEnabled ? 1 : 0) | (Entry.boolExists ? 2 : 0), 1);
+    WriteString(strBuffer, Entry.Name.Text());
+    WriteString(strBuffer, Entry.FileName.Text());
+    const TEMNameList& Unresolved = Entries.UnresolvedDependencies((int)i);
+    WriteInt(strBuffer, Unresolved.size(), 4);
+    for (size_t j = 0; j < Unresolved.size(); j++)
+      WriteString(strBuffer, Unresolved[j]);
+  }
+  return strBuffer;
+}
+
+/**
+
+  This method memory maps the given cache file and loads its records.
+
+  @precon  None.
+  @postcon Returns true if the file exists and is a valid cache of the current version else the
+           cache is left empty.
+
+  @param   strFileName as a std::wstring as a constant reference
+  @return  a bool
+
+**/
+bool TEMScanCache::LoadFromFile(const std::wstring& strFileName) {
+  TEMMappedFile File(strFileName);
+  return File.Data() != NULL && LoadFromBuffer(File.Data(), File.Size());
+}
+
+/**
+
+  This method loads the records from the given cache file contents. The file is the signature,
+  the version, the record count, the records and a checksum of everything before it. Each record
+  is the registry stamp, the validation, the registry path, the directory count, the directories,
+  the directory stamp and the length prefixed encoded entries (strings are length prefixed
+  UTF-16). The entries are kept encoded until the installation is restored.
+
+  @precon  pData must be valid for iSize bytes.
+  @postcon Returns true if the contents are a valid cache of the current version else the cache is
+           left empty.
+
+  @param   pData as a char pointer as a constant
+  @param   iSize as a size_t as a constant
+  @return  a bool
+
+**/
+bool TEMScanCache::LoadFromBuffer(const char* pData, const size_t iSize) {
+  FRecords.clear();
+  FModified = false;
+  size_t iPos = sizeof(strCacheSignature);
+  unsigned long long iVersion, iCount, iChecksum;
+  if (iSize < iPos + 12 || std::memcmp(pData, strCacheSignature, iPos) != 0)
+    return false;
+  size_t iEnd = iSize - 4;
+  ReadInt(pData, iSize, iEnd, 4, iChecksum);
+  if (iChecksum != Checksum(pData, iSize - 4))
+    return false;
+  iEnd = iSize - 4;
+  if (!ReadInt(pData, iEnd, iPos, 4, iVersion) || iVersion != iCacheVersion ||
+    !ReadInt(pData, iEnd, iPos, 4, iCount))
+    return false;
+  FRecords.reserve((size_t)iCount);
+  for (unsigned long long i = 0; i < iCount; i++) {
+    TEMScanCacheRecord Record;
+    unsigned long long iValidation, iDirectories = 0, iLength = 0;
+    bool boolValid = ReadInt(pData, iEnd, iPos, 8, Record.iStamp) &&
+      ReadInt(pData, iEnd, iPos, 1, iValidation) && iValidation <= evMissingDependencies &&
+      ReadString(pData, iEnd, iPos, Record.strRegPath) &&
+      ReadInt(pData, iEnd, iPos, 4, iDirectories) && (iEnd - iPos) / 4 >= iDirectories;
+    for (unsigned long long j = 0; boolValid && j < iDirectories; j++) {
+      Record.Directories.push_back(std::wstring());
+      boolValid = ReadString(pData, iEnd, iPos, Record.Directories.back());
+    }
+    boolValid = boolValid && ReadInt(pData, iEnd, iPos, 8, Record.iDirectoryStamp) &&
+      ReadInt(pData, iEnd, iPos, 4, iLength) && iEnd - iPos >= iLength;
+    if (!boolValid) {
+      FRecords.clear();
+      return false;
+    }
+    Record.eValidation = (TExpertValidation)iValidation;
+    Record.strEntries.assign(pData + iPos, (size_t)iLength);
+    iPos += (size_t)iLength;
+    FRecords[EMFoldCase(Record.strRegPath)] = Record;
+  }
+  return true;
+}
+
+/**
+
+  This method returns the cache file contents for the records.
+
+  @precon  None.
+  @postcon Returns the contents.
+
+  @return  a std::string
+
+**/
+std::string TEMScanCache::SaveToBuffer() const {
+  std::string strBuffer(strCacheSignature, sizeof(strCacheSignature));
+  WriteInt(strBuffer, iCacheVersion, 4);
+  WriteInt(strBuffer, FRecords.size(), 4);
+  for (auto& Item : FRecords) {
+    const TEMScanCacheRecord& Record = Item.second;
+    WriteInt(strBuffer, Record.iStamp, 8);
+    WriteInt(strBuffer, Record.eValidation, 1);
+    WriteString(strBuffer, Record.strRegPath);
+    WriteInt(strBuffer, Record.Directories.size(), 4);
+    for (size_t i = 0; i < Record.Directories.size(); i++)
+      WriteString(strBuffer, Record.Directories[i]);
+    WriteInt(strBuffer, Record.iDirectoryStamp, 8);
+    WriteInt(strBuffer, Record.strEntries.length(), 4);
+    strBuffer += Record.strEntries;
+  }
+  WriteInt(strBuffer, Checksum(strBuffer.data(), strBuffer.length()), 4);
+  return strBuffer;
+}
+
+/**
+
+  This method saves the records to the given cache file. The file is written to a temporary file
+  first and then replaces the existing file so a failed save does not leave a truncated cache.
+
+  @precon  None.
+  @postcon Returns true if the cache file was written.
+
+  @param   strFileName as a std::wstring as a constant reference
+  @return  a bool
+
+**/
+bool TEMScanCache::SaveToFile(const std::wstring& strFileName) {
+  std::string strBuffer = SaveToBuffer();
+  std::wstring strTempFileName = strFileName + L".tmp";
+#ifdef _WIN32
+  std::ofstream File(strTempFileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+#else
+  std::ofstream File(EMWideToUTF8(strTempFileName).c_str(),
+    std::ios::out | std::ios::binary | std::ios::trunc);
+#endif
+  File.write(strBuffer.data(), strBuffer.length());
+  File.close();
+  if (!File)
+    return false;
+#ifdef _WIN32
+  if (!MoveFileExW(strTempFileName.c_str(), strFileName.c_str(), MOVEFILE_REPLACE_EXISTING))
+    return false;
+#else
+  if (std::rename(EMWideToUTF8(strTempFileName).c_str(), EMWideToUTF8(strFileName).c_str()) != 0)
+    return false;
+#endif
+  FModified = false;
+  return true;
+}
+
+/**
+
+  This method returns the cached record of the given installation if its stamp matches.
+
+  @precon  None.
+  @postcon Returns the record or NULL if the installation is not cached or has changed.
+
+  @param   strRegPath as a std::wstring as a constant reference
+  @param   iStamp     as an unsigned long long as a constant
+  @return  a TEMScanCacheRecord pointer
+
+**/
+const TEMScanCacheRecord* TEMScanCache::Find(const std::wstring& strRegPath,
+  const unsigned long long iStamp) const {
+  auto Item = FRecords.find(EMFoldCase(strRegPath));
+  if (Item == FRecords.end() || Item->second.iStamp != iStamp)
+    return NULL;
+  return &Item->second;
+}
+
+/**
+
+  This method adds or updates the cached validation of the given scanned installation.
+
+  @precon  Result must contain the installation's entries.
+  @postcon The installation's record is updated.
+
+  @param   iStamp as an unsigned long long as a constant
+  @param   Result as a TEMInstallationResult as a constant reference
+
+**/
+void TEMScanCache::Update(const unsigned long long iStamp, const TEMInstallationResult& Result) {
+  TEMScanCacheRecord& Record = FRecords[EMFoldCase(Result.strRegPath)];
+  std::string strEntries = EncodeEntries(*Result.Entries);
+  if (Record.strRegPath == Result.strRegPath && Record.iStamp == iStamp &&
+    Record.eValidation == Result.Validation() && Record.Directories == Result.Directories &&
+    Record.iDirectoryStamp == Result.iDirectoryStamp && Record.strEntries == strEntries)
+    return;
+  Record.strRegPath = Result.strRegPath;
+  Record.iStamp = iStamp;
+  Record.eValidation = Result.Validation();
+  Record.Directories = Result.Directories;
+  Record.iDirectoryStamp = Result.iDirectoryStamp;
+  Record.strEntries.swap(strEntries);
+  FModified = true;
+}
+
+/**
+
+  This method decodes the entries of the given record into a result as if the installation had
+  just been scanned.
+
+  @precon  None.
+  @postcon Returns true with the installation's entries, directories and directory stamp in the
+           result if the record's entries are well formed.
+
+  @param   Record as a TEMScanCacheRecord as a constant reference
+  @param   Result as a TEMInstallationResult as a reference
+  @return  a bool
+
+**/
+bool TEMScanCache::Restore(const TEMScanCacheRecord& Record, TEMInstallationResult& Result) {
+  const char* pData = Record.strEntries.data();
+  size_t iSize = Record.strEntries.length(), iPos = 0;
+  unsigned long long iCount, iSection, iFlags, iUnresolved;
+  if (!ReadInt(pData, iSize, iPos, 4, iCount) || iCount > iSize)
+    return false;
+  std::vector<TEMEntry> Entries((size_t)iCount);
+  std::vector<TEMNameList> Unresolved((size_t)iCount);
+  std::wstring strText;
+  for (size_t i = 0; i < Entries.size(); i++) {
+    TEMEntry& Entry = Entries[i];
+    if (!ReadInt(pData, iSize, iPos, 1, iSection) || iSection > esKnownPackages ||
+      !ReadInt(pData, iSize, iPos, 1, iFlags) || !ReadString(pData, iSize, iPos, strText))
+      return false;
+    Entry.eSection = (TEMSection)iSection;
+    Entry.boolEnabled = (iFlags & 1) != 0;
+    Entry.boolExists = (iFlags & 2) != 0;
+    Entry.boolDeleted = false;
+    Entry.Name = TEMPath(strText);
+    if (!ReadString(pData, iSize, iPos, strText) ||
+      !ReadInt(pData, iSize, iPos, 4, iUnresolved) || iUnresolved > iSize - iPos)
+      return false;
+    Entry.FileName = TEMPath(strText);
+    Unresolved[i].resize((size_t)iUnresolved);
+    for (size_t j = 0; j < Unresolved[i].size(); j++)
+      if (!ReadString(pData, iSize, iPos, Unresolved[i][j]))
+        return false;
+  }
+  Result.strRegPath = Record.strRegPath;
+  Result.Entries = TEMEntriesPtr(new TEMInstallationEntries());
+  Result.Entries->Assign(Entries, Unresolved);
+  Result.Directories = Record.Directories;
+  Result.iDirectoryStamp = Record.iDirectoryStamp;
+  return true;
+}
+
+/**
+
+  This method removes the records of any installations that are not in the given list (i.e. that
+  have been uninstalled).
+
+  @precon  None.
+  @postcon Only the given installations remain in the cache.
+
+  @param   RegPaths as a TEMNameList as a constant reference
+
+**/
+void TEMScanCache::Retain(const TEMNameList& RegPaths) {
+  std::unordered_set<std::wstring> Keep;
+  for (size_t i = 0; i < RegPaths.size(); i++)
+    Keep.insert(EMFoldCase(RegPaths[i]));
+  for (auto Item = FRecords.begin(); Item != FRecords.end(); )
+    if (Keep.count(Item->first) == 0) {
+      Item = FRecords.erase(Item);
+      FModified = true;
+    } else
+      ++Item;
+}
+
+/**
+
+  This method returns a stamp of the registry keys that an installation's validation depends upon
+  (the installation key, its experts, packages and environment variables keys) made from their
+  last write times. Adding or removing a key changes its parent's last write time so any change to
+  the installation's experts or packages changes the stamp.
+
+  @precon  None.
+  @postcon Returns the installation's stamp.
+
+  @param   Store      as a TEMRegistryStore as a reference
+  @param   strRegPath as a std::wstring as a constant reference
+  @return  an unsigned long long
+
+**/
+unsigned long long EMInstallationStamp(TEMRegistryStore& Store, const std::wstring& strRegPath) {
+  const wchar_t* strSections[6] = {L"", strExperts, strDisabledExperts, strKnownIDEPackages,
+    strKnownPackages, L"Environment Variables"};
+  std::wstring strKey = EMKeyPath(strRegPath);
+  unsigned long long iStamp = 14695981039346656037ULL;
+  for (auto strSection : strSections) {
+    unsigned long long iWriteTime = 0;
+    if (!Store.KeyWriteTime(*strSection ? strKey + L'\\' + strSection : strKey, iWriteTime))
+      iWriteTime = ~0ULL;
+    for (size_t i = 0; i < 8; i++)
+      iStamp = (iStamp ^ (iWriteTime >> (8 * i) & 0xFF)) * 1099511628211ULL;
+  }
+  return iStamp;
+}
+
+/**
+
+  This method restores a cached installation (whose registry stamp has already been matched). If
+  the directories its validation depends upon are unchanged its entries are decoded from the
+  cache else (or if the record cannot be decoded) the installation is scanned again.
+
+  @precon  None.
+  @postcon Returns the installation's validation along with its entries.
+
+  @param   Scanner as a TEMInstallationScanner as a constant reference
+  @param   Record  as a TEMScanCacheRecord as a constant reference
+  @return  a TEMInstallationResult
+
+**/
+TEMInstallationResult EMRestoreInstallation(const TEMInstallationScanner& Scanner,
+  const TEMScanCacheRecord& Record) {
+  TEMTraceSpan Span("ScanCache.Restore", Record.strRegPath);
+  TEMInstallationResult Result;
+  if (Scanner.DirectoryStamp(Record.Directories) == Record.iDirectoryStamp &&
+    TEMScanCache::Restore(Record, Result))
+    return Result;
+  return Scanner.Scan(Record.strRegPath);
+}
@@ -0,0 +1,49 @@
+#ifndef ExpertManagerScanCacheH
+#define ExpertManagerScanCacheH
+
+#include "ExpertManagerRegistryStore.h"
+#include "ExpertManagerScanner.h"
+#include <string>
+#include <unordered_map>
+
+/** A record of the cached validation of a single installation. The entries (with their
+    existence and unresolved dependencies) are held encoded and are only decoded when the
+    installation is restored. **/
+struct TEMScanCacheRecord {
+  std::wstring       strRegPath;
+  unsigned long long iStamp;
+  TExpertValidation  eValidation;
+  TEMNameList        Directories;
+  unsigned long long iDirectoryStamp;
+  std::string        strEntries;
+};
+
+/** This class holds the validated entries of each installation from the last run along with a
+    stamp of the installation's registry keys last write times and a stamp of the directories its
+    validation depends upon so that at start up only the installations whose keys or directories
+    have changed need to be rescanned. The cache is persisted as a compact versioned binary file
+    which is memory mapped to load it. **/
+class TEMScanCache {
+  private:
+    std::unordered_map<std::wstring, TEMScanCacheRecord> FRecords;
+    bool                                                 FModified;
+  public:
+    TEMScanCache() : FModified(false) {};
+    bool LoadFromFile(const std::wstring& strFileName);
+    bool LoadFromBuffer(const char* pData, const size_t iSize);
+    bool SaveToFile(const std::wstring& strFileName);
+    std::string SaveToBuffer() const;
+    const TEMScanCacheRecord* Find(const std::wstring& strRegPath,
+      const unsigned long long iStamp) const;
+    void Update(const unsigned long long iStamp, const TEMInstallationResult& Result);
+    static bool Restore(const TEMScanCacheRecord& Record, TEMInstallationResult& Result);
+    void Retain(const TEMNameList& RegPaths);
+    size_t Count() const { return FRecords.size(); };
+    bool Modified() const { return FModified; };
+};
+
+unsigned long long EMInstallationStamp(TEMRegistryStore& Store, const std::wstring& strRegPath);
+TEMInstallationResult EMRestoreInstallation(const TEMInstallationScanner& Scanner,
+  const TEMScanCacheRecord& Record);
+
+#endif
@@ -0,0 +1,278 @@
+#pragma hdrstop
+
+#include "ExpertManagerScanner.h"
+#include "ExpertManagerDependencies.h"
+#include "ExpertManagerTrace.h"
+#include <regex>
+#include <algorithm>
+#include <unordered_set>
+
+#pragma package(smart_init)
+
+/**
+
+  This is the constructor for the installation result record.
+
+  @precon  None.
+  @postcon The record is initialised to an unvalidated state.
+
+**/
+TEMInstallationResult::TEMInstallationResult() : iID(-1), iDirectoryStamp(0) {}
+
+/**
+
+  This method returns the highest validation of the three sections of the installation.
+
+  @precon  None.
+  @postcon Returns the highest validation or evNone if the installation has not been scanned.
+
+  @return  a TExpertValidation
+
+**/
+TExpertValidation TEMInstallationResult::Validation() const {
+  if (!Entries)
+    return evNone;
+  return Entries->Validation();
+}
+
+/**
+
+  This is the constructor for the installation scanner class.
+
+  @precon  Snapshot must be a valid instance and FileSystem, MacroCache and ModuleCache (if not
+           null) must outlive the scanner.
+  @postcon Stores the snapshot and file system to validate against, the cache of the
+           installations macros and the cache of parsed modules (null to skip the dependency
+           checks).
+
+  @param   Snapshot    as a TEMSnapshotPtr
+  @param   FileSystem  as a TEMFileSystem as a reference
+  @param   MacroCache  as a TEMMacroCache as a reference
+  @param   ModuleCache as a TEMModuleCache as a pointer
+
+**/
+TEMInstallationScanner::TEMInstallationScanner(TEMSnapshotPtr Snapshot, TEMFileSystem& FileSystem,
+  TEMMacroCache& MacroCache, TEMModuleCache* ModuleCache) : FSnapshot(Snapshot),
+  FFileSystem(FileSystem), FMacroCache(MacroCache), FModuleCache(ModuleCache) {}
+
+/**
+
+  This method validates the experts, known IDE packages and known packages of the installation at
+  the given registry path using the installations cached macros.
+
+  @precon  None.
+  @postcon Returns a record of the installations validation along with its entries.
+
+  @param   strRegPath as a std::wstring as a constant reference
+  @return  a TEMInstallationResult
+
+**/
+TEMInstallationResult TEMInstallationScanner::Scan(const std::wstring& strRegPath) const {
+  return Scan(strRegPath, *FMacroCache.Get(*FSnapshot, strRegPath));
+}
+
+/**
+
+  This method loads the experts, known IDE packages and known packages of the installation at the
+  given registry path in a single pass and, if there is a module cache, resolves the packages that
+  they import. The resulting entries hold the status of each entry and of each section so that
+  nothing needs to be re-read to display them.
+
+  @precon  None.
+  @postcon Returns a record of the installations validation along with its entries.
+
+  @param   strRegPath as a std::wstring as a constant reference
+  @param   Macros     as a TEMMacroTable as a constant reference
+  @return  a TEMInstallationResult
+
+**/
+TEMInstallationResult TEMInstallationScanner::Scan(const std::wstring& strRegPath,
+  const TEMMacroTable& Macros) const {
+  TEMTraceSpan Span("Scanner.Scan", strRegPath);
+  TEMInstallationResult Result;
+  Result.strRegPath = strRegPath;
+  Result.Entries = TEMEntriesPtr(new TEMInstallationEntries());
+  Result.Entries->Load(*FSnapshot, strRegPath, Macros, FFileSystem);
+  if (FModuleCache != NULL) {
+    TEMDependencyGraph Graph;
+    Graph.Build(*Result.Entries, Macros, FFileSystem, *FModuleCache);
+    Graph.Apply(*Result.Entries);
+  }
+  StampDirectories(Result, Macros);
+  return Result;
+}
+
+/**
+
+  This method lists the distinct directories whose listings the validation of the scanned
+  installation depends upon (the folder of each entry and, if dependencies are checked, the IDE's
+  bin folder and the common Bpl folder) and stamps them. Adding, removing or renaming a file in a
+  directory changes its time stamp so if the stamp is unchanged so is the validation.
+
+  @precon  Result must contain the installation's entries.
+  @postcon The result's directories and directory stamp are set.
+
+  @param   Result as a TEMInstallationResult as a reference
+  @param   Macros as a TEMMacroTable as a constant reference
+
+**/
+void TEMInstallationScanner::StampDirectories(TEMInstallationResult& Result,
+  const TEMMacroTable& Macros) const {
+  TEMTraceSpan Span("Scanner.StampDirectories", Result.strRegPath);
+  std::unordered_set<std::wstring> Folded;
+  TEMNameList& Directories = Result.Directories;
+  Directories.clear();
+  TEMNameList FileNames;
+  for (size_t i = 0; i < Result.Entries->Count(); i++)
+    FileNames.push_back(Macros.Expand(Result.Entries->Entry((int)i).FileName.Text()));
+  if (FModuleCache != NULL) {
+    FileNames.push_back(Macros.Expand(L"$(BDSBIN)\\"));
+    FileNames.push_back(Macros.Expand(L"$(BDSCOMMONDIR)\\Bpl\\"));
+  }
+  for (size_t i = 0; i < FileNames.size(); i++) {
+    size_t iSeparator = FileNames[i].find_last_of(L"\\/");
+    if (iSeparator == std::wstring::npos || iSeparator == 0)
+      continue;
+    std::wstring strDirectory = FileNames[i].substr(0, iSeparator);
+    if (Folded.insert(EMFoldCase(strDirectory)).second)
+      Directories.push_back(strDirectory);
+  }
+  std::sort(Directories.begin(), Directories.end());
+  Result.iDirectoryStamp = DirectoryStamp(Directories);
+}
+
+/**
+
+  This method returns a stamp of the given directories made from whether each exists and its
+  time stamp.
+
+  @precon  None.
+  @postcon Returns the directories' stamp.
+
+  @param   Directories as a TEMNameList as a constant reference
+  @return  an unsigned long long
+
+**/
+unsigned long long TEMInstallationScanner::DirectoryStamp(const TEMNameList& Directories) const {
+  unsigned long long iStamp = 14695981039346656037ULL;
+  for (size_t i = 0; i < Directories.size(); i++) {
+    long long iTimeStamp = 0;
+    unsigned long long iValue = FFileSystem.GetTimeStamp(Directories[i], iTimeStamp) ?
+      (unsigned long long)iTimeStamp : ~0ULL;
+    for (size_t j = 0; j < 8; j++)
+      iStamp = (iStamp ^ (iValue >> (8 * j) & 0xFF)) * 1099511628211ULL;
+  }
+  return iStamp;
+}
+
+/**
+
+  This method returns true if the given registry key name is a RAD Studio version number (e.g.
+  22.0) and therefore denotes an installation.
+
+  @precon  None.
+  @postcon Returns whether the name is a version number.
+
+  @param   strName as a std::wstring as a constant reference
+  @return  a bool
+
+**/
+bool EMIsInstallationVersion(const std::wstring& strName) {
+  static const std::wregex VersionNumPattern(L"\\d+.\\d");
+  return std::regex_match(strName, VersionNumPattern);
+}
+
+/**
+
+  This method finds the RAD Studio installations beneath the given company roots (e.g.
+  Software\Embarcadero). Each installation is a version number key beneath a product key (BDS by
+  default or the name given to the IDE's -r command line option).
+
+  @precon  None.
+  @postcon Installations contains the registry path of each installation (with a trailing
+           backslash) in registry order.
+
+  @param   Snapshot      as a TEMRegistrySnapshot as a constant reference
+  @param   Roots         as a TEMNameList as a constant reference
+  @param   Installations as a TEMNameList as a reference
+
+**/
+void EMFindInstallations(const TEMRegistrySnapshot& Snapshot, const TEMNameList& Roots,
+  TEMNameList& Installations) {
+  Installations.clear();
+  for (size_t i = 0; i < Roots.size(); i++) {
+    TEMNameList Products;
+    Snapshot.ReadSections(Roots[i] + L"\\", Products);
+    for (size_t j = 0; j < Products.size(); j++) {
+      std::wstring strProduct = Roots[i] + L"\\" + Products[j] + L"\\";
+      TEMNameList Versions;
+      Snapshot.ReadSections(strProduct, Versions);
+      for (size_t k = 0; k < Versions.size(); k++)
+        if (EMIsInstallationVersion(Versions[k]))
+          Installations.push_back(strProduct + Versions[k] + L"\\");
+    }
+  }
+}
+
+/**
+
+  This method returns the key of the given registry path in the index.
+
+  @precon  None.
+  @postcon Returns the case folded path without any leading or trailing backslashes.
+
+  @param   strRegPath as a std::wstring as a constant reference
+  @return  a std::wstring
+
+**/
+std::wstring TEMInstallationIndex::Key(const std::wstring& strRegPath) {
+  return EMFoldCase(EMKeyPath(strRegPath));
+}
+
+/**
+
+  This method adds the installation at the given registry path to the index.
+
+  @precon  None.
+  @postcon Returns the new ID of the installation or its existing ID if already indexed.
+
+  @param   strRegPath as a std::wstring as a constant reference
+  @return  an int
+
+**/
+int TEMInstallationIndex::Add(const std::wstring& strRegPath) {
+  std::pair<std::unordered_map<std::wstring, int>::iterator, bool> Item =
+    FIDs.insert(std::make_pair(Key(strRegPath), (int)FRegPaths.size()));
+  if (Item.second)
+    FRegPaths.push_back(strRegPath);
+  return Item.first->second;
+}
+
+/**
+
+  This method returns the ID of the installation at the given registry path.
+
+  @precon  None.
+  @postcon Returns the installation's ID or -1 if it is not in the index.
+
+  @param   strRegPath as a std::wstring as a constant reference
+  @return  an int
+
+**/
+int TEMInstallationIndex::Find(const std::wstring& strRegPath) const {
+  std::unordered_map<std::wstring, int>::const_iterator Item = FIDs.find(Key(strRegPath));
+  return Item != FIDs.end() ? Item->second : -1;
+}
+
+/**
+
+  This method removes all the installations from the index.
+
+  @precon  None.
+  @postcon The index is empty.
+
+**/
+void TEMInstallationIndex::Clear() {
+  FRegPaths.clear();
+  FIDs.clear();
+}
@@ -0,0 +1,64 @@
+#ifndef ExpertManagerScannerH
+#define ExpertManagerScannerH
+
+#include "ExpertManagerEntries.h"
+#include "ExpertManagerPEFile.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/** A plain record of the validation results of a single RAD Studio installation which is produced
+    by a scan and merged into the user interface. The directories are those whose listings the
+    validation depends upon (the entries' folders and the folders packages are looked for in) and
+    the directory stamp is made from their time stamps when they were scanned. **/
+struct TEMInstallationResult {
+  int                iID;
+  std::wstring       strRegPath;
+  TEMEntriesPtr      Entries;
+  TEMNameList        Directories;
+  unsigned long long iDirectoryStamp;
+  TEMInstallationResult();
+  TExpertValidation Validation() const;
+};
+
+/** This class validates the experts and packages of RAD Studio installations against a registry
+    snapshot and a file system and, if given a module cache, checks the packages that they import.
+    It holds no mutable state so a single instance can be used by many
+    threads at once. **/
+class TEMInstallationScanner {
+  private:
+    TEMSnapshotPtr FSnapshot;
+    TEMFileSystem& FFileSystem;
+    TEMMacroCache& FMacroCache;
+    TEMModuleCache* FModuleCache;
+    void StampDirectories(TEMInstallationResult& Result, const TEMMacroTable& Macros) const;
+  public:
+    TEMInstallationScanner(TEMSnapshotPtr Snapshot, TEMFileSystem& FileSystem,
+      TEMMacroCache& MacroCache, TEMModuleCache* ModuleCache = NULL);
+    TEMInstallationResult Scan(const std::wstring& strRegPath) const;
+    TEMInstallationResult Scan(const std::wstring& strRegPath, const TEMMacroTable& Macros) const;
+    unsigned long long DirectoryStamp(const TEMNameList& Directories) const;
+};
+
+/** This class gives each installation found by a scan a stable ID (its index in the order it was
+    added) and maps between the IDs and the installations' registry paths in both directions. A
+    path is found regardless of case or trailing backslashes. **/
+class TEMInstallationIndex {
+  private:
+    std::vector<std::wstring>              FRegPaths;
+    std::unordered_map<std::wstring, int>  FIDs;
+    static std::wstring Key(const std::wstring& strRegPath);
+  public:
+    int Add(const std::wstring& strRegPath);
+    int Find(const std::wstring& strRegPath) const;
+    const std::wstring& RegPath(const int iID) const { return FRegPaths[iID]; };
+    const TEMNameList& RegPaths() const { return FRegPaths; };
+    size_t Count() const { return FRegPaths.size(); };
+    void Clear();
+};
+
+bool EMIsInstallationVersion(const std::wstring& strName);
+void EMFindInstallations(const TEMRegistrySnapshot& Snapshot, const TEMNameList& Roots,
+  TEMNameList& Installations);
+
+#endif
@@ -0,0 +1,287 @@
+#pragma hdrstop
+
+#include "ExpertManagerSearchIndex.h"
+#include "ExpertManagerTrace.h"
+#include <algorithm>
+
+#pragma package(smart_init)
+
+/** The number of characters in each indexed gram. **/
+static const size_t iGramLength = 3;
+/** The character which separates the fields of a document so that no gram spans two fields. **/
+static const wchar_t chFieldSeparator = L'\x01';
+
+/**
+
+  This is the constructor for the search index class.
+
+  @precon  None.
+  @postcon Creates an empty index.
+
+**/
+TEMSearchIndex::TEMSearchIndex() : FLive(0) {}
+
+/**
+
+  This method returns the key of the trigram at the start of the given text.
+
+  @precon  strText must have at least three characters.
+  @postcon Returns the three characters packed into an integer.
+
+  @param   strText as a wchar_t pointer as a constant
+  @return  an unsigned long long
+
+**/
+unsigned long long TEMSearchIndex::Gram(const wchar_t* strText) {
+  return ((unsigned long long)(strText[0] & 0x1FFFFF) << 42) |
+    ((unsigned long long)(strText[1] & 0x1FFFFF) << 21) |
+    (unsigned long long)(strText[2] & 0x1FFFFF);
+}
+
+/**
+
+  This method adds a document with the given text to the index. Documents are numbered in the
+  order they are added so each gram's list of documents stays sorted.
+
+  @precon  None.
+  @postcon The document is added to the lists of each of its distinct grams and its number is
+           returned.
+
+  @param   Usage   as a TEMUsage as a constant reference
+  @param   strText as a std::wstring as a constant reference
+  @return  an int
+
+**/
+int TEMSearchIndex::AddDocument(const TEMUsage& Usage, const std::wstring& strText) {
+  int iDocument = (int)FDocuments.size();
+  TEMSearchDocument Document = {Usage, strText, true};
+  FDocuments.push_back(Document);
+  FLive++;
+  for (size_t i = 0; i + iGramLength <= strText.length(); i++) {
+    std::vector<int>& Documents = FGrams[Gram(strText.c_str() + i)];
+    if (Documents.empty() || Documents.back() != iDocument)
+      Documents.push_back(iDocument);
+  }
+  return iDocument;
+}
+
+/**
+
+  This method marks the given document as removed. It stays in the gram lists (where it is skipped)
+  until the index is compacted.
+
+  @precon  iDocument must be a valid document number.
+  @postcon The document is no longer found.
+
+  @param   iDocument as an int as a constant
+
+**/
+void TEMSearchIndex::RemoveDocument(const int iDocument) {
+  if (iDocument >= 0 && FDocuments[iDocument].boolLive) {
+    FDocuments[iDocument].boolLive = false;
+    FDocuments[iDocument].strText.clear();
+    FLive--;
+  }
+}
+
+/**
+
+  This method replaces the document of the given entry with one for its current name, filename
+  and expanded filename (or removes it if the entry has been deleted).
+
+  @precon  iEntryID must be a valid entry ID and the installation must have a list of documents.
+  @postcon The entry's document is up to date.
+
+  @param   iInstallationID as an int as a constant
+  @param   Entries         as a TEMInstallationEntries as a constant reference
+  @param   iEntryID        as an int as a constant
+  @param   Macros          as a TEMMacroTable as a constant reference
+
+**/
+void TEMSearchIndex::IndexEntry(const int iInstallationID, const TEMInstallationEntries& Entries,
+  const int iEntryID, const TEMMacroTable& Macros) {
+  std::vector<int>& Documents = FInstallations[iInstallationID];
+  if ((int)Documents.size() <= iEntryID)
+    Documents.resize(iEntryID + 1, -1);
+  RemoveDocument(Documents[iEntryID]);
+  Documents[iEntryID] = -1;
+  const TEMEntry& Entry = Entries.Entry(iEntryID);
+  if (Entry.boolDeleted)
+    return;
+  TEMUsage Usage = {iInstallationID, Entry.eSection, iEntryID};
+  const std::wstring strFileName = Entry.FileName.Text();
+  Documents[iEntryID] = AddDocument(Usage, EMFoldCase(Entry.Name.Text() + chFieldSeparator +
+    strFileName + chFieldSeparator + Macros.Expand(strFileName)));
+}
+
+/**
+
+  This method rebuilds the index from its live documents so that removed documents no longer take
+  up space in the gram lists.
+
+  @precon  None.
+  @postcon The index holds only live documents.
+
+**/
+void TEMSearchIndex::Compact() {
+  TEMTraceSpan Span("SearchIndex.Compact");
+  std::vector<TEMSearchDocument> Documents;
+  Documents.swap(FDocuments);
+  FGrams.clear();
+  FLive = 0;
+  std::vector<int> Numbers(Documents.size(), -1);
+  for (size_t i = 0; i < Documents.size(); i++)
+    if (Documents[i].boolLive)
+      Numbers[i] = AddDocument(Documents[i].Usage, Documents[i].strText);
+  for (auto& Installation : FInstallations)
+    for (size_t i = 0; i < Installation.second.size(); i++)
+      if (Installation.second[i] >= 0)
+        Installation.second[i] = Numbers[Installation.second[i]];
+}
+
+/**
+
+  This method indexes all the entries of the given installation replacing any entries previously
+  indexed for it.
+
+  @precon  None.
+  @postcon The installation's entries are indexed.
+
+  @param   iInstallationID as an int as a constant
+  @param   Entries         as a TEMInstallationEntries as a constant reference
+  @param   Macros          as a TEMMacroTable as a constant reference
+
+**/
+void TEMSearchIndex::SetInstallation(const int iInstallationID,
+  const TEMInstallationEntries& Entries, const TEMMacroTable& Macros) {
+  TEMTraceSpan Span("SearchIndex.SetInstallation");
+  RemoveInstallation(iInstallationID);
+  FInstallations[iInstallationID].assign(Entries.Count(), -1);
+  for (size_t i = 0; i < Entries.Count(); i++)
+    IndexEntry(iInstallationID, Entries, (int)i, Macros);
+  if (FDocuments.size() > 2 * FLive + 1024)
+    Compact();
+}
+
+/**
+
+  This method removes all the entries of the given installation from the index.
+
+  @precon  None.
+  @postcon The installation's entries are no longer found.
+
+  @param   iInstallationID as an int as a constant
+
+**/
+void TEMSearchIndex::RemoveInstallation(const int iInstallationID) {
+  std::unordered_map<int, std::vector<int> >::iterator i = FInstallations.find(iInstallationID);
+  if (i == FInstallations.end())
+    return;
+  for (size_t j = 0; j < i->second.size(); j++)
+    RemoveDocument(i->second[j]);
+  FInstallations.erase(i);
+}
+
+/**
+
+  This method re-indexes the given entries of an indexed installation after they have been added,
+  updated or removed.
+
+  @precon  None.
+  @postcon The entries are re-indexed if the installation is indexed.
+
+  @param   iInstallationID as an int as a constant
+  @param   Entries         as a TEMInstallationEntries as a constant reference
+  @param   EntryIDs        as a TEMEntryIDList as a constant reference
+  @param   Macros          as a TEMMacroTable as a constant reference
+
+**/
+void TEMSearchIndex::UpdateEntries(const int iInstallationID,
+  const TEMInstallationEntries& Entries, const TEMEntryIDList& EntryIDs,
+  const TEMMacroTable& Macros) {
+  if (FInstallations.find(iInstallationID) == FInstallations.end())
+    return;
+  for (size_t i = 0; i < EntryIDs.size(); i++)
+    IndexEntry(iInstallationID, Entries, EntryIDs[i], Macros);
+  if (FDocuments.size() > 2 * FLive + 1024)
+    Compact();
+}
+
+/**
+
+  This method finds the entries whose name, filename or expanded filename contains the given text
+  ignoring case. Queries of three or more characters are answered from the gram lists, shorter
+  queries check every document.
+
+  @precon  None.
+  @postcon Results contains at most iMaxResults entries in the order they were indexed and true is
+           returned if there were more.
+
+  @param   strQuery    as a std::wstring as a constant reference
+  @param   iMaxResults as a size_t as a constant
+  @param   Results     as a TEMUsageList as a reference
+  @return  a bool
+
+**/
+bool TEMSearchIndex::Search(const std::wstring& strQuery, const size_t iMaxResults,
+  TEMUsageList& Results) const {
+  TEMTraceSpan Span("SearchIndex.Search", strQuery);
+  Results.clear();
+  std::wstring strText = EMFoldCase(strQuery);
+  if (strText.empty())
+    return false;
+  if (strText.length() < iGramLength) {
+    for (size_t i = 0; i < FDocuments.size(); i++)
+      if (FDocuments[i].boolLive && FDocuments[i].strText.find(strText) != std::wstring::npos) {
+        if (Results.size() == iMaxResults)
+          return true;
+        Results.push_back(FDocuments[i].Usage);
+      }
+    return false;
+  }
+  std::vector<const std::vector<int>*> Lists;
+  for (size_t i = 0; i + iGramLength <= strText.length(); i++) {
+    std::unordered_map<unsigned long long, std::vector<int> >::const_iterator Gram =
+      FGrams.find(TEMSearchIndex::Gram(strText.c_str() + i));
+    if (Gram == FGrams.end())
+      return false;
+    Lists.push_back(&Gram->second);
+  }
+  std::sort(Lists.begin(), Lists.end(),
+    [](const std::vector<int>* List1, const std::vector<int>* List2) {
+      return List1->size() < List2->size();
+    });
+  std::vector<size_t> Positions(Lists.size(), 0);
+  const std::vector<int>& Candidates = *Lists[0];
+  for (size_t i = 0; i < Candidates.size(); i++) {
+    int iDocument = Candidates[i];
+    bool boolCandidate = FDocuments[iDocument].boolLive;
+    for (size_t j = 1; j < Lists.size() && boolCandidate; j++) {
+      const std::vector<int>& List = *Lists[j];
+      Positions[j] = std::lower_bound(List.begin() + Positions[j], List.end(), iDocument) -
+        List.begin();
+      boolCandidate = Positions[j] < List.size() && List[Positions[j]] == iDocument;
+    }
+    if (boolCandidate && FDocuments[iDocument].strText.find(strText) != std::wstring::npos) {
+      if (Results.size() == iMaxResults)
+        return true;
+      Results.push_back(FDocuments[iDocument].Usage);
+    }
+  }
+  return false;
+}
+
+/**
+
+  This method removes all the entries from the index.
+
+  @precon  None.
+  @postcon The index is empty.
+
+**/
+void TEMSearchIndex::Clear() {
+  FDocuments.clear();
+  FGrams.clear();
+  FInstallations.clear();
+  FLive = 0;
+}
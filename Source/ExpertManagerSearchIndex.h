@@ -0,0 +1,47 @@
+#ifndef ExpertManagerSearchIndexH
+#define ExpertManagerSearchIndexH
+
+#include "ExpertManagerUsageIndex.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/** This class is a trigram index of the names, filenames and expanded filenames of the experts
+    and packages of all the scanned installations so that they can be searched for a substring as
+    the user types. A query is answered by intersecting the (sorted) lists of the entries which
+    contain each of its trigrams and checking only those entries for the whole query. Re-indexed
+    entries are replaced by new documents and the index is compacted once more than half of its
+    documents have been replaced. **/
+class TEMSearchIndex {
+  private:
+    /** A record of a single indexed entry and the case folded text that is searched. **/
+    struct TEMSearchDocument {
+      TEMUsage     Usage;
+      std::wstring strText;
+      bool         boolLive;
+    };
+    std::vector<TEMSearchDocument>                           FDocuments;
+    std::unordered_map<unsigned long long, std::vector<int> > FGrams;
+    std::unordered_map<int, std::vector<int> >               FInstallations;
+    size_t                                                   FLive;
+    static unsigned long long Gram(const wchar_t* strText);
+    int AddDocument(const TEMUsage& Usage, const std::wstring& strText);
+    void RemoveDocument(const int iDocument);
+    void IndexEntry(const int iInstallationID, const TEMInstallationEntries& Entries,
+      const int iEntryID, const TEMMacroTable& Macros);
+    void Compact();
+  public:
+    TEMSearchIndex();
+    void SetInstallation(const int iInstallationID, const TEMInstallationEntries& Entries,
+      const TEMMacroTable& Macros);
+    void RemoveInstallation(const int iInstallationID);
+    void UpdateEntries(const int iInstallationID, const TEMInstallationEntries& Entries,
+      const TEMEntryIDList& EntryIDs, const TEMMacroTable& Macros);
+    bool Search(const std::wstring& strQuery, const size_t iMaxResults,
+      TEMUsageList& Results) const;
+    size_t Count() const { return FLive; };
+    void Clear();
+};
+
+#endif
+
@@ -0,0 +1,279 @@
+#pragma hdrstop
+
+#include "ExpertManagerStrings.h"
+#include <cwctype>
+
+#pragma package(smart_init)
+
+/**
+
+  This function returns an upper case copy of the given text so that it can be used as a key for
+  case insensitive comparisons and hashing (registry keys, value names and filenames are all case
+  insensitive).
+
+  @precon  None.
+  @postcon Returns the case folded text.
+
+  @param   strText as a std::wstring as a constant reference
+  @return  a std::wstring
+
+**/
+std::wstring EMFoldCase(const std::wstring& strText) {
+  std::wstring strResult(strText);
+  for (size_t i = 0; i < strResult.length(); i++)
+    strResult[i] = (wchar_t)std::towupper(strResult[i]);
+  return strResult;
+}
+
+/**
+
+  This function returns true if the two pieces of text are the same ignoring case.
+
+  @precon  None.
+  @postcon Returns true if the texts are the same ignoring case.
+
+  @param   strText1 as a std::wstring as a constant reference
+  @param   strText2 as a std::wstring as a constant reference
+  @return  a bool
+
+**/
+bool EMSameText(const std::wstring& strText1, const std::wstring& strText2) {
+  if (strText1.length() != strText2.length())
+    return false;
+  for (size_t i = 0; i < strText1.length(); i++)
+    if (std::towupper(strText1[i]) != std::towupper(strText2[i]))
+      return false;
+  return true;
+}
+
+/**
+
+  This function returns true if the given text matches the given mask ignoring case (as per
+  MatchesMask) where * matches any run of characters and ? matches any single character.
+
+  @precon  None.
+  @postcon Returns whether the text matches the mask.
+
+  @param   strText as a std::wstring as a constant reference
+  @param   strMask as a std::wstring as a constant reference
+  @return  a bool
+
+**/
+bool EMMatchesMask(const std::wstring& strText, const std::wstring& strMask) {
+  size_t iText = 0, iMask = 0;
+  size_t iStar = std::wstring::npos, iStarText = 0;
+  while (iText < strText.length()) {
+    if (iMask < strMask.length() && (strMask[iMask] == L'?' ||
+      std::towupper(strMask[iMask]) == std::towupper(strText[iText]))) {
+      iText++;
+      iMask++;
+    } else if (iMask < strMask.length() && strMask[iMask] == L'*') {
+      iStar = iMask++;
+      iStarText = iText;
+    } else if (iStar != std::wstring::npos) {
+      iMask = iStar + 1;
+      iText = ++iStarText;
+    } else
+      return false;
+  }
+  while (iMask < strMask.length() && strMask[iMask] == L'*')
+    iMask++;
+  return iMask == strMask.length();
+}
+
+/**
+
+  This function splits the given registry path into its key names ignoring any leading, trailing
+  or doubled backslashes.
+
+  @precon  None.
+  @postcon Parts is cleared and filled with the key names in the path.
+
+  @param   strPath as a std::wstring as a constant reference
+  @param   Parts   as a TEMNameList as a reference
+
+**/
+void EMSplitPath(const std::wstring& strPath, TEMNameList& Parts) {
+  Parts.clear();
+  size_t iStart = 0;
+  while (iStart <= strPath.length()) {
+    size_t iEnd = strPath.find(L'\\', iStart);
+    if (iEnd == std::wstring::npos)
+      iEnd = strPath.length();
+    if (iEnd > iStart)
+      Parts.push_back(strPath.substr(iStart, iEnd - iStart));
+    iStart = iEnd + 1;
+  }
+}
+
+/**
+
+  This function returns the given registry path with single backslashes between its keys and no
+  leading or trailing backslashes so that it can be opened as a key and have sub-key names
+  appended.
+
+  @precon  None.
+  @postcon Returns the normalised key path.
+
+  @param   strPath as a std::wstring as a constant reference
+  @return  a std::wstring
+
+**/
+std::wstring EMKeyPath(const std::wstring& strPath) {
+  TEMNameList Parts;
+  EMSplitPath(strPath, Parts);
+  std::wstring strKey;
+  strKey.reserve(strPath.length());
+  for (size_t i = 0; i < Parts.size(); i++) {
+    if (i > 0)
+      strKey += L'\\';
+    strKey += Parts[i];
+  }
+  return strKey;
+}
+
+/**
+
+  This function returns the filename part of the given path (as per ExtractFileName).
+
+  @precon  None.
+  @postcon Returns the text after the last path or drive delimiter.
+
+  @param   strFileName as a std::wstring as a constant reference
+  @return  a std::wstring
+
+**/
+std::wstring EMExtractFileName(const std::wstring& strFileName) {
+  size_t iPos = strFileName.find_last_of(L"\\/:");
+  if (iPos == std::wstring::npos)
+    return strFileName;
+  return strFileName.substr(iPos + 1);
+}
+
+/**
+
+  This function decodes the given UTF-8 text into a wide string. Code points outside the basic
+  multilingual plane are written as surrogate pairs when wchar_t is 16 bits. Invalid sequences are
+  replaced with U+FFFD.
+
+  @precon  pText must point to at least iLength bytes.
+  @postcon Returns the decoded text.
+
+  @param   pText   as a char pointer as a constant
+  @param   iLength as a size_t as a constant
+  @return  a std::wstring
+
+**/
+std::wstring EMUTF8ToWide(const char* pText, const size_t iLength) {
+  std::wstring strResult;
+  strResult.reserve(iLength);
+  const unsigned char* p = (const unsigned char*)pText;
+  size_t i = 0;
+  while (i < iLength) {
+    unsigned int iCodePoint = p[i];
+    int iTrail = 0;
+    if (iCodePoint >= 0xF0 && iCodePoint < 0xF8) {
+      iCodePoint &= 0x07;
+      iTrail = 3;
+    } else if (iCodePoint >= 0xE0) {
+      iCodePoint &= 0x0F;
+      iTrail = 2;
+    } else if (iCodePoint >= 0xC0) {
+      iCodePoint &= 0x1F;
+      iTrail = 1;
+    } else if (iCodePoint >= 0x80)
+      iCodePoint = 0xFFFD;
+    i++;
+    for (; iTrail > 0 && i < iLength && (p[i] & 0xC0) == 0x80; iTrail--, i++)
+      iCodePoint = (iCodePoint << 6) | (p[i] & 0x3F);
+    if (iTrail > 0)
+      iCodePoint = 0xFFFD;
+    if (iCodePoint >= 0x10000 && sizeof(wchar_t) == 2) {
+      iCodePoint -= 0x10000;
+      strResult += (wchar_t)(0xD800 + (iCodePoint >> 10));
+      strResult += (wchar_t)(0xDC00 + (iCodePoint & 0x3FF));
+    } else
+      strResult += (wchar_t)iCodePoint;
+  }
+  return strResult;
+}
+
+/**
+
+  This function encodes the given wide string as UTF-8 combining any surrogate pairs.
+
+  @precon  None.
+  @postcon Returns the UTF-8 encoded text.
+
+  @param   strText as a std::wstring as a constant reference
+  @return  a std::string
+
+**/
+std::string EMWideToUTF8(const std::wstring& strText) {
+  std::string strResult;
+  strResult.reserve(strText.length());
+  for (size_t i = 0; i < strText.length(); i++) {
+    unsigned int iCodePoint = (unsigned int)strText[i];
+    if (iCodePoint >= 0xD800 && iCodePoint < 0xDC00 && i + 1 < strText.length()) {
+      unsigned int iLow = (unsigned int)strText[i + 1];
+      if (iLow >= 0xDC00 && iLow < 0xE000) {
+        iCodePoint = 0x10000 + ((iCodePoint - 0xD800) << 10) + (iLow - 0xDC00);
+        i++;
+      }
+    }
+    if (iCodePoint < 0x80)
+      strResult += (char)iCodePoint;
+    else if (iCodePoint < 0x800) {
+      strResult += (char)(0xC0 | (iCodePoint >> 6));
+      strResult += (char)(0x80 | (iCodePoint & 0x3F));
+    } else if (iCodePoint < 0x10000) {
+      strResult += (char)(0xE0 | (iCodePoint >> 12));
+      strResult += (char)(0x80 | ((iCodePoint >> 6) & 0x3F));
+      strResult += (char)(0x80 | (iCodePoint & 0x3F));
+    } else {
+      strResult += (char)(0xF0 | (iCodePoint >> 18));
+      strResult += (char)(0x80 | ((iCodePoint >> 12) & 0x3F));
+      strResult += (char)(0x80 | ((iCodePoint >> 6) & 0x3F));
+      strResult += (char)(0x80 | (iCodePoint & 0x3F));
+    }
+  }
+  return strResult;
+}
+
+/**
+
+  This method returns the given text as a quoted and escaped UTF-8 JSON string.
+
+  @precon  None.
+  @postcon Returns the JSON string.
+
+  @param   strText as a std::wstring as a constant reference
+  @return  a std::string
+
+**/
+std::string EMJSONString(const std::wstring& strText) {
+  std::string strUTF8 = EMWideToUTF8(strText);
+  std::string strResult;
+  strResult.reserve(strUTF8.length() + 2);
+  strResult += '"';
+  for (size_t i = 0; i < strUTF8.length(); i++) {
+    unsigned char c = (unsigned char)strUTF8[i];
+    switch (c) {
+      case '"':  strResult += "\\\""; break;
+      case '\\': strResult += "\\\\"; break;
+      case '\n': strResult += "\\n";  break;
+      case '\r': strResult += "\\r";  break;
+      case '\t': strResult += "\\t";  break;
+      default:
+        if (c < 0x20) {
+          const char strHex[] = "0123456789abcdef";
+          strResult += "\\u00";
+          strResult += strHex[c >> 4];
+          strResult += strHex[c & 0xF];
+        } else
+          strResult += (char)c;
+    }
+  }
+  strResult += '"';
+  return strResult;
+}
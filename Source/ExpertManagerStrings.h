@@ -0,0 +1,20 @@
+#ifndef ExpertManagerStringsH
+#define ExpertManagerStringsH
+
+#include <string>
+#include <vector>
+
+/** A simplified type for a list of key or value names. **/
+typedef std::vector<std::wstring> TEMNameList;
+
+std::wstring EMFoldCase(const std::wstring& strText);
+bool EMSameText(const std::wstring& strText1, const std::wstring& strText2);
+bool EMMatchesMask(const std::wstring& strText, const std::wstring& strMask);
+void EMSplitPath(const std::wstring& strPath, TEMNameList& Parts);
+std::wstring EMKeyPath(const std::wstring& strPath);
+std::wstring EMExtractFileName(const std::wstring& strFileName);
+std::wstring EMUTF8ToWide(const char* pText, const size_t iLength);
+std::string EMWideToUTF8(const std::wstring& strText);
+std::string EMJSONString(const std::wstring& strText);
+
+#endif
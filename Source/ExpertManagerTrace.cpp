@@ -0,0 +1,300 @@
+#pragma hdrstop
+
+#include "ExpertManagerTrace.h"
+#include "ExpertManagerStrings.h"
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cwchar>
+#include <algorithm>
+
+#pragma package(smart_init)
+
+/** The number of spans that each thread's ring buffer holds before it overwrites the oldest. **/
+static const size_t iTraceBufferSize = 8192;
+
+/** A record of a single completed span. **/
+struct TEMTraceEvent {
+  const char* strName;
+  long long   iStart;
+  long long   iDuration;
+  wchar_t     strDetail[iTraceDetailLength + 1];
+};
+
+/** A record to hold the ring buffer of spans of a single thread. Only the owning thread writes to
+    the buffer and the count is published after each span is written so that the buffer can be
+    read while tracing continues (the oldest spans may be overwritten while they are read). **/
+struct TEMTraceBuffer {
+  int                        iThreadID;
+  std::atomic<size_t>        iCount;
+  std::vector<TEMTraceEvent> Events;
+  TEMTraceBuffer(const int iID) : iThreadID(iID), iCount(0), Events(iTraceBufferSize) {}
+};
+
+typedef std::shared_ptr<TEMTraceBuffer> TEMTraceBufferPtr;
+
+std::atomic<bool> TEMTrace::FEnabled(false);
+
+/**
+
+  This method returns the lock that guards the list of thread buffers.
+
+  @precon  None.
+  @postcon Returns the lock (created on first use so that it is safe to use during start up).
+
+  @return  a std::mutex as a reference
+
+**/
+static std::mutex& BuffersLock() {
+  static std::mutex Lock;
+  return Lock;
+}
+
+/**
+
+  This method returns the list of the buffers of all the threads that have recorded spans. The
+  buffers outlive their threads so that the spans of finished threads can still be written.
+
+  @precon  BuffersLock() must be held.
+  @postcon Returns the list of buffers.
+
+  @return  a std::vector<TEMTraceBufferPtr> as a reference
+
+**/
+static std::vector<TEMTraceBufferPtr>& Buffers() {
+  static std::vector<TEMTraceBufferPtr> List;
+  return List;
+}
+
+/**
+
+  This method returns the calling thread's trace buffer creating and registering it the first
+  time the thread records a span.
+
+  @precon  None.
+  @postcon Returns the thread's buffer.
+
+  @return  a TEMTraceBuffer as a reference
+
+**/
+static TEMTraceBuffer& ThreadBuffer() {
+  static thread_local TEMTraceBufferPtr Buffer;
+  if (!Buffer) {
+    std::lock_guard<std::mutex> Lock(BuffersLock());
+    Buffer = TEMTraceBufferPtr(new TEMTraceBuffer((int)Buffers().size() + 1));
+    Buffers().push_back(Buffer);
+  }
+  return *Buffer;
+}
+
+/**
+
+  This method returns the number of nanoseconds since the first span of the process was started.
+
+  @precon  None.
+  @postcon Returns the time.
+
+  @return  a long long
+
+**/
+static long long TraceTime() {
+  static const std::chrono::steady_clock::time_point Epoch = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - Epoch).count();
+}
+
+/**
+
+  This method switches the recording of spans on or off.
+
+  @precon  None.
+  @postcon Spans are recorded if enabled. Recorded spans are kept.
+
+  @param   boolEnabled as a bool as a constant
+
+**/
+void TEMTrace::Enable(const bool boolEnabled) {
+  TraceTime();
+  FEnabled = boolEnabled;
+}
+
+/**
+
+  This method discards the recorded spans of all threads.
+
+  @precon  None.
+  @postcon The buffers are empty.
+
+**/
+void TEMTrace::Clear() {
+  std::lock_guard<std::mutex> Lock(BuffersLock());
+  for (size_t i = 0; i < Buffers().size(); i++)
+    Buffers()[i]->iCount = 0;
+}
+
+/**
+
+  This method returns the number of spans held in the buffers of all threads.
+
+  @precon  None.
+  @postcon Returns the number of spans.
+
+  @return  a size_t
+
+**/
+size_t TEMTrace::Count() {
+  std::lock_guard<std::mutex> Lock(BuffersLock());
+  size_t iCount = 0;
+  for (size_t i = 0; i < Buffers().size(); i++)
+    iCount += std::min(Buffers()[i]->iCount.load(), iTraceBufferSize);
+  return iCount;
+}
+
+/**
+
+  This method writes the given time in nanoseconds to the stream as microseconds (the unit of the
+  Chrome trace event format).
+
+  @precon  None.
+  @postcon The time is written.
+
+  @param   Stream as a std::ostream as a reference
+  @param   iTime  as a long long as a constant
+
+**/
+static void WriteMicroseconds(std::ostream& Stream, const long long iTime) {
+  const char strDigits[] = "0123456789";
+  Stream << iTime / 1000 << '.' << strDigits[iTime % 1000 / 100] << strDigits[iTime % 100 / 10]
+    << strDigits[iTime % 10];
+}
+
+/**
+
+  This method writes the recorded spans of all threads to the stream in the Chrome trace event
+  format as complete ("X") events with a thread name record for each thread. A span's detail is
+  written as its "detail" argument.
+
+  @precon  None.
+  @postcon The trace is written to the stream.
+
+  @param   Stream as a std::ostream as a reference
+
+**/
+void TEMTrace::WriteChromeTrace(std::ostream& Stream) {
+  std::vector<TEMTraceBufferPtr> Threads;
+  {
+    std::lock_guard<std::mutex> Lock(BuffersLock());
+    Threads = Buffers();
+  }
+  Stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool boolFirst = true;
+  for (size_t t = 0; t < Threads.size(); t++) {
+    const TEMTraceBuffer& Buffer = *Threads[t];
+    Stream << (boolFirst ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+      << "\"tid\":" << Buffer.iThreadID << ",\"args\":{\"name\":\"Thread " << Buffer.iThreadID
+      << "\"}}";
+    boolFirst = false;
+    size_t iCount = Buffer.iCount.load(std::memory_order_acquire);
+    size_t iFirst = iCount > iTraceBufferSize ? iCount - iTraceBufferSize : 0;
+    for (size_t i = iFirst; i < iCount; i++) {
+      const TEMTraceEvent& Event = Buffer.Events[i % iTraceBufferSize];
+      Stream << ",\n{\"name\":\"" << Event.strName << "\",\"cat\":\"scan\",\"ph\":\"X\",\"pid\":1,"
+        << "\"tid\":" << Buffer.iThreadID << ",\"ts\":";
+      WriteMicroseconds(Stream, Event.iStart);
+      Stream << ",\"dur\":";
+      WriteMicroseconds(Stream, Event.iDuration);
+      if (Event.strDetail[0] != L'\0')
+        Stream << ",\"args\":{\"detail\":" << EMJSONString(Event.strDetail) << '}';
+      Stream << '}';
+    }
+  }
+  Stream << "\n]}\n";
+}
+
+/**
+
+  This method writes the recorded spans to the named file as a Chrome trace.
+
+  @precon  None.
+  @postcon Returns true if the file was written.
+
+  @param   strFileName as a std::wstring as a constant reference
+  @return  a bool
+
+**/
+bool TEMTrace::SaveToFile(const std::wstring& strFileName) {
+#ifdef _WIN32
+  std::ofstream File(strFileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+#else
+  std::ofstream File(EMWideToUTF8(strFileName).c_str(),
+    std::ios::out | std::ios::binary | std::ios::trunc);
+#endif
+  WriteChromeTrace(File);
+  File.close();
+  return !File.fail();
+}
+
+/**
+
+  This is a constructor for the trace span class which starts timing the named span.
+
+  @precon  strName must be a string literal (only the pointer is recorded).
+  @postcon The span is started if tracing is enabled.
+
+  @param   strName as a char pointer as a constant
+
+**/
+TEMTraceSpan::TEMTraceSpan(const char* strName) : FName(NULL) {
+  if (!TEMTrace::Enabled())
+    return;
+  FName = strName;
+  FDetail[0] = L'\0';
+  FStart = TraceTime();
+}
+
+/**
+
+  This is a constructor for the trace span class which starts timing the named span with the given
+  detail.
+
+  @precon  strName must be a string literal (only the pointer is recorded).
+  @postcon The span is started if tracing is enabled.
+
+  @param   strName   as a char pointer as a constant
+  @param   strDetail as a std::wstring as a constant reference
+
+**/
+TEMTraceSpan::TEMTraceSpan(const char* strName, const std::wstring& strDetail) : FName(NULL) {
+  if (!TEMTrace::Enabled())
+    return;
+  FName = strName;
+  size_t iLength = std::min(strDetail.length(), iTraceDetailLength);
+  std::wmemcpy(FDetail, strDetail.data(), iLength);
+  FDetail[iLength] = L'\0';
+  FStart = TraceTime();
+}
+
+/**
+
+  This is a destructor for the trace span class which records the span in the calling thread's
+  buffer.
+
+  @precon  None.
+  @postcon The span is recorded if it was started.
+
+**/
+TEMTraceSpan::~TEMTraceSpan() {
+  if (FName == NULL)
+    return;
+  long long iEnd = TraceTime();
+  TEMTraceBuffer& Buffer = ThreadBuffer();
+  size_t iCount = Buffer.iCount.load(std::memory_order_relaxed);
+  TEMTraceEvent& Event = Buffer.Events[iCount % iTraceBufferSize];
+  Event.strName = FName;
+  Event.iStart = FStart;
+  Event.iDuration = iEnd - FStart;
+  std::wmemcpy(Event.strDetail, FDetail, std::wcslen(FDetail) + 1);
+  Buffer.iCount.store(iCount + 1, std::memory_order_release);
+}
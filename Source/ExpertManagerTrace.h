@@ -0,0 +1,41 @@
+#ifndef ExpertManagerTraceH
+#define ExpertManagerTraceH
+
+#include <string>
+#include <ostream>
+#include <atomic>
+
+/** The number of characters of a span's detail that are recorded. **/
+const size_t iTraceDetailLength = 63;
+
+/** This class records timed spans of the scan engine's phases (registry reads, macro tables,
+    macro expansion, file probes, duplicate detection and list rendering) into a ring buffer for
+    each thread so that they can be written out as a Chrome trace (chrome://tracing or Perfetto).
+    Recording is off by default and a span then costs a single relaxed atomic load. **/
+class TEMTrace {
+  private:
+    static std::atomic<bool> FEnabled;
+  public:
+    static bool Enabled() { return FEnabled.load(std::memory_order_relaxed); };
+    static void Enable(const bool boolEnabled);
+    static void Clear();
+    static size_t Count();
+    static void WriteChromeTrace(std::ostream& Stream);
+    static bool SaveToFile(const std::wstring& strFileName);
+};
+
+/** This class times a span from its construction to its destruction and records it in the
+    calling thread's trace buffer if tracing is enabled. The name must be a string literal and the
+    optional detail (e.g. the registry path of the installation) is truncated. **/
+class TEMTraceSpan {
+  private:
+    const char* FName;
+    long long   FStart;
+    wchar_t     FDetail[iTraceDetailLength + 1];
+  public:
+    TEMTraceSpan(const char* strName);
+    TEMTraceSpan(const char* strName, const std::wstring& strDetail);
+    ~TEMTraceSpan();
+};
+
+#endif
@@ -0,0 +1,291 @@
+#pragma hdrstop
+
+#include "ExpertManagerUsageIndex.h"
+#include "ExpertManagerTrace.h"
+#include "ExpertManagerStrings.h"
+
+#pragma package(smart_init)
+
+/** The key of an entry which is not indexed (e.g. deleted or without a filename). **/
+static const unsigned int iNoUsageKey = (unsigned int)-1;
+
+/**
+
+  This function orders usages by their installation and then by their entry so that lists of
+  usages are shown in the order of the installations and their entries.
+
+  @precon  None.
+  @postcon Returns true if the first usage comes before the second.
+
+  @param   Usage1 as a TEMUsage as a constant reference
+  @param   Usage2 as a TEMUsage as a constant reference
+  @return  a bool
+
+**/
+bool EMUsageLess(const TEMUsage& Usage1, const TEMUsage& Usage2) {
+  return Usage1.iInstallationID != Usage2.iInstallationID ?
+    Usage1.iInstallationID < Usage2.iInstallationID : Usage1.iEntryID < Usage2.iEntryID;
+}
+
+/**
+
+  This method removes the given entry from the usages of the given key.
+
+  @precon  None.
+  @postcon The entry is no longer listed under the key and empty lists are removed.
+
+  @param   Index           as a TEMUsageMap as a reference
+  @param   iKey            as an unsigned int as a constant
+  @param   iInstallationID as an int as a constant
+  @param   iEntryID        as an int as a constant
+
+**/
+void TEMUsageIndex::Remove(TEMUsageMap& Index, const unsigned int iKey,
+  const int iInstallationID, const int iEntryID) {
+  TEMUsageMap::iterator i = Index.find(iKey);
+  if (i == Index.end())
+    return;
+  TEMUsageList& Usages = i->second;
+  for (size_t j = 0; j < Usages.size(); j++)
+    if (Usages[j].iInstallationID == iInstallationID && Usages[j].iEntryID == iEntryID) {
+      Usages.erase(Usages.begin() + j);
+      break;
+    }
+  if (Usages.empty())
+    Index.erase(i);
+}
+
+/**
+
+  This method returns the usages of the given key.
+
+  @precon  None.
+  @postcon Returns the usages which are empty if nothing is indexed under the key.
+
+  @param   Index as a TEMUsageMap as a constant reference
+  @param   iKey  as an unsigned int as a constant
+  @return  a TEMUsageList as a constant reference
+
+**/
+const TEMUsageList& TEMUsageIndex::Find(const TEMUsageMap& Index, const unsigned int iKey) {
+  static const TEMUsageList NoUsages;
+  TEMUsageMap::const_iterator i = Index.find(iKey);
+  return i != Index.end() ? i->second : NoUsages;
+}
+
+/**
+
+  This method indexes the given entry of the installation unless it has been deleted.
+
+  @precon  iEntryID must be a valid entry ID of the installation and must not be indexed.
+  @postcon The entry is indexed under its filename and expanded path.
+
+  @param   Installation    as a TEMIndexedInstallation as a reference
+  @param   iInstallationID as an int as a constant
+  @param   iEntryID        as an int as a constant
+  @param   Macros          as a TEMMacroTable as a constant reference
+
+**/
+void TEMUsageIndex::AddEntry(TEMIndexedInstallation& Installation, const int iInstallationID,
+  const int iEntryID, const TEMMacroTable& Macros) {
+  const TEMEntry& Entry = Installation.Entries->Entry(iEntryID);
+  if (Entry.boolDeleted || Entry.FileName.Empty())
+    return;
+  TEMUsage Usage = {iInstallationID, Entry.eSection, iEntryID};
+  Installation.FileNameKeys[iEntryID] = TEMDuplicateIndex::Key(Entry.FileName);
+  Installation.PathKeys[iEntryID] = TEMPath(Macros.Expand(Entry.FileName.Text())).FoldedID();
+  FFileNames[Installation.FileNameKeys[iEntryID]].push_back(Usage);
+  FPaths[Installation.PathKeys[iEntryID]].push_back(Usage);
+}
+
+/**
+
+  This method removes the given entry of the installation from the index.
+
+  @precon  iEntryID must be a valid index into the installation's keys.
+  @postcon The entry is no longer indexed.
+
+  @param   Installation    as a TEMIndexedInstallation as a reference
+  @param   iInstallationID as an int as a constant
+  @param   iEntryID        as an int as a constant
+
+**/
+void TEMUsageIndex::RemoveEntry(TEMIndexedInstallation& Installation, const int iInstallationID,
+  const int iEntryID) {
+  if (Installation.FileNameKeys[iEntryID] == iNoUsageKey)
+    return;
+  Remove(FFileNames, Installation.FileNameKeys[iEntryID], iInstallationID, iEntryID);
+  Remove(FPaths, Installation.PathKeys[iEntryID], iInstallationID, iEntryID);
+  Installation.FileNameKeys[iEntryID] = iNoUsageKey;
+  Installation.PathKeys[iEntryID] = iNoUsageKey;
+}
+
+/**
+
+  This method indexes all the entries of the given installation replacing any entries previously
+  indexed for it. The index shares the entries so later edits are re-indexed with UpdateEntries.
+
+  @precon  Entries must be a valid instance.
+  @postcon The installation's entries are indexed.
+
+  @param   iInstallationID as an int as a constant
+  @param   Entries         as a TEMEntriesPtr
+  @param   Macros          as a TEMMacroTable as a constant reference
+
+**/
+void TEMUsageIndex::SetInstallation(const int iInstallationID, TEMEntriesPtr Entries,
+  const TEMMacroTable& Macros) {
+  TEMTraceSpan Span("UsageIndex.SetInstallation");
+  RemoveInstallation(iInstallationID);
+  TEMIndexedInstallation& Installation = FInstallations[iInstallationID];
+  Installation.Entries = Entries;
+  Installation.FileNameKeys.resize(Entries->Count(), iNoUsageKey);
+  Installation.PathKeys.resize(Entries->Count(), iNoUsageKey);
+  for (size_t i = 0; i < Entries->Count(); i++)
+    AddEntry(Installation, iInstallationID, (int)i, Macros);
+}
+
+/**
+
+  This method removes all the entries of the given installation from the index.
+
+  @precon  None.
+  @postcon The installation is no longer indexed.
+
+  @param   iInstallationID as an int as a constant
+
+**/
+void TEMUsageIndex::RemoveInstallation(const int iInstallationID) {
+  std::unordered_map<int, TEMIndexedInstallation>::iterator i =
+    FInstallations.find(iInstallationID);
+  if (i == FInstallations.end())
+    return;
+  for (size_t j = 0; j < i->second.FileNameKeys.size(); j++)
+    RemoveEntry(i->second, iInstallationID, (int)j);
+  FInstallations.erase(i);
+}
+
+/**
+
+  This method re-indexes the given entries of an indexed installation after they have been added,
+  updated or removed (e.g. the changed entries returned by TEMInstallationEntries).
+
+  @precon  None.
+  @postcon The entries are re-indexed if the installation is indexed.
+
+  @param   iInstallationID as an int as a constant
+  @param   EntryIDs        as a TEMEntryIDList as a constant reference
+  @param   Macros          as a TEMMacroTable as a constant reference
+
+**/
+void TEMUsageIndex::UpdateEntries(const int iInstallationID, const TEMEntryIDList& EntryIDs,
+  const TEMMacroTable& Macros) {
+  std::unordered_map<int, TEMIndexedInstallation>::iterator i =
+    FInstallations.find(iInstallationID);
+  if (i == FInstallations.end())
+    return;
+  TEMIndexedInstallation& Installation = i->second;
+  Installation.FileNameKeys.resize(Installation.Entries->Count(), iNoUsageKey);
+  Installation.PathKeys.resize(Installation.Entries->Count(), iNoUsageKey);
+  for (size_t j = 0; j < EntryIDs.size(); j++) {
+    RemoveEntry(Installation, iInstallationID, EntryIDs[j]);
+    AddEntry(Installation, iInstallationID, EntryIDs[j], Macros);
+  }
+}
+
+/**
+
+  This method returns whether the given installation is indexed.
+
+  @precon  None.
+  @postcon Returns true if the installation's entries are indexed.
+
+  @param   iInstallationID as an int as a constant
+  @return  a bool
+
+**/
+bool TEMUsageIndex::Indexed(const int iInstallationID) const {
+  return FInstallations.find(iInstallationID) != FInstallations.end();
+}
+
+/**
+
+  This method returns the indexed entries of the given installation.
+
+  @precon  None.
+  @postcon Returns the entries or null if the installation is not indexed.
+
+  @param   iInstallationID as an int as a constant
+  @return  a TEMEntriesPtr
+
+**/
+TEMEntriesPtr TEMUsageIndex::Entries(const int iInstallationID) const {
+  std::unordered_map<int, TEMIndexedInstallation>::const_iterator i =
+    FInstallations.find(iInstallationID);
+  return i != FInstallations.end() ? i->second.Entries : TEMEntriesPtr();
+}
+
+/**
+
+  This method returns the entries of all the indexed installations which reference a file with the
+  given filename (the path of the given filename is ignored) in any folder.
+
+  @precon  None.
+  @postcon Returns the usages in the order they were indexed.
+
+  @param   FileName as a TEMPath as a constant reference
+  @return  a TEMUsageList as a constant reference
+
+**/
+const TEMUsageList& TEMUsageIndex::FindFileName(const TEMPath& FileName) const {
+  return Find(FFileNames, TEMDuplicateIndex::Key(FileName));
+}
+
+/**
+
+  This method returns the entries of all the indexed installations which reference a file with the
+  given filename (any path is ignored) in any folder. The query is not added to the path pool.
+
+  @precon  None.
+  @postcon Returns the usages in the order they were indexed.
+
+  @param   strFileName as a std::wstring as a constant reference
+  @return  a TEMUsageList as a constant reference
+
+**/
+const TEMUsageList& TEMUsageIndex::FindFileName(const std::wstring& strFileName) const {
+  unsigned int iKey = iNoUsageKey;
+  TEMPathPool::Global().FindFileNameKey(strFileName, iKey);
+  return Find(FFileNames, iKey);
+}
+
+/**
+
+  This method returns the entries of all the indexed installations whose expanded filename is the
+  given path (ignoring case). The query is not added to the path pool.
+
+  @precon  None.
+  @postcon Returns the usages in the order they were indexed.
+
+  @param   strExpandedFileName as a std::wstring as a constant reference
+  @return  a TEMUsageList as a constant reference
+
+**/
+const TEMUsageList& TEMUsageIndex::FindPath(const std::wstring& strExpandedFileName) const {
+  TEMPathID iFolded = TEMPathPool::Global().Find(EMFoldCase(strExpandedFileName));
+  return Find(FPaths, iFolded != 0 ? iFolded : iNoUsageKey);
+}
+
+/**
+
+  This method removes all the installations from the index.
+
+  @precon  None.
+  @postcon The index is empty.
+
+**/
+void TEMUsageIndex::Clear() {
+  FInstallations.clear();
+  FFileNames.clear();
+  FPaths.clear();
+}
@@ -0,0 +1,62 @@
+#ifndef ExpertManagerUsageIndexH
+#define ExpertManagerUsageIndexH
+
+#include "ExpertManagerEntries.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/** A record of a single expert or package of an installation which references a file. **/
+struct TEMUsage {
+  int        iInstallationID;
+  TEMSection eSection;
+  int        iEntryID;
+};
+
+/** A simplified type for a list of the entries which reference a file. **/
+typedef std::vector<TEMUsage> TEMUsageList;
+
+bool EMUsageLess(const TEMUsage& Usage1, const TEMUsage& Usage2);
+
+/** This class is an inverted index of the experts and packages of all the scanned installations
+    by their case folded filename (without the path) and by their case folded expanded path (both
+    as path pool IDs) so that every entry which loads a given file is found in constant time.
+    Installations are added as they are scanned and single entries are re-indexed as they are
+    edited. **/
+class TEMUsageIndex {
+  private:
+    /** A record of an indexed installation's entries and the keys each entry is indexed under
+        (iNoUsageKey for deleted entries). **/
+    struct TEMIndexedInstallation {
+      TEMEntriesPtr                Entries;
+      std::vector<TEMDuplicateKey> FileNameKeys;
+      std::vector<TEMPathID>       PathKeys;
+    };
+    typedef std::unordered_map<unsigned int, TEMUsageList> TEMUsageMap;
+    std::unordered_map<int, TEMIndexedInstallation> FInstallations;
+    TEMUsageMap                                     FFileNames;
+    TEMUsageMap                                     FPaths;
+    static void Remove(TEMUsageMap& Index, const unsigned int iKey, const int iInstallationID,
+      const int iEntryID);
+    static const TEMUsageList& Find(const TEMUsageMap& Index, const unsigned int iKey);
+    void AddEntry(TEMIndexedInstallation& Installation, const int iInstallationID,
+      const int iEntryID, const TEMMacroTable& Macros);
+    void RemoveEntry(TEMIndexedInstallation& Installation, const int iInstallationID,
+      const int iEntryID);
+  public:
+    void SetInstallation(const int iInstallationID, TEMEntriesPtr Entries,
+      const TEMMacroTable& Macros);
+    void RemoveInstallation(const int iInstallationID);
+    void UpdateEntries(const int iInstallationID, const TEMEntryIDList& EntryIDs,
+      const TEMMacroTable& Macros);
+    bool Indexed(const int iInstallationID) const;
+    TEMEntriesPtr Entries(const int iInstallationID) const;
+    const TEMUsageList& FindFileName(const TEMPath& FileName) const;
+    const TEMUsageList& FindFileName(const std::wstring& strFileName) const;
+    const TEMUsageList& FindPath(const std::wstring& strExpandedFileName) const;
+    size_t Count() const { return FInstallations.size(); };
+    void Clear();
+};
+
+#endif
+
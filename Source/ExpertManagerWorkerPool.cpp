@@ -0,0 +1,177 @@
+#pragma hdrstop
+
+#include "ExpertManagerWorkerPool.h"
+#include "ExpertManagerTrace.h"
+#include "ExpertManagerStrings.h"
+#include <exception>
+
+#pragma package(smart_init)
+
+/**
+
+  This is the constructor for the worker pool class.
+
+  @precon  None.
+  @postcon Starts the given number of worker threads or one per core if zero.
+
+  @param   iThreads as a size_t
+
+**/
+TEMWorkerPool::TEMWorkerPool(size_t iThreads) : FNextQueue(0), FFailures(0), FQueued(0),
+  FTerminated(false) {
+  if (iThreads == 0)
+    iThreads = std::thread::hardware_concurrency();
+  if (iThreads == 0)
+    iThreads = 1;
+  for (size_t i = 0; i < iThreads; i++)
+    FQueues.push_back(std::unique_ptr<TEMWorkerQueue>(new TEMWorkerQueue()));
+  for (size_t i = 0; i < iThreads; i++)
+    FThreads.push_back(std::thread(&TEMWorkerPool::Execute, this, i));
+}
+
+/**
+
+  This is the destructor for the worker pool class.
+
+  @precon  None.
+  @postcon Signals the workers to terminate (abandoning any queued jobs) and waits for them to
+           finish their current job.
+
+**/
+TEMWorkerPool::~TEMWorkerPool() {
+  {
+    std::lock_guard<std::mutex> Lock(FLock);
+    FTerminated = true;
+  }
+  FWakeUp.notify_all();
+  for (size_t i = 0; i < FThreads.size(); i++)
+    FThreads[i].join();
+}
+
+/**
+
+  This method queues a job on the next worker in turn (or on the shared low priority queue). If
+  the job raises an exception the optional failure function is called with its message so that
+  the job's owner can still account for it (e.g. post a result for the installation the job was
+  validating).
+
+  @precon  None.
+  @postcon The job is queued and a sleeping worker is woken.
+
+  @param   Job       as a TEMJob as a constant reference
+  @param   Failed    as a TEMJobFailed as a constant reference
+  @param   ePriority as a TEMJobPriority as a constant
+
+**/
+void TEMWorkerPool::Submit(const TEMJob& Job, const TEMJobFailed& Failed,
+  const TEMJobPriority ePriority) {
+  TEMWorkerQueue& Queue = ePriority == jpLow ? FLowQueue :
+    *FQueues[FNextQueue++ % FQueues.size()];
+  {
+    std::lock_guard<std::mutex> Lock(Queue.Lock);
+    Queue.Jobs.push_back(std::make_pair(Job, Failed));
+  }
+  {
+    std::lock_guard<std::mutex> Lock(FLock);
+    FQueued++;
+  }
+  FWakeUp.notify_one();
+}
+
+/**
+
+  This method takes the most recent job from the workers own queue or failing that steals the
+  oldest job from another worker's queue or failing that takes the oldest low priority job.
+
+  @precon  None.
+  @postcon Returns true with the job if one was found.
+
+  @param   iWorker as a size_t as a constant
+  @param   Job     as a std::pair<TEMJob, TEMJobFailed> as a reference
+  @return  a bool
+
+**/
+bool TEMWorkerPool::TakeJob(const size_t iWorker, std::pair<TEMJob, TEMJobFailed>& Job) {
+  for (size_t i = 0; i < FQueues.size(); i++) {
+    TEMWorkerQueue& Queue = *FQueues[(iWorker + i) % FQueues.size()];
+    std::lock_guard<std::mutex> Lock(Queue.Lock);
+    if (!Queue.Jobs.empty()) {
+      if (i == 0) {
+        Job = Queue.Jobs.back();
+        Queue.Jobs.pop_back();
+      } else {
+        Job = Queue.Jobs.front();
+        Queue.Jobs.pop_front();
+      }
+      return true;
+    }
+  }
+  std::lock_guard<std::mutex> Lock(FLowQueue.Lock);
+  if (FLowQueue.Jobs.empty())
+    return false;
+  Job = FLowQueue.Jobs.front();
+  FLowQueue.Jobs.pop_front();
+  return true;
+}
+
+/**
+
+  This method runs the given job. An exception raised by the job is counted, recorded as a trace
+  span and passed to the job's failure function (if any) so that the worker survives and the
+  job's owner still hears of it. An exception raised by the failure function itself is only
+  counted.
+
+  @precon  None.
+  @postcon The job has been run or its failure has been reported.
+
+  @param   Job as a std::pair<TEMJob, TEMJobFailed> as a constant reference
+
+**/
+void TEMWorkerPool::Run(const std::pair<TEMJob, TEMJobFailed>& Job) {
+  std::string strMessage;
+  try {
+    Job.first();
+    return;
+  } catch (std::exception& E) {
+    strMessage = E.what();
+  } catch (...) {
+    strMessage = "Unknown exception";
+  }
+  FFailures++;
+  TEMTraceSpan Span("WorkerPool.JobFailed", EMUTF8ToWide(strMessage.c_str(), strMessage.length()));
+  if (Job.second)
+    try {
+      Job.second(strMessage);
+    } catch (...) {
+      FFailures++;
+    }
+}
+
+/**
+
+  This is the main loop of each worker thread.
+
+  @precon  None.
+  @postcon Runs jobs until the pool is terminated.
+
+  @param   iWorker as a size_t as a constant
+
+**/
+void TEMWorkerPool::Execute(const size_t iWorker) {
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> Lock(FLock);
+      FWakeUp.wait(Lock, [this]() { return FQueued > 0 || FTerminated; });
+      if (FTerminated)
+        return;
+    }
+    std::pair<TEMJob, TEMJobFailed> Job;
+    if (TakeJob(iWorker, Job)) {
+      {
+        std::lock_guard<std::mutex> Lock(FLock);
+        FQueued--;
+      }
+      Run(Job);
+    }
+  }
+}
@@ -0,0 +1,123 @@
+#ifndef ExpertManagerWorkerPoolH
+#define ExpertManagerWorkerPoolH
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+/** A simplified type for a job to be run on the worker pool. **/
+typedef std::function<void()> TEMJob;
+/** A simplified type for a function which is called (on the worker thread) with the message of
+    the exception raised by a job so that the job's owner still receives an outcome. **/
+typedef std::function<void(const std::string& strMessage)> TEMJobFailed;
+/** An enumerate to define the priority of a job: low priority jobs (e.g. revalidating cached
+    results) are only run when there are no normal priority jobs waiting. **/
+enum TEMJobPriority {jpNormal, jpLow};
+
+/** This class manages a fixed number of worker threads (by default one per core) each with its own
+    queue of jobs. Idle workers steal jobs from the other workers queues so that uneven jobs
+    (installations with many or few entries) still keep all the cores busy. Low priority jobs are
+    kept in a single shared queue which is only taken from when the workers' queues are empty. **/
+class TEMWorkerPool {
+  private:
+    /** A record to hold the job queue of a single worker thread. **/
+    struct TEMWorkerQueue {
+      std::mutex                                Lock;
+      std::deque<std::pair<TEMJob, TEMJobFailed>> Jobs;
+    };
+    std::vector<std::thread>                     FThreads;
+    std::vector<std::unique_ptr<TEMWorkerQueue>> FQueues;
+    TEMWorkerQueue                               FLowQueue;
+    std::mutex                                   FLock;
+    std::condition_variable                      FWakeUp;
+    std::atomic<size_t>                          FNextQueue;
+    std::atomic<size_t>                          FFailures;
+    size_t                                       FQueued;
+    bool                                         FTerminated;
+    bool TakeJob(const size_t iWorker, std::pair<TEMJob, TEMJobFailed>& Job);
+    void Run(const std::pair<TEMJob, TEMJobFailed>& Job);
+    void Execute(const size_t iWorker);
+  public:
+    TEMWorkerPool(size_t iThreads = 0);
+    ~TEMWorkerPool();
+    void Submit(const TEMJob& Job, const TEMJobFailed& Failed = TEMJobFailed(),
+      const TEMJobPriority ePriority = jpNormal);
+    size_t ThreadCount() const { return FThreads.size(); };
+    size_t Failures() const { return FFailures; };
+};
+
+/** A token shared between the user interface and queued jobs so that outstanding work can be
+    abandoned (e.g. when the application closes or a rescan is started). **/
+class TEMCancelToken {
+  private:
+    std::atomic<bool> FCancelled;
+  public:
+    TEMCancelToken() : FCancelled(false) {};
+    void Cancel() { FCancelled = true; };
+    bool Cancelled() const { return FCancelled; };
+};
+
+/** A simplified type for a shared cancel token. **/
+typedef std::shared_ptr<TEMCancelToken> TEMCancelTokenPtr;
+
+/** A thread safe queue into which workers push plain result records for the user interface
+    thread to drain and merge. **/
+template <class T>
+class TEMResultQueue {
+  private:
+    std::mutex              FLock;
+    std::condition_variable FReady;
+    std::vector<T>          FItems;
+  public:
+    /**
+
+      This method adds a result to the queue and wakes any waiting thread. The waiting thread is
+      woken while the lock is held so that the queue is not touched once the consumer can see the
+      result (and may destroy the queue).
+
+      @precon  None.
+      @postcon The result is queued and true is returned if the queue was empty (i.e. the consumer
+               needs to be notified).
+
+      @param   Item as a T as a constant reference
+      @return  a bool
+
+    **/
+    bool Push(const T& Item) {
+      std::lock_guard<std::mutex> Lock(FLock);
+      bool boolWasEmpty = FItems.empty();
+      FItems.push_back(Item);
+      FReady.notify_all();
+      return boolWasEmpty;
+    };
+    /**
+
+      This method waits up to the given time for results and moves all the queued results into the
+      given vector.
+
+      @precon  None.
+      @postcon Items contains the drained results and true is returned if there were any.
+
+      @param   Items       as a std::vector<T> as a reference
+      @param   iTimeoutMS  as an int as a constant
+      @return  a bool
+
+    **/
+    bool Drain(std::vector<T>& Items, const int iTimeoutMS) {
+      std::unique_lock<std::mutex> Lock(FLock);
+      if (FItems.empty() && iTimeoutMS > 0)
+        FReady.wait_for(Lock, std::chrono::milliseconds(iTimeoutMS));
+      Items.clear();
+      Items.swap(FItems);
+      return !Items.empty();
+    };
+};
+
+#endif
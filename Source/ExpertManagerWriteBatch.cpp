@@ -0,0 +1,248 @@
+#pragma hdrstop
+
+#include "ExpertManagerWriteBatch.h"
+#include "ExpertManagerGlobals.h"
+#include <unordered_map>
+#include <unordered_set>
+
+#pragma package(smart_init)
+
+/**
+
+  This method queues a write of the named string value to the given key.
+
+  @precon  None.
+  @postcon The write is queued.
+
+  @param   strKey   as a std::wstring as a constant reference
+  @param   strName  as a std::wstring as a constant reference
+  @param   strValue as a std::wstring as a constant reference
+
+**/
+void TEMRegistryWriteBatch::WriteString(const std::wstring& strKey, const std::wstring& strName,
+  const std::wstring& strValue) {
+  TEMRegMutation Mutation = {false, EMKeyPath(strKey), strName, strValue};
+  FMutations.push_back(Mutation);
+}
+
+/**
+
+  This method queues a delete of the named value from the given key.
+
+  @precon  None.
+  @postcon The delete is queued.
+
+  @param   strKey  as a std::wstring as a constant reference
+  @param   strName as a std::wstring as a constant reference
+
+**/
+void TEMRegistryWriteBatch::DeleteValue(const std::wstring& strKey, const std::wstring& strName) {
+  TEMRegMutation Mutation = {true, EMKeyPath(strKey), strName, L""};
+  FMutations.push_back(Mutation);
+}
+
+/**
+
+  This method discards all the queued mutations.
+
+  @precon  None.
+  @postcon The batch is empty.
+
+**/
+void TEMRegistryWriteBatch::Clear() {
+  FMutations.clear();
+}
+
+/**
+
+  This function returns the outermost key of the given path which does not exist (i.e. the key
+  that opening the path with create would add).
+
+  @precon  None.
+  @postcon Returns the path of the missing key or an empty string if the key exists.
+
+  @param   Store  as a TEMRegistryStore as a reference
+  @param   strKey as a std::wstring as a constant reference
+  @return  a std::wstring
+
+**/
+static std::wstring MissingKey(TEMRegistryStore& Store, const std::wstring& strKey) {
+  TEMNameList Parts;
+  EMSplitPath(strKey, Parts);
+  std::wstring strPath;
+  unsigned long long iWriteTime = 0;
+  for (size_t i = 0; i < Parts.size(); i++) {
+    if (i > 0)
+      strPath += L'\\';
+    strPath += Parts[i];
+    if (!Store.KeyWriteTime(strPath, iWriteTime))
+      return strPath;
+  }
+  return L"";
+}
+
+/**
+
+  This method restores the values recorded in the undo log (with their original types and data)
+  and deletes the keys the batch created in reverse order.
+
+  @precon  None.
+  @postcon The values and keys are restored as far as possible.
+
+  @param   Store as a TEMRegistryStore as a reference
+  @param   Undo  as a std::vector<TEMRegUndo> as a constant reference
+
+**/
+void TEMRegistryWriteBatch::Rollback(TEMRegistryStore& Store, const std::vector<TEMRegUndo>& Undo) {
+  for (size_t i = Undo.size(); i > 0; i--) {
+    const TEMRegUndo& Value = Undo[i - 1];
+    if (Value.boolCreatedKey) {
+      Store.CloseKey();
+      Store.DeleteKey(Value.strKey);
+      continue;
+    }
+    if (!Store.OpenKey(Value.strKey, Value.boolExisted))
+      continue;
+    if (Value.boolExisted)
+      Store.WriteRawValue(Value.strName, Value.Raw);
+    else
+      Store.DeleteValue(Value.strName);
+  }
+  Store.CloseKey();
+}
+
+/**
+
+  This method applies the queued mutations to the given store. The mutations are grouped by key
+  (in the order that each key was first used and keeping the order of the mutations within each
+  key) so that each key is opened once. The previous type and data of each value is recorded before
+  it is first changed, as is the outermost key that opening a key creates, and if any mutation
+  fails those values are restored and those keys are deleted. Deletes from keys that do not exist
+  are ignored.
+
+  @precon  None.
+  @postcon Returns true and empties the batch if all the mutations were applied else returns false
+           with the store as it was before and the batch unchanged.
+
+  @param   Store as a TEMRegistryStore as a reference
+  @return  a bool
+
+**/
+bool TEMRegistryWriteBatch::Apply(TEMRegistryStore& Store) {
+  std::vector<std::wstring> Keys;
+  std::unordered_map<std::wstring, std::vector<size_t> > Groups;
+  for (size_t i = 0; i < FMutations.size(); i++) {
+    std::wstring strFolded = EMFoldCase(FMutations[i].strKey);
+    std::vector<size_t>& Group = Groups[strFolded];
+    if (Group.empty())
+      Keys.push_back(strFolded);
+    Group.push_back(i);
+  }
+  std::vector<TEMRegUndo> Undo;
+  for (size_t k = 0; k < Keys.size(); k++) {
+    const std::vector<size_t>& Group = Groups[Keys[k]];
+    bool boolCreate = false;
+    for (size_t i = 0; i < Group.size(); i++)
+      boolCreate = boolCreate || !FMutations[Group[i]].boolDelete;
+    if (boolCreate) {
+      TEMRegUndo Created = {MissingKey(Store, FMutations[Group[0]].strKey), L"", true, false,
+        TEMRegRawValue()};
+      if (!Created.strKey.empty())
+        Undo.push_back(Created);
+    }
+    if (!Store.OpenKey(FMutations[Group[0]].strKey, boolCreate)) {
+      if (!boolCreate)
+        continue;
+      Rollback(Store, Undo);
+      return false;
+    }
+    std::unordered_set<std::wstring> Recorded;
+    for (size_t i = 0; i < Group.size(); i++) {
+      const TEMRegMutation& Mutation = FMutations[Group[i]];
+      if (Recorded.insert(EMFoldCase(Mutation.strName)).second) {
+        TEMRegUndo Value;
+        Value.strKey = Mutation.strKey;
+        Value.strName = Mutation.strName;
+        Value.boolCreatedKey = false;
+        Value.boolExisted = Store.ReadRawValue(Mutation.strName, Value.Raw);
+        Undo.push_back(Value);
+      }
+      bool boolSuccess = Mutation.boolDelete ? Store.DeleteValue(Mutation.strName) :
+        Store.WriteValue(Mutation.strName, Mutation.strValue);
+      if (!boolSuccess) {
+        Rollback(Store, Undo);
+        return false;
+      }
+    }
+  }
+  Store.CloseKey();
+  FMutations.clear();
+  return true;
+}
+
+/**
+
+  This method returns the key that the given entry is stored in beneath the given installation.
+
+  @precon  None.
+  @postcon Returns the entry's key.
+
+  @param   strRegPath as a std::wstring as a constant reference
+  @param   Entry      as a TEMEntry as a constant reference
+  @return  a std::wstring
+
+**/
+static std::wstring EntryKey(const std::wstring& strRegPath, const TEMEntry& Entry) {
+  std::wstring strKey = EMKeyPath(strRegPath) + L'\\';
+  switch (Entry.eSection) {
+    case esExperts:
+      return strKey + (Entry.boolEnabled ? strExperts : strDisabledExperts);
+    case esKnownIDEPackages:
+      return strKey + strKnownIDEPackages;
+    default:
+      return strKey + strKnownPackages;
+  }
+}
+
+/**
+
+  This method queues the write of the given entry to the installation at the given registry path.
+  Experts are written as Name=FileName to the Experts key (or Experts\Disabled if disabled) and
+  packages as FileName=Description to their key with a double underscore prefixed to the
+  description if disabled.
+
+  @precon  None.
+  @postcon The write is queued.
+
+  @param   Batch      as a TEMRegistryWriteBatch as a reference
+  @param   strRegPath as a std::wstring as a constant reference
+  @param   Entry      as a TEMEntry as a constant reference
+
+**/
+void EMWriteEntry(TEMRegistryWriteBatch& Batch, const std::wstring& strRegPath,
+  const TEMEntry& Entry) {
+  if (Entry.eSection == esExperts)
+    Batch.WriteString(EntryKey(strRegPath, Entry), Entry.Name.Text(), Entry.FileName.Text());
+  else
+    Batch.WriteString(EntryKey(strRegPath, Entry), Entry.FileName.Text(),
+      Entry.boolEnabled ? Entry.Name.Text() : L"__" + Entry.Name.Text());
+}
+
+/**
+
+  This method queues the delete of the given entry from the installation at the given registry
+  path.
+
+  @precon  None.
+  @postcon The delete is queued.
+
+  @param   Batch      as a TEMRegistryWriteBatch as a reference
+  @param   strRegPath as a std::wstring as a constant reference
+  @param   Entry      as a TEMEntry as a constant reference
+
+**/
+void EMDeleteEntry(TEMRegistryWriteBatch& Batch, const std::wstring& strRegPath,
+  const TEMEntry& Entry) {
+  Batch.DeleteValue(EntryKey(strRegPath, Entry), Entry.eSection == esExperts ? Entry.Name.Text() :
+    Entry.FileName.Text());
+}
@@ -0,0 +1,47 @@
+#ifndef ExpertManagerWriteBatchH
+#define ExpertManagerWriteBatchH
+
+#include "ExpertManagerRegistryStore.h"
+#include "ExpertManagerEntries.h"
+#include <string>
+#include <vector>
+
+/** This class collects registry value writes and deletes across any number of keys and applies
+    them in a single pass opening each key once. If any mutation fails the values that have
+    already been changed are restored (with their original types) and the keys the batch created
+    are deleted so that the batch is applied completely or not at all. **/
+class TEMRegistryWriteBatch {
+  private:
+    /** A record to describe a single queued mutation. **/
+    struct TEMRegMutation {
+      bool         boolDelete;
+      std::wstring strKey;
+      std::wstring strName;
+      std::wstring strValue;
+    };
+    /** A record of the type and data of a registry value before the batch changed it or of a key
+        which the batch created (boolCreatedKey). **/
+    struct TEMRegUndo {
+      std::wstring   strKey;
+      std::wstring   strName;
+      bool           boolCreatedKey;
+      bool           boolExisted;
+      TEMRegRawValue Raw;
+    };
+    std::vector<TEMRegMutation> FMutations;
+    static void Rollback(TEMRegistryStore& Store, const std::vector<TEMRegUndo>& Undo);
+  public:
+    void WriteString(const std::wstring& strKey, const std::wstring& strName,
+      const std::wstring& strValue);
+    void DeleteValue(const std::wstring& strKey, const std::wstring& strName);
+    size_t Count() const { return FMutations.size(); };
+    void Clear();
+    bool Apply(TEMRegistryStore& Store);
+};
+
+void EMWriteEntry(TEMRegistryWriteBatch& Batch, const std::wstring& strRegPath,
+  const TEMEntry& Entry);
+void EMDeleteEntry(TEMRegistryWriteBatch& Batch, const std::wstring& strRegPath,
+  const TEMEntry& Entry);
+
+#endif
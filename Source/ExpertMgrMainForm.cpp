@@ -1,8 +1,6 @@
 /**
 
-  @todo Consider replacing the list veiws and treeview with TVirtualStringTree instances.
-  @todo Or instead of the above maintain the lists in the background and sync them with the listview
-        so the listviews do not need rendering for each change.
+  @todo Consider replacing the treeview with a TVirtualStringTree instance.
 
 **/
 #include <vcl.h>
@@ -12,8 +10,10 @@
 #include "sstream"
 #include <ExpertEditorForm.h>
 #include <ExpertManagerGlobals.h>
-#include <regex>
+#include <algorithm>
 #include "ExpertManagerTypes.h"
+#include "ExpertManagerTrace.h"
+#include <System.IOUtils.hpp>
 
 #pragma package(smart_init)
 #pragma resource "*.dfm"
@@ -57,11 +57,15 @@ void __fastcall TfrmExpertManager::LoadSettings() {
     lvKnownPackages->Columns->Items[0]->Width);
   pagPages->ActivePageIndex = iniFile->ReadInteger(strSetup, strFocusedPage, pagPages->ActivePageIndex);
   FSelectedNodePath = iniFile->ReadString(strSetup, strSelectedNode, "");
+  FLazyValidation = iniFile->ReadBool(strSetup, strLazyValidation, false);
+  actLazyValidation->Checked = FLazyValidation;
 }
 
 /**
 
   This method searches the treeview for the given selected node and if found selects that node.
+  Installation nodes are found from the installation index and other nodes by descending the tree
+  along the path rather than converting every node to a path.
 
   @precon  None.
   @postcon The given node is selected if found in the treeview.
@@ -70,14 +74,11 @@ void __fastcall TfrmExpertManager::LoadSettings() {
 
 **/
 void __fastcall TfrmExpertManager::SelectTreeViewNode(const String strSelectedPath) {
-  for (int iNode = 0; iNode < tvExpertInstallations->Items->Count; iNode++) {
-    String strNodePath = FExpandedNodeManager->ConvertNodeToPath(
-      tvExpertInstallations->Items->Item[iNode]);
-    if (strSelectedPath.Compare(strNodePath) == 0) {
-      tvExpertInstallations->Selected = tvExpertInstallations->Items->Item[iNode];
-      return;
-    }
-  }
+  TTreeNode* Node = FindInstallationNode(String("Software\\" + strSelectedPath).c_str());
+  if (Node == NULL)
+    Node = TExpandedNodeManager::FindNode(tvExpertInstallations->Items, strSelectedPath);
+  if (Node != NULL)
+    tvExpertInstallations->Selected = Node;
 };
 
 /**
@@ -101,37 +102,54 @@ void __fastcall TfrmExpertManager::SaveSettings() {
   iniFile->WriteInteger(strSetup, strFocusedPage, pagPages->ActivePageIndex);
   iniFile->WriteString(strSetup, strSelectedNode,
     FExpandedNodeManager->ConvertNodeToPath(tvExpertInstallations->Selected));
+  iniFile->WriteBool(strSetup, strLazyValidation, FLazyValidation);
 }
 
 /**
 
   This method starts the process of searching for registry installations of RAD Studio
-  starting with Borland, Codegear and finally Embarcadero.
+  starting with Borland, Codegear and finally Embarcadero. The three registry nodes are read once
+  into a snapshot and all subsequent registry reads come from that snapshot. The tree structure is
+  built first, the registry keys of the roots and installations are watched for changes and then
+  the installations are validated in the background (any scan already in progress is cancelled).
 
   @precon  None.
   @postcon Each of the three regsitry nodes is searched for expert installations.
 
+  @param   boolUseCache as a bool as a constant
+
 **/
-void __fastcall TfrmExpertManager::IterateExpertInstallations() {
+void __fastcall TfrmExpertManager::IterateExpertInstallations(const bool boolUseCache) {
   tvExpertInstallations->Items->BeginUpdate();
   try {
     const String strInstallationRoots[3] = { L"Borland", L"CodeGear", L"Embarcadero"};
+    CancelScan();
+    FFileSystem->Invalidate();
+    FStaleInstallations.clear();
     tvExpertInstallations->Items->Clear();
+    FIteration = 1;
     FProgressMgr->Show(3, "Please Wait...");
     try {
+      TEMNameList Roots;
+      for (auto strInstallation : strInstallationRoots)
+        Roots.push_back(String("Software\\" + strInstallation).c_str());
+      FSnapshot = TEMRegistrySnapshot::Create(*FRegistryStore, Roots,
+        TEMRegistrySnapshot::InstallationFilter);
       for (auto strInstallation : strInstallationRoots) {
         FProgressMgr->Update(FIteration, 0, 3, "Searching: " + strInstallation + "...");
         TTreeNode* N = tvExpertInstallations->Items->AddChild(NULL, strInstallation.c_str());
         IterateSubInstallations(N, strInstallation);
-        SetExpandedNodes(N);
+        SetExpandedNodes(N, "");
         FIteration++;
       }
+      WatchInstallations(Roots);
     } __finally {
       FProgressMgr->Hide();
     }
   } __finally {
     tvExpertInstallations->Items->EndUpdate();
   }
+  ScanInstallations(boolUseCache);
 }
 
 /**
@@ -149,140 +167,513 @@ void __fastcall TfrmExpertManager::IterateExpertInstallations() {
 **/
 void __fastcall TfrmExpertManager::IterateSubInstallations(TTreeNode *Node,
   String strRootInstallation) {
-  std::unique_ptr<TRegistryINIFileCls> iniFile( new TRegistryINIFileCls(L"Software\\" +
-    strRootInstallation + "\\") );
-  std::unique_ptr<TStringList> sl( new TStringList() );
-  iniFile->ReadSections(sl.get());
+  TEMNameList Sections;
+  FSnapshot->ReadSections(String(L"Software\\" + strRootInstallation + "\\").c_str(), Sections);
   TTreeNode *N = NULL;
-  for (int i = 0; i < sl->Count; i++) {
-    String strKey = "Software\\" + strRootInstallation + "\\" + sl->Strings[i] + "\\";
-    FProgressMgr->Update(FIteration, i, sl->Count, strKey);
-    N = tvExpertInstallations->Items->AddChild(Node, sl->Strings[i]);
+  int iCount = Sections.size();
+  for (int i = 0; i < iCount; i++) {
+    String strSection = Sections[i].c_str();
+    String strKey = "Software\\" + strRootInstallation + "\\" + strSection + "\\";
+    FProgressMgr->Update(FIteration, i, iCount, strKey);
+    N = tvExpertInstallations->Items->AddChild(Node, strSection);
     IterateVersions(N, strKey);
     if (N->Count == 0)
       N->Delete();
-    FProgressMgr->Update(FIteration, i + 1, sl->Count, strKey);
+    FProgressMgr->Update(FIteration, i + 1, iCount, strKey);
   }
 }
 
 /**
 
   This method iterates the next level down looking for a decimal number denoting the
-  version of RAD Studio and if found searches for expert installations.
+  version of RAD Studio and if found adds a node for the installation to the list of nodes
+  to be validated. Each installation is given an ID in the installation index which is also
+  its index in the list of pending nodes.
 
   @precon  Node must be a valid instance.
-  @postcon If a decimal number is found at the next level down the expert installations
-           are iterated and checked and the nodes data value asigned an enumerate
-           according to their state.
+  @postcon If a decimal number is found at the next level down a node is added for the
+           installation, indexed and queued for validation.
 
   @param   Node as a TTreeNode
   @param   strSubSection as a String
 
 **/
 void __fastcall TfrmExpertManager::IterateVersions(TTreeNode *Node, String strSubSection) {
-  std::unique_ptr<TRegistryINIFileCls> iniFile( new TRegistryINIFileCls(strSubSection) );
-  std::unique_ptr<TStringList> sl( new TStringList() );
-  iniFile->ReadSections(sl.get());
+  TEMNameList Sections;
+  FSnapshot->ReadSections(strSubSection.c_str(), Sections);
   TTreeNode *N = NULL;
-  for (int i = 0; i < sl->Count; i++) {
-    String strVersion = sl->Strings[i];
-    std::wregex VersionNumPattern(L"\\d+.\\d");
-    if (std::regex_match(strVersion.c_str(), VersionNumPattern)) {
+  for (size_t i = 0; i < Sections.size(); i++) {
+    String strVersion = Sections[i].c_str();
+    if (EMIsInstallationVersion(strVersion.c_str())) {
       N = tvExpertInstallations->Items->AddChild(Node, strVersion);
-      UpdateTreeViewStatus(N, false);
+      FInstallationIDs[N] = FInstallations.Add(String(strSubSection + strVersion + "\\").c_str());
+      FPendingNodes.push_back(N);
     }
   }
 }
 
 /**
 
-  This method checks the given node for expert installations and returns an enumerate
-  depending on their state. If any experts have invalid paths then evInvalidPaths. If any
-  two or more experts have the same filename (not path) then the function returns
-  evDuplicates.
+  This method starts validating the installation nodes queued by IterateVersions in the
+  background. Each installation is validated as an independent job on the worker pool which
+  produces a plain result record and posts a message to the form so that only this (the VCL)
+  thread updates the tree nodes with the results as they arrive. If the cache is to be used the
+  installations whose registry keys have not been written to since they were cached are given
+  their cached status straight away and a low priority job restores their cached entries (or
+  rescans them if the directories their validation depends upon have changed) so that the cached
+  status is replaced once it has been confirmed. When validating lazily only the other
+  installations whose nodes are visible are queued now and the rest are queued as their parents
+  are expanded.
 
-  @precon  Node must be a valid instance.
-  @postcon Returns the collective state of the experts.
+  @precon  None.
+  @postcon The validation jobs are queued and the method returns immediately.
 
-  @param   Node as a TTreeNode
-  @param   strSubSection as a String
-  @return  a TExpertValidation
+  @param   boolUseCache as a bool as a constant
 
 **/
-TExpertValidation __fastcall TfrmExpertManager::CheckExperts(TTreeNode* Node, String strSubSection) {
-  TExpertValidation iExpertValidation = evOkay;
-  std::unique_ptr<TRegistryINIFileCls> iniFile( new TRegistryINIFileCls(strSubSection) );
-  std::unique_ptr<TStringList> sl( new TStringList() );
-  iniFile->ReadSection(strKnownIDEPackages, sl.get());
-  if (sl->Count > 0)
-    iExpertValidation = evOkay;
-  std::unique_ptr<TStringList> slDuplicates( new TStringList() );
-  GetCurrentRADStudioMacros(strSubSection);
-  sl->Clear();
-  iniFile->ReadSection(strExperts, sl.get());
-  for (int i = 0; i < sl->Count; i++) {
-    String strFullFileName = iniFile->ReadString(strExperts, sl->Strings[i], "");
-    String strFileName = ExtractFileName(strFullFileName);
-    if (!FileExists(ExpandRADStudioMacros(strFullFileName)) && iExpertValidation == evOkay)
-      iExpertValidation = evInvalidPaths;
-    if (slDuplicates->IndexOf(strFileName) != -1) {
-      iExpertValidation = evDuplication;
-      break;
-    } else
-      slDuplicates->Add(strFileName);
+void __fastcall TfrmExpertManager::ScanInstallations(const bool boolUseCache) {
+  FScanner = std::shared_ptr<TEMInstallationScanner>(new TEMInstallationScanner(FSnapshot,
+    *FFileSystem, *FMacroCache, FModuleCache.get()));
+  FScanResults = std::shared_ptr<TEMResultQueue<TEMInstallationResult> >(
+    new TEMResultQueue<TEMInstallationResult>());
+  FScanCancelToken = TEMCancelTokenPtr(new TEMCancelToken());
+  int iCount = FPendingNodes.size();
+  TEMNameList Installations;
+  FPendingStamps.resize(iCount);
+  FQueuedNodes.assign(iCount, false);
+  FProvisionalNodes.assign(iCount, false);
+  for (int i = 0; i < iCount; i++) {
+    const std::wstring& strRegPath = FInstallations.RegPath(i);
+    Installations.push_back(strRegPath);
+    FPendingStamps[i] = EMInstallationStamp(*FRegistryStore, strRegPath);
+    const TEMScanCacheRecord* Record = FScanCache->Find(strRegPath, FPendingStamps[i]);
+    if (boolUseCache && Record != NULL) {
+      SetNodeStatus(FPendingNodes[i], Record->eValidation);
+      UpdateAncestorStatus(FPendingNodes[i]);
+      FProvisionalNodes[i] = true;
+      QueueInstallation(i, Record);
+    }
   }
-  sl->Clear();
-  iniFile->ReadSection(strDisabledExperts, sl.get());
-  for (int i = 0; i < sl->Count; i++) {
-    String strFullFileName = iniFile->ReadString(strDisabledExperts, sl->Strings[i], "");
-    String strFileName = ExtractFileName(strFullFileName);
+  QueueVisibleInstallations();
+  FScanCache->Retain(Installations);
+  tvExpertInstallations->Invalidate();
+}
+
+/**
+
+  This method queues the validation of the given pending installation node on the worker pool
+  unless it has already been queued. If a cache record is given the job restores the cached
+  entries at low priority instead of scanning the installation. If the validation raises an
+  exception a result without any entries is posted instead so that the node is not left queued.
+
+  @precon  iNode must be a valid index into FPendingNodes.
+  @postcon The installation's validation job is queued.
+
+  @param   iNode     as an int as a constant
+  @param   Record    as a TEMScanCacheRecord as a constant pointer
+  @param   ePriority as a TEMJobPriority as a constant
+
+**/
+void __fastcall TfrmExpertManager::QueueInstallation(const int iNode,
+  const TEMScanCacheRecord* Record, const TEMJobPriority ePriority) {
+  if (FQueuedNodes[iNode])
+    return;
+  FQueuedNodes[iNode] = true;
+  std::shared_ptr<TEMInstallationScanner> Scanner = FScanner;
+  std::shared_ptr<TEMResultQueue<TEMInstallationResult> > Results = FScanResults;
+  TEMCancelTokenPtr CancelToken = FScanCancelToken;
+  HWND hWnd = Handle;
+  std::wstring strRegPath = FInstallations.RegPath(iNode);
+  std::shared_ptr<TEMScanCacheRecord> Cached;
+  if (Record != NULL)
+    Cached = std::shared_ptr<TEMScanCacheRecord>(new TEMScanCacheRecord(*Record));
+  FWorkerPool->Submit([Scanner, Results, CancelToken, hWnd, iNode, strRegPath, Cached]() {
+    if (CancelToken->Cancelled())
+      return;
+    TEMInstallationResult Result = Cached ? EMRestoreInstallation(*Scanner, *Cached) :
+      Scanner->Scan(strRegPath);
+    Result.iID = iNode;
+    if (!CancelToken->Cancelled() && Results->Push(Result))
+      PostMessage(hWnd, WM_EMSCANRESULT, 0, 0);
+  }, [Results, CancelToken, hWnd, iNode, strRegPath](const std::string&) {
+    TEMInstallationResult Result;
+    Result.iID = iNode;
+    Result.strRegPath = strRegPath;
+    if (!CancelToken->Cancelled() && Results->Push(Result))
+      PostMessage(hWnd, WM_EMSCANRESULT, 0, 0);
+  }, Cached ? jpLow : ePriority);
+}
+
+/**
+
+  This method queues the validation of the pending installation nodes that are visible (i.e. all
+  their ancestors are expanded) or all of them if not validating lazily.
+
+  @precon  None.
+  @postcon The visible installations' validation jobs are queued.
+
+**/
+void __fastcall TfrmExpertManager::QueueVisibleInstallations() {
+  for (size_t i = 0; i < FQueuedNodes.size(); i++)
+    if (!FQueuedNodes[i] && (!FLazyValidation || FPendingNodes[i]->IsVisible))
+      QueueInstallation(i);
+}
+
+/**
+
+  This is an on expanded event handler for the tree view.
+
+  @precon  None.
+  @postcon The installations that have become visible are queued for validation.
+
+  @param   Sender as a TObject
+  @param   Node   as a TTreeNode
+
+**/
+void __fastcall TfrmExpertManager::tvExpertInstallationsExpanded(TObject *Sender, TTreeNode *Node) {
+  QueueVisibleInstallations();
+}
+
+/**
+
+  This is an on execute event handler for the Lazy Validation action.
+
+  @precon  None.
+  @postcon Lazy validation is switched on or off and if off all the pending installations are
+           queued for validation.
+
+  @param   Sender as a TObject
+
+**/
+void __fastcall TfrmExpertManager::actLazyValidationExecute(TObject *Sender) {
+  FLazyValidation = actLazyValidation->Checked;
+  QueueVisibleInstallations();
+}
+
+/**
+
+  This is an on execute event handler for the Record Trace action.
+
+  @precon  None.
+  @postcon The recording of trace spans is switched on or off. Switching it on discards any
+           previously recorded spans.
+
+  @param   Sender as a TObject
+
+**/
+void __fastcall TfrmExpertManager::actRecordTraceExecute(TObject *Sender) {
+  if (actRecordTrace->Checked)
+    TEMTrace::Clear();
+  TEMTrace::Enable(actRecordTrace->Checked);
+}
+
+/**
+
+  This is an on execute event handler for the Save Trace action.
+
+  @precon  None.
+  @postcon The recorded trace spans are saved to a Chrome trace file chosen by the user.
+
+  @param   Sender as a TObject
+
+**/
+void __fastcall TfrmExpertManager::actSaveTraceExecute(TObject *Sender) {
+  std::unique_ptr<TSaveDialog> dlgSave(new TSaveDialog(NULL));
+  dlgSave->Title = "Save Trace";
+  dlgSave->Filter = "Chrome Trace Files (*.json)|*.json";
+  dlgSave->DefaultExt = "json";
+  dlgSave->FileName = "ExpertMgrTrace.json";
+  dlgSave->Options = dlgSave->Options << ofOverwritePrompt;
+  if (dlgSave->Execute() && !TEMTrace::SaveToFile(dlgSave->FileName.c_str()))
+    throw Exception("The trace could not be written to \"" + dlgSave->FileName + "\".");
+}
+
+/**
+
+  This is an on update event handler for the Save Trace action.
+
+  @precon  None.
+  @postcon The action is only enabled when there are spans to save.
+
+  @param   Sender as a TObject
+
+**/
+void __fastcall TfrmExpertManager::actSaveTraceUpdate(TObject *Sender) {
+  actSaveTrace->Enabled = TEMTrace::Count() > 0;
+}
+
+/**
+
+  This method returns the name of the scan cache file in the user's application data folder.
+
+  @precon  None.
+  @postcon Returns the scan cache file name.
+
+  @return  a String
+
+**/
+String __fastcall TfrmExpertManager::ScanCacheFileName() {
+  return TPath::Combine(TPath::GetHomePath(), strScanCacheFile);
+}
+
+/**
+
+  This method records the given scanned installation in the scan cache against the installation's
+  current registry stamp.
+
+  @precon  Result must contain the installation's entries.
+  @postcon The installation's cache record is updated.
+
+  @param   Result as a TEMInstallationResult as a constant reference
+
+**/
+void __fastcall TfrmExpertManager::CacheInstallation(const TEMInstallationResult& Result) {
+  FScanCache->Update(EMInstallationStamp(*FRegistryStore, Result.strRegPath), Result);
+}
+
+/**
+
+  This method cancels any background scan that is in progress.
+
+  @precon  None.
+  @postcon Outstanding validation jobs are abandoned and any results not yet merged are discarded.
+           The installation and usage indexes are cleared as the tree is about to be rebuilt or
+           destroyed.
+
+**/
+void __fastcall TfrmExpertManager::CancelScan() {
+  if (FScanCancelToken)
+    FScanCancelToken->Cancel();
+  FScanCancelToken.reset();
+  FScanResults.reset();
+  FScanner.reset();
+  FPendingNodes.clear();
+  FInstallations.Clear();
+  FInstallationIDs.clear();
+  FUsageIndex.Clear();
+  FSearchIndex.Clear();
+  FUsedByRows.clear();
+  lvUsedBy->Items->Count = 0;
+  FPendingStamps.clear();
+  FQueuedNodes.clear();
+  FProvisionalNodes.clear();
+  FIndexPending = false;
+}
+
+/**
+
+  This is a message handler for the scan result message posted by the scan workers.
+
+  @precon  None.
+  @postcon The waiting results are merged into the installation nodes (unless the node has been
+           validated since, i.e. by an edit, and only shows a cached status) along with their
+           ancestors and the tree is repainted.
+           The entries of installations not yet in the usage and search indexes (or whose
+           status is provisional, i.e. restored from the cache or being revalidated) are indexed
+           (and the used by list refreshed if it is showing partial results). An
+           installation whose validation failed is no longer marked as queued so that it is
+           queued again the next time its node becomes visible.
+
+  @param   Message as a TMessage as a reference
+
+**/
+void __fastcall TfrmExpertManager::WMScanResult(TMessage& Message) {
+  std::vector<TEMInstallationResult> Items;
+  if (FScanResults && FScanResults->Drain(Items, 0)) {
+    bool boolIndexed = false;
+    for (auto Item : Items) {
+      TTreeNode* Node = FPendingNodes[Item.iID];
+      if (Item.Entries) {
+        FScanCache->Update(FPendingStamps[Item.iID], Item);
+        if (!FUsageIndex.Indexed(Item.iID) || FProvisionalNodes[Item.iID]) {
+          IndexInstallation(Item.iID, Item.Entries, *FMacroCache->Get(*FSnapshot, Item.strRegPath));
+          boolIndexed = true;
+        }
+        if ((TExpertValidation)(int)Node->Data == evNone || FProvisionalNodes[Item.iID]) {
+          SetNodeStatus(Node, Item.Validation());
+          UpdateAncestorStatus(Node);
+        }
+      } else
+        FQueuedNodes[Item.iID] = false;
+    }
+    tvExpertInstallations->Invalidate();
+    if (boolIndexed && FIndexPending)
+      edtSearchChange(NULL);
+  }
+}
+
+/**
+
+  This method watches the given company roots and the installations queued by IterateVersions for
+  changes made outside the application (e.g. by an installer or the IDE). If only changes are
+  required the notifier is left alone unless the keys to watch have changed (e.g. an installation
+  has gained an Experts key since it was last watched).
+
+  @precon  None.
+  @postcon The registry notifier watches the roots and installation keys in the snapshot.
+
+  @param   Roots           as a TEMNameList as a constant reference
+  @param   boolChangedOnly as a bool as a constant
+
+**/
+void __fastcall TfrmExpertManager::WatchInstallations(const TEMNameList& Roots,
+  const bool boolChangedOnly) {
+  TEMRegistryWatchList Watches;
+  EMInstallationWatches(Roots, FInstallations.RegPaths(), *FSnapshot, Watches);
+  if (boolChangedOnly && Watches == FWatches)
+    return;
+  FWatchedRoots = Roots;
+  FWatches = Watches;
+  FRegistryNotifier->Watch(Watches);
+}
+
+/**
+
+  This is a message handler for the registry changed message posted by the registry notifier.
+
+  @precon  None.
+  @postcon Each changed installation is re-read and revalidated. If a company root (or an unknown
+           installation) has changed the installations are rescanned. If the installation was
+           written to by this application and its keys still hold exactly what was written the
+           entries are already up to date so only the snapshot is refreshed. Any other change
+           (including one made outside the application at about the same time) is revalidated.
+
+  @param   Message as a TMessage as a reference
+
+**/
+void __fastcall TfrmExpertManager::WMRegistryChanged(TMessage& Message) {
+  std::vector<std::wstring> Paths;
+  if (!FRegistryChanges->Drain(Paths, 0))
+    return;
+  for (auto strPath : Paths)
+    if (!FindInstallationNode(strPath)) {
+      actRescanExecute(NULL);
+      return;
+    }
+  TEMNameList Changed;
+  for (auto strPath : Paths) {
+    std::unordered_map<std::wstring, size_t>::iterator Stale =
+      FStaleInstallations.find(EMFoldCase(strPath));
+    if (Stale != FStaleInstallations.end() &&
+      Stale->second == EMInstallationFingerprint(*FRegistryStore, strPath))
+      FSnapshot = FSnapshot->Refresh(*FRegistryStore, strPath);
+    else {
+      if (Stale != FStaleInstallations.end())
+        FStaleInstallations.erase(Stale);
+      Changed.push_back(strPath);
+    }
   }
-  return iExpertValidation;
+  RevalidateInstallations(Changed);
+}
+
+/**
+
+  This method marks the given installation as written to by this application. Its keys are
+  re-read into the registry snapshot the next time it is shown and the fingerprint of its keys as
+  written is kept so that the change notifications that follow are only ignored while the
+  registry still holds exactly what was written.
+
+  @precon  None.
+  @postcon The installation is marked as stale with the fingerprint of its keys.
+
+  @param   strRegPath as a std::wstring as a constant reference
+
+**/
+void __fastcall TfrmExpertManager::MarkStale(const std::wstring& strRegPath) {
+  FStaleInstallations[EMFoldCase(strRegPath)] = EMInstallationFingerprint(*FRegistryStore,
+    strRegPath);
+}
+
+/**
+
+  This method re-reads the given installations into the snapshot and revalidates them. If the
+  selected installation is one of them the lists are reloaded. The others are scanned again on
+  the worker pool (with a scanner of the refreshed snapshot) and merged by WMScanResult, showing
+  their current status until then. The registry watches are rebuilt if the installations'
+  sections have changed.
+
+  @precon  None.
+  @postcon The selected installation's lists reflect the registry and the others are queued.
+
+  @param   RegPaths as a TEMNameList as a constant reference
+
+**/
+void __fastcall TfrmExpertManager::RevalidateInstallations(const TEMNameList& RegPaths) {
+  if (RegPaths.empty() || !FScanResults)
+    return;
+  FFileSystem->Invalidate();
+  for (size_t i = 0; i < RegPaths.size(); i++)
+    FSnapshot = FSnapshot->Refresh(*FRegistryStore, RegPaths[i]);
+  FScanner = std::shared_ptr<TEMInstallationScanner>(new TEMInstallationScanner(FSnapshot,
+    *FFileSystem, *FMacroCache, FModuleCache.get()));
+  for (size_t i = 0; i < RegPaths.size(); i++) {
+    int iNode = FInstallations.Find(RegPaths[i]);
+    if (iNode < 0)
+      continue;
+    TTreeNode* Node = FPendingNodes[iNode];
+    if (Node == tvExpertInstallations->Selected) {
+      SetNodeStatus(Node, evNone);
+      ShowExperts(Node);
+    } else {
+      FPendingStamps[iNode] = EMInstallationStamp(*FRegistryStore, RegPaths[i]);
+      FProvisionalNodes[iNode] = true;
+      FQueuedNodes[iNode] = false;
+      QueueInstallation(iNode);
+    }
+  }
+  WatchInstallations(FWatchedRoots, true);
+  tvExpertInstallations->Invalidate();
+}
+
+/**
+
+  This method returns the installation node for the given registry path or NULL if there is none.
+
+  @precon  None.
+  @postcon Returns the installation node (from the installation index) or NULL.
+
+  @param   strRegPath as a std::wstring as a constant reference
+  @return  a TTreeNode
+
+**/
+TTreeNode* __fastcall TfrmExpertManager::FindInstallationNode(const std::wstring& strRegPath) {
+  int iID = FInstallations.Find(strRegPath);
+  return iID >= 0 ? FPendingNodes[iID] : NULL;
+}
+
+/**
+
+  This method returns the installation ID of the given tree node.
+
+  @precon  None.
+  @postcon Returns the node's installation ID or -1 if it is not an installation node.
+
+  @param   Node as a TTreeNode
+  @return  an int
+
+**/
+int __fastcall TfrmExpertManager::InstallationID(TTreeNode* Node) {
+  std::unordered_map<TTreeNode*, int>::iterator Item = FInstallationIDs.find(Node);
+  return Item != FInstallationIDs.end() ? Item->second : -1;
 }
 
 /**
 
-  This method checks the given node for package installations and returns an enumerate
-  depending on their state. If any packages have invalid paths then evInvalidPaths. If any
-  two or more packages have the same filename (not path) then the function returns
-  evDuplicates.
+  This method sets the status of each ancestor of the given node to the highest status of its
+  children.
 
   @precon  Node must be a valid instance.
-  @postcon Returns the collective state of the experts.
+  @postcon The ancestor nodes statuses are updated from their children.
 
   @param   Node as a TTreeNode
-  @param   strSubSection as a String
-  @param   strPackage as a String
-  @return  a TExpertValidation
 
 **/
-TExpertValidation __fastcall TfrmExpertManager::CheckPackages(TTreeNode* Node, String strSubSection,
-  String strPackage) {
-  TExpertValidation iPackageValidation = evOkay;
-  std::unique_ptr<TRegistryINIFileCls> iniFile( new TRegistryINIFileCls(strSubSection) );
-  std::unique_ptr<TStringList> sl( new TStringList() );
-  iniFile->ReadSection(strPackage, sl.get());
-  if (sl->Count > 0)
-    iPackageValidation = evOkay;
-  std::unique_ptr<TStringList> slDuplicates( new TStringList() );
-  GetCurrentRADStudioMacros(strSubSection);
-  sl->Clear();
-  iniFile->ReadSection(strPackage, sl.get());
-  for (int i = 0; i < sl->Count; i++) {
-    String strFullFileName = sl->Strings[i];
-    String strFileName = ExtractFileName(strFullFileName);
-    String strName = iniFile->ReadString(strPackage, sl->Strings[i], "");
-    if (strName.SubString(1, 2) != "__") {
-      if (!FileExists(ExpandRADStudioMacros(strFullFileName)) && iPackageValidation == evOkay)
-        iPackageValidation = evInvalidPaths;
-      if (slDuplicates->IndexOf(strFileName) != -1) {
-        iPackageValidation = evDuplication;
-        break;
-      } else
-        slDuplicates->Add(strFileName);
-    }
+void __fastcall TfrmExpertManager::UpdateAncestorStatus(TTreeNode* Node) {
+  TTreeNode* N = Node->Parent;
+  while (N) {
+    SetNodeStatus(N, GetHighestValidation(N));
+    N = N->Parent;
   }
-  return iPackageValidation;
 }
 
 /**
@@ -298,15 +689,30 @@ TExpertValidation __fastcall TfrmExpertManager::CheckPackages(TTreeNode* Node, S
 void __fastcall TfrmExpertManager::FormCreate(TObject *Sender) {
   pagPages->ActivePageIndex = 0;
   GetVersionAndBuild();
-  FCurrentRADStudioMacros = std::unique_ptr<TStringList>( new TStringList() );
+  FCurrentMacros = TEMMacroTablePtr( new TEMMacroTable() );
   LoadSettings();
+  actRecordTrace->Checked = TEMTrace::Enabled();
   FExpandedNodeManager = std::unique_ptr<TExpandedNodeManager>( new TExpandedNodeManager() );
-  FBDSMacroRegEx = std::unique_ptr<TRegEx>( new TRegEx("\\$\\(\\w+\\)",
-    TRegExOptions() << roIgnoreCase << roCompiled << roSingleLine) );
-  FBDSPathPatternRegEx = std::unique_ptr<TRegEx>( new TRegEx(
-      "(?<Name>(Embarcadero|CodeGear|Borland)\\\\[\\w\\s]+)\\\\(?<Number>\\d+.\\d)",
-      TRegExOptions() << roIgnoreCase << roSingleLine << roCompiled << roExplicitCapture));
   FProgressMgr = std::unique_ptr<TEMProgressMgr>( new TEMProgressMgr() );
+  FRegistryStore = std::unique_ptr<TEMRegistryStore>( new TEMWinRegistryStore() );
+  FFileSystem = std::unique_ptr<TEMCachedFileSystem>(
+    new TEMCachedFileSystem(new TEMNativeFileSystem()) );
+  FMacroCache = std::unique_ptr<TEMMacroCache>( new TEMMacroCache() );
+  FModuleCache = std::unique_ptr<TEMModuleCache>( new TEMModuleCache() );
+  FWorkerPool = std::unique_ptr<TEMWorkerPool>( new TEMWorkerPool() );
+  FScanCache = std::unique_ptr<TEMScanCache>( new TEMScanCache() );
+  FScanCache->LoadFromFile(ScanCacheFileName().c_str());
+  std::shared_ptr<TEMResultQueue<std::wstring> > Changes(new TEMResultQueue<std::wstring>());
+  FRegistryChanges = Changes;
+  HWND hWnd = Handle;
+  FRegistryNotifier = TEMRegistryNotifierPtr( new TEMWinRegistryNotifier(HKEY_CURRENT_USER,
+    [Changes, hWnd](const TEMNameList& Owners) {
+      bool boolNotify = false;
+      for (size_t i = 0; i < Owners.size(); i++)
+        boolNotify = Changes->Push(Owners[i]) || boolNotify;
+      if (boolNotify)
+        PostMessage(hWnd, WM_EMREGISTRYCHANGED, 0, 0);
+    }) );
 }
 
 /**
@@ -314,20 +720,37 @@ void __fastcall TfrmExpertManager::FormCreate(TObject *Sender) {
   This is an on destroy event handler for the form.
 
   @precon  None.
-  @postcon Gets all the expanded nodes and saves them in the expanded nodes manager, then
-           frees the expanded node manager (it saves the settings to the registry) and
-           saves the applications settings.
+  @postcon Stops watching the registry, cancels any background scan, gets all the expanded
+           nodes and saves them in the expanded nodes manager, then frees the expanded node
+           manager (it saves the settings to the registry) and saves the applications settings
+           and the scan cache.
 
   @param   Sender as a TObject
 
 **/
 void __fastcall TfrmExpertManager::FormDestroy(TObject *Sender) {
+  FRegistryNotifier.reset();
+  CancelScan();
+  SaveExpandedNodes();
+  SaveSettings();
+  if (FScanCache->Modified() && ForceDirectories(ExtractFilePath(ScanCacheFileName())))
+    FScanCache->SaveToFile(ScanCacheFileName().c_str());
+}
+
+/**
+
+  This method stores the expanded state of all the nodes in the tree in the expanded node manager.
+
+  @precon  None.
+  @postcon The expanded node manager is updated for all nodes.
+
+**/
+void __fastcall TfrmExpertManager::SaveExpandedNodes() {
   TTreeNode* N = tvExpertInstallations->Items->GetFirstNode();
   while (N != NULL) {
-    GetExpandedNodes(N);
+    GetExpandedNodes(N, "");
     N = N->getNextSibling();
   }
-  SaveSettings();
 }
 
 /**
@@ -336,13 +759,14 @@ void __fastcall TfrmExpertManager::FormDestroy(TObject *Sender) {
 
   @precon  None.
   @postcon This is used in preference to OnFormCreate as the treeview renders quicker.
-           Starts the iterations of all installations of RAD Studio.
+           Starts the iterations of all installations of RAD Studio (using the scan cache for
+           the installations that have not changed since the last run).
 
   @param   Sender as a TObject
 
 **/
 void __fastcall TfrmExpertManager::FormShow(TObject *Sender) {
-  IterateExpertInstallations();
+  IterateExpertInstallations(true);
   SelectTreeViewNode(FSelectedNodePath);
 }
 
@@ -355,269 +779,625 @@ void __fastcall TfrmExpertManager::FormShow(TObject *Sender) {
            validation enumerate for all child nodes recursively and set the colour of the
            node accordingly. RED = Duplicates, GRAY = Invalid paths & BLUE is Okay.
 
-  @param   Sender      as a TCustomTreeView
-  @param   Node        as a TTreeNode
-  @param   State       as a TCustomDrawState
-  @param   Stage       as a TCustomDrawStage
-  @param   PaintImage  as a bool as a Reference
-  @param   DefaultDraw as a bool as a Reference
+  @param   Sender      as a TCustomTreeView
+  @param   Node        as a TTreeNode
+  @param   State       as a TCustomDrawState
+  @param   Stage       as a TCustomDrawStage
+  @param   PaintImage  as a bool as a Reference
+  @param   DefaultDraw as a bool as a Reference
+
+**/
+void __fastcall TfrmExpertManager::tvExpertInstallationsAdvancedCustomDrawItem(TCustomTreeView *Sender,
+          TTreeNode *Node, TCustomDrawState State, TCustomDrawStage Stage, bool &PaintImages,
+          bool &DefaultDraw) {
+  DefaultDraw = true;
+  int i = (int)Node->Data;
+  switch ((TExpertValidation)i) {
+    case evNone:
+      Sender->Canvas->Font->Color = iNoneColour;
+      break;
+    case evOkay:
+      Sender->Canvas->Font->Color = iOkayColour;
+      break;
+    case evInvalidPaths:
+      Sender->Canvas->Font->Color = iInvalidPathColour;
+      break;
+    case evDuplication:
+      Sender->Canvas->Font->Color = iDuplicateColour;
+      break;
+    case evMissingDependencies:
+      Sender->Canvas->Font->Color = iMissingDependencyColour;
+      break;
+  }
+}
+
+/**
+
+  This method iterates over all child nodes of the given node looking for the highest
+  enumerate assigned to the nodes and returns the highest enumerate to the calling
+  code. If the children are all okay but some have not been validated yet (e.g. collapsed nodes
+  when validating lazily) the node is shown as pending (evNone) rather than okay.
+
+  @precon  Node must be a valid instance.
+  @postcon Iterates over all child nodes returning the highesy assigned enumerate.
+
+  @param   Node as a TTreeNode
+  @return  a TExpertValidation
+
+**/
+TExpertValidation  __fastcall TfrmExpertManager::GetHighestValidation(TTreeNode* Node) {
+  int i = (int)Node->Data;
+  TExpertValidation iReturn = evNone;
+  bool boolPending = false;
+  TTreeNode* N = Node->getFirstChild();
+  while (N) {
+    TExpertValidation iResult = (TExpertValidation)(int)N->Data;
+    if (iResult > iReturn)
+      iReturn = iResult;
+    boolPending = boolPending || iResult == evNone;
+    N = N->getNextSibling();
+  }
+  if (iReturn == evOkay && boolPending)
+    return evNone;
+  return iReturn;
+}
+
+/**
+
+  This is an on change event handler for the tvExpertInstallations tree view.
+
+  @precon  None.
+  @postcon For a tree node with a TExpertValidation of evOkay, evInvalidPaths,
+           evDuplication, evMissingDependencies the list of installed experts for the
+           installation are rendered in the listview with duplicates coloured in red.
+
+  @param   Sender as a TObject
+  @param   Node   as a TTreeNode
+
+**/
+void __fastcall TfrmExpertManager::tvExpertInstallationsChange(TObject *Sender,
+  TTreeNode *Node) {
+  FUpdatingListView = true;
+  __try {
+    ShowExperts(Node);
+  } __finally {
+    FUpdatingListView = false;
+  }
+}
+
+/**
+
+  This method updates the list views in the tabs to contain the experts and pacakges for the selected
+  installation.
+
+  @precon  Node must be a valid instance
+  @postcon The experts and packages are listed in the listviews in the tab pages.
+
+  @param   Node as a TTreeNode
+
+**/
+void __fastcall TfrmExpertManager::ShowExperts(TTreeNode *Node) {
+  TEMTraceSpan Span("Form.ShowExperts");
+  tabExperts->ImageIndex = 1;
+  tabKnownIDEPackages->ImageIndex = 1;
+  tabKnownPackages->ImageIndex = 1;
+  if (Node) {
+    if (EMIsInstallationVersion(Node->Text.c_str())) {
+      String strSubSection = GetRegPathToNode(Node);
+      if (FStaleInstallations.erase(EMFoldCase(strSubSection.c_str())) > 0)
+        FSnapshot = FSnapshot->Refresh(*FRegistryStore, strSubSection.c_str());
+      GetCurrentRADStudioMacros(strSubSection);
+      FFileSystem->Invalidate();
+      TEMInstallationResult Result = TEMInstallationScanner(FSnapshot, *FFileSystem,
+        *FMacroCache, FModuleCache.get()).Scan(strSubSection.c_str(), *FCurrentMacros);
+      FCurrentEntries = Result.Entries;
+      if (InstallationID(Node) >= 0)
+        IndexInstallation(InstallationID(Node), FCurrentEntries, *FCurrentMacros);
+      if ((TExpertValidation)(int)Node->Data != FCurrentEntries->Validation()) {
+        SetNodeStatus(Node, FCurrentEntries->Validation());
+        UpdateAncestorStatus(Node);
+        tvExpertInstallations->Invalidate();
+      }
+      CacheInstallation(Result);
+      AddExpertsToList(lvInstalledExperts, strSubSection, *FCurrentEntries);
+      AddPackagesToList(lvKnownIDEPackages, strSubSection, *FCurrentEntries, esKnownIDEPackages);
+      AddPackagesToList(lvKnownPackages, strSubSection, *FCurrentEntries, esKnownPackages);
+      SetTabStatuses();
+    }
+  }
+}
+
+/**
+
+  This method updates the three tab sheet status images from the section validations of the
+  current installations entries.
+
+  @precon  FCurrentEntries must be a valid instance.
+  @postcon The tab sheet images are updated.
+
+**/
+void TfrmExpertManager::SetTabStatuses() {
+  SetTabStatus(tabExperts, FCurrentEntries->SectionValidation(esExperts));
+  SetTabStatus(tabKnownIDEPackages, FCurrentEntries->SectionValidation(esKnownIDEPackages));
+  SetTabStatus(tabKnownPackages, FCurrentEntries->SectionValidation(esKnownPackages));
+}
+
+/**
+
+  This method updates the given tab sheet status images based on the given status.
+
+  @precon  TabSheet must be a valid instance.
+  @postcon The tab sheet image is updated.
+
+  @param   TabSheet as a TTabSheet
+  @param   eStatus as a TExpertValidation as a constant
+
+**/
+void TfrmExpertManager::SetTabStatus(TTabSheet* TabSheet, const TExpertValidation eStatus) {
+  switch (eStatus) {
+    case evOkay:
+      TabSheet->ImageIndex = 1;
+      break;
+    case evInvalidPaths:
+      TabSheet->ImageIndex = 2;
+      break;
+    case evDuplication:
+      TabSheet->ImageIndex = 3;
+      break;
+    case evMissingDependencies:
+      TabSheet->ImageIndex = 4;
+      break;
+    default:
+      TabSheet->ImageIndex = 0;
+  }
+}
+
+/**
+
+  This function shows the enabled and disabled experts of the installation in the (virtual)
+  listview keeping the selected expert if the same installation is shown again.
+
+  @precon  None.
+  @postcon The experts of the installation are shown in the list view.
+
+  @param   lvList        as a TListView
+  @param   strSubSection as a String
+  @param   Entries       as a TEMInstallationEntries as a constant reference
+
+**/
+void __fastcall TfrmExpertManager::AddExpertsToList(TListView* lvList, String strSubSection,
+  const TEMInstallationEntries& Entries) {
+  RenderPackageList(lvList, Entries, esExperts, FLastExpertViewName, strSubSection + strExperts);
+}
+
+/**
+
+  This function adds the packages found in the passed sub section into the listview.
+
+  @precon  None.
+  @postcon The experts i the passed subs ection are added to the list view.
+
+  @param   lvList        as a TListView
+  @param   strSubSection as a String
+  @param   Entries       as a TEMInstallationEntries as a constant reference
+  @param   eSection      as a TEMSection as a constant
+
+**/
+void __fastcall TfrmExpertManager::AddPackagesToList(TListView* lvList, String strSubSection,
+  const TEMInstallationEntries& Entries, const TEMSection eSection) {
+  if (eSection == esKnownIDEPackages)
+    RenderPackageList(lvList, Entries, eSection, FLastKnownIDEPackagesViewName,
+      strSubSection + strKnownIDEPackages);
+  else
+    RenderPackageList(lvList, Entries, eSection, FLastKnownPackagesViewName,
+      strSubSection + strKnownPackages);
+}
+
+/**
+
+  This method shows the entries of the given section of the installation in the given (virtual)
+  listview control, keeping the selected item if the view has not changed. Only the IDs of the
+  section's entries are stored for the rows and the visible items are fetched from the entries in
+  the OnData event.
+
+  @precon  lvList must be a valid instance.
+  @postcon The entries of the section are shown in the listview lvList.
+
+  @param   lvList          as a TListView
+  @param   Entries         as a TEMInstallationEntries as a constant reference
+  @param   eSection        as a TEMSection as a constant
+  @param   strLastViewName as a String as a Reference
+  @param   strViewName     as a String
+
+**/
+void __fastcall TfrmExpertManager::RenderPackageList(TListView* lvList,
+  const TEMInstallationEntries& Entries, const TEMSection eSection, String &strLastViewName,
+  const String strViewName) {
+  TEMTraceSpan Span("Form.RenderList", lvList->Name.c_str());
+  int iSelected = -1;
+  GetCurrentPosition(lvList, strLastViewName, strViewName, iSelected);
+  TEMEntryIDList& Rows = ListRows(lvList);
+  Entries.Section(eSection, Rows);
+  lvList->Items->Count = Rows.size();
+  if (iSelected >= lvList->Items->Count)
+    iSelected--;
+  SetCurrentPosition(lvList, iSelected);
+  lvList->Invalidate();
+}
+
+/**
+
+  This method returns the list of entry IDs shown in the rows of the given list view.
+
+  @precon  lvList must be one of the three entry list views.
+  @postcon Returns the rows of the list view.
+
+  @param   lvList as a TListView
+  @return  a TEMEntryIDList as a reference
+
+**/
+TEMEntryIDList& __fastcall TfrmExpertManager::ListRows(TListView* lvList) {
+  if (lvList == lvKnownIDEPackages)
+    return FKnownIDEPackageRows;
+  if (lvList == lvKnownPackages)
+    return FKnownPackageRows;
+  return FExpertRows;
+}
+
+/**
+
+  This is an on data event handler for the three (virtual) entry list views which fills in the
+  requested item from its entry.
+
+  @precon  None.
+  @postcon The item is populated with the entry's name, filename and enabled state and holds the
+           entry's ID.
+
+  @param   Sender as a TObject
+  @param   Item   as a TListItem
+
+**/
+void __fastcall TfrmExpertManager::lvEntriesData(TObject *Sender, TListItem *Item) {
+  TEMTraceSpan Span("Form.ListData");
+  const TEMEntryIDList& Rows = ListRows(static_cast<TListView*>(Sender));
+  if (FCurrentEntries && Item->Index < (int)Rows.size()) {
+    const TEMEntry& Entry = FCurrentEntries->Entry(Rows[Item->Index]);
+    Item->Caption = Entry.Name.Text().c_str();
+    Item->SubItems->Add(Entry.FileName.Text().c_str());
+    Item->Checked = Entry.boolEnabled;
+    Item->Data = (void*)Rows[Item->Index];
+  }
+}
+
+/**
+
+  This method adds (or replaces) the entries of the given installation in the usage and search
+  indexes.
+
+  @precon  Entries must be a valid instance.
+  @postcon The installation's entries are indexed.
+
+  @param   iInstallationID as an int as a constant
+  @param   Entries         as a TEMEntriesPtr
+  @param   Macros          as a TEMMacroTable as a constant reference
+
+**/
+void __fastcall TfrmExpertManager::IndexInstallation(const int iInstallationID,
+  TEMEntriesPtr Entries, const TEMMacroTable& Macros) {
+  FUsageIndex.SetInstallation(iInstallationID, Entries, Macros);
+  FSearchIndex.SetInstallation(iInstallationID, *Entries, Macros);
+}
+
+/**
+
+  This method queues the installations which have not been queued yet (i.e. they are hidden while
+  validating lazily) on the worker pool at low priority so that their entries are added to the
+  usage and search indexes as their results arrive (as are those of the installations already
+  queued). Nothing is scanned on this thread.
+
+  @precon  None.
+  @postcon Returns true if every installation is in the usage and search indexes else the
+           remaining installations are queued and the used by list is refreshed as they are
+           indexed.
+
+  @return  a bool
+
+**/
+bool __fastcall TfrmExpertManager::IndexInstallations() {
+  FIndexPending = FUsageIndex.Count() < FInstallations.Count();
+  if (FIndexPending)
+    for (size_t i = 0; i < FQueuedNodes.size(); i++)
+      if (!FQueuedNodes[i])
+        QueueInstallation(i, NULL, jpLow);
+  return !FIndexPending;
+}
+
+/**
+
+  This method lists the experts and packages of every installation whose name, filename or
+  expanded filename contains the text of the search box in the used by list view (which is
+  captioned "Found In" while there is search text). Only the installations indexed so far are
+  searched and the caption says so while the others are being indexed.
+
+  @precon  None.
+  @postcon The used by list view shows the first iMaxSearchResults matches.
+
+**/
+void __fastcall TfrmExpertManager::ShowSearchResults() {
+  bool boolIndexed = IndexInstallations();
+  bool boolTruncated = FSearchIndex.Search(edtSearch->Text.c_str(), iMaxSearchResults,
+    FUsedByRows);
+  std::sort(FUsedByRows.begin(), FUsedByRows.end(), EMUsageLess);
+  lvUsedBy->Column[0]->Caption = Format("Found In (%d%s%s)",
+    ARRAYOFCONST(((int)FUsedByRows.size(), String(boolTruncated ? "+" : ""),
+    String(boolIndexed ? "" : ", indexing..."))));
+  lvUsedBy->Items->Count = FUsedByRows.size();
+  lvUsedBy->Invalidate();
+}
+
+/**
+
+  This method lists every expert and package of every installation which references a file with
+  the same filename as the selected entry of the given list in the used by list view. Only the
+  installations indexed so far are listed and the caption says so while the others are being
+  indexed. While there is search text the search results are refreshed instead.
+
+  @precon  lvList must be a valid instance.
+  @postcon The used by list view is updated (and is empty if no entry is selected).
+
+  @param   lvList as a TListView
+
+**/
+void __fastcall TfrmExpertManager::ShowUsedBy(TListView* lvList) {
+  if (edtSearch->Text.Length() != 0) {
+    ShowSearchResults();
+    return;
+  }
+  lvUsedBy->Column[0]->Caption = "Used By";
+  FIndexPending = false;
+  FUsedByRows.clear();
+  const TEMEntryIDList& Rows = ListRows(lvList);
+  TListItem* Item = lvList->Selected;
+  if (FCurrentEntries && Item != NULL && Item->Index < (int)Rows.size()) {
+    if (!IndexInstallations())
+      lvUsedBy->Column[0]->Caption = "Used By (indexing...)";
+    FUsedByRows = FUsageIndex.FindFileName(FCurrentEntries->Entry(Rows[Item->Index]).FileName);
+    std::sort(FUsedByRows.begin(), FUsedByRows.end(), EMUsageLess);
+  }
+  lvUsedBy->Items->Count = FUsedByRows.size();
+  lvUsedBy->Invalidate();
+}
+
+/**
+
+  This is an on select item event handler for the three entry list views which shows the
+  installations that use the selected entry's file.
+
+  @precon  None.
+  @postcon The used by list view is updated.
+
+  @param   Sender   as a TObject
+  @param   Item     as a TListItem
+  @param   Selected as a bool
+
+**/
+void __fastcall TfrmExpertManager::lvEntriesSelectItem(TObject *Sender, TListItem *Item,
+  bool Selected) {
+  if (!FUpdatingListView)
+    ShowUsedBy(static_cast<TListView*>(Sender));
+}
+
+/**
+
+  This is an on data event handler for the (virtual) used by list view which fills in the
+  requested item from its usage.
+
+  @precon  None.
+  @postcon The item is populated with the installation, section, name and expanded filename of
+           the entry.
+
+  @param   Sender as a TObject
+  @param   Item   as a TListItem
+
+**/
+void __fastcall TfrmExpertManager::lvUsedByData(TObject *Sender, TListItem *Item) {
+  const String strSections[3] = {"Experts", "Known IDE Packages", "Known Packages"};
+  if (Item->Index >= (int)FUsedByRows.size())
+    return;
+  const TEMUsage& Usage = FUsedByRows[Item->Index];
+  TEMEntriesPtr Entries = FUsageIndex.Entries(Usage.iInstallationID);
+  if (!Entries)
+    return;
+  const TEMEntry& Entry = Entries->Entry(Usage.iEntryID);
+  const std::wstring& strRegPath = FInstallations.RegPath(Usage.iInstallationID);
+  Item->Caption = strRegPath.c_str();
+  Item->SubItems->Add(strSections[Usage.eSection]);
+  Item->SubItems->Add(Entry.Name.Text().c_str());
+  Item->SubItems->Add(
+    FMacroCache->Get(*FSnapshot, strRegPath)->Expand(Entry.FileName.Text()).c_str());
+}
+
+/**
+
+  This is an on double click event handler for the used by list view which selects the
+  installation, tab and entry of the double clicked usage.
+
+  @precon  None.
+  @postcon The usage's entry is selected.
+
+  @param   Sender as a TObject
 
 **/
-void __fastcall TfrmExpertManager::tvExpertInstallationsAdvancedCustomDrawItem(TCustomTreeView *Sender,
-          TTreeNode *Node, TCustomDrawState State, TCustomDrawStage Stage, bool &PaintImages,
-          bool &DefaultDraw) {
-  DefaultDraw = true;
-  int i = (int)Node->Data;
-  switch ((TExpertValidation)i) {
-    case evNone:
-      Sender->Canvas->Font->Color = iNoneColour;
-      break;
-    case evOkay:
-      Sender->Canvas->Font->Color = iOkayColour;
-      break;
-    case evInvalidPaths:
-      Sender->Canvas->Font->Color = iInvalidPathColour;
-      break;
-    case evDuplication:
-      Sender->Canvas->Font->Color = iDuplicateColour;
-      break;
+void __fastcall TfrmExpertManager::lvUsedByDblClick(TObject *Sender) {
+  TListItem* Item = lvUsedBy->Selected;
+  if (Item == NULL || Item->Index >= (int)FUsedByRows.size())
+    return;
+  TEMUsage Usage = FUsedByRows[Item->Index];
+  TTabSheet* Tabs[3] = {tabExperts, tabKnownIDEPackages, tabKnownPackages};
+  TListView* Lists[3] = {lvInstalledExperts, lvKnownIDEPackages, lvKnownPackages};
+  tvExpertInstallations->Selected = FPendingNodes[Usage.iInstallationID];
+  pagPages->ActivePage = Tabs[Usage.eSection];
+  const TEMEntryIDList& Rows = ListRows(Lists[Usage.eSection]);
+  TEMEntryIDList::const_iterator Row = std::lower_bound(Rows.begin(), Rows.end(), Usage.iEntryID);
+  if (Row != Rows.end() && *Row == Usage.iEntryID) {
+    int iSelected = Row - Rows.begin();
+    Lists[Usage.eSection]->ClearSelection();
+    SetCurrentPosition(Lists[Usage.eSection], iSelected);
   }
 }
 
 /**
 
-  This method iterates over all child nodes of the given node looking for the highest
-  enumerate assigned to the nodes and returns the highest enumerate to the calling
-  code.
+  This is an on change event handler for the search box which lists the entries of all the
+  installations that match the search text as it is typed (or the used by list of the selected
+  entry when the search box is cleared).
 
-  @precon  Node must be a valid instance.
-  @postcon Iterates over all child nodes returning the highesy assigned enumerate.
+  @precon  None.
+  @postcon The used by list view is updated.
 
-  @param   Node as a TTreeNode
-  @return  a TExpertValidation
+  @param   Sender as a TObject
 
 **/
-TExpertValidation  __fastcall TfrmExpertManager::GetHighestValidation(TTreeNode* Node) {
-  int i = (int)Node->Data;
-  TExpertValidation iReturn = evNone;
-  TTreeNode* N = Node->getFirstChild();
-  while (N) {
-    TExpertValidation iResult = (TExpertValidation)(int)N->Data;
-    if (iResult > iReturn)
-      iReturn = iResult;
-    N = N->getNextSibling();
-  }
-  return iReturn;
+void __fastcall TfrmExpertManager::edtSearchChange(TObject *Sender) {
+  if (edtSearch->Text.Length() != 0)
+    ShowSearchResults();
+  else
+    ShowUsedBy(pagPages->ActivePage == tabExperts ? lvInstalledExperts :
+      pagPages->ActivePage == tabKnownIDEPackages ? lvKnownIDEPackages : lvKnownPackages);
 }
 
 /**
 
-  This is an on change event handler for the tvExpertInstallations tree view.
+  This is an on mouse down event handler for the three entry list views. As virtual list views do
+  not store their items check states, clicking an items check box toggles that entry only.
 
   @precon  None.
-  @postcon For a tree node with a TExpertValidation of evOkay, evInvalidPaths,
-           evDuplication the list of installed experts for the installation are rendered
-           in the listview with duplicates coloured in red.
+  @postcon The clicked entry is enabled or disabled.
 
   @param   Sender as a TObject
-  @param   Node   as a TTreeNode
+  @param   Button as a TMouseButton
+  @param   Shift  as a TShiftState
+  @param   X      as an int
+  @param   Y      as an int
 
 **/
-void __fastcall TfrmExpertManager::tvExpertInstallationsChange(TObject *Sender,
-  TTreeNode *Node) {
-  FUpdatingListView = true;
-  __try {
-    ShowExperts(Node);
-  } __finally {
-    FUpdatingListView = false;
+void __fastcall TfrmExpertManager::lvEntriesMouseDown(TObject *Sender, TMouseButton Button,
+  TShiftState Shift, int X, int Y) {
+  TListView* lvList = static_cast<TListView*>(Sender);
+  TListItem* Item = lvList->GetItemAt(X, Y);
+  if (Button == mbLeft && Item != NULL && lvList->GetHitTestInfoAt(X, Y).Contains(htOnStateIcon)) {
+    std::vector<int> Rows(1, Item->Index);
+    ToggleEntries(lvList, Rows, !FCurrentEntries->Entry(ListRows(lvList)[Item->Index]).boolEnabled);
   }
 }
 
 /**
 
-  This method updates the list views in the tabs to contain the experts and pacakges for the selected
-  installation.
+  This is an on key down event handler for the three entry list views. Pressing space enables or
+  disables all the selected entries (the opposite of the state of the focused entry).
 
-  @precon  Node must be a valid instance
-  @postcon The experts and packages are listed in the listviews in the tab pages.
+  @precon  None.
+  @postcon The selected entries are enabled or disabled.
 
-  @param   Node as a TTreeNode
+  @param   Sender as a TObject
+  @param   Key    as a WORD as a reference
+  @param   Shift  as a TShiftState
 
 **/
-void __fastcall TfrmExpertManager::ShowExperts(TTreeNode *Node) {
-  tabExperts->ImageIndex = 1;
-  tabKnownIDEPackages->ImageIndex = 1;
-  tabKnownPackages->ImageIndex = 1;
-  if (Node) {
-    std::wregex VersionNumPattern(L"\\d+.\\d");
-    if (std::regex_match(Node->Text.c_str(), VersionNumPattern)) {
-      String strSubSection = GetRegPathToNode(Node);
-      GetCurrentRADStudioMacros(strSubSection);
-      std::unique_ptr<TStringList> slDups( new TStringList() );
-      lvInstalledExperts->Clear();
-      //: @bug Cannot remember the selected expert
-      AddExpertsToList(lvInstalledExperts, strSubSection, strExperts, true, slDups.get());
-      AddExpertsToList(lvInstalledExperts, strSubSection, strDisabledExperts, false, slDups.get());
-      SetTabStatus(tabExperts, CheckExperts(Node, GetRegPathToNode(Node)));
-      AddPackagesToList(lvKnownIDEPackages, strSubSection, strKnownIDEPackages);
-      SetTabStatus(tabKnownIDEPackages, CheckPackages(Node, GetRegPathToNode(Node), strKnownIDEPackages));
-      AddPackagesToList(lvKnownPackages, strSubSection, strKnownPackages);
-      SetTabStatus(tabKnownPackages, CheckPackages(Node, GetRegPathToNode(Node), strKnownPackages));
-    }
+void __fastcall TfrmExpertManager::lvEntriesKeyDown(TObject *Sender, WORD &Key, TShiftState Shift) {
+  TListView* lvList = static_cast<TListView*>(Sender);
+  if (Key == VK_SPACE && lvList->Selected != NULL) {
+    TListItem* Item = lvList->ItemFocused != NULL ? lvList->ItemFocused : lvList->Selected;
+    std::vector<int> Rows;
+    SelectedRows(lvList, Rows);
+    ToggleEntries(lvList, Rows, !FCurrentEntries->Entry(ListRows(lvList)[Item->Index]).boolEnabled);
+    Key = 0;
   }
 }
 
 /**
 
-  This method updates the given tab sheet status images based on the given status.
+  This method adds a new entry to the current installation and shows it as the last row of the
+  given list view.
 
-  @precon  TabSheet must be a valid instance.
-  @postcon The tab sheet image is updated.
+  @precon  lvList must be one of the three entry list views.
+  @postcon The entry is added, selected and revalidated.
 
-  @param   TabSheet as a TTabSheet
-  @param   eStatus as a TExpertValidation as a constant
+  @param   lvList as a TListView
+  @param   Entry  as a TEMEntry as a constant reference
 
 **/
-void TfrmExpertManager::SetTabStatus(TTabSheet* TabSheet, const TExpertValidation eStatus) {
-  switch (eStatus) {
-    case evOkay:
-      TabSheet->ImageIndex = 1;
-      break;
-    case evInvalidPaths:
-      TabSheet->ImageIndex = 2;
-      break;
-    case evDuplication:
-      TabSheet->ImageIndex = 3;
-      break;
-    default:
-      TabSheet->ImageIndex = 0;
-  }
+void __fastcall TfrmExpertManager::AddRow(TListView* lvList, const TEMEntry& Entry) {
+  TEMEntryIDList Changed;
+  TEMEntryIDList& Rows = ListRows(lvList);
+  Rows.push_back(FCurrentEntries->Add(Entry, Changed));
+  lvList->Items->Count = Rows.size();
+  lvList->ItemIndex = Rows.size() - 1;
+  UpdateEntries(lvList, Changed);
 }
 
 /**
 
-  This function adds the experts found in the passed sub section into the listview.
+  This method replaces the entry shown in the given row of the given list view.
 
-  @precon  None.
-  @postcon The experts i the passed subs ection are added to the list view.
+  @precon  lvList must be one of the three entry list views and iRow a valid row.
+  @postcon The entry is updated and revalidated.
 
-  @param   strSubSection as a String
-  @param   strKey        as a String
-  @param   boolEnabled   as a bool
+  @param   lvList as a TListView
+  @param   iRow   as an int as a constant
+  @param   Entry  as a TEMEntry as a constant reference
 
 **/
-void __fastcall TfrmExpertManager::AddExpertsToList(TListView* lvList, String strSubSection,
-  String strKey, bool boolEnabled, TStringList* slDups) {
-  // Get expert list
-  std::unique_ptr<TRegistryINIFileCls> iniFile( new TRegistryINIFileCls(strSubSection) );
-  std::unique_ptr<TStringList> slKeys( new TStringList() );
-  iniFile->ReadSection(strKey, slKeys.get());
-  std::unique_ptr<TStringList> slExperts( new TStringList() );
-  for (int iKey = 0; iKey < slKeys->Count; iKey++) {
-    String S = iniFile->ReadString(strKey, slKeys->Strings[iKey], "");
-    slExperts->AddPair(slKeys->Strings[iKey], S);
-  }
-  // Render List
-  lvList->Items->BeginUpdate();
-  try {
-    GetCurrentRADStudioMacros(strSubSection);
-    for (int i = 0; i < slExperts->Count; i++) {
-      TListItem* Item = lvList->Items->Add();
-      String strFullFileName = slExperts->ValueFromIndex[i];
-      String strFileName = ExtractFileName(strFullFileName);
-      Item->Caption = slExperts->Names[i];
-      Item->SubItems->Add(strFullFileName);
-      Item->Checked = boolEnabled;
-      Item->Data = (void*)evOkay;
-      int iIndex = slDups->IndexOf(strFileName);
-      if (iIndex != -1) {
-        Item->Data = (void*)evDuplication;
-        int iOtherIndex = (int)slDups->Objects[iIndex]; //: @bug CANNOT GET INDEX WHEN SORTED
-        if ((int)lvList->Items->Item[iOtherIndex]->Data == 0)
-          lvList->Items->Item[iOtherIndex]->Data = (void*)evDuplication;
-      }
-      if (!FileExists(ExpandRADStudioMacros(strFullFileName)))
-        Item->Data = (void*)evInvalidPaths;
-      slDups->AddObject(strFileName, (TObject*)Item->Index); //: @bug CANNOT STORE INDEX ACROSS 2 SETS
-    }
-  } __finally {
-    lvList->Items->EndUpdate();
-  }
+void __fastcall TfrmExpertManager::UpdateRow(TListView* lvList, const int iRow,
+  const TEMEntry& Entry) {
+  TEMEntryIDList Changed;
+  FCurrentEntries->Update(ListRows(lvList)[iRow], Entry, Changed);
+  UpdateEntries(lvList, Changed);
 }
 
 /**
 
-  This function adds the packages found in the passed sub section into the listview.
+  This method removes the entries shown in the given rows of the given list view.
 
-  @precon  None.
-  @postcon The experts i the passed subs ection are added to the list view.
+  @precon  lvList must be one of the three entry list views and Rows valid rows.
+  @postcon The entries are removed from the installation and the list view and revalidated once.
 
-  @param   strSubSection as a String
-  @param   strKey        as a String
-  @param   boolEnabled   as a bool
+  @param   lvList as a TListView
+  @param   Rows   as a std::vector<int> as a constant reference
 
 **/
-void __fastcall TfrmExpertManager::AddPackagesToList(TListView* lvList, String strSubSection,
-  String strKey) {
-  TUPStrList slPackages( new TStringList() );
-  GetPackageList(slPackages.get(), strSubSection, strKey);
-  String strViewName = strSubSection + strKey;
-  if (strKey == strKnownIDEPackages)
-    RenderPackageList(lvList, slPackages.get(), FLastKnownIDEPackagesViewName, strViewName);
-  else
-    RenderPackageList(lvList, slPackages.get(), FLastKnownPackagesViewName, strViewName);
+void __fastcall TfrmExpertManager::DeleteRows(TListView* lvList, const std::vector<int>& Rows) {
+  TEMEntryIDList Changed;
+  TEMEntryIDList& ListedRows = ListRows(lvList);
+  std::vector<int> Sorted(Rows);
+  std::sort(Sorted.begin(), Sorted.end());
+  for (size_t i = Sorted.size(); i > 0; i--) {
+    FCurrentEntries->Remove(ListedRows[Sorted[i - 1]], Changed);
+    ListedRows.erase(ListedRows.begin() + Sorted[i - 1]);
+  }
+  lvList->ClearSelection();
+  lvList->Items->Count = ListedRows.size();
+  lvList->Invalidate();
+  UpdateEntries(lvList, Changed);
 }
 
 /**
 
-  This method renders the list of packages passed to the function into the given listview control.
+  This method returns the rows of the selected items of the given list view.
 
-  @precon  lvList and slPackages must be validl instances.
-  @postcon The list of packages in slPackages is renddered in the listview lvList.
+  @precon  lvList must be a valid instance.
+  @postcon Rows contains the selected rows in ascending order.
 
   @param   lvList as a TListView
-  @param   slPackages as a TStringList
-  @param   strLastViewName as a Strign as a Reference
-  @param strViewName as a String
+  @param   Rows   as a std::vector<int> as a reference
 
 **/
-void __fastcall TfrmExpertManager::RenderPackageList(TListView* lvList, TStringList* slPackages,
-  String &strLastViewName, const String strViewName) {
-  TUPStrList slDups( new TStringList() );
-  lvList->Items->BeginUpdate();
-  try {
-    int iSelected = -1;
-    GetCurrentPosition(lvList, strLastViewName, strViewName, iSelected);
-    // Render List
-    lvList->Clear();
-    for (int i = 0; i < slPackages->Count; i++) {
-      TListItem* Item = lvList->Items->Add();
-      String strFullFileName = slPackages->ValueFromIndex[i];
-      String strFileName = ExtractFileName(strFullFileName);
-      String strName = slPackages->Names[i];
-      if (strName.SubString(1, 2) == "__")
-        strName.Delete(1, 2);
-      Item->Caption = strName;
-      Item->SubItems->Add(strFullFileName);
-      Item->Checked = (slPackages->Names[i].SubString(1, 2) != "__");
-      Item->Data = (void*)evOkay;
-      // Update list item state
-      int iIndex = slDups->IndexOf(strFileName);
-      if (iIndex != -1) {
-        Item->Data = (void*)evDuplication;
-        int iOtherIndex = (int)slDups->Objects[iIndex]; //: @bug CANNOT GET INDEX WHEN SORTED
-        if ((int)lvList->Items->Item[iOtherIndex]->Data == 0)
-          lvList->Items->Item[iOtherIndex]->Data = (void*)evDuplication;
-      }
-      if (!FileExists(ExpandRADStudioMacros(strFullFileName)))
-        Item->Data = (void*)evInvalidPaths;
-      slDups->AddObject(strFileName, (TObject*)Item->Index); //: @bug CANNOT STORE INDEX ACROSS 2 SETS
-    }
-    if (iSelected >= lvList->Items->Count)
-      iSelected--;
-    SetCurrentPosition(lvList, iSelected);
-  } __finally {
-    lvList->Items->EndUpdate();
+void __fastcall TfrmExpertManager::SelectedRows(TListView* lvList, std::vector<int>& Rows) {
+  Rows.clear();
+  TListItem* Item = lvList->Selected;
+  while (Item != NULL) {
+    Rows.push_back(Item->Index);
+    Item = lvList->GetNextItem(Item, sdAll, TItemStates() << isSelected);
   }
 }
 
@@ -659,34 +1439,10 @@ void __fastcall TfrmExpertManager::SetCurrentPosition(TListView* lvList, int &iS
     lvList->Items->Item[iSelected]->MakeVisible(false);
 }
 
-/**
-
-  This method extracts the packages from the given registry keys and puts them into the given string
-  list with the filename as the key and the package name as the value.
-
-  @precon  slPackages must be a valid instance.
-  @postcon The slPackages string list is populated with the pacakges.
-
-  @param   slPackages as a TStringList
-  @param   strSubSection as a String as a constant
-  @param   strKey as a String as a constant
-
-**/
-void __fastcall TfrmExpertManager::GetPackageList(TStringList* slPackages, const String strSubSection,
-  const String strKey) {
-  TUPIniFile iniFile( new TRegistryINIFileCls(strSubSection) );
-  TUPStrList slKeys( new TStringList() );
-  iniFile->ReadSection(strKey, slKeys.get());
-  for (int iKey = 0; iKey < slKeys->Count; iKey++) {
-    String S = iniFile->ReadString(strKey, slKeys->Strings[iKey], "");
-    slPackages->AddPair(S, slKeys->Strings[iKey]);
-  }
-}
-
 /**
 
   This method returns the registry path to the given nodes installation (without the
-  Expert bit).
+  Expert bit) from the installation index.
 
   @precon  Node must be a valid instance.
   @postcon Returns the regsitry path to the RAD Studio installation.
@@ -696,6 +1452,9 @@ void __fastcall TfrmExpertManager::GetPackageList(TStringList* slPackages, const
 
 **/
 String __fastcall TfrmExpertManager::GetRegPathToNode(TTreeNode* Node) {
+  int iID = InstallationID(Node);
+  if (iID >= 0)
+    return FInstallations.RegPath(iID).c_str();
   return
     "Software\\" +
     Node->Parent->Parent->Text + "\\" +
@@ -709,7 +1468,7 @@ String __fastcall TfrmExpertManager::GetRegPathToNode(TTreeNode* Node) {
   control.
 
   @precon  None.
-  @postcon Any item with a data value > 0 (NUL) will be draw in red font.
+  @postcon Each item is drawn in the colour of its entry's validation.
 
   @param   Sender      as a TCustomListView
   @param   Item        as a TListItem
@@ -721,8 +1480,10 @@ String __fastcall TfrmExpertManager::GetRegPathToNode(TTreeNode* Node) {
 void __fastcall TfrmExpertManager::lvInstalledExpertsAdvancedCustomDrawItem(TCustomListView *Sender,
           TListItem *Item, TCustomDrawState State, TCustomDrawStage Stage, bool &DefaultDraw) {
   DefaultDraw = true;
-  int i = (int)Item->Data;
-  switch ((TExpertValidation)i) {
+  TExpertValidation eValidation = evNone;
+  if (FCurrentEntries)
+    eValidation = FCurrentEntries->EntryValidation((int)Item->Data);
+  switch (eValidation) {
     case evNone:
       Sender->Canvas->Font->Color = iNoneColour;
       break;
@@ -735,6 +1496,9 @@ void __fastcall TfrmExpertManager::lvInstalledExpertsAdvancedCustomDrawItem(TCus
     case evDuplication:
       Sender->Canvas->Font->Color = iDuplicateColour;
       break;
+    case evMissingDependencies:
+      Sender->Canvas->Font->Color = iMissingDependencyColour;
+      break;
   }
 }
 
@@ -761,36 +1525,62 @@ void __fastcall TfrmExpertManager::lvInstalledExpertsDblClick(TObject *Sender) {
 
 /**
 
-  This method force the tree to update the currently selected node based on any changes
-  to the experts listed (checks the registry).
+  This method creates an entry record for the current installation checking whether the entry's
+  file exists.
+
+  @precon  None.
+  @postcon Returns the entry record.
+
+  @param   eSection    as a TEMSection as a constant
+  @param   strName     as a String
+  @param   strFileName as a String
+  @param   boolEnabled as a bool as a constant
+  @return  a TEMEntry
+
+**/
+TEMEntry __fastcall TfrmExpertManager::MakeEntry(const TEMSection eSection, String strName,
+  String strFileName, const bool boolEnabled) {
+  TEMEntry Entry;
+  Entry.eSection = eSection;
+  Entry.Name = TEMPath(strName.c_str());
+  Entry.FileName = TEMPath(strFileName.c_str());
+  Entry.boolEnabled = boolEnabled;
+  Entry.boolDeleted = false;
+  FFileSystem->Invalidate();
+  Entry.boolExists = FFileSystem->FileExists(FCurrentMacros->Expand(Entry.FileName.Text()));
+  return Entry;
+}
+
+/**
+
+  This method updates the user interface after a single entry of the current installation has
+  been edited. Only the rows of the changed entries are repainted (the rows are in entry ID
+  order so each is found by a binary search), the tab and tree node
+  statuses are taken from the entries aggregate counts and the installation's keys are marked so
+  that they are re-read into the registry snapshot the next time the installation is shown.
 
   @precon  tvExpertInstallations->Selected must be a valid node.
-  @postcon Updates the current treenodes enumerate valid and asks the tre view to repaint.
+  @postcon The changed items, tabs and tree nodes are updated.
 
-  @param   Node as a TTreeNode
-  @param   boolShow as a bool as a Constant
-
-**/
-void __fastcall TfrmExpertManager::UpdateTreeViewStatus(TTreeNode* Node, const bool boolShow) {
-  TExpertValidation iExpertValidation = CheckExperts(Node, GetRegPathToNode(Node));
-  TExpertValidation iKnownIDEPackageValidation = CheckPackages(Node, GetRegPathToNode(Node),
-    strKnownIDEPackages);
-  if (iKnownIDEPackageValidation > iExpertValidation)
-    iExpertValidation = iKnownIDEPackageValidation;
-  TExpertValidation iKnownPackageValidation = CheckPackages(Node, GetRegPathToNode(Node),
-    strKnownPackages);
-  if (iKnownPackageValidation > iExpertValidation)
-    iExpertValidation = iKnownPackageValidation;
-  SetNodeStatus(Node, iExpertValidation);
-  TTreeNode* N = Node->Parent;
-  while (N) {
-    SetNodeStatus(N, GetHighestValidation(N));
-    N = N->Parent;
-  }
-  if (boolShow) {
-    tvExpertInstallations->Invalidate();
-    tvExpertInstallationsChange(tvExpertInstallations, tvExpertInstallations->Selected);
+  @param   lvList  as a TListView
+  @param   Changed as a TEMEntryIDList as a constant reference
+
+**/
+void __fastcall TfrmExpertManager::UpdateEntries(TListView* lvList, const TEMEntryIDList& Changed) {
+  const TEMEntryIDList& Rows = ListRows(lvList);
+  for (size_t i = 0; i < Changed.size(); i++) {
+    TEMEntryIDList::const_iterator Row = std::lower_bound(Rows.begin(), Rows.end(), Changed[i]);
+    if (Row != Rows.end() && *Row == Changed[i])
+      lvList->UpdateItems(Row - Rows.begin(), Row - Rows.begin());
   }
+  SetTabStatuses();
+  TTreeNode* Node = tvExpertInstallations->Selected;
+  SetNodeStatus(Node, FCurrentEntries->Validation());
+  UpdateAncestorStatus(Node);
+  MarkStale(GetRegPathToNode(Node).c_str());
+  FUsageIndex.UpdateEntries(InstallationID(Node), Changed, *FCurrentMacros);
+  FSearchIndex.UpdateEntries(InstallationID(Node), *FCurrentEntries, Changed, *FCurrentMacros);
+  ShowUsedBy(lvList);
 }
 
 /**
@@ -798,7 +1588,7 @@ void __fastcall TfrmExpertManager::UpdateTreeViewStatus(TTreeNode* Node, const b
   This method updates the given node with the given status.
 
   @precon  Node must be a valid instance.
-  @postcon The nodes status is updated.
+  @postcon The nodes status is updated and an installation node no longer shows a cached status.
 
   @param   Node as a TTreeNode
   @param   eStatus as a TExpertValidation as a Constant
@@ -806,6 +1596,9 @@ void __fastcall TfrmExpertManager::UpdateTreeViewStatus(TTreeNode* Node, const b
 **/
 void TfrmExpertManager::SetNodeStatus(TTreeNode* Node, const TExpertValidation eStatus) {
   Node->Data = (void*)eStatus;
+  int iID = InstallationID(Node);
+  if (iID >= 0 && iID < (int)FProvisionalNodes.size())
+    FProvisionalNodes[iID] = false;
   switch (eStatus) {
     case evNone:
       Node->StateIndex = 0;
@@ -819,6 +1612,9 @@ void TfrmExpertManager::SetNodeStatus(TTreeNode* Node, const TExpertValidation e
     case evDuplication:
       Node->StateIndex = 3;
       break;
+    case evMissingDependencies:
+      Node->StateIndex = 4;
+      break;
   }
 }
 
@@ -839,13 +1635,11 @@ void __fastcall TfrmExpertManager::actAddExpertExecute(TObject *Sender) {
     String strExpertName = "";
     String strExpertFileName = "";
     if (TfrmExpertEditor::Execute(dtExpert, strExpertName, strExpertFileName, ExpandRADStudioMacros)) {
-      TListItem* Item = lvInstalledExperts->Items->Add();
-      Item->Caption = strExpertName;
-      Item->SubItems->Add(strExpertFileName);
-      String strRegSection = GetRegPathToNode(tvExpertInstallations->Selected);
-      TUPIniFile iniFile = TUPIniFile( new TRegistryINIFileCls(strRegSection) );
-      iniFile->WriteString(strExperts, strExpertName, strExpertFileName);
-      UpdateTreeViewStatus(tvExpertInstallations->Selected, true);
+      TEMEntry Entry = MakeEntry(esExperts, strExpertName, strExpertFileName, true);
+      TEMRegistryWriteBatch Batch;
+      EMWriteEntry(Batch, GetRegPathToNode(tvExpertInstallations->Selected).c_str(), Entry);
+      ApplyBatch(Batch);
+      AddRow(lvInstalledExperts, Entry);
     }
   } __finally {
     FUpdatingListView = false;
@@ -865,20 +1659,18 @@ void __fastcall TfrmExpertManager::actAddExpertExecute(TObject *Sender) {
 
 **/
 void __fastcall TfrmExpertManager::actEditExpertExecute(TObject *Sender) {
-  String strExpertName = lvInstalledExperts->Selected->Caption;
-  String strOldExpertName = strExpertName;
-  String strExpertFileName = lvInstalledExperts->Selected->SubItems->Strings[0];
+  int iRow = lvInstalledExperts->Selected->Index;
+  TEMEntry OldEntry = FCurrentEntries->Entry(FExpertRows[iRow]);
+  String strExpertName = OldEntry.Name.Text().c_str();
+  String strExpertFileName = OldEntry.FileName.Text().c_str();
   if (TfrmExpertEditor::Execute(dtExpert, strExpertName, strExpertFileName, ExpandRADStudioMacros)) {
-    lvInstalledExperts->Selected->Caption = strExpertName;
-    lvInstalledExperts->Selected->SubItems->Strings[0] = strExpertFileName;
-    String strRegSection = GetRegPathToNode(tvExpertInstallations->Selected);
-    String strKey = lvInstalledExperts->Selected->Checked ? strExperts : strDisabledExperts ;
-    TUPIniFile iniFile( new TRegistryINIFileCls(strRegSection + strKey) );
-    iniFile->DeleteValue(strOldExpertName);
-    iniFile = TUPIniFile( new TRegistryINIFileCls(strRegSection) );
-    strKey = lvInstalledExperts->Selected->Checked ? strExperts : strDisabledExperts ;
-    iniFile->WriteString(strKey, strExpertName, strExpertFileName);
-    UpdateTreeViewStatus(tvExpertInstallations->Selected, true);
+    TEMEntry Entry = MakeEntry(esExperts, strExpertName, strExpertFileName, OldEntry.boolEnabled);
+    std::wstring strRegPath = GetRegPathToNode(tvExpertInstallations->Selected).c_str();
+    TEMRegistryWriteBatch Batch;
+    EMDeleteEntry(Batch, strRegPath, OldEntry);
+    EMWriteEntry(Batch, strRegPath, Entry);
+    ApplyBatch(Batch);
+    UpdateRow(lvInstalledExperts, iRow, Entry);
   }
 }
 
@@ -896,14 +1688,8 @@ void __fastcall TfrmExpertManager::actEditExpertExecute(TObject *Sender) {
 void __fastcall TfrmExpertManager::actDeleteExpertExecute(TObject *Sender) {
   FUpdatingListView = true;
   __try {
-    if (tvExpertInstallations->Selected != NULL && lvInstalledExperts->Selected != NULL) {
-      String strExpertName = lvInstalledExperts->Selected->Caption;
-      String strRegSection = GetRegPathToNode(tvExpertInstallations->Selected);
-      String strKey = lvInstalledExperts->Selected->Checked ? L"Experts\\" : L"Experts\\Disabled\\" ;
-      TUPIniFile iniFile( new TRegistryINIFileCls(strRegSection + strKey) );
-      iniFile->DeleteValue(strExpertName);
-      UpdateTreeViewStatus(tvExpertInstallations->Selected, true);
-    }
+    if (tvExpertInstallations->Selected != NULL && lvInstalledExperts->Selected != NULL)
+      DeleteSelectedEntries(lvInstalledExperts);
   } __finally {
     FUpdatingListView = false;
   }
@@ -965,7 +1751,7 @@ bool __fastcall TfrmExpertManager::IsViewableNode(TTreeNode* Node) {
     int i = (int)Node->Data;
     TExpertValidation iExpertValidation = (TExpertValidation)i;
     TExpertValidations setExpertValidations = TExpertValidations() << evOkay << evInvalidPaths <<
-      evDuplication;
+      evDuplication << evMissingDependencies;
     return setExpertValidations.Contains(iExpertValidation);
   } else
     return false;
@@ -980,17 +1766,20 @@ bool __fastcall TfrmExpertManager::IsViewableNode(TTreeNode* Node) {
   @postcon The status of all the node under the given node are stored in the expanded node
            maanger.
 
-  @param   Node as a TTreeNode
+  @param   Node          as a TTreeNode
+  @param   strParentPath as a String as a constant reference
 
 **/
-void __fastcall TfrmExpertManager::GetExpandedNodes(TTreeNode* Node) {
+void __fastcall TfrmExpertManager::GetExpandedNodes(TTreeNode* Node,
+  const String& strParentPath) {
+  String strPath = TExpandedNodeManager::ChildPath(strParentPath, Node);
   if (Node->Expanded)
-    FExpandedNodeManager->AddNode(Node);
+    FExpandedNodeManager->AddNode(strPath);
   else
-    FExpandedNodeManager->RemoveNode(Node);
+    FExpandedNodeManager->RemoveNode(strPath);
   TTreeNode* N = Node->getFirstChild();
   while (N != NULL) {
-    GetExpandedNodes(N);
+    GetExpandedNodes(N, strPath);
     N = N->getNextSibling();
   }
 }
@@ -1004,80 +1793,41 @@ void __fastcall TfrmExpertManager::GetExpandedNodes(TTreeNode* Node) {
   @postcon The status of all the node expanded status under the given node are restored
            from the informatioh in the expanded node maanger.
 
-  @param   Node as a TTreeNode
+  @param   Node          as a TTreeNode
+  @param   strParentPath as a String as a constant reference
 
 **/
-void __fastcall TfrmExpertManager::SetExpandedNodes(TTreeNode* Node) {
-  if (FExpandedNodeManager->IsExpanded(Node))
+void __fastcall TfrmExpertManager::SetExpandedNodes(TTreeNode* Node,
+  const String& strParentPath) {
+  String strPath = TExpandedNodeManager::ChildPath(strParentPath, Node);
+  if (FExpandedNodeManager->IsExpanded(strPath))
     Node->Expand(false);
   TTreeNode* N = Node->getFirstChild();
   while (N != NULL) {
-    SetExpandedNodes(N);
+    SetExpandedNodes(N, strPath);
     N = N->getNextSibling();
   }
 }
 
 /**
 
-  This method loads the FCurrentRADStudioMacros string list with the environemnt variables
-  in the given RAD Studio installation so that they can be used for expanded macros.
+  This method loads the current macro table with the macros of the given RAD Studio installation
+  (from the macro cache) so that they can be used for expanding filenames.
 
   @precon  None.
-  @postcon The internal string list for environment variables is cleared and repopulated
-           with enviroment variables from the given RAD Studio installation and the users
-           additional variables.
+  @postcon The current macro table is replaced with one for the given RAD Studio installation.
 
   @param   strRegPathToRADStudioRoot as a String
 
 **/
 void __fastcall TfrmExpertManager::GetCurrentRADStudioMacros(String strRegPathToRADStudioRoot) {
-  FCurrentRADStudioMacros->Clear();
-  TUPIniFile iniFile( new TRegistryINIFileCls(strRegPathToRADStudioRoot) );
-  // Create system wide enviroment variables
-  String strRootDir = iniFile->ReadString("", "RootDir", "");
-  if (strRootDir.Length() > 0) {
-    AddRADStudioMacro("$(BDS)", strRootDir);
-    AddRADStudioMacro("$(BCB)", strRootDir);
-    AddRADStudioMacro("$(BDSBIN)", strRootDir + "\\Bin");
-    AddRADStudioMacro("$(BDSINCLUDE)", strRootDir + "\\Include");
-    AddRADStudioMacro("$(BDSLIB)", strRootDir + "\\Lib");
-    AddRADStudioMacro("$(DELPHI)", strRootDir);
-    // Disect path
-    String strName = "Embarcadero\\Studio";
-    String strNumber = "0.0";
-    TMatchCollection M = FBDSPathPatternRegEx->Matches(strRootDir);
-    if (M.Count > 0) {
-      if (M.Item[0].Groups.Count >= 2)
-        strName = M.Item[0].Groups[1].Value;
-      if (M.Item[0].Groups.Count >= 3)
-        strNumber = M.Item[0].Groups[2].Value;
-    }
-    // Create extended paths
-    AddRADStudioMacro("$(BDSCATALOGREPOSITORY)",
-      "%userprofile%\\Documents\\" + strName + "\\" + strNumber + "\\CatalogRepository");
-    AddRADStudioMacro("$(BDSCatalogRepositoryAllUsers)",
-      "%public%\\Documents\\" + strName + "\\" + strNumber + "\\CatalogRepository");
-    AddRADStudioMacro("$(BDSCOMMONDIR)", "%public%\\Documents\\" + strName + "\\" + strNumber);
-    AddRADStudioMacro("$(BDSPLATFORMSDIR)", "%userprofile%\\Documents\\" + strName + "\\SDKs");
-    AddRADStudioMacro("$(BDSPROFILEDIR)", "%userprofile%\\Documents\\" + strName + "\\Profiles");
-    AddRADStudioMacro("$(BDSPROJECTDIR)", "%userprofile%\\Documents\\" + strName + "\\Projects");
-    AddRADStudioMacro("$(BDSUSERDIR)", "%userprofile%\\Documents\\" + strName + "\\" + strNumber);
-    // Create user wide environment variables
-    TUPStrList slUserEn( new TStringList() );
-    iniFile->ReadSection("Environment Variables", slUserEn.get());
-    for (int i = 0; i < slUserEn->Count; i++)
-      AddRADStudioMacro(
-        slUserEn->Strings[i],
-        iniFile->ReadString("Environment Variables", slUserEn->Strings[i], "")
-      );
-  }
+  FCurrentMacros = FMacroCache->Get(*FSnapshot, strRegPathToRADStudioRoot.c_str());
 }
 
 /**
 
-  This method searches through the given filename for text matching any environment
-  variables found the FCurrentRADStudioMacros string list and replaces them with
-  the actual path.
+  This method expands any RAD Studio macros in the given filename using the macros of the current
+  installation.
 
   @precon  None.
   @postcon An macros which match environment variables are expanded.
@@ -1087,44 +1837,7 @@ void __fastcall TfrmExpertManager::GetCurrentRADStudioMacros(String strRegPathTo
 
 **/
 String __fastcall TfrmExpertManager::ExpandRADStudioMacros(String strFullFileName) {
-  String strExpandedFileName = strFullFileName;
-  TMatchCollection M = FBDSMacroRegEx->Matches(strFullFileName);
-  for (int iMatches = M.Count - 1; iMatches >= 0; iMatches--) {
-    int iIndex = FCurrentRADStudioMacros->IndexOfName(M.Item[iMatches].Value);
-    if (iIndex > -1) {
-      strExpandedFileName = StringReplace(
-        strExpandedFileName,
-        M.Item[iMatches].Value,
-        FCurrentRADStudioMacros->ValueFromIndex[iIndex],
-        TReplaceFlags() << rfReplaceAll << rfIgnoreCase);
-    }
-  }
-  return strExpandedFileName;
-}
-
-/**
-
-  This method attempts to add an enviroment variable to the string list.
-
-  @precon  None.
-  @postcon The enviroment variable is added if it does not exist else the existing
-           variable is updated to the new value.
-
-  @param   strMacro as a String
-  @param   strValue as a String
-
-**/
-void __fastcall TfrmExpertManager::AddRADStudioMacro(String strMacro, String strValue) {
-  int iSize = MAX_PATH;
-  String strBuffer;
-  strBuffer.SetLength(iSize);
-  iSize = ExpandEnvironmentStrings(strValue.c_str(), strBuffer.c_str(), iSize);
-  strBuffer.SetLength(--iSize);
-  int iIndex = FCurrentRADStudioMacros->IndexOf(strMacro);
-  if (iIndex == -1)
-    FCurrentRADStudioMacros->AddPair(strMacro, strBuffer);
-  else
-    FCurrentRADStudioMacros->ValueFromIndex[iIndex] = strBuffer;
+  return FCurrentMacros->Expand(strFullFileName.c_str()).c_str();
 }
 
 /**
@@ -1183,87 +1896,80 @@ void __fastcall TfrmExpertManager::actFileExitExecute(TObject *Sender) {
 
 /**
 
-  This is an item checked event handler for the experts listview control.
+  This method enables or disables the entries in the given rows of the given list view. Experts
+  are moved between the Experts and Experts\Disabled keys whereas packages have double underscores
+  added to or removed from their descriptions. All the changes are written in a single batch and
+  revalidated once.
 
-  @precon  None.
-  @postcon If an item is checked the expert is copied to the Experts key and deleted from the
-           Disabled or the erverse if unchecked.
+  @precon  lvList must be one of the three entry list views and Rows valid rows.
+  @postcon The entries are enabled or disabled in the registry and revalidated.
 
-  @param   Sender as a TObject
-  @param   Item   as a TListItem
+  @param   lvList      as a TListView
+  @param   Rows        as a std::vector<int> as a constant reference
+  @param   boolEnabled as a bool as a constant
 
 **/
-void __fastcall TfrmExpertManager::lvInstalledExpertsItemChecked(TObject *Sender, TListItem *Item) {
-  if (!FUpdatingListView) {
-    String strRegSection = GetRegPathToNode(tvExpertInstallations->Selected);
-    String strExpertName = Item->Caption;
-    String strExpertFileName = Item->SubItems->Strings[0];
-    TUPIniFile iniFile;
-    if (Item->Checked) {
-      iniFile = TUPIniFile( new TRegistryINIFileCls(strRegSection) );
-      iniFile->WriteString(strExperts, strExpertName, strExpertFileName);
-      iniFile = TUPIniFile( new TRegistryINIFileCls(strRegSection + strDisabledExperts) );
-      iniFile->DeleteValue(strExpertName);
-    } else {
-      iniFile = TUPIniFile( new TRegistryINIFileCls(strRegSection) );
-      iniFile->WriteString(strDisabledExperts, strExpertName, strExpertFileName);
-      iniFile = TUPIniFile( new TRegistryINIFileCls(strRegSection + strExperts) );
-      iniFile->DeleteValue(strExpertName);
+void __fastcall TfrmExpertManager::ToggleEntries(TListView* lvList, const std::vector<int>& Rows,
+  const bool boolEnabled) {
+  if (!FUpdatingListView && FCurrentEntries) {
+    const TEMEntryIDList& ListedRows = ListRows(lvList);
+    std::wstring strRegPath = GetRegPathToNode(tvExpertInstallations->Selected).c_str();
+    TEMRegistryWriteBatch Batch;
+    std::vector<TEMEntry> Entries;
+    for (size_t i = 0; i < Rows.size(); i++) {
+      const TEMEntry& OldEntry = FCurrentEntries->Entry(ListedRows[Rows[i]]);
+      TEMEntry Entry = OldEntry;
+      Entry.boolEnabled = boolEnabled;
+      if (Entry.boolEnabled != OldEntry.boolEnabled) {
+        EMDeleteEntry(Batch, strRegPath, OldEntry);
+        EMWriteEntry(Batch, strRegPath, Entry);
+      }
+      Entries.push_back(Entry);
     }
-    UpdateTreeViewStatus(tvExpertInstallations->Selected, true);
+    ApplyBatch(Batch);
+    TEMEntryIDList Changed;
+    for (size_t i = 0; i < Rows.size(); i++)
+      FCurrentEntries->Update(ListedRows[Rows[i]], Entries[i], Changed);
+    UpdateEntries(lvList, Changed);
   }
 }
 
 /**
 
-  This is an item checked event handler for the Known IDE Packages listview control.
+  This method deletes the entries in the selected rows of the given list view from the registry
+  (in a single batch) and the list.
 
-  @precon  None.
-  @postcon If an item is checked the package has any double underscores removed from the package name
-           else double underscore are added to the package name to disable the package.
+  @precon  lvList must be one of the three entry list views.
+  @postcon The selected entries are deleted from the registry and the list.
 
-  @param   Sender as a TObject
-  @param   Item   as a TListItem
+  @param   lvList as a TListView
 
 **/
-void __fastcall TfrmExpertManager::lvKnownIDEPackagesItemChecked(TObject *Sender, TListItem *Item) {
-  if (!FUpdatingListView) {
-    lvKnownIDEPackages->ItemIndex =  Item->Index;
-    String strRegSection = GetRegPathToNode(tvExpertInstallations->Selected);
-    String strExpertName = Item->Caption;
-    String strExpertFileName = Item->SubItems->Strings[0];
-    TUPIniFile iniFile( new TRegistryINIFileCls(strRegSection) );
-    if (!Item->Checked)
-      strExpertName = "__" + strExpertName;
-    iniFile->WriteString(strKnownIDEPackages, strExpertFileName, strExpertName);
-    UpdateTreeViewStatus(tvExpertInstallations->Selected, true);
-  }
+void __fastcall TfrmExpertManager::DeleteSelectedEntries(TListView* lvList) {
+  std::vector<int> Rows;
+  SelectedRows(lvList, Rows);
+  const TEMEntryIDList& ListedRows = ListRows(lvList);
+  std::wstring strRegPath = GetRegPathToNode(tvExpertInstallations->Selected).c_str();
+  TEMRegistryWriteBatch Batch;
+  for (size_t i = 0; i < Rows.size(); i++)
+    EMDeleteEntry(Batch, strRegPath, FCurrentEntries->Entry(ListedRows[Rows[i]]));
+  ApplyBatch(Batch);
+  DeleteRows(lvList, Rows);
 }
 
 /**
 
-  This is an item checked event handler for the Known Packages listview control.
+  This method applies the given batch of registry changes.
 
   @precon  None.
-  @postcon If an item is checked the package has any double underscores removed from the package name
-           else double underscore are added to the package name to disable the package.
+  @postcon The changes are applied or if any change fails none are and an exception is raised.
 
-  @param   Sender as a TObject
-  @param   Item   as a TListItem
+  @param   Batch as a TEMRegistryWriteBatch as a reference
 
 **/
-void __fastcall TfrmExpertManager::lvKnownPackagesItemChecked(TObject *Sender, TListItem *Item) {
-  if (!FUpdatingListView) {
-    lvKnownPackages->ItemIndex =  Item->Index;
-    String strRegSection = GetRegPathToNode(tvExpertInstallations->Selected);
-    String strExpertName = Item->Caption;
-    String strExpertFileName = Item->SubItems->Strings[0];
-    TUPIniFile iniFile( new TRegistryINIFileCls(strRegSection) );
-    if (!Item->Checked)
-      strExpertName = "__" + strExpertName;
-    iniFile->WriteString(strKnownPackages, strExpertFileName, strExpertName);
-    UpdateTreeViewStatus(tvExpertInstallations->Selected, true);
-  }
+void __fastcall TfrmExpertManager::ApplyBatch(TEMRegistryWriteBatch& Batch) {
+  if (!Batch.Apply(*FRegistryStore))
+    throw Exception("The registry could not be updated so no changes have been made.");
 }
 
 /**
@@ -1279,13 +1985,8 @@ void __fastcall TfrmExpertManager::lvKnownPackagesItemChecked(TObject *Sender, T
 void __fastcall TfrmExpertManager::actDeleteKnownIDEPackagesExecute(TObject *Sender) {
   FUpdatingListView = true;
   __try {
-    if (tvExpertInstallations->Selected != NULL && lvKnownIDEPackages->Selected != NULL) {
-      String strPackageFileName = lvKnownIDEPackages->Selected->SubItems->Strings[0];
-      String strRegSection = GetRegPathToNode(tvExpertInstallations->Selected);
-      TUPIniFile iniFile( new TRegistryINIFileCls(strRegSection + strKnownIDEPackages) );
-      iniFile->DeleteValue(strPackageFileName);
-      UpdateTreeViewStatus(tvExpertInstallations->Selected, true);
-    }
+    if (tvExpertInstallations->Selected != NULL && lvKnownIDEPackages->Selected != NULL)
+      DeleteSelectedEntries(lvKnownIDEPackages);
   } __finally {
     FUpdatingListView = false;
   }
@@ -1307,13 +2008,11 @@ void __fastcall TfrmExpertManager::actAddKnownIDEPackageExecute(TObject *Sender)
     String strPackageName = "";
     String strPackageFileName = "";
     if (TfrmExpertEditor::Execute(dtPackage, strPackageName, strPackageFileName, ExpandRADStudioMacros)) {
-      TListItem* Item = lvKnownIDEPackages->Items->Add();
-      Item->Caption = strPackageName;
-      Item->SubItems->Add(strPackageFileName);
-      String strRegSection = GetRegPathToNode(tvExpertInstallations->Selected);
-      TUPIniFile iniFile = TUPIniFile( new TRegistryINIFileCls(strRegSection) );
-      iniFile->WriteString(strKnownIDEPackages, strPackageFileName, strPackageName);
-      UpdateTreeViewStatus(tvExpertInstallations->Selected, true);
+      TEMEntry Entry = MakeEntry(esKnownIDEPackages, strPackageName, strPackageFileName, true);
+      TEMRegistryWriteBatch Batch;
+      EMWriteEntry(Batch, GetRegPathToNode(tvExpertInstallations->Selected).c_str(), Entry);
+      ApplyBatch(Batch);
+      AddRow(lvKnownIDEPackages, Entry);
     }
   } __finally {
     FUpdatingListView = false;
@@ -1331,21 +2030,18 @@ void __fastcall TfrmExpertManager::actAddKnownIDEPackageExecute(TObject *Sender)
 
 **/
 void __fastcall TfrmExpertManager::actEditKnownIDEPackageExecute(TObject *Sender) {
-  String strPackageName = lvKnownIDEPackages->Selected->Caption;
-  String strPackageFileName = lvKnownIDEPackages->Selected->SubItems->Strings[0];
-  bool boolEnabled = lvKnownIDEPackages->Selected->Checked;
-  String strOldPackageFileName = strPackageFileName;
+  int iRow = lvKnownIDEPackages->Selected->Index;
+  TEMEntry OldEntry = FCurrentEntries->Entry(FKnownIDEPackageRows[iRow]);
+  String strPackageName = OldEntry.Name.Text().c_str();
+  String strPackageFileName = OldEntry.FileName.Text().c_str();
   if (TfrmExpertEditor::Execute(dtPackage, strPackageName, strPackageFileName, ExpandRADStudioMacros)) {
-    lvKnownIDEPackages->Selected->SubItems->Strings[0] = strPackageFileName;
-    lvKnownIDEPackages->Selected->Caption = strPackageName;
-    String strRegSection = GetRegPathToNode(tvExpertInstallations->Selected);
-    TUPIniFile iniFile( new TRegistryINIFileCls(strRegSection) );
-    iniFile->WriteString(strKnownIDEPackages, strPackageFileName, strPackageName);
-    if(strOldPackageFileName.Compare(strPackageFileName) != 0) {
-      TUPIniFile iniFile( new TRegistryINIFileCls(strRegSection + strKnownIDEPackages) );
-      iniFile->DeleteValue(strOldPackageFileName);
-    }
-    UpdateTreeViewStatus(tvExpertInstallations->Selected, true);
+    TEMEntry Entry = MakeEntry(esKnownIDEPackages, strPackageName, strPackageFileName, OldEntry.boolEnabled);
+    std::wstring strRegPath = GetRegPathToNode(tvExpertInstallations->Selected).c_str();
+    TEMRegistryWriteBatch Batch;
+    EMDeleteEntry(Batch, strRegPath, OldEntry);
+    EMWriteEntry(Batch, strRegPath, Entry);
+    ApplyBatch(Batch);
+    UpdateRow(lvKnownIDEPackages, iRow, Entry);
   }
 }
 
@@ -1411,13 +2107,11 @@ void __fastcall TfrmExpertManager::actAddKnownPackageExecute(TObject *Sender) {
     String strPackageName = "";
     String strPackageFileName = "";
     if (TfrmExpertEditor::Execute(dtPackage, strPackageName, strPackageFileName, ExpandRADStudioMacros)) {
-      TListItem* Item = lvKnownPackages->Items->Add();
-      Item->Caption = strPackageName;
-      Item->SubItems->Add(strPackageFileName);
-      String strRegSection = GetRegPathToNode(tvExpertInstallations->Selected);
-      TUPIniFile iniFile = TUPIniFile( new TRegistryINIFileCls(strRegSection) );
-      iniFile->WriteString(strKnownPackages, strPackageFileName, strPackageName);
-      UpdateTreeViewStatus(tvExpertInstallations->Selected, true);
+      TEMEntry Entry = MakeEntry(esKnownPackages, strPackageName, strPackageFileName, true);
+      TEMRegistryWriteBatch Batch;
+      EMWriteEntry(Batch, GetRegPathToNode(tvExpertInstallations->Selected).c_str(), Entry);
+      ApplyBatch(Batch);
+      AddRow(lvKnownPackages, Entry);
     }
   } __finally {
     FUpdatingListView = false;
@@ -1435,21 +2129,18 @@ void __fastcall TfrmExpertManager::actAddKnownPackageExecute(TObject *Sender) {
 
 **/
 void __fastcall TfrmExpertManager::actEditKnownPackagesExecute(TObject *Sender) {
-  String strPackageName = lvKnownPackages->Selected->Caption;
-  String strPackageFileName = lvKnownPackages->Selected->SubItems->Strings[0];
-  bool boolEnabled = lvKnownPackages->Selected->Checked;
-  String strOldPackageFileName = strPackageFileName;
+  int iRow = lvKnownPackages->Selected->Index;
+  TEMEntry OldEntry = FCurrentEntries->Entry(FKnownPackageRows[iRow]);
+  String strPackageName = OldEntry.Name.Text().c_str();
+  String strPackageFileName = OldEntry.FileName.Text().c_str();
   if (TfrmExpertEditor::Execute(dtPackage, strPackageName, strPackageFileName, ExpandRADStudioMacros)) {
-    lvKnownPackages->Selected->SubItems->Strings[0] = strPackageFileName;
-    lvKnownPackages->Selected->Caption = strPackageName;
-    String strRegSection = GetRegPathToNode(tvExpertInstallations->Selected);
-    TUPIniFile iniFile( new TRegistryINIFileCls(strRegSection) );
-    iniFile->WriteString(strKnownPackages, strPackageFileName, strPackageName);
-    if(strOldPackageFileName.Compare(strPackageFileName) != 0) {
-      TUPIniFile iniFile( new TRegistryINIFileCls(strRegSection + strKnownPackages) );
-      iniFile->DeleteValue(strOldPackageFileName);
-    }
-    UpdateTreeViewStatus(tvExpertInstallations->Selected, true);
+    TEMEntry Entry = MakeEntry(esKnownPackages, strPackageName, strPackageFileName, OldEntry.boolEnabled);
+    std::wstring strRegPath = GetRegPathToNode(tvExpertInstallations->Selected).c_str();
+    TEMRegistryWriteBatch Batch;
+    EMDeleteEntry(Batch, strRegPath, OldEntry);
+    EMWriteEntry(Batch, strRegPath, Entry);
+    ApplyBatch(Batch);
+    UpdateRow(lvKnownPackages, iRow, Entry);
   }
 }
 
@@ -1466,13 +2157,8 @@ void __fastcall TfrmExpertManager::actEditKnownPackagesExecute(TObject *Sender)
 void __fastcall TfrmExpertManager::actDeleteKnownPackagesExecute(TObject *Sender) {
   FUpdatingListView = true;
   __try {
-    if (tvExpertInstallations->Selected != NULL && lvKnownPackages->Selected != NULL) {
-      String strPackageFileName = lvKnownPackages->Selected->SubItems->Strings[0];
-      String strRegSection = GetRegPathToNode(tvExpertInstallations->Selected);
-      TUPIniFile iniFile( new TRegistryINIFileCls(strRegSection + strKnownPackages) );
-      iniFile->DeleteValue(strPackageFileName);
-      UpdateTreeViewStatus(tvExpertInstallations->Selected, true);
-    }
+    if (tvExpertInstallations->Selected != NULL && lvKnownPackages->Selected != NULL)
+      DeleteSelectedEntries(lvKnownPackages);
   } __finally {
     FUpdatingListView = false;
   }
@@ -1492,3 +2178,162 @@ void __fastcall TfrmExpertManager::lvKnownPackagesDblClick(TObject *Sender) {
   actEditKnownPackagesExecute(Sender);
 }
 
+/**
+
+  This is an on execute event handler for the Rescan action.
+
+  @precon  None.
+  @postcon Cancels any scan in progress, re-reads the registry and rescans all the installations
+           (ignoring the scan cache) restoring the expanded and selected nodes.
+
+  @param   Sender as a TObject
+
+**/
+void __fastcall TfrmExpertManager::actRescanExecute(TObject *Sender) {
+  String strSelectedPath = FExpandedNodeManager->ConvertNodeToPath(tvExpertInstallations->Selected);
+  SaveExpandedNodes();
+  IterateExpertInstallations(false);
+  SelectTreeViewNode(strSelectedPath);
+}
+
+
+/**
+
+  This method returns the registry paths of the installations at or beneath the given tree node.
+
+  @precon  Node must be a valid instance.
+  @postcon RegPaths contains the installations in the node's sub-tree.
+
+  @param   Node     as a TTreeNode
+  @param   RegPaths as a TEMNameList as a reference
+
+**/
+void __fastcall TfrmExpertManager::InstallationsBeneath(TTreeNode* Node, TEMNameList& RegPaths) {
+  RegPaths.clear();
+  if (Node->Level == 2) {
+    RegPaths.push_back(GetRegPathToNode(Node).c_str());
+    return;
+  }
+  for (TTreeNode* N = Node->getFirstChild(); N != NULL; N = N->GetNext()) {
+    if (N->Level <= Node->Level)
+      break;
+    if (N->Level == 2)
+      RegPaths.push_back(GetRegPathToNode(N).c_str());
+  }
+}
+
+/**
+
+  This method plans the given bulk operation against the entries of the installations beneath
+  the selected tree node and once confirmed writes all the changes to the registry in a single
+  batch and revalidates the changed installations once. Experts which are skipped because an
+  expert of the same name is already in the other key are reported in the confirmation.
+
+  @precon  None.
+  @postcon The matching entries are enabled, disabled or deleted.
+
+  @param   eAction        as a TEMBulkAction as a constant
+  @param   Filter         as a TEMBulkFilter as a constant reference
+  @param   strDescription as a String as a constant
+
+**/
+void __fastcall TfrmExpertManager::ExecuteBulkPlan(const TEMBulkAction eAction,
+  const TEMBulkFilter& Filter, const String strDescription) {
+  TEMNameList RegPaths;
+  InstallationsBeneath(tvExpertInstallations->Selected, RegPaths);
+  TEMBulkPlan Plan(eAction);
+  FFileSystem->Invalidate();
+  EMPlanBulkOperation(TEMInstallationScanner(FSnapshot, *FFileSystem, *FMacroCache), RegPaths,
+    Filter, Plan);
+  String strSkipped;
+  for (size_t i = 0; i < Plan.Collisions().size(); i++) {
+    const TEMBulkChange& Collision = Plan.Collisions()[i];
+    strSkipped += "\n  " + String(Collision.OldEntry.Name.Text().c_str()) + " (" +
+      String(Collision.strRegPath.c_str()) + ")";
+  }
+  if (!strSkipped.IsEmpty())
+    strSkipped = "\n\nThese experts are skipped as an expert of the same name is already " +
+      String(eAction == baEnable ? "enabled" : "disabled") + ":" + strSkipped;
+  if (Plan.Changes().empty()) {
+    ShowMessage("There are no entries to " + strDescription + "." + strSkipped);
+    return;
+  }
+  TEMNameList Changed;
+  Plan.Installations(Changed);
+  if (MessageDlg(Format("Are you sure you want to %s %d entries in %d installations?",
+    ARRAYOFCONST((strDescription, (int)Plan.Changes().size(), (int)Changed.size()))) + strSkipped,
+    mtConfirmation, TMsgDlgButtons() << mbYes << mbNo, 0) != mrYes)
+    return;
+  TEMRegistryWriteBatch Batch;
+  Plan.Build(Batch);
+  ApplyBatch(Batch);
+  RevalidateInstallations(Changed);
+  for (size_t i = 0; i < Changed.size(); i++)
+    MarkStale(Changed[i]);
+}
+
+/**
+
+  This is an on execute event handler for the Bulk Enable action.
+
+  @precon  None.
+  @postcon All the disabled entries beneath the selected node are enabled.
+
+  @param   Sender as a TObject
+
+**/
+void __fastcall TfrmExpertManager::actBulkEnableExecute(TObject *Sender) {
+  ExecuteBulkPlan(baEnable, TEMBulkFilter(), "enable");
+}
+
+/**
+
+  This is an on execute event handler for the Bulk Disable action.
+
+  @precon  None.
+  @postcon The enabled entries beneath the selected node whose names or filenames match the mask
+           entered by the user are disabled.
+
+  @param   Sender as a TObject
+
+**/
+void __fastcall TfrmExpertManager::actBulkDisableExecute(TObject *Sender) {
+  String strMask = "*";
+  if (InputQuery("Disable Matching Entries", "Name or filename mask (* and ?):", strMask)) {
+    TEMBulkFilter Filter;
+    Filter.strMask = strMask.c_str();
+    ExecuteBulkPlan(baDisable, Filter, "disable");
+  }
+}
+
+/**
+
+  This is an on execute event handler for the Bulk Purge Invalid action.
+
+  @precon  None.
+  @postcon The entries beneath the selected node whose files do not exist are deleted.
+
+  @param   Sender as a TObject
+
+**/
+void __fastcall TfrmExpertManager::actBulkPurgeInvalidExecute(TObject *Sender) {
+  TEMBulkFilter Filter;
+  Filter.boolInvalidOnly = true;
+  ExecuteBulkPlan(baDelete, Filter, "delete");
+}
+
+/**
+
+  This is an on update event handler for the bulk actions.
+
+  @precon  None.
+  @postcon The bulk actions are only enabled if a tree node is selected.
+
+  @param   Sender as a TObject
+
+**/
+void __fastcall TfrmExpertManager::actBulkUpdate(TObject *Sender) {
+  TAction* Action = dynamic_cast<TAction*>(Sender);
+  if (Action)
+    Action->Enabled = tvExpertInstallations->Selected != NULL;
+}
@@ -20,25 +20,30 @@
 #include <Vcl.Menus.hpp>
 #include <ExpandedNodeManager.h>
 #include "ExpertManagerProgressMgr.h"
+#include "ExpertManagerRegistryStore.h"
+#include "ExpertManagerRegistryWatcher.h"
+#include "ExpertManagerWriteBatch.h"
+#include "ExpertManagerBulk.h"
+#include "ExpertManagerScanner.h"
+#include "ExpertManagerWorkerPool.h"
+#include "ExpertManagerScanCache.h"
+#include "ExpertManagerUsageIndex.h"
+#include "ExpertManagerSearchIndex.h"
 #include <memory>
-#include <System.RegularExpressions.hpp>
-#include <System.RegularExpressionsCore.hpp>
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
 #ifdef DEBUG
   #include "CodeSiteLogging.hpp"
 #endif
 
-/**
-  This is an enumerate to define the state of the tree nodes as follows:
-    evNone         Denotes a standard tree node which does not represent an expert
-                   instance.
-    evOkay         A node for an expert instance that has all valid entries.
-    evInvalidPath  A node for an expert instance that has invalid paths / filenames.
-    evDuplication  A node     for an expert instance that has duplicate filenames (not paths).
-**/
-enum TExpertValidation {evNone, evOkay, evInvalidPaths, evDuplication};
+/** A message posted by the scan workers to tell the form that results are waiting to be merged. **/
+const UINT WM_EMSCANRESULT = WM_APP + 1;
+/** A message posted by the registry notifier to tell the form that registry keys have changed. **/
+const UINT WM_EMREGISTRYCHANGED = WM_APP + 2;
 
 /** This is a type to represent a set of expert validation enumerates. **/
-typedef Set<TExpertValidation, evNone, evDuplication> TExpertValidations;
+typedef Set<TExpertValidation, evNone, evMissingDependencies> TExpertValidations;
 
 /** A class to represent a form for displaying the expert installations in a treeview. **/
 class TfrmExpertManager : public TForm
@@ -73,6 +78,26 @@ __published: // IDE-managed Components
   TAction *actEditKnownPackages;
   TAction *actDeleteKnownPackages;
   TImageList *ilTabStatus;
+  TAction *actRescan;
+  TPopupActionBar *pabTreeContextMenu;
+  TMenuItem *Rescan1;
+  TAction *actBulkEnable;
+  TAction *actBulkDisable;
+  TAction *actBulkPurgeInvalid;
+  TMenuItem *N1;
+  TMenuItem *EnableAllEntries1;
+  TMenuItem *DisableMatchingEntries1;
+  TMenuItem *PurgeInvalidEntries1;
+  TAction *actLazyValidation;
+  TMenuItem *ValidateOnlyVisibleInstallations1;
+  TAction *actRecordTrace;
+  TAction *actSaveTrace;
+  TMenuItem *N2;
+  TMenuItem *RecordTrace1;
+  TMenuItem *SaveTrace1;
+  TSplitter *splUsedBy;
+  TListView *lvUsedBy;
+  TEdit *edtSearch;
   void __fastcall FormCreate(TObject *Sender);
   void __fastcall FormDestroy(TObject *Sender);
   void __fastcall FormShow(TObject *Sender);
@@ -88,9 +113,10 @@ __published: // IDE-managed Components
   void __fastcall actActionExpertUpdate(TObject *Sender);
   void __fastcall actAddExpertPackageUpdate(TObject *Sender);
   void __fastcall actFileExitExecute(TObject *Sender);
-  void __fastcall lvInstalledExpertsItemChecked(TObject *Sender, TListItem *Item);
-  void __fastcall lvKnownIDEPackagesItemChecked(TObject *Sender, TListItem *Item);
-  void __fastcall lvKnownPackagesItemChecked(TObject *Sender, TListItem *Item);
+  void __fastcall lvEntriesData(TObject *Sender, TListItem *Item);
+  void __fastcall lvEntriesMouseDown(TObject *Sender, TMouseButton Button, TShiftState Shift,
+    int X, int Y);
+  void __fastcall lvEntriesKeyDown(TObject *Sender, WORD &Key, TShiftState Shift);
   void __fastcall actDeleteKnownIDEPackagesExecute(TObject *Sender);
   void __fastcall actAddKnownIDEPackageExecute(TObject *Sender);
   void __fastcall actEditKnownIDEPackageExecute(TObject *Sender);
@@ -101,53 +127,136 @@ __published: // IDE-managed Components
   void __fastcall actAddKnownPackageExecute(TObject *Sender);
   void __fastcall actEditKnownPackagesExecute(TObject *Sender);
   void __fastcall lvKnownPackagesDblClick(TObject *Sender);
+  void __fastcall actRescanExecute(TObject *Sender);
+  void __fastcall actBulkEnableExecute(TObject *Sender);
+  void __fastcall actBulkDisableExecute(TObject *Sender);
+  void __fastcall actBulkPurgeInvalidExecute(TObject *Sender);
+  void __fastcall actBulkUpdate(TObject *Sender);
+  void __fastcall tvExpertInstallationsExpanded(TObject *Sender, TTreeNode *Node);
+  void __fastcall actLazyValidationExecute(TObject *Sender);
+  void __fastcall actRecordTraceExecute(TObject *Sender);
+  void __fastcall actSaveTraceExecute(TObject *Sender);
+  void __fastcall actSaveTraceUpdate(TObject *Sender);
+  void __fastcall lvEntriesSelectItem(TObject *Sender, TListItem *Item, bool Selected);
+  void __fastcall lvUsedByData(TObject *Sender, TListItem *Item);
+  void __fastcall lvUsedByDblClick(TObject *Sender);
+  void __fastcall edtSearchChange(TObject *Sender);
 private: // Constants
   const TColor iNoneColour        = (TColor)0x0000FF; // Red
   const TColor iOkayColour        = (TColor)0x008000; // Dark Green
   const TColor iInvalidPathColour = (TColor)0x808080; // Dark Grey
   const TColor iDuplicateColour   = (TColor)0x000080; // Dark Red
+  const TColor iMissingDependencyColour = (TColor)0x0080FF; // Orange
+  const size_t iMaxSearchResults  = 1000;
 private:
   std::unique_ptr<TExpandedNodeManager> FExpandedNodeManager;
-  std::unique_ptr<TStringList>          FCurrentRADStudioMacros;
-  std::unique_ptr<TRegEx>               FBDSMacroRegEx;
-  std::unique_ptr<TRegEx>               FBDSPathPatternRegEx;
+  TEMMacroTablePtr                      FCurrentMacros;
   bool                                  FUpdatingListView;
   String                                FSelectedNodePath;
   String                                FLastExpertViewName;
   String                                FLastKnownIDEPackagesViewName;
   String                                FLastKnownPackagesViewName;
   std::unique_ptr<TEMProgressMgr>       FProgressMgr;
+  std::unique_ptr<TEMRegistryStore>     FRegistryStore;
+  TEMSnapshotPtr                        FSnapshot;
+  std::unique_ptr<TEMCachedFileSystem>  FFileSystem;
+  std::unique_ptr<TEMMacroCache>        FMacroCache;
+  std::unique_ptr<TEMModuleCache>       FModuleCache;
+  TEMEntriesPtr                         FCurrentEntries;
+  TEMEntryIDList                        FExpertRows;
+  TEMEntryIDList                        FKnownIDEPackageRows;
+  TEMEntryIDList                        FKnownPackageRows;
+  std::unordered_map<std::wstring, size_t> FStaleInstallations;
+  std::unique_ptr<TEMWorkerPool>        FWorkerPool;
+  TEMInstallationIndex                  FInstallations;
+  std::unordered_map<TTreeNode*, int>   FInstallationIDs;
+  TEMUsageIndex                         FUsageIndex;
+  TEMSearchIndex                        FSearchIndex;
+  TEMUsageList                          FUsedByRows;
+  std::vector<TTreeNode*>               FPendingNodes;
+  std::vector<unsigned long long>       FPendingStamps;
+  std::vector<bool>                     FQueuedNodes;
+  std::vector<bool>                     FProvisionalNodes;
+  bool                                  FIndexPending = false;
+  std::shared_ptr<TEMInstallationScanner> FScanner;
+  bool                                  FLazyValidation;
+  std::unique_ptr<TEMScanCache>         FScanCache;
+  std::shared_ptr<TEMResultQueue<TEMInstallationResult> > FScanResults;
+  TEMCancelTokenPtr                     FScanCancelToken;
+  std::shared_ptr<TEMResultQueue<std::wstring> > FRegistryChanges;
+  TEMRegistryNotifierPtr                FRegistryNotifier;
+  TEMNameList                           FWatchedRoots;
+  TEMRegistryWatchList                  FWatches;
   int                                   FIteration = 1;
 protected:
   void __fastcall LoadSettings();
   void __fastcall SaveSettings();
-  void __fastcall IterateExpertInstallations();
+  void __fastcall IterateExpertInstallations(const bool boolUseCache);
   void __fastcall IterateSubInstallations(TTreeNode *Node, String strRootInstallation);
   void __fastcall IterateVersions(TTreeNode *Node, String strSubSection);
-  TExpertValidation __fastcall CheckExperts(TTreeNode *Node, String strSubSection);
-  TExpertValidation __fastcall CheckPackages(TTreeNode* Node, String strSubSection, String strPackage);
+  void __fastcall ScanInstallations(const bool boolUseCache);
+  void __fastcall QueueInstallation(const int iNode, const TEMScanCacheRecord* Record = NULL,
+    const TEMJobPriority ePriority = jpNormal);
+  void __fastcall QueueVisibleInstallations();
+  String __fastcall ScanCacheFileName();
+  void __fastcall CacheInstallation(const TEMInstallationResult& Result);
+  void __fastcall CancelScan();
+  void __fastcall MarkStale(const std::wstring& strRegPath);
+  void __fastcall UpdateAncestorStatus(TTreeNode* Node);
+  void __fastcall SaveExpandedNodes();
+  void __fastcall WMScanResult(TMessage& Message);
+  void __fastcall WMRegistryChanged(TMessage& Message);
+  void __fastcall WatchInstallations(const TEMNameList& Roots, const bool boolChangedOnly = false);
+  void __fastcall RevalidateInstallations(const TEMNameList& RegPaths);
+  void __fastcall InstallationsBeneath(TTreeNode* Node, TEMNameList& RegPaths);
+  void __fastcall ExecuteBulkPlan(const TEMBulkAction eAction, const TEMBulkFilter& Filter,
+    const String strDescription);
+  TTreeNode* __fastcall FindInstallationNode(const std::wstring& strRegPath);
   TExpertValidation __fastcall GetHighestValidation(TTreeNode* Node);
   String __fastcall GetRegPathToNode(TTreeNode* Node);
-  void __fastcall UpdateTreeViewStatus(TTreeNode* Node, const bool boolShow);
+  int __fastcall InstallationID(TTreeNode* Node);
+  void __fastcall IndexInstallation(const int iInstallationID, TEMEntriesPtr Entries,
+    const TEMMacroTable& Macros);
+  bool __fastcall IndexInstallations();
+  void __fastcall ShowSearchResults();
+  void __fastcall ShowUsedBy(TListView* lvList);
+  TEMEntry __fastcall MakeEntry(const TEMSection eSection, String strName, String strFileName,
+    const bool boolEnabled);
+  void __fastcall UpdateEntries(TListView* lvList, const TEMEntryIDList& Changed);
+  TEMEntryIDList& __fastcall ListRows(TListView* lvList);
+  void __fastcall AddRow(TListView* lvList, const TEMEntry& Entry);
+  void __fastcall UpdateRow(TListView* lvList, const int iRow, const TEMEntry& Entry);
+  void __fastcall DeleteRows(TListView* lvList, const std::vector<int>& Rows);
+  void __fastcall SelectedRows(TListView* lvList, std::vector<int>& Rows);
+  void __fastcall ToggleEntries(TListView* lvList, const std::vector<int>& Rows,
+    const bool boolEnabled);
+  void __fastcall DeleteSelectedEntries(TListView* lvList);
+  void __fastcall ApplyBatch(TEMRegistryWriteBatch& Batch);
   bool __fastcall IsViewableNode(TTreeNode* Node);
-  void __fastcall GetExpandedNodes(TTreeNode* Node);
-  void __fastcall SetExpandedNodes(TTreeNode* Node);
+  void __fastcall GetExpandedNodes(TTreeNode* Node, const String& strParentPath);
+  void __fastcall SetExpandedNodes(TTreeNode* Node, const String& strParentPath);
   void __fastcall GetCurrentRADStudioMacros(String strRegPathToRADStudioRoot);
   String __fastcall ExpandRADStudioMacros(String strFullFileName);
-  void __fastcall AddRADStudioMacro(String strMacro, String strValue);
   void __fastcall GetVersionAndBuild();
-  void __fastcall AddExpertsToList(TListView* lvList, String strSubSection, String strKey, bool boolEnabled, TStringList* slDups);
-  void __fastcall AddPackagesToList(TListView* lvList, String strSubSection, String strKey);
+  void __fastcall AddExpertsToList(TListView* lvList, String strSubSection,
+    const TEMInstallationEntries& Entries);
+  void __fastcall AddPackagesToList(TListView* lvList, String strSubSection,
+    const TEMInstallationEntries& Entries, const TEMSection eSection);
   void __fastcall ShowExperts(TTreeNode *Node);
   void __fastcall SelectTreeViewNode(const String strSelectedPath);
-  void __fastcall GetPackageList(TStringList* slPackages, const String strSubSection, const String strKey);
-  void __fastcall RenderPackageList(TListView* lvList, TStringList* slPackages, String &strLastViewName, const String strViewName);
+  void __fastcall RenderPackageList(TListView* lvList, const TEMInstallationEntries& Entries,
+    const TEMSection eSection, String &strLastViewName, const String strViewName);
   void __fastcall GetCurrentPosition(TListView* lvList, String &strLastViewName, const String strViewName, int &iSelected);
   void __fastcall SetCurrentPosition(TListView* lvList, int &iSelected);
   void SetTabStatus(TTabSheet* TabSheet, const TExpertValidation eStatus);
+  void SetTabStatuses();
   void SetNodeStatus(TTreeNode* Node, const TExpertValidation eStatus);
 public:      // User declarations
   __fastcall TfrmExpertManager(TComponent* Owner);
+  BEGIN_MESSAGE_MAP
+    VCL_MESSAGE_HANDLER(WM_EMSCANRESULT, TMessage, WMScanResult)
+    VCL_MESSAGE_HANDLER(WM_EMREGISTRYCHANGED, TMessage, WMRegistryChanged)
+  END_MESSAGE_MAP(TForm)
 };
 
 extern PACKAGE TfrmExpertManager *frmExpertManager;
@@ -0,0 +1,37 @@
+#ifndef ExpertManagerTestsH
+#define ExpertManagerTestsH
+
+#include <cstdio>
+
+/** The number of checks which have failed in the running test program. **/
+static int iEMTestFailures = 0;
+
+/** This macro checks that the given condition is true and reports the file and line if not. **/
+#define EMCheck(boolCondition)                                                                    \
+  do {                                                                                            \
+    if (!(boolCondition)) {                                                                       \
+      std::printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #boolCondition);              \
+      iEMTestFailures++;                                                                          \
+    }                                                                                             \
+  } while (false)
+
+/**
+
+  This function reports the outcome of the named test program.
+
+  @precon  None.
+  @postcon Writes a summary line and returns the exit code for the test program.
+
+  @param   strName as a const char pointer
+  @return  an int
+
+**/
+static inline int EMTestResult(const char* strName) {
+  if (iEMTestFailures == 0)
+    std::printf("%s: passed\n", strName);
+  else
+    std::printf("%s: %d check(s) failed\n", strName, iEMTestFailures);
+  return iEMTestFailures == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,210 @@
+#include "ExpertManagerTests.h"
+#include "ExpertManagerBulk.h"
+
+/** The registry text of an installation with an expert (Both) in both the Experts and
+    Experts\Disabled keys, an expert and a disabled package whose files are missing. **/
+static const char* strRegistry =
+  "[Software\\Embarcadero\\BDS\\19.0]\n"
+  "RootDir=C:\\Studio\\19.0\n"
+  "[Software\\Embarcadero\\BDS\\19.0\\Experts]\n"
+  "GExperts=$(BDS)\\bin\\GExperts.dll\n"
+  "Both=C:\\Both\\Enabled.dll\n"
+  "Missing=C:\\Missing\\Missing.dll\n"
+  "[Software\\Embarcadero\\BDS\\19.0\\Experts\\Disabled]\n"
+  "CnPack=C:\\CnPack\\CnWizards.dll\n"
+  "Both=C:\\Both\\Disabled.dll\n"
+  "[Software\\Embarcadero\\BDS\\19.0\\Known Packages]\n"
+  "C:\\Packages\\Package.bpl=Package\n"
+  "C:\\Packages\\Gone.bpl=__Gone\n";
+
+/** The registry path of the installation. **/
+static const std::wstring strRegPath = L"Software\\Embarcadero\\BDS\\19.0\\";
+
+/** This class holds a store loaded with the installation and the scanner to plan against it. **/
+class TEMBulkFixture {
+  private:
+    TEMMacroCache FMacroCache;
+  public:
+    TEMFileRegistryStore Store;
+    TEMMemoryFileSystem  FileSystem;
+    TEMBulkFixture() {
+      Store.LoadFromUTF8(strRegistry);
+      FileSystem.AddFile(L"C:\\Studio\\19.0\\bin\\GExperts.dll");
+      FileSystem.AddFile(L"C:\\Both\\Enabled.dll");
+      FileSystem.AddFile(L"C:\\Both\\Disabled.dll");
+      FileSystem.AddFile(L"C:\\CnPack\\CnWizards.dll");
+      FileSystem.AddFile(L"C:\\Packages\\Package.bpl");
+    };
+    /**
+
+      This method plans the given action against the installation as it is in the store.
+
+      @precon  None.
+      @postcon The plan holds the changes and collisions.
+
+      @param   Filter as a TEMBulkFilter as a constant reference
+      @param   Plan   as a TEMBulkPlan as a reference
+
+    **/
+    void Plan(const TEMBulkFilter& Filter, TEMBulkPlan& Plan) {
+      TEMNameList Roots(1, L"Software\\Embarcadero");
+      TEMSnapshotPtr Snapshot = TEMRegistrySnapshot::Create(Store, Roots,
+        TEMRegistrySnapshot::InstallationFilter);
+      TEMInstallationScanner Scanner(Snapshot, FileSystem, FMacroCache);
+      EMPlanBulkOperation(Scanner, TEMNameList(1, strRegPath), Filter, Plan);
+    };
+    /**
+
+      This method returns the value of the named value in the given key of the installation.
+
+      @precon  None.
+      @postcon Returns the value or "(none)" if it does not exist.
+
+      @param   strKey  as a std::wstring as a constant reference
+      @param   strName as a std::wstring as a constant reference
+      @return  a std::wstring
+
+    **/
+    std::wstring Value(const std::wstring& strKey, const std::wstring& strName) {
+      std::wstring strValue = L"(none)";
+      if (Store.OpenKey(strRegPath + strKey, false))
+        Store.ReadValue(strName, strValue);
+      Store.CloseKey();
+      return strValue;
+    };
+};
+
+/**
+
+  This function returns the names of the old entries of the given changes.
+
+  @precon  None.
+  @postcon Returns the names in the order of the changes.
+
+  @param   Changes as a std::vector<TEMBulkChange> as a constant reference
+  @return  a TEMNameList
+
+**/
+static TEMNameList Names(const std::vector<TEMBulkChange>& Changes) {
+  TEMNameList Names;
+  for (size_t i = 0; i < Changes.size(); i++)
+    Names.push_back(Changes[i].OldEntry.Name.Text());
+  return Names;
+}
+
+/**
+
+  This function checks that enabling everything enables the disabled expert and package but skips
+  the expert whose name is already enabled and leaves both of its entries as they were.
+
+  @precon  None.
+  @postcon Checks the plan and the store after it is applied.
+
+**/
+static void TestEnable() {
+  TEMBulkFixture Fixture;
+  TEMBulkPlan Plan(baEnable);
+  Fixture.Plan(TEMBulkFilter(), Plan);
+  TEMNameList Expected;
+  Expected.push_back(L"CnPack");
+  Expected.push_back(L"Gone");
+  EMCheck(Names(Plan.Changes()) == Expected);
+  EMCheck(Names(Plan.Collisions()) == TEMNameList(1, L"Both"));
+  TEMRegistryWriteBatch Batch;
+  Plan.Build(Batch);
+  EMCheck(Batch.Apply(Fixture.Store));
+  EMCheck(Fixture.Value(L"Experts", L"CnPack") == L"C:\\CnPack\\CnWizards.dll");
+  EMCheck(Fixture.Value(L"Experts\\Disabled", L"CnPack") == L"(none)");
+  EMCheck(Fixture.Value(L"Experts", L"Both") == L"C:\\Both\\Enabled.dll");
+  EMCheck(Fixture.Value(L"Experts\\Disabled", L"Both") == L"C:\\Both\\Disabled.dll");
+  EMCheck(Fixture.Value(L"Known Packages", L"C:\\Packages\\Gone.bpl") == L"Gone");
+}
+
+/**
+
+  This function checks that disabling everything disables the enabled experts and package but
+  skips the expert whose name is already disabled.
+
+  @precon  None.
+  @postcon Checks the plan and the store after it is applied.
+
+**/
+static void TestDisable() {
+  TEMBulkFixture Fixture;
+  TEMBulkPlan Plan(baDisable);
+  Fixture.Plan(TEMBulkFilter(), Plan);
+  EMCheck(Plan.Changes().size() == 3);
+  EMCheck(Names(Plan.Collisions()) == TEMNameList(1, L"Both"));
+  TEMRegistryWriteBatch Batch;
+  Plan.Build(Batch);
+  EMCheck(Batch.Apply(Fixture.Store));
+  EMCheck(Fixture.Value(L"Experts", L"GExperts") == L"(none)");
+  EMCheck(Fixture.Value(L"Experts\\Disabled", L"GExperts") == L"$(BDS)\\bin\\GExperts.dll");
+  EMCheck(Fixture.Value(L"Experts", L"Both") == L"C:\\Both\\Enabled.dll");
+  EMCheck(Fixture.Value(L"Experts\\Disabled", L"Both") == L"C:\\Both\\Disabled.dll");
+  EMCheck(Fixture.Value(L"Known Packages", L"C:\\Packages\\Package.bpl") == L"__Package");
+}
+
+/**
+
+  This function checks that deleting only the invalid entries deletes the entries whose files are
+  missing from both sections.
+
+  @precon  None.
+  @postcon Checks the plan and the store after it is applied.
+
+**/
+static void TestDeleteInvalid() {
+  TEMBulkFixture Fixture;
+  TEMBulkPlan Plan(baDelete);
+  TEMBulkFilter Filter;
+  Filter.boolInvalidOnly = true;
+  Fixture.Plan(Filter, Plan);
+  TEMNameList Expected;
+  Expected.push_back(L"Missing");
+  Expected.push_back(L"Gone");
+  EMCheck(Names(Plan.Changes()) == Expected);
+  EMCheck(Plan.Collisions().empty());
+  TEMRegistryWriteBatch Batch;
+  Plan.Build(Batch);
+  EMCheck(Batch.Apply(Fixture.Store));
+  EMCheck(Fixture.Value(L"Experts", L"Missing") == L"(none)");
+  EMCheck(Fixture.Value(L"Known Packages", L"C:\\Packages\\Gone.bpl") == L"(none)");
+  EMCheck(Fixture.Value(L"Experts", L"GExperts") == L"$(BDS)\\bin\\GExperts.dll");
+}
+
+/**
+
+  This function checks that the mask is matched against the names and filenames (ignoring case)
+  and that the sections which are not chosen are left alone.
+
+  @precon  None.
+  @postcon Checks the plans.
+
+**/
+static void TestFilter() {
+  TEMBulkFixture Fixture;
+  TEMBulkFilter Filter;
+  Filter.strMask = L"*wizards*";
+  TEMBulkPlan Plan(baEnable);
+  Fixture.Plan(Filter, Plan);
+  EMCheck(Names(Plan.Changes()) == TEMNameList(1, L"CnPack"));
+  Filter.strMask = L"*";
+  Filter.boolSections[esExperts] = false;
+  TEMBulkPlan Packages(baDelete);
+  Fixture.Plan(Filter, Packages);
+  EMCheck(Packages.Changes().size() == 2);
+  for (size_t i = 0; i < Packages.Changes().size(); i++)
+    EMCheck(Packages.Changes()[i].OldEntry.eSection == esKnownPackages);
+  TEMNameList RegPaths;
+  Packages.Installations(RegPaths);
+  EMCheck(RegPaths == TEMNameList(1, strRegPath));
+}
+
+int main() {
+  TestEnable();
+  TestDisable();
+  TestDeleteInvalid();
+  TestFilter();
+  return EMTestResult("TestBulk");
+}
@@ -0,0 +1,275 @@
+#include "ExpertManagerTests.h"
+#include "ExpertManagerEntries.h"
+#include <algorithm>
+
+/** The registry text of an installation with two experts (one a duplicate of a disabled expert)
+    and a known package whose file is missing. **/
+static const char* strRegistry =
+  "[Software\\Embarcadero\\BDS\\19.0]\n"
+  "RootDir=C:\\Studio\\19.0\n"
+  "[Software\\Embarcadero\\BDS\\19.0\\Experts]\n"
+  "GExperts=$(BDS)\\bin\\GExperts.dll\n"
+  "CnPack=C:\\CnPack\\CnWizards.dll\n"
+  "[Software\\Embarcadero\\BDS\\19.0\\Experts\\Disabled]\n"
+  "OldGExperts=C:\\Old\\GExperts.dll\n"
+  "[Software\\Embarcadero\\BDS\\19.0\\Known Packages]\n"
+  "C:\\Missing\\Missing.bpl=Missing Package\n"
+  "C:\\Packages\\Off.bpl=__Disabled Package\n";
+
+/** The registry path of the installation. **/
+static const std::wstring strRegPath = L"Software\\Embarcadero\\BDS\\19.0\\";
+
+/** This class holds an installation's entries loaded from the registry text above. **/
+class TEMTestInstallation {
+  public:
+    TEMFileRegistryStore   Store;
+    TEMSnapshotPtr         Snapshot;
+    TEMMacroTablePtr       Macros;
+    TEMMemoryFileSystem    FileSystem;
+    TEMInstallationEntries Entries;
+    TEMTestInstallation() {
+      Store.LoadFromUTF8(strRegistry);
+      TEMNameList Roots(1, L"Software\\Embarcadero");
+      Snapshot = TEMRegistrySnapshot::Create(Store, Roots, TEMRegistrySnapshot::InstallationFilter);
+      Macros = TEMMacroTablePtr(new TEMMacroTable(*Snapshot, strRegPath));
+      FileSystem.AddFile(L"C:\\Studio\\19.0\\bin\\GExperts.dll");
+      FileSystem.AddFile(L"C:\\CnPack\\CnWizards.dll");
+      FileSystem.AddFile(L"C:\\Old\\GExperts.dll");
+      FileSystem.AddFile(L"C:\\Packages\\Off.bpl");
+      FileSystem.AddFile(L"C:\\Packages\\New.bpl");
+      Entries.Load(*Snapshot, strRegPath, *Macros, FileSystem);
+    };
+};
+
+/**
+
+  This function returns a new entry for the given section.
+
+  @precon  None.
+  @postcon Returns the entry.
+
+  @param   eSection    as a TEMSection as a constant
+  @param   strName     as a wchar_t pointer as a constant
+  @param   strFileName as a wchar_t pointer as a constant
+  @param   boolEnabled as a bool as a constant
+  @param   boolExists  as a bool as a constant
+  @return  a TEMEntry
+
+**/
+static TEMEntry MakeEntry(const TEMSection eSection, const wchar_t* strName,
+  const wchar_t* strFileName, const bool boolEnabled, const bool boolExists) {
+  TEMEntry Entry;
+  Entry.eSection = eSection;
+  Entry.Name = TEMPath(strName);
+  Entry.FileName = TEMPath(strFileName);
+  Entry.boolEnabled = boolEnabled;
+  Entry.boolExists = boolExists;
+  Entry.boolDeleted = false;
+  return Entry;
+}
+
+/**
+
+  This function returns the ID of the first entry with the given name.
+
+  @precon  None.
+  @postcon Returns the ID or -1 if not found.
+
+  @param   Entries as a TEMInstallationEntries as a constant reference
+  @param   strName as a wchar_t pointer as a constant
+  @return  an int
+
+**/
+static int FindEntry(const TEMInstallationEntries& Entries, const wchar_t* strName) {
+  for (size_t i = 0; i < Entries.Count(); i++)
+    if (!Entries.Entry(i).boolDeleted && Entries.Entry(i).Name.Text() == strName)
+      return (int)i;
+  return -1;
+}
+
+/**
+
+  This function checks that the given list contains the given entry ID.
+
+  @precon  None.
+  @postcon Returns true if found.
+
+  @param   Changed  as a TEMEntryIDList as a constant reference
+  @param   iEntryID as an int as a constant
+  @return  a bool
+
+**/
+static bool Contains(const TEMEntryIDList& Changed, const int iEntryID) {
+  return std::find(Changed.begin(), Changed.end(), iEntryID) != Changed.end();
+}
+
+/**
+
+  This function checks that the rows kept by the list view (appended on add, erased on delete)
+  are the section's entries in ascending ID order so that a changed entry's row can be found by a
+  binary search.
+
+  @precon  None.
+  @postcon Checks the rows.
+
+  @param   Entries  as a TEMInstallationEntries as a constant reference
+  @param   eSection as a TEMSection as a constant
+  @param   Rows     as a TEMEntryIDList as a constant reference
+
+**/
+static void CheckRows(const TEMInstallationEntries& Entries, const TEMSection eSection,
+  const TEMEntryIDList& Rows) {
+  TEMEntryIDList EntryIDs;
+  Entries.Section(eSection, EntryIDs);
+  EMCheck(std::is_sorted(Rows.begin(), Rows.end()));
+  EMCheck(Rows == EntryIDs);
+  for (size_t i = 0; i < Rows.size(); i++)
+    EMCheck(std::lower_bound(Rows.begin(), Rows.end(), Rows[i]) - Rows.begin() == (int)i);
+}
+
+/**
+
+  This function checks the entries and validations loaded from the registry.
+
+  @precon  None.
+  @postcon Checks the loaded entries.
+
+**/
+static void TestLoad() {
+  TEMTestInstallation Installation;
+  TEMInstallationEntries& Entries = Installation.Entries;
+  EMCheck(Entries.Count() == 5);
+  TEMEntryIDList Experts, Packages;
+  Entries.Section(esExperts, Experts);
+  Entries.Section(esKnownPackages, Packages);
+  EMCheck(Experts.size() == 3);
+  EMCheck(Packages.size() == 2);
+  int iGExperts = FindEntry(Entries, L"GExperts");
+  int iOld = FindEntry(Entries, L"OldGExperts");
+  int iMissing = FindEntry(Entries, L"Missing Package");
+  int iOff = FindEntry(Entries, L"Disabled Package");
+  EMCheck(iGExperts >= 0 && Entries.Entry(iGExperts).boolExists);
+  EMCheck(iOld >= 0 && !Entries.Entry(iOld).boolEnabled);
+  EMCheck(iOff >= 0 && !Entries.Entry(iOff).boolEnabled);
+  EMCheck(iMissing >= 0 && !Entries.Entry(iMissing).boolExists);
+  EMCheck(Entries.EntryValidation(iGExperts) == evDuplication);
+  EMCheck(Entries.EntryValidation(iOld) == evDuplication);
+  EMCheck(Entries.EntryValidation(iMissing) == evInvalidPaths);
+  EMCheck(Entries.SectionValidation(esExperts) == evOkay);
+  EMCheck(Entries.SectionValidation(esKnownIDEPackages) == evOkay);
+  EMCheck(Entries.SectionValidation(esKnownPackages) == evInvalidPaths);
+  EMCheck(Entries.Validation() == evInvalidPaths);
+}
+
+/**
+
+  This function checks adding, updating, toggling and deleting entries against the section and
+  installation validations, the changed entries reported and the order of the rows.
+
+  @precon  None.
+  @postcon Checks the edits.
+
+**/
+static void TestEdits() {
+  TEMTestInstallation Installation;
+  TEMInstallationEntries& Entries = Installation.Entries;
+  TEMEntryIDList Rows, Changed;
+  Entries.Section(esExperts, Rows);
+  int iGExperts = FindEntry(Entries, L"GExperts");
+  int iOld = FindEntry(Entries, L"OldGExperts");
+  // Add a second enabled GExperts: the section now has a duplicate group
+  int iCopy = Entries.Add(MakeEntry(esExperts, L"Copy", L"C:\\Copy\\GEXPERTS.DLL", true, true),
+    Changed);
+  Rows.push_back(iCopy);
+  CheckRows(Entries, esExperts, Rows);
+  EMCheck(iCopy == 5);
+  EMCheck(Contains(Changed, iCopy));
+  EMCheck(Entries.EntryValidation(iCopy) == evDuplication);
+  EMCheck(Entries.SectionValidation(esExperts) == evDuplication);
+  EMCheck(Entries.Validation() == evDuplication);
+  // Toggle the copy off: only enabled entries count towards the section's duplicates
+  Changed.clear();
+  TEMEntry Entry = Entries.Entry(iCopy);
+  Entry.boolEnabled = false;
+  Entries.Update(iCopy, Entry, Changed);
+  EMCheck(Contains(Changed, iCopy));
+  EMCheck(!Entries.Entry(iCopy).boolEnabled);
+  EMCheck(Entries.SectionValidation(esExperts) == evOkay);
+  // Toggle it back on
+  Changed.clear();
+  Entry.boolEnabled = true;
+  Entries.Update(iCopy, Entry, Changed);
+  EMCheck(Entries.SectionValidation(esExperts) == evDuplication);
+  // Update the copy to a different file: the original and old entries remain a pair
+  Changed.clear();
+  Entries.Update(iCopy, MakeEntry(esExperts, L"Copy", L"C:\\Copy\\Other.dll", true, false),
+    Changed);
+  EMCheck(Contains(Changed, iCopy));
+  EMCheck(Entries.Entry(iCopy).Name.Text() == L"Copy");
+  EMCheck(Entries.Entry(iCopy).FileName.Text() == L"C:\\Copy\\Other.dll");
+  EMCheck(Entries.EntryValidation(iCopy) == evInvalidPaths);
+  EMCheck(Entries.EntryValidation(iGExperts) == evDuplication);
+  EMCheck(Entries.SectionValidation(esExperts) == evInvalidPaths);
+  CheckRows(Entries, esExperts, Rows);
+  // Delete the disabled duplicate: GExperts is no longer a duplicate and is reported as changed
+  Changed.clear();
+  Entries.Remove(iOld, Changed);
+  Rows.erase(std::lower_bound(Rows.begin(), Rows.end(), iOld));
+  CheckRows(Entries, esExperts, Rows);
+  EMCheck(Contains(Changed, iOld));
+  EMCheck(Contains(Changed, iGExperts));
+  EMCheck(Entries.Entry(iOld).boolDeleted);
+  EMCheck(Entries.EntryValidation(iGExperts) == evOkay);
+  // Deleting again changes nothing and IDs are not reused
+  Changed.clear();
+  Entries.Remove(iOld, Changed);
+  EMCheck(Changed.empty());
+  int iNew = Entries.Add(MakeEntry(esExperts, L"New", L"C:\\CnPack\\New.dll", true, true),
+    Changed);
+  Rows.push_back(iNew);
+  EMCheck(iNew == 6);
+  CheckRows(Entries, esExperts, Rows);
+  // Delete the missing copy: the section is valid again
+  Changed.clear();
+  Entries.Remove(iCopy, Changed);
+  Rows.erase(std::lower_bound(Rows.begin(), Rows.end(), iCopy));
+  CheckRows(Entries, esExperts, Rows);
+  EMCheck(Entries.SectionValidation(esExperts) == evOkay);
+}
+
+/**
+
+  This function checks that unresolved dependencies count towards the section's validation only
+  while the entry is enabled and that changing an entry's file clears them.
+
+  @precon  None.
+  @postcon Checks the dependencies.
+
+**/
+static void TestDependencies() {
+  TEMTestInstallation Installation;
+  TEMInstallationEntries& Entries = Installation.Entries;
+  TEMEntryIDList Changed;
+  int iCnPack = FindEntry(Entries, L"CnPack");
+  Entries.SetUnresolvedDependencies(iCnPack, TEMNameList(1, L"rtl260.bpl"));
+  EMCheck(Entries.EntryValidation(iCnPack) == evMissingDependencies);
+  EMCheck(Entries.SectionValidation(esExperts) == evMissingDependencies);
+  TEMEntry Entry = Entries.Entry(iCnPack);
+  Entry.boolEnabled = false;
+  Entries.Update(iCnPack, Entry, Changed);
+  EMCheck(Entries.SectionValidation(esExperts) == evOkay);
+  Entry.boolEnabled = true;
+  Entries.Update(iCnPack, Entry, Changed);
+  EMCheck(Entries.SectionValidation(esExperts) == evMissingDependencies);
+  Entry.FileName = TEMPath(L"C:\\CnPack\\CnWizards2.dll");
+  Entries.Update(iCnPack, Entry, Changed);
+  EMCheck(Entries.UnresolvedDependencies(iCnPack).empty());
+  EMCheck(Entries.SectionValidation(esExperts) == evOkay);
+}
+
+int main() {
+  TestLoad();
+  TestEdits();
+  TestDependencies();
+  return EMTestResult("TestEntries");
+}
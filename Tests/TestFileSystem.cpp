@@ -0,0 +1,138 @@
+#include "ExpertManagerTests.h"
+#include "ExpertManagerFileSystem.h"
+
+/** A memory file system which counts the calls the cached file system makes to it and whose
+    directories all have the same time stamp which the test can change. **/
+class TEMCountingFileSystem : public TEMMemoryFileSystem {
+  public:
+    int       iFileExists;
+    int       iTimeStamps;
+    int       iListings;
+    long long iTimeStamp;
+    TEMCountingFileSystem() : iFileExists(0), iTimeStamps(0), iListings(0), iTimeStamp(1) {};
+    bool FileExists(const std::wstring& strFileName) {
+      iFileExists++;
+      return TEMMemoryFileSystem::FileExists(strFileName);
+    };
+    bool GetTimeStamp(const std::wstring& strDirectory, long long& iTimeStamp) {
+      iTimeStamps++;
+      bool boolExists = TEMMemoryFileSystem::GetTimeStamp(strDirectory, iTimeStamp);
+      iTimeStamp = this->iTimeStamp;
+      return boolExists;
+    };
+    bool ListDirectory(const std::wstring& strDirectory, TEMNameList& FileNames) {
+      iListings++;
+      return TEMMemoryFileSystem::ListDirectory(strDirectory, FileNames);
+    };
+};
+
+/**
+
+  This function checks that a single listing of a directory answers every lookup of a file in it
+  (ignoring case) and that a missing directory is only listed once too.
+
+  @precon  None.
+  @postcon Checks the lookups and the calls to the underlying file system.
+
+**/
+static void TestSingleListing() {
+  TEMCountingFileSystem* Counting = new TEMCountingFileSystem();
+  Counting->AddFile(L"C:\\Studio\\bin\\GExperts.dll");
+  Counting->AddFile(L"C:\\Studio\\bin\\CnWizards.dll");
+  TEMCachedFileSystem FileSystem(Counting);
+  for (int i = 0; i < 10; i++) {
+    EMCheck(FileSystem.FileExists(L"C:\\Studio\\bin\\GExperts.dll"));
+    EMCheck(FileSystem.FileExists(L"c:\\studio\\BIN\\cnwizards.DLL"));
+    EMCheck(!FileSystem.FileExists(L"C:\\Studio\\bin\\Missing.dll"));
+    EMCheck(!FileSystem.FileExists(L"C:\\Missing\\Missing.dll"));
+  }
+  EMCheck(Counting->iListings == 1);
+  EMCheck(Counting->iTimeStamps == 2);
+  EMCheck(Counting->iFileExists == 0);
+}
+
+/**
+
+  This function checks that invalidating the cache only re-lists a directory whose time stamp has
+  changed and that the new listing sees the files added to it.
+
+  @precon  None.
+  @postcon Checks the lookups and the calls to the underlying file system.
+
+**/
+static void TestInvalidate() {
+  TEMCountingFileSystem* Counting = new TEMCountingFileSystem();
+  Counting->AddFile(L"C:\\Studio\\bin\\GExperts.dll");
+  TEMCachedFileSystem FileSystem(Counting);
+  EMCheck(!FileSystem.FileExists(L"C:\\Studio\\bin\\CnWizards.dll"));
+  Counting->AddFile(L"C:\\Studio\\bin\\CnWizards.dll");
+  EMCheck(!FileSystem.FileExists(L"C:\\Studio\\bin\\CnWizards.dll"));
+  FileSystem.Invalidate();
+  EMCheck(!FileSystem.FileExists(L"C:\\Studio\\bin\\CnWizards.dll"));
+  EMCheck(Counting->iListings == 1);
+  EMCheck(Counting->iTimeStamps == 2);
+  Counting->iTimeStamp++;
+  EMCheck(!FileSystem.FileExists(L"C:\\Studio\\bin\\CnWizards.dll"));
+  FileSystem.Invalidate();
+  EMCheck(FileSystem.FileExists(L"C:\\Studio\\bin\\CnWizards.dll"));
+  EMCheck(FileSystem.FileExists(L"C:\\Studio\\bin\\GExperts.dll"));
+  EMCheck(Counting->iListings == 2);
+  EMCheck(Counting->iTimeStamps == 3);
+}
+
+/**
+
+  This function checks that filenames without a directory (or with nothing after their last
+  separator) are passed to the underlying file system rather than listed.
+
+  @precon  None.
+  @postcon Checks the lookups and the calls to the underlying file system.
+
+**/
+static void TestNoDirectory() {
+  TEMCountingFileSystem* Counting = new TEMCountingFileSystem();
+  Counting->AddFile(L"GExperts.dll");
+  TEMCachedFileSystem FileSystem(Counting);
+  EMCheck(FileSystem.FileExists(L"GExperts.dll"));
+  EMCheck(!FileSystem.FileExists(L"\\CnWizards.dll"));
+  EMCheck(!FileSystem.FileExists(L"C:\\Studio\\"));
+  EMCheck(Counting->iFileExists == 3);
+  EMCheck(Counting->iListings == 0);
+  EMCheck(Counting->iTimeStamps == 0);
+}
+
+/**
+
+  This function checks that prefetching lists each distinct directory once whatever the case of
+  the filenames so that the lookups which follow need no more listings.
+
+  @precon  None.
+  @postcon Checks the lookups and the calls to the underlying file system.
+
+**/
+static void TestPrefetch() {
+  TEMCountingFileSystem* Counting = new TEMCountingFileSystem();
+  Counting->AddFile(L"C:\\Studio\\bin\\GExperts.dll");
+  Counting->AddFile(L"C:\\CnPack\\CnWizards.dll");
+  TEMCachedFileSystem FileSystem(Counting);
+  TEMNameList FileNames;
+  FileNames.push_back(L"C:\\Studio\\bin\\GExperts.dll");
+  FileNames.push_back(L"C:\\STUDIO\\BIN\\Other.dll");
+  FileNames.push_back(L"C:\\CnPack\\CnWizards.dll");
+  FileNames.push_back(L"Relative.dll");
+  FileSystem.Prefetch(FileNames);
+  EMCheck(Counting->iListings == 2);
+  EMCheck(FileSystem.FileExists(FileNames[0]));
+  EMCheck(!FileSystem.FileExists(FileNames[1]));
+  EMCheck(FileSystem.FileExists(FileNames[2]));
+  EMCheck(Counting->iListings == 2);
+  EMCheck(Counting->iFileExists == 0);
+}
+
+int main() {
+  TestSingleListing();
+  TestInvalidate();
+  TestNoDirectory();
+  TestPrefetch();
+  return EMTestResult("TestFileSystem");
+}
@@ -0,0 +1,158 @@
+#include "ExpertManagerTests.h"
+#include "ExpertManagerHeadless.h"
+#include <sstream>
+
+/**
+
+  This function fills the given store with three installations added out of order, the last
+  having an expert whose name needs escaping in JSON and one whose file may be missing.
+
+  @precon  None.
+  @postcon The installations are in the store.
+
+  @param   Store as a TEMMemoryRegistryStore as a reference
+
+**/
+static void FillStore(TEMMemoryRegistryStore& Store) {
+  const wchar_t* strVersions[3] = {L"22.0", L"19.0", L"20.0"};
+  for (auto strVersion : strVersions) {
+    std::wstring strRegPath = std::wstring(L"Software\\Embarcadero\\BDS\\") + strVersion;
+    Store.SetValue(strRegPath, L"RootDir", L"C:\\Studio\\" + std::wstring(strVersion));
+    Store.SetValue(strRegPath + L"\\Experts", L"GExperts", L"$(BDS)\\bin\\GExperts.dll");
+  }
+  Store.SetValue(L"Software\\Embarcadero\\BDS\\22.0\\Experts",
+    L"Say \"Hi\"\\\t\x01\x00e9", L"C:\\Experts\\Hi.dll");
+}
+
+/**
+
+  This function splits the given text into its lines.
+
+  @precon  None.
+  @postcon Returns the lines without their new lines.
+
+  @param   strText as a std::string as a constant reference
+  @return  a std::vector<std::string>
+
+**/
+static std::vector<std::string> Lines(const std::string& strText) {
+  std::vector<std::string> Lines;
+  std::istringstream Stream(strText);
+  std::string strLine;
+  while (std::getline(Stream, strLine))
+    Lines.push_back(strLine);
+  return Lines;
+}
+
+/**
+
+  This function returns the raw (still escaped) text of the named string field of the given JSON
+  record.
+
+  @precon  None.
+  @postcon Returns the field's text or "(none)" if the record has no such string field.
+
+  @param   strLine  as a std::string as a constant reference
+  @param   strField as a std::string as a constant reference
+  @return  a std::string
+
+**/
+static std::string Field(const std::string& strLine, const std::string& strField) {
+  std::string strKey = "\"" + strField + "\":\"";
+  size_t iStart = strLine.find(strKey);
+  if (iStart == std::string::npos)
+    return "(none)";
+  iStart += strKey.length();
+  size_t iEnd = iStart;
+  while (iEnd < strLine.length() && strLine[iEnd] != '"')
+    iEnd += strLine[iEnd] == '\\' ? 2 : 1;
+  return strLine.substr(iStart, iEnd - iStart);
+}
+
+/**
+
+  This function checks that the installations are written in the order of their registry paths
+  whatever the order they were added or completed in, each followed by its entries, and that the
+  names are escaped.
+
+  @precon  None.
+  @postcon Checks the JSON lines and the validation returned.
+
+**/
+static void TestScan() {
+  TEMMemoryRegistryStore Store;
+  FillStore(Store);
+  TEMMemoryFileSystem FileSystem;
+  FileSystem.AddFile(L"C:\\Studio\\19.0\\bin\\GExperts.dll");
+  FileSystem.AddFile(L"C:\\Studio\\20.0\\bin\\GExperts.dll");
+  FileSystem.AddFile(L"C:\\Studio\\22.0\\bin\\GExperts.dll");
+  FileSystem.AddFile(L"C:\\Experts\\Hi.dll");
+  std::ostringstream Stream;
+  EMCheck(EMHeadlessScan(Store, FileSystem, Stream, 3) == evOkay);
+  std::vector<std::string> Output = Lines(Stream.str());
+  EMCheck(Output.size() == 7);
+  std::vector<std::string> Installations;
+  for (size_t i = 0; i < Output.size(); i++) {
+    EMCheck(Output[i].front() == '{' && Output[i].back() == '}');
+    if (Field(Output[i], "type") == "installation") {
+      Installations.push_back(Field(Output[i], "path"));
+      EMCheck(Field(Output[i], "status") == "okay");
+    } else {
+      EMCheck(Field(Output[i], "type") == "entry");
+      EMCheck(!Installations.empty() &&
+        Field(Output[i], "installation") == Installations.back());
+    }
+  }
+  std::vector<std::string> Expected;
+  Expected.push_back("Software\\\\Embarcadero\\\\BDS\\\\19.0\\\\");
+  Expected.push_back("Software\\\\Embarcadero\\\\BDS\\\\20.0\\\\");
+  Expected.push_back("Software\\\\Embarcadero\\\\BDS\\\\22.0\\\\");
+  EMCheck(Installations == Expected);
+  EMCheck(Field(Output[1], "expandedFileName") ==
+    "C:\\\\Studio\\\\19.0\\\\bin\\\\GExperts.dll");
+  EMCheck(Output[6].find("\"name\":\"Say \\\"Hi\\\"\\\\\\t\\u0001\xC3\xA9\"") !=
+    std::string::npos);
+  for (int i = 0; i < 5; i++) {
+    std::ostringstream Again;
+    EMHeadlessScan(Store, FileSystem, Again, 3);
+    EMCheck(Again.str() == Stream.str());
+  }
+}
+
+/**
+
+  This function checks that an installation with a missing file makes the scan return a
+  validation worse than okay (and so the command fail) while the others are still okay.
+
+  @precon  None.
+  @postcon Checks the statuses and the validation returned.
+
+**/
+static void TestInvalid() {
+  TEMMemoryRegistryStore Store;
+  FillStore(Store);
+  TEMMemoryFileSystem FileSystem;
+  FileSystem.AddFile(L"C:\\Studio\\19.0\\bin\\GExperts.dll");
+  FileSystem.AddFile(L"C:\\Studio\\20.0\\bin\\GExperts.dll");
+  FileSystem.AddFile(L"C:\\Studio\\22.0\\bin\\GExperts.dll");
+  std::ostringstream Stream;
+  TExpertValidation eValidation = EMHeadlessScan(Store, FileSystem, Stream, 2);
+  EMCheck(eValidation == evInvalidPaths);
+  EMCheck(eValidation > evOkay);
+  std::vector<std::string> Output = Lines(Stream.str());
+  EMCheck(Output.size() == 7);
+  EMCheck(Field(Output[0], "status") == "okay");
+  EMCheck(Field(Output[2], "status") == "okay");
+  EMCheck(Field(Output[4], "status") == "invalidPaths");
+  EMCheck(Output[6].find("\"exists\":false") != std::string::npos);
+  TEMMemoryRegistryStore Empty;
+  std::ostringstream EmptyStream;
+  EMCheck(EMHeadlessScan(Empty, FileSystem, EmptyStream, 2) == evNone);
+  EMCheck(EmptyStream.str().empty());
+}
+
+int main() {
+  TestScan();
+  TestInvalid();
+  return EMTestResult("TestHeadless");
+}
@@ -0,0 +1,91 @@
+#include "ExpertManagerTests.h"
+#include "ExpertManagerMacros.h"
+
+/** The registry path of the installation. **/
+static const std::wstring strRegPath = L"Software\\Embarcadero\\BDS\\19.0";
+
+/** This class holds the macro table of an installation with a RootDir, a short environment
+    variable and one whose value is longer than any filename expanded below. **/
+class TEMMacroFixture {
+  public:
+    TEMMemoryRegistryStore Store;
+    TEMSnapshotPtr         Snapshot;
+    TEMMacroTablePtr       Macros;
+    std::wstring           strLong;
+    TEMMacroFixture() : strLong(L"C:\\" + std::wstring(300, L'L')) {
+      Store.SetValue(strRegPath, L"RootDir", L"C:\\Studio\\19.0");
+      Store.SetValue(strRegPath + L"\\Environment Variables", L"$(VENDORLIB)",
+        L"C:\\Vendor\\Lib");
+      Store.SetValue(strRegPath + L"\\Environment Variables", L"$(LONG_DIR)", strLong);
+      TEMNameList Roots(1, L"Software\\Embarcadero");
+      Snapshot = TEMRegistrySnapshot::Create(Store, Roots, TEMRegistrySnapshot::InstallationFilter);
+      Macros = TEMMacroTablePtr(new TEMMacroTable(*Snapshot, strRegPath));
+    };
+};
+
+/**
+
+  This function checks that filenames without a macro and an empty table return the filename
+  unchanged.
+
+  @precon  None.
+  @postcon Checks the expansions.
+
+**/
+static void TestNoMacros() {
+  TEMMacroFixture Fixture;
+  EMCheck(Fixture.Macros->Expand(L"C:\\CnPack\\CnWizards.dll") == L"C:\\CnPack\\CnWizards.dll");
+  EMCheck(Fixture.Macros->Expand(L"C:\\$Dollar\\(Paren).dll") == L"C:\\$Dollar\\(Paren).dll");
+  EMCheck(Fixture.Macros->Expand(L"") == L"");
+  TEMMacroTable Empty;
+  EMCheck(Empty.Expand(L"$(BDS)\\bin\\GExperts.dll") == L"$(BDS)\\bin\\GExperts.dll");
+}
+
+/**
+
+  This function checks that known macros are expanded ignoring the case of their names (including
+  macros next to each other) and that unknown, empty and unterminated macros are left as they are.
+
+  @precon  None.
+  @postcon Checks the expansions.
+
+**/
+static void TestExpand() {
+  TEMMacroFixture Fixture;
+  const TEMMacroTable& Macros = *Fixture.Macros;
+  EMCheck(Macros.Expand(L"$(BDS)\\bin\\GExperts.dll") == L"C:\\Studio\\19.0\\bin\\GExperts.dll");
+  EMCheck(Macros.Expand(L"$(bds)\\bin\\a.dll") == L"C:\\Studio\\19.0\\bin\\a.dll");
+  EMCheck(Macros.Expand(L"$(VendorLib)\\a.bpl") == L"C:\\Vendor\\Lib\\a.bpl");
+  EMCheck(Macros.Expand(L"$(BDSBIN)$(VENDORLIB)") == L"C:\\Studio\\19.0\\BinC:\\Vendor\\Lib");
+  EMCheck(Macros.Expand(L"$(UNKNOWN)\\a.dll") == L"$(UNKNOWN)\\a.dll");
+  EMCheck(Macros.Expand(L"$(UNKNOWN)$(BDS)\\a.dll") == L"$(UNKNOWN)C:\\Studio\\19.0\\a.dll");
+  EMCheck(Macros.Expand(L"$()\\$(BDS)") == L"$()\\C:\\Studio\\19.0");
+  EMCheck(Macros.Expand(L"$(BDS\\a.dll") == L"$(BDS\\a.dll");
+  EMCheck(Macros.Expand(L"$(BDS)\\$(BDS") == L"C:\\Studio\\19.0\\$(BDS");
+  EMCheck(Macros.Expand(L"$($(BDS))") == L"$(C:\\Studio\\19.0)");
+}
+
+/**
+
+  This function checks that values longer than the filename (which the result is reserved for)
+  and results longer than the reservation are expanded in full.
+
+  @precon  None.
+  @postcon Checks the expansions.
+
+**/
+static void TestLongValues() {
+  TEMMacroFixture Fixture;
+  const TEMMacroTable& Macros = *Fixture.Macros;
+  const std::wstring& strLong = Fixture.strLong;
+  EMCheck(Macros.Expand(L"$(LONG_DIR)\\a.dll") == strLong + L"\\a.dll");
+  EMCheck(Macros.Expand(L"$(long_dir)$(LONG_DIR)\\$(BDS)\\$(LONG_DIR)") ==
+    strLong + strLong + L"\\C:\\Studio\\19.0\\" + strLong);
+}
+
+int main() {
+  TestNoMacros();
+  TestExpand();
+  TestLongValues();
+  return EMTestResult("TestMacros");
+}
@@ -0,0 +1,195 @@
+#include "ExpertManagerTests.h"
+#include "ExpertManagerDependencies.h"
+#include <fstream>
+#include <iterator>
+
+/** The sample modules: a Win32 expert importing a package, a Win32 package with a PACKAGEINFO
+    resource that requires a package it does not import and a Win64 package. Each is a minimal
+    image with an import section at file offset 0x200 and a resource section at 0x400 (the
+    PACKAGEINFO data is at 0x480 with its required package count at 0x484). **/
+static const char* strExpert = "Samples/Expert.dll";
+static const char* strHelper = "Samples/Helper290.bpl";
+static const char* strWin64 = "Samples/Win64.bpl";
+
+/**
+
+  This function returns the contents of the given sample file.
+
+  @precon  None.
+  @postcon Returns the file's bytes (empty if it cannot be read).
+
+  @param   strFileName as a const char pointer
+  @return  a std::vector<unsigned char>
+
+**/
+static std::vector<unsigned char> ReadSample(const char* strFileName) {
+  std::ifstream File(strFileName, std::ios::in | std::ios::binary);
+  return std::vector<unsigned char>(std::istreambuf_iterator<char>(File),
+    std::istreambuf_iterator<char>());
+}
+
+/**
+
+  This function parses the given bytes after writing the given 32 bit value at the given offset.
+
+  @precon  iOffset must be within the bytes.
+  @postcon Returns whether the image was parsed along with its module information.
+
+  @param   Image   as a std::vector<unsigned char> (a copy)
+  @param   iOffset as a size_t as a constant
+  @param   iValue  as an unsigned int as a constant
+  @param   Info    as a TEMModuleInfo as a reference
+  @return  a bool
+
+**/
+static bool ParseCorrupted(std::vector<unsigned char> Image, const size_t iOffset,
+  const unsigned int iValue, TEMModuleInfo& Info) {
+  for (size_t i = 0; i < 4; i++)
+    Image[iOffset + i] = (unsigned char)(iValue >> (8 * i));
+  return EMParsePEImage(Image.data(), Image.size(), Info);
+}
+
+/**
+
+  This function checks the imports, machine and package information read from the samples.
+
+  @precon  None.
+  @postcon Checks the module information.
+
+**/
+static void TestSamples() {
+  TEMModuleInfo Info;
+  EMCheck(EMReadModuleInfo(L"Samples/Expert.dll", Info));
+  EMCheck(Info.boolValid && Info.iMachine == 0x14C);
+  EMCheck(Info.Imports.size() == 3);
+  EMCheck(Info.Imports.size() == 3 && Info.Imports[0] == L"kernel32.dll" &&
+    Info.Imports[1] == L"rtl290.bpl" && Info.Imports[2] == L"Helper290.bpl");
+  EMCheck(!Info.boolPackageInfo && Info.Requires.empty());
+  EMCheck(EMReadModuleInfo(L"Samples/Helper290.bpl", Info));
+  EMCheck(Info.Imports.size() == 2);
+  EMCheck(Info.boolPackageInfo);
+  EMCheck(Info.Requires.size() == 2 && Info.Requires[0] == L"rtl" &&
+    Info.Requires[1] == L"vcl290");
+  EMCheck(EMReadModuleInfo(L"Samples/Win64.bpl", Info));
+  EMCheck(Info.boolValid && Info.iMachine == 0x8664);
+  EMCheck(Info.Imports.size() == 1 && Info.Imports[0] == L"rtl290.bpl");
+  EMCheck(Info.boolPackageInfo && Info.Requires.size() == 1);
+  EMCheck(!EMReadModuleInfo(L"Samples/Missing.bpl", Info));
+  EMCheck(!Info.boolValid);
+}
+
+/**
+
+  This function checks that every truncation of a sample is parsed without reading beyond the end
+  of the buffer: the headers (up to the end of the section table at 0x178) must be complete for
+  the image to be valid and a truncated import table or PACKAGEINFO resource only loses what is
+  missing.
+
+  @precon  None.
+  @postcon Checks the truncated images.
+
+**/
+static void TestTruncated() {
+  std::vector<unsigned char> Image = ReadSample(strHelper);
+  EMCheck(Image.size() == 0x600);
+  TEMModuleInfo Info;
+  for (size_t iSize = 0; iSize <= Image.size(); iSize++) {
+    std::vector<unsigned char> Truncated(Image.begin(), Image.begin() + iSize);
+    bool boolValid = EMParsePEImage(Truncated.data(), Truncated.size(), Info);
+    EMCheck(boolValid == (iSize >= 0x178));
+    EMCheck(Info.Imports.size() <= 2 && Info.Requires.size() <= 2);
+  }
+  EMCheck(EMParsePEImage(Image.data(), 0x220, Info) && Info.Imports.empty());
+  EMCheck(EMParsePEImage(Image.data(), 0x488, Info) && Info.Imports.size() == 2);
+  EMCheck(!Info.boolPackageInfo);
+}
+
+/**
+
+  This function checks that images with corrupt headers are rejected and that corrupt tables are
+  skipped.
+
+  @precon  None.
+  @postcon Checks the corrupt images.
+
+**/
+static void TestCorrupt() {
+  std::vector<unsigned char> Image = ReadSample(strHelper);
+  TEMModuleInfo Info;
+  EMCheck(Image.size() == 0x600);
+  if (Image.size() != 0x600)
+    return;
+  EMCheck(EMParsePEImage(Image.data(), Image.size(), Info));
+  // The DOS signature, the PE header offset, the PE signature and the optional header's magic
+  EMCheck(!ParseCorrupted(Image, 0x00, 0x00905A4E, Info));
+  EMCheck(!ParseCorrupted(Image, 0x3C, 0xFFFFFFF0, Info));
+  EMCheck(!ParseCorrupted(Image, 0x40, 0x00004551, Info));
+  EMCheck(!ParseCorrupted(Image, 0x56, 0x01070000, Info));
+  // A section table beyond the end of the file
+  EMCheck(!ParseCorrupted(Image, 0x44, 0xFFFF014C, Info));
+  // An import name outside every section is skipped
+  EMCheck(ParseCorrupted(Image, 0x20C, 0x7FFFFFFF, Info));
+  EMCheck(Info.Imports.size() == 1);
+  // An import table outside every section
+  EMCheck(ParseCorrupted(Image, 0xC0, 0x00900000, Info));
+  EMCheck(Info.Imports.empty() && Info.boolPackageInfo);
+  // A required package count far larger than the resource
+  EMCheck(ParseCorrupted(Image, 0x484, 0x7FFFFFFF, Info));
+  EMCheck(Info.boolPackageInfo && Info.Requires.size() == 2);
+  // A resource data entry larger than the file
+  EMCheck(ParseCorrupted(Image, 0x44C, 0x00010000, Info));
+  EMCheck(!Info.boolPackageInfo && Info.Requires.empty());
+}
+
+/**
+
+  This function checks the dependencies of the samples as the entries of an installation: a
+  required package which is not imported is still a dependency, a Win64 package cannot be loaded
+  and an expert which imports a package that cannot be loaded cannot be loaded either.
+
+  @precon  None.
+  @postcon Checks the unresolved dependencies.
+
+**/
+static void TestGraph() {
+  TEMFileRegistryStore Store;
+  Store.LoadFromUTF8("[Software\\Embarcadero\\BDS\\19.0]\nRootDir=C:\\Studio\\19.0\n");
+  TEMNameList Roots(1, L"Software\\Embarcadero");
+  TEMSnapshotPtr Snapshot = TEMRegistrySnapshot::Create(Store, Roots,
+    TEMRegistrySnapshot::InstallationFilter);
+  TEMMacroTable Macros(*Snapshot, L"Software\\Embarcadero\\BDS\\19.0\\");
+  TEMMemoryFileSystem FileSystem;
+  FileSystem.AddFile(L"C:\\Studio\\19.0\\bin\\rtl290.bpl");
+  const char* strFileNames[3] = {strExpert, strHelper, strWin64};
+  std::vector<TEMEntry> Items;
+  for (size_t i = 0; i < 3; i++) {
+    TEMEntry Entry;
+    Entry.eSection = i == 0 ? esExperts : esKnownPackages;
+    Entry.Name = TEMPath(EMUTF8ToWide(strFileNames[i], std::string(strFileNames[i]).length()));
+    Entry.FileName = Entry.Name;
+    Entry.boolEnabled = true;
+    Entry.boolExists = true;
+    Entry.boolDeleted = false;
+    Items.push_back(Entry);
+  }
+  TEMInstallationEntries Entries;
+  Entries.Assign(Items, std::vector<TEMNameList>(Items.size()));
+  TEMModuleCache ModuleCache;
+  TEMDependencyGraph Graph;
+  Graph.Build(Entries, Macros, FileSystem, ModuleCache);
+  Graph.Apply(Entries);
+  EMCheck(!Graph.Loadable(0) && !Graph.Loadable(1) && !Graph.Loadable(2));
+  EMCheck(Entries.UnresolvedDependencies(1) == TEMNameList(1, L"vcl290.bpl"));
+  EMCheck(Entries.UnresolvedDependencies(0) ==
+    TEMNameList(1, L"Helper290.bpl (cannot be loaded)"));
+  EMCheck(Entries.UnresolvedDependencies(2) == TEMNameList(1, L"Win64.bpl (Win64 module)"));
+  EMCheck(Entries.Validation() == evMissingDependencies);
+}
+
+int main() {
+  TestSamples();
+  TestTruncated();
+  TestCorrupt();
+  TestGraph();
+  return EMTestResult("TestPEFile");
+}
@@ -0,0 +1,78 @@
+#include "ExpertManagerTests.h"
+#include "ExpertManagerPathPool.h"
+#include "ExpertManagerStrings.h"
+#include <thread>
+
+/**
+
+  This function checks that finding text in the pool returns the ID of interned text and adds
+  nothing when the text is not there.
+
+  @precon  None.
+  @postcon Checks the IDs and the number of paths.
+
+**/
+static void TestFind() {
+  TEMPathPool Pool;
+  TEMPathID iPath = Pool.Intern(L"C:\\Studio\\bin\\GExperts.dll");
+  size_t iCount = Pool.Count();
+  EMCheck(Pool.Find(L"C:\\Studio\\bin\\GExperts.dll") == iPath);
+  EMCheck(Pool.Find(L"C:\\Studio\\bin\\CnWizards.dll") == 0);
+  EMCheck(Pool.Find(L"C:\\Studio\\bin") == 0);
+  EMCheck(Pool.Find(L"") == 0);
+  EMCheck(Pool.Count() == iCount);
+  unsigned int iKey = 0;
+  EMCheck(Pool.FindFileNameKey(L"GEXPERTS.DLL", iKey) && iKey == Pool.FileNameKey(iPath));
+  EMCheck(Pool.FindFileNameKey(L"D:\\Other\\gexperts.dll", iKey) &&
+    iKey == Pool.FileNameKey(iPath));
+  EMCheck(!Pool.FindFileNameKey(L"CnWizards.dll", iKey));
+  EMCheck(Pool.Count() == iCount);
+  TEMPathID iFolded = Pool.Folded(iPath);
+  EMCheck(iFolded != 0 && iFolded != iPath);
+  EMCheck(Pool.Find(L"C:\\STUDIO\\BIN\\GEXPERTS.DLL") == iFolded);
+  EMCheck(Pool.Folded(iFolded) == iFolded);
+}
+
+/**
+
+  This function checks that paths are read correctly while other threads intern paths (enough to
+  fill several chunks) and that the threads agree on the IDs of the paths they share.
+
+  @precon  None.
+  @postcon Checks the texts, folded paths and IDs.
+
+**/
+static void TestConcurrent() {
+  const int iThreads = 4;
+  const int iPaths = 6000;
+  TEMPathPool Pool;
+  std::vector<std::thread> Threads;
+  std::vector<std::vector<TEMPathID> > Shared(iThreads);
+  std::vector<int> Failures(iThreads, 0);
+  for (int t = 0; t < iThreads; t++)
+    Threads.push_back(std::thread([&Pool, &Shared, &Failures, t, iPaths]() {
+      for (int i = 0; i < iPaths; i++) {
+        const std::wstring strText = L"C:\\Thread" + std::to_wstring(t) + L"\\Sub" +
+          std::to_wstring(i % 50) + L"\\File" + std::to_wstring(i) + L".DLL";
+        TEMPathID iPath = Pool.Intern(strText);
+        if (Pool.Text(iPath) != strText || Pool.Text(Pool.Folded(iPath)) != EMFoldCase(strText) ||
+          Pool.FileName(iPath) != L"File" + std::to_wstring(i) + L".DLL")
+          Failures[t]++;
+        Shared[t].push_back(Pool.Intern(L"$(BDS)\\bin\\Shared" + std::to_wstring(i % 100) +
+          L".bpl"));
+      }
+    }));
+  for (int t = 0; t < iThreads; t++)
+    Threads[t].join();
+  for (int t = 0; t < iThreads; t++) {
+    EMCheck(Failures[t] == 0);
+    EMCheck(Shared[t] == Shared[0]);
+  }
+  EMCheck(Pool.Count() == (size_t)(iThreads * iPaths * 2 + 100));
+}
+
+int main() {
+  TestFind();
+  TestConcurrent();
+  return EMTestResult("TestPathPool");
+}
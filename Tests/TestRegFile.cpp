@@ -0,0 +1,96 @@
+#include "ExpertManagerTests.h"
+#include "ExpertManagerRegFile.h"
+#include <string>
+
+/** A registry editor export of an installation with keys that are read and keys that are not. **/
+static const char* strExport =
+  "REGEDIT4\r\n"
+  "\r\n"
+  "[HKEY_CURRENT_USER\\Software\\Embarcadero\\BDS\\19.0]\r\n"
+  "\"RootDir\"=\"C:\\\\Studio\\\\19.0\\\\\"\r\n"
+  "\"Edition\"=dword:0000001f\r\n"
+  "\r\n"
+  "[HKEY_CURRENT_USER\\Software\\Embarcadero\\BDS\\19.0\\Experts]\r\n"
+  "\"GExperts\"=\"$(BDS)\\\\bin\\\\GExperts.dll\"\r\n"
+  "\"CnPack\"=hex(2):43,00,3a,00,5c,00,43,00,6e,00,2e,00,64,00,6c,00,6c,00,00,00\r\n"
+  "\"Removed\"=\"C:\\\\Removed.dll\"\r\n"
+  "\"Removed\"=-\r\n"
+  "\r\n"
+  "[HKEY_CURRENT_USER\\Software\\Embarcadero\\BDS\\19.0\\Experts\\Disabled]\r\n"
+  "\"Old\"=\"C:\\\\Old.dll\"\r\n"
+  "\r\n"
+  "[HKEY_CURRENT_USER\\Software\\Embarcadero\\BDS\\19.0\\Library\\Win32]\r\n"
+  "\"Search Path\"=\"$(BDSLIB)\\\\$(Platform)\\\\release\"\r\n"
+  "\r\n"
+  "[HKEY_CURRENT_USER\\Software\\Embarcadero\\BDS\\19.0\\Library\\Win32\\Deep\\Deeper]\r\n"
+  "\"Value\"=\"1\"\r\n"
+  "\r\n"
+  "[-HKEY_CURRENT_USER\\Software\\Embarcadero\\BDS\\18.0]\r\n";
+
+/**
+
+  This function checks that the values of the kept keys are decoded and that the keys which a
+  snapshot would not reach (including their parent keys) are not created.
+
+  @precon  None.
+  @postcon Checks the loaded keys.
+
+**/
+static void TestFilteredLoad() {
+  TEMRegFileRegistryStore Store(TEMRegistrySnapshot::InstallationFilter);
+  EMCheck(Store.LoadFromBuffer(strExport, std::string(strExport).length()));
+  TEMNameList Keys;
+  TEMRegValueList Values;
+  EMCheck(Store.ReadKey(L"Software\\Embarcadero\\BDS\\19.0", Keys, Values));
+  EMCheck(Keys.size() == 1 && Keys[0] == L"Experts");
+  EMCheck(Values.size() == 2);
+  EMCheck(Values.size() == 2 && Values[0].second == L"C:\\Studio\\19.0\\");
+  EMCheck(Values.size() == 2 && Values[1].second == L"31");
+  EMCheck(Store.ReadKey(L"Software\\Embarcadero\\BDS\\19.0\\Experts", Keys, Values));
+  EMCheck(Keys.size() == 1 && Keys[0] == L"Disabled");
+  EMCheck(Values.size() == 2);
+  EMCheck(Values.size() == 2 && Values[1].first == L"CnPack" && Values[1].second == L"C:\\Cn.dll");
+  EMCheck(!Store.ReadKey(L"Software\\Embarcadero\\BDS\\19.0\\Library", Keys, Values));
+  EMCheck(!Store.ReadKey(L"Software\\Embarcadero\\BDS\\19.0\\Library\\Win32", Keys, Values));
+  EMCheck(!Store.ReadKey(L"Software\\Embarcadero\\BDS\\18.0", Keys, Values));
+}
+
+/**
+
+  This function checks that without a filter every key in the export is loaded.
+
+  @precon  None.
+  @postcon Checks the loaded keys.
+
+**/
+static void TestUnfilteredLoad() {
+  TEMRegFileRegistryStore Store;
+  EMCheck(Store.LoadFromBuffer(strExport, std::string(strExport).length()));
+  TEMNameList Keys;
+  TEMRegValueList Values;
+  EMCheck(Store.ReadKey(L"Software\\Embarcadero\\BDS\\19.0\\Library\\Win32", Keys, Values));
+  EMCheck(Values.size() == 1 && Values[0].second == L"$(BDSLIB)\\$(Platform)\\release");
+  EMCheck(Store.ReadKey(L"Software\\Embarcadero\\BDS\\19.0\\Library\\Win32\\Deep\\Deeper", Keys,
+    Values));
+}
+
+/**
+
+  This function checks that text which is not a registry editor export is rejected.
+
+  @precon  None.
+  @postcon Checks the result of the load.
+
+**/
+static void TestNotAnExport() {
+  TEMRegFileRegistryStore Store;
+  const char* strText = "[Software\\Embarcadero]\r\n";
+  EMCheck(!Store.LoadFromBuffer(strText, std::string(strText).length()));
+}
+
+int main() {
+  TestFilteredLoad();
+  TestUnfilteredLoad();
+  TestNotAnExport();
+  return EMTestResult("TestRegFile");
+}
@@ -0,0 +1,175 @@
+#include "ExpertManagerTests.h"
+#include "ExpertManagerRegistryStore.h"
+#include "ExpertManagerScanner.h"
+
+/** The registry text of an installation under each of the three company roots. **/
+static const char* strRegistry =
+  "[Software\\Borland\\BDS\\5.0]\n"
+  "RootDir=C:\\Borland\\BDS\\5.0\n"
+  "[Software\\Borland\\BDS\\5.0\\Experts]\n"
+  "CnPack=C:\\CnPack\\CnWizards.dll\n"
+  "[Software\\CodeGear\\BDS\\7.0]\n"
+  "RootDir=C:\\CodeGear\\RAD Studio\\7.0\n"
+  "[Software\\CodeGear\\BDS\\7.0\\Known Packages]\n"
+  "$(BDS)\\bin\\dclib140.bpl=InterBase Data Access Components\n"
+  "[Software\\Embarcadero\\BDS\\19.0]\n"
+  "RootDir=C:\\Studio\\19.0\n"
+  "[Software\\Embarcadero\\BDS\\19.0\\Experts]\n"
+  "GExperts=$(BDS)\\bin\\GExperts.dll\n"
+  "[Software\\Embarcadero\\BDS\\19.0\\Library\\Win32]\n"
+  "Search Path=$(BDSLIB)\\$(Platform)\\release\n"
+  "[Software\\Embarcadero\\BDS\\19.0\\Environment Variables]\n"
+  "VENDORLIB=C:\\Vendor\n"
+  "[Software\\Embarcadero\\Other]\n"
+  "Value=1\n";
+
+/**
+
+  This function returns the registry paths of the company roots which Expert Manager reads.
+
+  @precon  None.
+  @postcon Returns the roots.
+
+  @return  a TEMNameList
+
+**/
+static TEMNameList Roots() {
+  TEMNameList Roots;
+  Roots.push_back(L"Software\\Borland");
+  Roots.push_back(L"Software\\CodeGear");
+  Roots.push_back(L"Software\\Embarcadero");
+  return Roots;
+}
+
+/**
+
+  This function checks that a snapshot holds the installations of all three company roots with the
+  sections that are read and without the sections that are filtered out.
+
+  @precon  None.
+  @postcon Checks the snapshot.
+
+**/
+static void TestSnapshot() {
+  TEMFileRegistryStore Store;
+  Store.LoadFromUTF8(strRegistry);
+  TEMSnapshotPtr Snapshot = TEMRegistrySnapshot::Create(Store, Roots(),
+    TEMRegistrySnapshot::InstallationFilter);
+  TEMNameList Installations;
+  EMFindInstallations(*Snapshot, Roots(), Installations);
+  EMCheck(Installations.size() == 3);
+  EMCheck(Installations.size() == 3 && Installations[0] == L"Software\\Borland\\BDS\\5.0\\");
+  EMCheck(Installations.size() == 3 && Installations[1] == L"Software\\CodeGear\\BDS\\7.0\\");
+  EMCheck(Installations.size() == 3 && Installations[2] == L"Software\\Embarcadero\\BDS\\19.0\\");
+  EMCheck(Snapshot->ReadString(L"Software\\Borland\\BDS\\5.0\\", L"Experts", L"cnpack", L"") ==
+    L"C:\\CnPack\\CnWizards.dll");
+  EMCheck(Snapshot->ReadString(L"software\\codegear\\bds\\7.0\\", L"", L"RootDir", L"") ==
+    L"C:\\CodeGear\\RAD Studio\\7.0");
+  TEMRegValueList Values;
+  Snapshot->ReadSectionValues(L"Software\\CodeGear\\BDS\\7.0\\", L"Known Packages", Values);
+  EMCheck(Values.size() == 1 && Values[0].second == L"InterBase Data Access Components");
+  TEMNameList Sections;
+  Snapshot->ReadSections(L"Software\\Embarcadero\\BDS\\19.0\\", Sections);
+  EMCheck(Sections.size() == 2);
+  EMCheck(Snapshot->FindKey(L"Software\\Embarcadero\\BDS\\19.0\\Library") == NULL);
+  EMCheck(Snapshot->FindKey(L"Software\\Embarcadero\\Other") != NULL);
+  EMCheck(Snapshot->ReadString(L"Software\\Embarcadero\\BDS\\19.0\\", L"Experts", L"Missing",
+    L"Default") == L"Default");
+}
+
+/**
+
+  This function checks that refreshing one installation re-reads only that installation and shares
+  every other key with the previous snapshot which itself is left unchanged.
+
+  @precon  None.
+  @postcon Checks the refreshed snapshot.
+
+**/
+static void TestRefresh() {
+  TEMFileRegistryStore Store;
+  Store.LoadFromUTF8(strRegistry);
+  TEMSnapshotPtr Snapshot = TEMRegistrySnapshot::Create(Store, Roots(),
+    TEMRegistrySnapshot::InstallationFilter);
+  Store.SetValue(L"Software\\Embarcadero\\BDS\\19.0\\Experts", L"CnPack", L"C:\\CnPack\\Cn.dll");
+  TEMSnapshotPtr Refreshed = Snapshot->Refresh(Store, L"Software\\Embarcadero\\BDS\\19.0\\");
+  TEMNameList Names;
+  Snapshot->ReadSection(L"Software\\Embarcadero\\BDS\\19.0\\", L"Experts", Names);
+  EMCheck(Names.size() == 1);
+  Refreshed->ReadSection(L"Software\\Embarcadero\\BDS\\19.0\\", L"Experts", Names);
+  EMCheck(Names.size() == 2);
+  EMCheck(Refreshed->ReadString(L"Software\\Embarcadero\\BDS\\19.0\\", L"Experts", L"CnPack",
+    L"") == L"C:\\CnPack\\Cn.dll");
+  EMCheck(Refreshed->ReadString(L"Software\\Embarcadero\\BDS\\19.0\\", L"Environment Variables",
+    L"VENDORLIB", L"") == L"C:\\Vendor");
+  EMCheck(Refreshed->FindKey(L"Software\\Borland") == Snapshot->FindKey(L"Software\\Borland"));
+  EMCheck(Refreshed->FindKey(L"Software\\CodeGear\\BDS\\7.0") ==
+    Snapshot->FindKey(L"Software\\CodeGear\\BDS\\7.0"));
+  EMCheck(Refreshed->FindKey(L"Software\\Embarcadero\\Other") ==
+    Snapshot->FindKey(L"Software\\Embarcadero\\Other"));
+  EMCheck(Refreshed->FindKey(L"Software\\Embarcadero\\BDS\\19.0") !=
+    Snapshot->FindKey(L"Software\\Embarcadero\\BDS\\19.0"));
+  EMCheck(Refreshed->FindKey(L"Software\\Embarcadero\\BDS\\19.0\\Library") == NULL);
+}
+
+/**
+
+  This function checks that refreshing an installation which has been deleted from the store
+  removes it from the new snapshot only.
+
+  @precon  None.
+  @postcon Checks the refreshed snapshot.
+
+**/
+static void TestRefreshDeleted() {
+  TEMFileRegistryStore Store;
+  Store.LoadFromUTF8(strRegistry);
+  TEMSnapshotPtr Snapshot = TEMRegistrySnapshot::Create(Store, Roots(),
+    TEMRegistrySnapshot::InstallationFilter);
+  TEMFileRegistryStore Deleted;
+  Deleted.LoadFromUTF8(
+    "[Software\\CodeGear\\BDS\\7.0]\n"
+    "RootDir=C:\\CodeGear\\RAD Studio\\7.0\n");
+  TEMSnapshotPtr Refreshed = Snapshot->Refresh(Deleted, L"Software\\Borland\\BDS\\5.0\\");
+  TEMNameList Installations;
+  EMFindInstallations(*Refreshed, Roots(), Installations);
+  EMCheck(Installations.size() == 2);
+  EMFindInstallations(*Snapshot, Roots(), Installations);
+  EMCheck(Installations.size() == 3);
+}
+
+/**
+
+  This function checks that the memory store keeps a write time per key which changes only when
+  that key is written.
+
+  @precon  None.
+  @postcon Checks the write times.
+
+**/
+static void TestWriteTimes() {
+  TEMFileRegistryStore Store;
+  Store.LoadFromUTF8(strRegistry);
+  unsigned long long iExperts = 0, iPackages = 0, iTime = 0;
+  EMCheck(Store.KeyWriteTime(L"Software\\Embarcadero\\BDS\\19.0\\Experts", iExperts));
+  EMCheck(Store.KeyWriteTime(L"Software\\CodeGear\\BDS\\7.0\\Known Packages", iPackages));
+  EMCheck(Store.OpenKey(L"Software\\Embarcadero\\BDS\\19.0\\Experts", false));
+  EMCheck(Store.WriteValue(L"New", L"C:\\New.dll"));
+  std::wstring strValue;
+  EMCheck(Store.ReadValue(L"new", strValue) && strValue == L"C:\\New.dll");
+  Store.CloseKey();
+  EMCheck(Store.KeyWriteTime(L"Software\\Embarcadero\\BDS\\19.0\\Experts", iTime));
+  EMCheck(iTime > iExperts);
+  EMCheck(Store.KeyWriteTime(L"Software\\CodeGear\\BDS\\7.0\\Known Packages", iTime));
+  EMCheck(iTime == iPackages);
+  EMCheck(!Store.KeyWriteTime(L"Software\\Embarcadero\\BDS\\99.0", iTime));
+  EMCheck(!Store.OpenKey(L"Software\\Embarcadero\\BDS\\99.0", false));
+}
+
+int main() {
+  TestSnapshot();
+  TestRefresh();
+  TestRefreshDeleted();
+  TestWriteTimes();
+  return EMTestResult("TestRegistryStore");
+}
@@ -0,0 +1,154 @@
+#include "ExpertManagerTests.h"
+#include "ExpertManagerRegistryWatcher.h"
+#include "ExpertManagerScanner.h"
+#include "ExpertManagerWorkerPool.h"
+#include <fstream>
+#include <cstdio>
+
+/** The file which the notifier polls. **/
+static const char* strFileName = "Build/TestRegistryWatcher.txt";
+
+/** The registry text of two installations under one product and one under another company. **/
+static const char* strRegistry =
+  "[Software\\CodeGear\\BDS\\7.0]\n"
+  "RootDir=C:\\CodeGear\\RAD Studio\\7.0\n"
+  "[Software\\CodeGear\\BDS\\7.0\\Experts]\n"
+  "CnPack=C:\\CnPack\\CnWizards.dll\n"
+  "[Software\\Embarcadero\\BDS\\19.0]\n"
+  "RootDir=C:\\Studio\\19.0\n"
+  "[Software\\Embarcadero\\BDS\\19.0\\Experts]\n"
+  "GExperts=$(BDS)\\bin\\GExperts.dll\n"
+  "[Software\\Embarcadero\\BDS\\19.0\\Library\\Win32]\n"
+  "Search Path=$(BDSLIB)\\$(Platform)\\release\n"
+  "[Software\\Embarcadero\\BDS\\20.0]\n"
+  "RootDir=C:\\Studio\\20.0\n"
+  "[Software\\Embarcadero\\BDS\\20.0\\Known Packages]\n"
+  "$(BDS)\\bin\\dclib270.bpl=InterBase Data Access Components\n";
+
+/**
+
+  This function writes the given text (the registry text above with the given extra lines) to the
+  file which the notifier polls. The text is written to another file which then replaces it so
+  that the notifier never reads a partly written file.
+
+  @precon  None.
+  @postcon The file is rewritten.
+
+  @param   strExtra as a const char pointer
+
+**/
+static void WriteRegistry(const char* strExtra) {
+  std::string strTempFileName = std::string(strFileName) + ".tmp";
+  {
+    std::ofstream File(strTempFileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    File << strRegistry << strExtra;
+  }
+  std::rename(strTempFileName.c_str(), strFileName);
+}
+
+/**
+
+  This function waits for the next change notification and returns the owners it reported.
+
+  @precon  None.
+  @postcon Returns the reported owners or an empty list if nothing was reported in time.
+
+  @param   Changes    as a TEMResultQueue<TEMNameList> as a reference
+  @param   iTimeoutMS as an int as a constant
+  @return  a TEMNameList
+
+**/
+static TEMNameList WaitForChange(TEMResultQueue<TEMNameList>& Changes, const int iTimeoutMS) {
+  std::vector<TEMNameList> Items;
+  Changes.Drain(Items, iTimeoutMS);
+  TEMNameList Owners;
+  for (size_t i = 0; i < Items.size(); i++)
+    Owners.insert(Owners.end(), Items[i].begin(), Items[i].end());
+  return Owners;
+}
+
+/**
+
+  This function checks that the file notifier reports only the owner of the watch whose key has
+  changed, nothing for changes to keys which are not watched and the company root for a new
+  installation.
+
+  @precon  None.
+  @postcon Checks the notifications.
+
+**/
+static void TestNotifier() {
+  WriteRegistry("");
+  TEMFileRegistryStore Store(strFileName);
+  TEMNameList Roots;
+  Roots.push_back(L"Software\\CodeGear");
+  Roots.push_back(L"Software\\Embarcadero");
+  TEMSnapshotPtr Snapshot = TEMRegistrySnapshot::Create(Store, Roots,
+    TEMRegistrySnapshot::InstallationFilter);
+  TEMNameList Installations;
+  EMFindInstallations(*Snapshot, Roots, Installations);
+  EMCheck(Installations.size() == 3);
+  TEMRegistryWatchList Watches;
+  EMInstallationWatches(Roots, Installations, *Snapshot, Watches);
+  TEMResultQueue<TEMNameList> Changes;
+  TEMFileRegistryNotifier Notifier(strFileName, [&Changes](const TEMNameList& Owners) {
+    Changes.Push(Owners); }, 10);
+  Notifier.Watch(Watches);
+  EMCheck(WaitForChange(Changes, 100).empty());
+  // A new expert in one installation
+  WriteRegistry(
+    "[Software\\Embarcadero\\BDS\\19.0\\Experts]\n"
+    "CnPack=C:\\CnPack\\CnWizards.dll\n");
+  TEMNameList Owners = WaitForChange(Changes, 2000);
+  EMCheck(Owners.size() == 1);
+  EMCheck(Owners.size() == 1 && Owners[0] == L"Software\\Embarcadero\\BDS\\19.0\\");
+  EMCheck(WaitForChange(Changes, 100).empty());
+  // A change to a key beneath the installation which is not watched
+  WriteRegistry(
+    "[Software\\Embarcadero\\BDS\\19.0\\Experts]\n"
+    "CnPack=C:\\CnPack\\CnWizards.dll\n"
+    "[Software\\Embarcadero\\BDS\\19.0\\Library\\Win32]\n"
+    "Browsing Path=$(BDSLIB)\\$(Platform)\\release\n");
+  EMCheck(WaitForChange(Changes, 200).empty());
+  // A new installation is reported against its company root
+  WriteRegistry(
+    "[Software\\Embarcadero\\BDS\\19.0\\Experts]\n"
+    "CnPack=C:\\CnPack\\CnWizards.dll\n"
+    "[Software\\Embarcadero\\BDS\\21.0]\n"
+    "RootDir=C:\\Studio\\21.0\n");
+  Owners = WaitForChange(Changes, 2000);
+  EMCheck(Owners.size() == 1 && Owners[0] == L"Software\\Embarcadero");
+}
+
+/**
+
+  This function checks that an installation's fingerprint changes with the keys that are watched
+  for it and only with those.
+
+  @precon  None.
+  @postcon Checks the fingerprints.
+
+**/
+static void TestFingerprint() {
+  TEMFileRegistryStore Store;
+  Store.LoadFromUTF8(strRegistry);
+  const std::wstring strRegPath = L"Software\\Embarcadero\\BDS\\19.0\\";
+  size_t iFingerprint = EMInstallationFingerprint(Store, strRegPath);
+  size_t iOther = EMInstallationFingerprint(Store, L"Software\\Embarcadero\\BDS\\20.0\\");
+  EMCheck(iFingerprint != iOther);
+  EMCheck(EMInstallationFingerprint(Store, strRegPath) == iFingerprint);
+  Store.SetValue(L"Software\\Embarcadero\\BDS\\19.0\\Library\\Win32", L"Debug DCU Path", L"");
+  EMCheck(EMInstallationFingerprint(Store, strRegPath) == iFingerprint);
+  Store.SetValue(L"Software\\Embarcadero\\BDS\\19.0\\Experts", L"GExperts", L"C:\\GExperts.dll");
+  size_t iChanged = EMInstallationFingerprint(Store, strRegPath);
+  EMCheck(iChanged != iFingerprint);
+  Store.SetValue(L"Software\\Embarcadero\\BDS\\19.0\\Experts\\Disabled", L"Old", L"C:\\Old.dll");
+  EMCheck(EMInstallationFingerprint(Store, strRegPath) != iChanged);
+  EMCheck(EMInstallationFingerprint(Store, L"Software\\Embarcadero\\BDS\\20.0\\") == iOther);
+}
+
+int main() {
+  TestNotifier();
+  TestFingerprint();
+  return EMTestResult("TestRegistryWatcher");
+}
@@ -0,0 +1,133 @@
+#include "ExpertManagerTests.h"
+#include "ExpertManagerScanCache.h"
+
+/** The registry text of an installation with an expert, a disabled expert and a known package
+    whose file is missing. **/
+static const char* strRegistry =
+  "[Software\\Embarcadero\\BDS\\19.0]\n"
+  "RootDir=C:\\Studio\\19.0\n"
+  "[Software\\Embarcadero\\BDS\\19.0\\Experts]\n"
+  "GExperts=$(BDS)\\bin\\GExperts.dll\n"
+  "[Software\\Embarcadero\\BDS\\19.0\\Experts\\Disabled]\n"
+  "CnPack=C:\\CnPack\\CnWizards.dll\n"
+  "[Software\\Embarcadero\\BDS\\19.0\\Known Packages]\n"
+  "C:\\Missing\\Missing.bpl=Missing Package\n";
+
+/** The registry path of the installation. **/
+static const std::wstring strRegPath = L"Software\\Embarcadero\\BDS\\19.0\\";
+
+/**
+
+  This function checks that the given restored entries are the same as the scanned entries.
+
+  @precon  None.
+  @postcon Checks the entries.
+
+  @param   Scanned  as a TEMInstallationEntries as a constant reference
+  @param   Restored as a TEMInstallationEntries as a constant reference
+
+**/
+static void CheckEntries(const TEMInstallationEntries& Scanned,
+  const TEMInstallationEntries& Restored) {
+  EMCheck(Restored.Count() == Scanned.Count());
+  for (size_t i = 0; i < Scanned.Count() && i < Restored.Count(); i++) {
+    const TEMEntry& Entry = Scanned.Entry((int)i);
+    const TEMEntry& Other = Restored.Entry((int)i);
+    EMCheck(Other.eSection == Entry.eSection);
+    EMCheck(Other.Name.Text() == Entry.Name.Text());
+    EMCheck(Other.FileName.Text() == Entry.FileName.Text());
+    EMCheck(Other.boolEnabled == Entry.boolEnabled);
+    EMCheck(Other.boolExists == Entry.boolExists);
+    EMCheck(Restored.UnresolvedDependencies((int)i) == Scanned.UnresolvedDependencies((int)i));
+    EMCheck(Restored.EntryValidation((int)i) == Scanned.EntryValidation((int)i));
+  }
+  EMCheck(Restored.Validation() == Scanned.Validation());
+}
+
+/**
+
+  This function checks that a scanned installation survives a round trip through the cache file
+  contents and is restored without a rescan while its directories are unchanged but is rescanned
+  once a missing directory appears.
+
+  @precon  None.
+  @postcon Checks the restored installations.
+
+**/
+static void TestRestore() {
+  TEMFileRegistryStore Store;
+  Store.LoadFromUTF8(strRegistry);
+  TEMNameList Roots(1, L"Software\\Embarcadero");
+  TEMSnapshotPtr Snapshot = TEMRegistrySnapshot::Create(Store, Roots,
+    TEMRegistrySnapshot::InstallationFilter);
+  TEMMemoryFileSystem FileSystem;
+  FileSystem.AddFile(L"C:\\Studio\\19.0\\bin\\GExperts.dll");
+  FileSystem.AddFile(L"C:\\CnPack\\CnWizards.dll");
+  TEMMacroCache MacroCache;
+  TEMInstallationScanner Scanner(Snapshot, FileSystem, MacroCache);
+  TEMInstallationResult Scanned = Scanner.Scan(strRegPath);
+  EMCheck(Scanned.Validation() == evInvalidPaths);
+  EMCheck(Scanned.Directories.size() == 3);
+  TEMScanCache Cache;
+  Cache.Update(1, Scanned);
+  EMCheck(Cache.Modified());
+  std::string strBuffer = Cache.SaveToBuffer();
+  TEMScanCache Loaded;
+  EMCheck(Loaded.LoadFromBuffer(strBuffer.data(), strBuffer.length()));
+  EMCheck(Loaded.Find(strRegPath, 2) == NULL);
+  const TEMScanCacheRecord* Record = Loaded.Find(strRegPath, 1);
+  EMCheck(Record != NULL);
+  if (Record == NULL)
+    return;
+  EMCheck(Record->eValidation == evInvalidPaths);
+  EMCheck(Record->Directories == Scanned.Directories);
+  TEMInstallationResult Restored;
+  EMCheck(TEMScanCache::Restore(*Record, Restored));
+  CheckEntries(*Scanned.Entries, *Restored.Entries);
+  // Updating with the same result changes nothing
+  Loaded.Update(1, Restored);
+  EMCheck(!Loaded.Modified());
+  // The missing package's directory appears so the installation is scanned again
+  FileSystem.AddFile(L"C:\\Missing\\Missing.bpl");
+  TEMInstallationResult Rescanned = EMRestoreInstallation(Scanner, *Record);
+  EMCheck(Rescanned.Validation() == evOkay);
+  EMCheck(Rescanned.iDirectoryStamp != Record->iDirectoryStamp);
+}
+
+/**
+
+  This function checks that truncated or corrupt cache file contents are rejected.
+
+  @precon  None.
+  @postcon Checks the loads.
+
+**/
+static void TestCorrupt() {
+  TEMFileRegistryStore Store;
+  Store.LoadFromUTF8(strRegistry);
+  TEMNameList Roots(1, L"Software\\Embarcadero");
+  TEMSnapshotPtr Snapshot = TEMRegistrySnapshot::Create(Store, Roots,
+    TEMRegistrySnapshot::InstallationFilter);
+  TEMMemoryFileSystem FileSystem;
+  TEMMacroCache MacroCache;
+  TEMInstallationScanner Scanner(Snapshot, FileSystem, MacroCache);
+  TEMScanCache Cache;
+  Cache.Update(1, Scanner.Scan(strRegPath));
+  std::string strBuffer = Cache.SaveToBuffer();
+  TEMScanCache Loaded;
+  EMCheck(!Loaded.LoadFromBuffer(strBuffer.data(), strBuffer.length() - 1));
+  EMCheck(Loaded.Count() == 0);
+  strBuffer[strBuffer.length() / 2] ^= 0x55;
+  EMCheck(!Loaded.LoadFromBuffer(strBuffer.data(), strBuffer.length()));
+  EMCheck(Loaded.Count() == 0);
+  TEMScanCacheRecord Record;
+  Record.strEntries = std::string("\x01\x00\x00\x00\x00", 5);
+  TEMInstallationResult Result;
+  EMCheck(!TEMScanCache::Restore(Record, Result));
+}
+
+int main() {
+  TestRestore();
+  TestCorrupt();
+  return EMTestResult("TestScanCache");
+}
@@ -0,0 +1,224 @@
+#include "ExpertManagerTests.h"
+#include "ExpertManagerSearchIndex.h"
+#include <algorithm>
+
+/** The registry text of an installation with an expert whose filename is only found once it is
+    expanded, an expert whose name and filename hold the trigrams ABC and BCD but not ABCD and a
+    package. **/
+static const char* strRegistry =
+  "[Software\\Embarcadero\\BDS\\19.0]\n"
+  "RootDir=C:\\Studio\\19.0\n"
+  "[Software\\Embarcadero\\BDS\\19.0\\Experts]\n"
+  "GExperts=$(BDS)\\bin\\GExperts.dll\n"
+  "CnPack=C:\\CnPack\\CnWizards.dll\n"
+  "XABC=C:\\Grams\\BCD.dll\n"
+  "[Software\\Embarcadero\\BDS\\19.0\\Known Packages]\n"
+  "C:\\Packages\\Package.bpl=Package\n";
+
+/** The registry path of the installation. **/
+static const std::wstring strRegPath = L"Software\\Embarcadero\\BDS\\19.0\\";
+
+/** This class holds the installation's entries and a search index of them. **/
+class TEMSearchFixture {
+  public:
+    TEMFileRegistryStore   Store;
+    TEMMemoryFileSystem    FileSystem;
+    TEMSnapshotPtr         Snapshot;
+    TEMMacroTablePtr       Macros;
+    TEMInstallationEntries Entries;
+    TEMSearchIndex         Index;
+    TEMSearchFixture() {
+      Store.LoadFromUTF8(strRegistry);
+      TEMNameList Roots(1, L"Software\\Embarcadero");
+      Snapshot = TEMRegistrySnapshot::Create(Store, Roots, TEMRegistrySnapshot::InstallationFilter);
+      Macros = TEMMacroTablePtr(new TEMMacroTable(*Snapshot, strRegPath));
+      Entries.Load(*Snapshot, strRegPath, *Macros, FileSystem);
+      Index.SetInstallation(0, Entries, *Macros);
+    };
+    /**
+
+      This method returns the ID of the entry with the given name.
+
+      @precon  None.
+      @postcon Returns the ID or -1 if not found.
+
+      @param   strName as a wchar_t pointer as a constant
+      @return  an int
+
+    **/
+    int FindEntry(const wchar_t* strName) const {
+      for (size_t i = 0; i < Entries.Count(); i++)
+        if (!Entries.Entry(i).boolDeleted && Entries.Entry(i).Name.Text() == strName)
+          return (int)i;
+      return -1;
+    };
+    /**
+
+      This method searches for the given query and returns the names of the entries found
+      (separated by spaces and sorted) so that the results can be compared whatever the order of
+      the documents.
+
+      @precon  None.
+      @postcon Returns the names of the entries found.
+
+      @param   strQuery as a wchar_t pointer as a constant
+      @return  a std::wstring
+
+    **/
+    std::wstring Search(const wchar_t* strQuery) const {
+      TEMUsageList Results;
+      Index.Search(strQuery, 100, Results);
+      TEMNameList Names;
+      for (size_t i = 0; i < Results.size(); i++)
+        Names.push_back(Entries.Entry(Results[i].iEntryID).Name.Text());
+      std::sort(Names.begin(), Names.end());
+      std::wstring strNames;
+      for (size_t i = 0; i < Names.size(); i++)
+        strNames += (i > 0 ? L" " : L"") + Names[i];
+      return strNames;
+    };
+    /**
+
+      This method changes the filename of the named entry and re-indexes it.
+
+      @precon  The entry must exist.
+      @postcon The entry is updated and re-indexed.
+
+      @param   strName     as a wchar_t pointer as a constant
+      @param   strFileName as a std::wstring as a constant reference
+
+    **/
+    void Rename(const wchar_t* strName, const std::wstring& strFileName) {
+      int iEntryID = FindEntry(strName);
+      TEMEntry Entry = Entries.Entry(iEntryID);
+      Entry.FileName = TEMPath(strFileName);
+      TEMEntryIDList Changed(1, iEntryID);
+      Entries.Update(iEntryID, Entry, Changed);
+      Index.UpdateEntries(0, Entries, Changed, *Macros);
+    };
+};
+
+/**
+
+  This function checks that queries shorter than a trigram are found by checking every document
+  (ignoring case) and that an empty query finds nothing.
+
+  @precon  None.
+  @postcon Checks the entries found.
+
+**/
+static void TestShortQueries() {
+  TEMSearchFixture Fixture;
+  EMCheck(Fixture.Index.Count() == 4);
+  EMCheck(Fixture.Search(L"cn") == L"CnPack");
+  EMCheck(Fixture.Search(L"Z") == L"CnPack");
+  EMCheck(Fixture.Search(L"bc") == L"XABC");
+  EMCheck(Fixture.Search(L"q") == L"");
+  EMCheck(Fixture.Search(L"") == L"");
+}
+
+/**
+
+  This function checks that longer queries are found by intersecting their trigrams' documents
+  and that a document holding all of a query's trigrams but not the query is not found.
+
+  @precon  None.
+  @postcon Checks the entries found.
+
+**/
+static void TestTrigrams() {
+  TEMSearchFixture Fixture;
+  EMCheck(Fixture.Search(L"wizards") == L"CnPack");
+  EMCheck(Fixture.Search(L"GEXPERTS") == L"GExperts");
+  EMCheck(Fixture.Search(L"package") == L"Package");
+  EMCheck(Fixture.Search(L".dll") == L"CnPack GExperts XABC");
+  EMCheck(Fixture.Search(L"abc") == L"XABC");
+  EMCheck(Fixture.Search(L"bcd") == L"XABC");
+  EMCheck(Fixture.Search(L"abcd") == L"");
+  EMCheck(Fixture.Search(L"xyzzy") == L"");
+}
+
+/**
+
+  This function checks that an entry is found by text which only occurs in its expanded filename
+  and that the unexpanded filename is searched too.
+
+  @precon  None.
+  @postcon Checks the entries found.
+
+**/
+static void TestExpandedFileName() {
+  TEMSearchFixture Fixture;
+  EMCheck(Fixture.Search(L"studio\\19.0\\BIN") == L"GExperts");
+  EMCheck(Fixture.Search(L"$(bds)") == L"GExperts");
+}
+
+/**
+
+  This function checks that the results are cut off at the maximum (for short and long queries)
+  and that true is only returned when there were more results than the maximum.
+
+  @precon  None.
+  @postcon Checks the results and the return values.
+
+**/
+static void TestMaxResults() {
+  TEMSearchFixture Fixture;
+  TEMUsageList Results;
+  EMCheck(!Fixture.Index.Search(L".dll", 3, Results) && Results.size() == 3);
+  EMCheck(Fixture.Index.Search(L".dll", 2, Results) && Results.size() == 2);
+  EMCheck(Fixture.Index.Search(L".dll", 0, Results) && Results.empty());
+  EMCheck(!Fixture.Index.Search(L"l", 4, Results) && Results.size() == 4);
+  EMCheck(Fixture.Index.Search(L"l", 1, Results) && Results.size() == 1);
+  EMCheck(!Fixture.Index.Search(L"xyzzy", 0, Results) && Results.empty());
+}
+
+/**
+
+  This function checks that re-indexed and deleted entries are found by their new text only and
+  that this is still so after the index has been compacted (renumbering its documents) and the
+  entries are re-indexed again.
+
+  @precon  None.
+  @postcon Checks the entries found and the number of live documents.
+
+**/
+static void TestUpdateAndCompact() {
+  TEMSearchFixture Fixture;
+  Fixture.Rename(L"CnPack", L"C:\\CnPack\\Renamed.dll");
+  EMCheck(Fixture.Search(L"wizards") == L"");
+  EMCheck(Fixture.Search(L"renamed") == L"CnPack");
+  int iGExperts = Fixture.FindEntry(L"GExperts");
+  TEMEntryIDList Changed(1, iGExperts);
+  Fixture.Entries.Remove(iGExperts, Changed);
+  Fixture.Index.UpdateEntries(0, Fixture.Entries, Changed, *Fixture.Macros);
+  EMCheck(Fixture.Search(L"gexperts") == L"");
+  EMCheck(Fixture.Index.Count() == 3);
+  // Replace more than enough documents for the index to be compacted
+  for (int i = 0; i < 1100; i++)
+    Fixture.Rename(L"CnPack", L"C:\\CnPack\\File" + std::to_wstring(i) + L".dll");
+  EMCheck(Fixture.Index.Count() == 3);
+  EMCheck(Fixture.Search(L"file1099.dll") == L"CnPack");
+  EMCheck(Fixture.Search(L"file1098.dll") == L"");
+  EMCheck(Fixture.Search(L".dll") == L"CnPack XABC");
+  EMCheck(Fixture.Search(L"package") == L"Package");
+  // The installation's documents must have been renumbered for these to be replaced
+  Fixture.Rename(L"XABC", L"C:\\Grams\\Moved.dll");
+  Fixture.Rename(L"CnPack", L"C:\\CnPack\\CnWizards.dll");
+  EMCheck(Fixture.Index.Count() == 3);
+  EMCheck(Fixture.Search(L".dll") == L"CnPack XABC");
+  EMCheck(Fixture.Search(L"bcd") == L"");
+  EMCheck(Fixture.Search(L"moved") == L"XABC");
+  EMCheck(Fixture.Search(L"wizards") == L"CnPack");
+  EMCheck(Fixture.Search(L"file1099") == L"");
+  EMCheck(Fixture.Search(L"package") == L"Package");
+}
+
+int main() {
+  TestShortQueries();
+  TestTrigrams();
+  TestExpandedFileName();
+  TestMaxResults();
+  TestUpdateAndCompact();
+  return EMTestResult("TestSearchIndex");
+}
@@ -0,0 +1,207 @@
+#include "ExpertManagerTests.h"
+#include "ExpertManagerUsageIndex.h"
+#include "ExpertManagerHeadless.h"
+#include <algorithm>
+#include <sstream>
+
+/** The registry text of two installations which both load the first's GExperts, the second also
+    loading a different file with the same filename and a package. **/
+static const char* strRegistry =
+  "[Software\\Embarcadero\\BDS\\19.0]\n"
+  "RootDir=C:\\Studio\\19.0\n"
+  "[Software\\Embarcadero\\BDS\\19.0\\Experts]\n"
+  "GExperts=$(BDS)\\bin\\GExperts.dll\n"
+  "CnPack=C:\\CnPack\\CnWizards.dll\n"
+  "[Software\\Embarcadero\\BDS\\20.0]\n"
+  "RootDir=C:\\Studio\\20.0\n"
+  "[Software\\Embarcadero\\BDS\\20.0\\Experts]\n"
+  "GExperts=C:\\Studio\\19.0\\bin\\gexperts.dll\n"
+  "Other=C:\\Other\\GExperts.dll\n"
+  "[Software\\Embarcadero\\BDS\\20.0\\Known Packages]\n"
+  "C:\\Packages\\Package.bpl=Package\n";
+
+/** The registry paths of the installations. **/
+static const std::wstring strRegPaths[2] = {L"Software\\Embarcadero\\BDS\\19.0\\",
+  L"Software\\Embarcadero\\BDS\\20.0\\"};
+
+/** This class holds the entries of both installations indexed by their position above. **/
+class TEMUsageFixture {
+  public:
+    TEMFileRegistryStore Store;
+    TEMMemoryFileSystem  FileSystem;
+    TEMSnapshotPtr       Snapshot;
+    TEMMacroTablePtr     Macros[2];
+    TEMEntriesPtr        Entries[2];
+    TEMUsageIndex        Index;
+    TEMUsageFixture() {
+      Store.LoadFromUTF8(strRegistry);
+      FileSystem.AddFile(L"C:\\Studio\\19.0\\bin\\GExperts.dll");
+      FileSystem.AddFile(L"C:\\CnPack\\CnWizards.dll");
+      FileSystem.AddFile(L"C:\\Other\\GExperts.dll");
+      TEMNameList Roots(1, L"Software\\Embarcadero");
+      Snapshot = TEMRegistrySnapshot::Create(Store, Roots, TEMRegistrySnapshot::InstallationFilter);
+      for (int i = 0; i < 2; i++) {
+        Macros[i] = TEMMacroTablePtr(new TEMMacroTable(*Snapshot, strRegPaths[i]));
+        Entries[i] = TEMEntriesPtr(new TEMInstallationEntries());
+        Entries[i]->Load(*Snapshot, strRegPaths[i], *Macros[i], FileSystem);
+        Index.SetInstallation(i, Entries[i], *Macros[i]);
+      }
+    };
+    /**
+
+      This method returns the ID of the entry of the given installation with the given name.
+
+      @precon  None.
+      @postcon Returns the ID or -1 if not found.
+
+      @param   iInstallationID as an int as a constant
+      @param   strName         as a wchar_t pointer as a constant
+      @return  an int
+
+    **/
+    int FindEntry(const int iInstallationID, const wchar_t* strName) const {
+      for (size_t i = 0; i < Entries[iInstallationID]->Count(); i++)
+        if (Entries[iInstallationID]->Entry(i).Name.Text() == strName)
+          return (int)i;
+      return -1;
+    };
+    /**
+
+      This method returns the given usages as "installation:name" separated by spaces in the
+      order of EMUsageLess.
+
+      @precon  None.
+      @postcon Returns the usages' description.
+
+      @param   Usages as a TEMUsageList as a constant reference
+      @return  a std::wstring
+
+    **/
+    std::wstring Describe(const TEMUsageList& Usages) const {
+      TEMUsageList Sorted = Usages;
+      std::sort(Sorted.begin(), Sorted.end(), EMUsageLess);
+      std::wstring strUsages;
+      for (size_t i = 0; i < Sorted.size(); i++)
+        strUsages += (i > 0 ? L" " : L"") + std::to_wstring(Sorted[i].iInstallationID) + L":" +
+          Index.Entries(Sorted[i].iInstallationID)->Entry(Sorted[i].iEntryID).Name.Text();
+      return strUsages;
+    };
+};
+
+/**
+
+  This function checks that entries are found by their filename (ignoring case and any path in
+  the query) and by their expanded path (ignoring case but not expanding the query).
+
+  @precon  None.
+  @postcon Checks the usages found.
+
+**/
+static void TestFind() {
+  TEMUsageFixture Fixture;
+  EMCheck(Fixture.Index.Count() == 2);
+  EMCheck(Fixture.Index.Indexed(1) && !Fixture.Index.Indexed(2));
+  const std::wstring strGExperts = L"0:GExperts 1:GExperts 1:Other";
+  EMCheck(Fixture.Describe(Fixture.Index.FindFileName(L"GExperts.dll")) == strGExperts);
+  EMCheck(Fixture.Describe(Fixture.Index.FindFileName(L"gexperts.DLL")) == strGExperts);
+  EMCheck(Fixture.Describe(Fixture.Index.FindFileName(L"D:\\Any\\GEXPERTS.dll")) == strGExperts);
+  EMCheck(Fixture.Describe(Fixture.Index.FindFileName(L"C:\\Packages\\Package.bpl")) ==
+    L"1:Package");
+  EMCheck(Fixture.Index.FindFileName(L"Missing.dll").empty());
+  EMCheck(Fixture.Describe(Fixture.Index.FindPath(L"c:\\studio\\19.0\\BIN\\GExperts.dll")) ==
+    L"0:GExperts 1:GExperts");
+  EMCheck(Fixture.Describe(Fixture.Index.FindPath(L"C:\\Other\\GExperts.dll")) == L"1:Other");
+  EMCheck(Fixture.Index.FindPath(L"$(BDS)\\bin\\GExperts.dll").empty());
+  EMCheck(Fixture.Index.FindPath(L"GExperts.dll").empty());
+}
+
+/**
+
+  This function checks that renaming an entry's file and deleting an entry moves and removes
+  them in the index once the entries are updated, and that removing an installation removes all
+  of its usages.
+
+  @precon  None.
+  @postcon Checks the usages found.
+
+**/
+static void TestUpdateEntries() {
+  TEMUsageFixture Fixture;
+  int iOther = Fixture.FindEntry(1, L"Other");
+  TEMEntry Entry = Fixture.Entries[1]->Entry(iOther);
+  Entry.FileName = TEMPath(L"C:\\Other\\Renamed.dll");
+  TEMEntryIDList Changed(1, iOther);
+  Fixture.Entries[1]->Update(iOther, Entry, Changed);
+  Fixture.Index.UpdateEntries(1, Changed, *Fixture.Macros[1]);
+  EMCheck(Fixture.Describe(Fixture.Index.FindFileName(L"GExperts.dll")) ==
+    L"0:GExperts 1:GExperts");
+  EMCheck(Fixture.Describe(Fixture.Index.FindFileName(L"Renamed.dll")) == L"1:Other");
+  EMCheck(Fixture.Index.FindPath(L"C:\\Other\\GExperts.dll").empty());
+  EMCheck(Fixture.Describe(Fixture.Index.FindPath(L"C:\\Other\\Renamed.dll")) == L"1:Other");
+  int iGExperts = Fixture.FindEntry(0, L"GExperts");
+  Changed.assign(1, iGExperts);
+  Fixture.Entries[0]->Remove(iGExperts, Changed);
+  Fixture.Index.UpdateEntries(0, Changed, *Fixture.Macros[0]);
+  EMCheck(Fixture.Describe(Fixture.Index.FindFileName(L"GExperts.dll")) == L"1:GExperts");
+  EMCheck(Fixture.Describe(Fixture.Index.FindPath(L"C:\\Studio\\19.0\\bin\\GExperts.dll")) ==
+    L"1:GExperts");
+  Fixture.Index.RemoveInstallation(1);
+  EMCheck(Fixture.Index.FindFileName(L"GExperts.dll").empty());
+  EMCheck(Fixture.Describe(Fixture.Index.FindFileName(L"CnWizards.dll")) == L"0:CnPack");
+}
+
+/**
+
+  This function returns the number of lines in the given text.
+
+  @precon  None.
+  @postcon Returns the number of newlines.
+
+  @param   strText as a std::string as a constant reference
+  @return  a size_t
+
+**/
+static size_t Lines(const std::string& strText) {
+  return (size_t)std::count(strText.begin(), strText.end(), '\n');
+}
+
+/**
+
+  This function checks that the headless used by command finds the entries by filename or (when
+  given a path) by expanded path and writes them in the order of the installations.
+
+  @precon  None.
+  @postcon Checks the number of usages and the JSON lines written.
+
+**/
+static void TestHeadlessUsedBy() {
+  TEMUsageFixture Fixture;
+  std::ostringstream FileNameStream;
+  EMCheck(EMHeadlessUsedBy(Fixture.Store, Fixture.FileSystem, L"gexperts.dll", FileNameStream,
+    2) == 3);
+  const std::string strFileNames = FileNameStream.str();
+  EMCheck(Lines(strFileNames) == 3);
+  size_t iFirst = strFileNames.find("\"name\":\"GExperts\"");
+  size_t iOther = strFileNames.find("\"name\":\"Other\"");
+  EMCheck(iFirst != std::string::npos && iOther != std::string::npos && iFirst < iOther);
+  EMCheck(strFileNames.find("BDS\\\\19.0") < strFileNames.find("BDS\\\\20.0"));
+  EMCheck(strFileNames.find("\"file\":\"gexperts.dll\"") != std::string::npos);
+  std::ostringstream PathStream;
+  EMCheck(EMHeadlessUsedBy(Fixture.Store, Fixture.FileSystem,
+    L"C:\\Studio\\19.0\\bin\\GExperts.dll", PathStream, 2) == 2);
+  const std::string strPaths = PathStream.str();
+  EMCheck(Lines(strPaths) == 2);
+  EMCheck(strPaths.find("\"name\":\"Other\"") == std::string::npos);
+  EMCheck(strPaths.find("\"fileName\":\"$(BDS)\\\\bin\\\\GExperts.dll\"") != std::string::npos);
+  std::ostringstream MissingStream;
+  EMCheck(EMHeadlessUsedBy(Fixture.Store, Fixture.FileSystem, L"Missing.dll", MissingStream,
+    2) == 0);
+  EMCheck(MissingStream.str().empty());
+}
+
+int main() {
+  TestFind();
+  TestUpdateEntries();
+  TestHeadlessUsedBy();
+  return EMTestResult("TestUsageIndex");
+}
@@ -0,0 +1,82 @@
+#include "ExpertManagerTests.h"
+#include "ExpertManagerWorkerPool.h"
+#include <stdexcept>
+
+/**
+
+  This function checks that every job submitted to the pool has an outcome: it either runs to
+  completion or its failure function is called with the message of the exception it raised.
+
+  @precon  None.
+  @postcon Checks the outcomes of the jobs.
+
+**/
+static void TestOutcomes() {
+  const int iJobs = 1000;
+  TEMResultQueue<int> Results;
+  std::atomic<int> iFailed(0);
+  size_t iFailures = 0;
+  std::vector<int> Items, Done;
+  {
+    TEMWorkerPool WorkerPool(4);
+    for (int i = 0; i < iJobs; i++)
+      WorkerPool.Submit([&Results, i]() {
+        if (i % 7 == 0)
+          throw std::runtime_error("Job failed");
+        Results.Push(i);
+      }, [&Results, &iFailed, i](const std::string& strMessage) {
+        if (strMessage == "Job failed")
+          iFailed++;
+        Results.Push(-i - 1);
+      });
+    WorkerPool.Submit([]() { throw 1; });
+    while (Done.size() < (size_t)iJobs)
+      if (Results.Drain(Items, 1000))
+        Done.insert(Done.end(), Items.begin(), Items.end());
+      else
+        break;
+    iFailures = WorkerPool.Failures();
+  }
+  EMCheck(Done.size() == (size_t)iJobs);
+  EMCheck(iFailed == (iJobs + 6) / 7);
+  EMCheck(iFailures == (size_t)iFailed || iFailures == (size_t)iFailed + 1);
+  std::vector<bool> Seen(iJobs, false);
+  for (int i : Done)
+    Seen[i < 0 ? -i - 1 : i] = true;
+  bool boolAllSeen = true;
+  for (size_t i = 0; i < Seen.size(); i++)
+    boolAllSeen = boolAllSeen && Seen[i];
+  EMCheck(boolAllSeen);
+}
+
+/**
+
+  This function checks that a low priority job waits until the normal priority jobs queued with it
+  have been taken.
+
+  @precon  None.
+  @postcon Checks the order in which the jobs ran.
+
+**/
+static void TestPriority() {
+  TEMResultQueue<int> Results;
+  std::atomic<bool> boolRelease(false);
+  std::vector<int> Items, Done;
+  TEMWorkerPool WorkerPool(1);
+  WorkerPool.Submit([&boolRelease]() {
+    while (!boolRelease)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  });
+  WorkerPool.Submit([&Results]() { Results.Push(2); }, TEMJobFailed(), jpLow);
+  WorkerPool.Submit([&Results]() { Results.Push(1); });
+  boolRelease = true;
+  while (Done.size() < 2 && Results.Drain(Items, 1000))
+    Done.insert(Done.end(), Items.begin(), Items.end());
+  EMCheck(Done.size() == 2 && Done[0] == 1 && Done[1] == 2);
+}
+
+int main() {
+  TestOutcomes();
+  TestPriority();
+  return EMTestResult("TestWorkerPool");
+}
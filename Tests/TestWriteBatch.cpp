@@ -0,0 +1,127 @@
+#include "ExpertManagerTests.h"
+#include "ExpertManagerWriteBatch.h"
+
+/** The registry path of the installation. **/
+static const std::wstring strRegPath = L"Software\\Embarcadero\\BDS\\19.0";
+
+/** A memory registry store which fails to write the named value so that a batch can be made to
+    fail part of the way through. **/
+class TEMFailingRegistryStore : public TEMMemoryRegistryStore {
+  private:
+    std::wstring FFailName;
+  public:
+    TEMFailingRegistryStore(const std::wstring& strFailName) : FFailName(strFailName) {};
+    bool WriteValue(const std::wstring& strName, const std::wstring& strValue) {
+      if (EMSameText(strName, FFailName))
+        return false;
+      return TEMMemoryRegistryStore::WriteValue(strName, strValue);
+    };
+};
+
+/**
+
+  This function fills the given store with an installation whose Experts key has an expandable
+  string, a DWORD and a string value.
+
+  @precon  None.
+  @postcon The installation's keys and values are in the store.
+
+  @param   Store as a TEMMemoryRegistryStore as a reference
+
+**/
+static void FillStore(TEMMemoryRegistryStore& Store) {
+  Store.SetValue(strRegPath, L"RootDir", L"C:\\Studio\\19.0");
+  Store.SetValue(strRegPath + L"\\Experts", L"GExperts", L"$(BDS)\\bin\\GExperts.dll",
+    rvExpandString);
+  Store.SetValue(strRegPath + L"\\Experts", L"Count", L"31", rvDWord);
+  Store.SetValue(strRegPath + L"\\Experts", L"CnPack", L"C:\\CnPack\\CnWizards.dll");
+}
+
+/**
+
+  This function queues changes to the values of the Experts key and to keys which do not exist
+  (ending with a write of the named value) in the given batch.
+
+  @precon  None.
+  @postcon The mutations are queued.
+
+  @param   Batch   as a TEMRegistryWriteBatch as a reference
+  @param   strLast as a std::wstring as a constant reference
+
+**/
+static void QueueChanges(TEMRegistryWriteBatch& Batch, const std::wstring& strLast) {
+  Batch.WriteString(strRegPath + L"\\Experts", L"GExperts", L"C:\\GExperts\\GExperts.dll");
+  Batch.WriteString(strRegPath + L"\\Experts", L"Count", L"1");
+  Batch.DeleteValue(strRegPath + L"\\Experts", L"CnPack");
+  Batch.WriteString(strRegPath + L"\\Experts\\Disabled\\Deep", L"Old", L"C:\\Old.dll");
+  Batch.WriteString(strRegPath + L"\\Known Packages", strLast, L"Package");
+}
+
+/**
+
+  This function checks that a batch which fails part of the way through leaves the values (with
+  their types) and the keys of the store as they were.
+
+  @precon  None.
+  @postcon Checks the store after the rollback.
+
+**/
+static void TestRollback() {
+  TEMFailingRegistryStore Store(L"C:\\Fail.bpl");
+  FillStore(Store);
+  TEMRegistryWriteBatch Batch;
+  QueueChanges(Batch, L"C:\\Fail.bpl");
+  EMCheck(!Batch.Apply(Store));
+  EMCheck(Batch.Count() == 5);
+  TEMNameList Keys;
+  TEMRegValueList Values;
+  EMCheck(Store.ReadKey(strRegPath, Keys, Values));
+  EMCheck(Keys == TEMNameList(1, L"Experts"));
+  EMCheck(Store.ReadKey(strRegPath + L"\\Experts", Keys, Values));
+  EMCheck(Keys.empty());
+  EMCheck(Values.size() == 3);
+  EMCheck(!Store.ReadKey(strRegPath + L"\\Experts\\Disabled", Keys, Values));
+  EMCheck(!Store.ReadKey(strRegPath + L"\\Known Packages", Keys, Values));
+  EMCheck(Store.OpenKey(strRegPath + L"\\Experts", false));
+  std::wstring strValue;
+  EMCheck(Store.ReadValue(L"GExperts", strValue) && strValue == L"$(BDS)\\bin\\GExperts.dll");
+  EMCheck(Store.ReadValue(L"Count", strValue) && strValue == L"31");
+  EMCheck(Store.ReadValue(L"CnPack", strValue) && strValue == L"C:\\CnPack\\CnWizards.dll");
+  Store.CloseKey();
+  EMCheck(Store.ValueType(strRegPath + L"\\Experts", L"GExperts") == rvExpandString);
+  EMCheck(Store.ValueType(strRegPath + L"\\Experts", L"Count") == rvDWord);
+  EMCheck(Store.ValueType(strRegPath + L"\\Experts", L"CnPack") == rvString);
+}
+
+/**
+
+  This function checks that a batch which succeeds writes all its mutations and is emptied.
+
+  @precon  None.
+  @postcon Checks the store after the batch.
+
+**/
+static void TestApply() {
+  TEMMemoryRegistryStore Store;
+  FillStore(Store);
+  TEMRegistryWriteBatch Batch;
+  QueueChanges(Batch, L"C:\\Package.bpl");
+  EMCheck(Batch.Apply(Store));
+  EMCheck(Batch.Count() == 0);
+  TEMNameList Keys;
+  TEMRegValueList Values;
+  EMCheck(Store.ReadKey(strRegPath + L"\\Experts", Keys, Values));
+  EMCheck(Keys == TEMNameList(1, L"Disabled"));
+  EMCheck(Values.size() == 2);
+  EMCheck(Store.ReadKey(strRegPath + L"\\Experts\\Disabled\\Deep", Keys, Values));
+  EMCheck(Values.size() == 1 && Values[0].second == L"C:\\Old.dll");
+  EMCheck(Store.ValueType(strRegPath + L"\\Experts", L"GExperts") == rvString);
+  EMCheck(Store.ValueType(strRegPath + L"\\Experts", L"CnPack") == 0);
+  EMCheck(Store.ValueType(strRegPath + L"\\Known Packages", L"C:\\Package.bpl") == rvString);
+}
+
+int main() {
+  TestRollback();
+  TestApply();
+  return EMTestResult("TestWriteBatch");
+}